@@ -358,34 +358,36 @@ extern "C" int gtatool_combine(int argc, char *argv[])
             {
                 array_loops[i].start_element_loop(element_loops[i], hdri[i], hdro);
             }
-            blob element_buf(checked_cast<size_t>(hdro.element_size()));
             std::vector<size_t> component_offsets(hdro.components());
-            for (uintmax_t e = 0; e < hdro.elements(); e++)
+            for (uintmax_t c = 1; c < hdro.components(); c++)
             {
-                for (uintmax_t c = 0; c < hdro.components(); c++)
-                {
-                    component_offsets[c] = static_cast<const char*>(hdro.component(element_buf.ptr(), c))
-                        - element_buf.ptr<const char>();
-                }
+                component_offsets[c] = component_offsets[c - 1] + checked_cast<size_t>(hdro.component_size(c - 1));
             }
-            std::vector<const void*> element_ptrs(arguments.size());
+            size_t element_size = checked_cast<size_t>(hdro.element_size());
+            std::vector<const void*> batch_ptrs(arguments.size());
             std::vector<const void*> component_ptrs(arguments.size());
-            for (uintmax_t e = 0; e < hdro.elements(); e++)
+            size_t n;
+            while ((n = element_loops[0].read_batch(&batch_ptrs[0])) > 0)
             {
-                for (size_t i = 0; i < arguments.size(); i++)
+                // all arrays have the same element size and therefore the same batches
+                for (size_t i = 1; i < arguments.size(); i++)
                 {
-                    element_ptrs[i] = element_loops[i].read();
+                    element_loops[i].read_batch(&batch_ptrs[i]);
                 }
-                for (uintmax_t c = 0; c < hdro.components(); c++)
+                char *dst = static_cast<char*>(element_loops[0].out_batch(n));
+                for (size_t j = 0; j < n; j++)
                 {
-                    for (size_t i = 0; i < arguments.size(); i++)
+                    for (uintmax_t c = 0; c < hdro.components(); c++)
                     {
-                        component_ptrs[i] = static_cast<const char*>(element_ptrs[i]) + component_offsets[c];
+                        for (size_t i = 0; i < arguments.size(); i++)
+                        {
+                            component_ptrs[i] = static_cast<const char*>(batch_ptrs[i]) + j * element_size + component_offsets[c];
+                        }
+                        combine(hdro.component_type(c), m, force.value(), arguments.size(), &component_ptrs[0],
+                                static_cast<void*>(dst + j * element_size + component_offsets[c]));
                     }
-                    combine(hdro.component_type(c), m, force.value(), arguments.size(), &component_ptrs[0],
-                            static_cast<void*>(element_buf.ptr<char>(component_offsets[c])));
                 }
-                element_loops[0].write(element_buf.ptr());
+                element_loops[0].write(dst, n);
             }
         }
         array_loops[0].finish();
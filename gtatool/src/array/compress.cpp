@@ -37,11 +37,16 @@
 extern "C" void gtatool_compress_help(void)
 {
     msg::req_txt(
-            "compress [-m|--method=zlib[1-9]|bzip2|xz] [<files>...]\n"
+            "compress [-m|--method=zlib[1-9]|bzip2|xz|zstd[1-19]|lz4] [-f|--filter=none|shuffle|bitshuffle|delta] [<files>...]\n"
             "\n"
-            "Compresses GTAs, with method zlib, bzip2, or xz. The default method is bzip2.\n"
-            "The zlib method can optionally be followed by the compression level (1-9). If no level is specified, "
-            "the default level is used.");
+            "Compresses GTAs, with method zlib, bzip2, xz, zstd, or lz4. The default method is bzip2.\n"
+            "The zlib and zstd methods can optionally be followed by the compression level (1-9 for zlib, "
+            "1-19 for zstd). If no level is specified, the default level is used.\n"
+            "The zstd and lz4 methods are only available if libgta was built with support for them.\n"
+            "The filter rearranges the array data before compression, which often improves the compression "
+            "ratio of numerical data: shuffle groups the bytes of all elements by their position, bitshuffle "
+            "does the same for single bits, and delta stores differences of consecutive elements. "
+            "The default is none.");
 }
 
 extern "C" int gtatool_compress(int argc, char *argv[])
@@ -62,8 +67,21 @@ extern "C" int gtatool_compress(int argc, char *argv[])
     methods.push_back("zlib9");
     methods.push_back("bzip2");
     methods.push_back("xz");
+    methods.push_back("zstd");
+    for (int level = 1; level <= 19; level++)
+    {
+        methods.push_back("zstd" + str::from(level));
+    }
+    methods.push_back("lz4");
     opt::val<std::string> method("method", 'm', opt::optional, methods, "bzip2");
     options.push_back(&method);
+    std::vector<std::string> filters;
+    filters.push_back("none");
+    filters.push_back("shuffle");
+    filters.push_back("bitshuffle");
+    filters.push_back("delta");
+    opt::val<std::string> filter("filter", 'f', opt::optional, filters, "none");
+    options.push_back(&filter);
     std::vector<std::string> arguments;
     if (!opt::parse(argc, argv, options, -1, -1, arguments))
     {
@@ -86,7 +104,15 @@ extern "C" int gtatool_compress(int argc, char *argv[])
          : method.value().compare("zlib8") == 0 ? gta::zlib8
          : method.value().compare("zlib9") == 0 ? gta::zlib9
          : method.value().compare("bzip2") == 0 ? gta::bzip2
-         : gta::xz);
+         : method.value().compare("xz") == 0 ? gta::xz
+         : method.value().compare("zstd") == 0 ? gta::zstd
+         : method.value().compare("lz4") == 0 ? gta::lz4
+         : static_cast<gta::compression>(gta::zstd1 + str::to<int>(method.value().substr(4)) - 1));
+    gta::filter pre_filter =
+        (  filter.value().compare("shuffle") == 0 ? gta::filter_shuffle
+         : filter.value().compare("bitshuffle") == 0 ? gta::filter_bitshuffle
+         : filter.value().compare("delta") == 0 ? gta::filter_delta
+         : gta::filter_none);
 
     try
     {
@@ -98,6 +124,7 @@ extern "C" int gtatool_compress(int argc, char *argv[])
         {
             hdro = hdri;
             hdro.set_compression(compression);
+            hdro.set_filter(pre_filter);
             array_loop.write(hdro, nameo);
             array_loop.copy_data(hdri, hdro);
         }
@@ -263,28 +263,36 @@ extern "C" int gtatool_diff(int argc, char *argv[])
             element_loop_t element_loops[2];
             array_loops[0].start_element_loop(element_loops[0], hdri[0], hdro);
             array_loops[1].start_element_loop(element_loops[1], hdri[1], hdro);
-            blob element_buf(checked_cast<size_t>(hdro.element_size()));
+            size_t element_size = checked_cast<size_t>(hdro.element_size());
             std::vector<size_t> component_offsets(hdro.components());
-            for (uintmax_t e = 0; e < hdro.elements(); e++)
+            size_t component_offset = 0;
+            for (uintmax_t c = 0; c < hdro.components(); c++)
             {
-                for (uintmax_t c = 0; c < hdro.components(); c++)
-                {
-                    component_offsets[c] = static_cast<const char*>(hdro.component(element_buf.ptr(), c))
-                        - element_buf.ptr<const char>();
-                }
+                component_offsets[c] = component_offset;
+                component_offset += checked_cast<size_t>(hdro.component_size(c));
             }
-            for (uintmax_t e = 0; e < hdro.elements(); e++)
+            // both inputs have the same element size, so they share the same batches
+            const void* b0;
+            const void* b1;
+            size_t n;
+            while ((n = element_loops[0].read_batch(&b0)) > 0)
             {
-                const void* e0 = element_loops[0].read();
-                const void* e1 = element_loops[1].read();
-                for (uintmax_t c = 0; c < hdro.components(); c++)
+                element_loops[1].read_batch(&b1);
+                char* dst = static_cast<char*>(element_loops[0].out_batch(n));
+                for (size_t j = 0; j < n; j++)
                 {
-                    diff(hdro.component_type(c), absolute.value(), force.value(),
-                            static_cast<const void*>(static_cast<const char*>(e0) + component_offsets[c]),
-                            static_cast<const void*>(static_cast<const char*>(e1) + component_offsets[c]),
-                            static_cast<void*>(element_buf.ptr<char>(component_offsets[c])));
+                    const char* e0 = static_cast<const char*>(b0) + j * element_size;
+                    const char* e1 = static_cast<const char*>(b1) + j * element_size;
+                    char* eo = dst + j * element_size;
+                    for (uintmax_t c = 0; c < hdro.components(); c++)
+                    {
+                        diff(hdro.component_type(c), absolute.value(), force.value(),
+                                static_cast<const void*>(e0 + component_offsets[c]),
+                                static_cast<const void*>(e1 + component_offsets[c]),
+                                static_cast<void*>(eo + component_offsets[c]));
+                    }
                 }
-                element_loops[0].write(element_buf.ptr());
+                element_loops[0].write(dst, n);
             }
         }
         array_loops[0].finish();
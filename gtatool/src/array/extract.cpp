@@ -117,22 +117,35 @@ extern "C" int gtatool_extract(int argc, char *argv[])
             element_loop_t element_loop;
             std::vector<uintmax_t> index(hdro.dimensions());
             array_loop.start_element_loop(element_loop, hdri, hdro);
-            for (uintmax_t e = 0; e < hdri.elements(); e++)
+            size_t element_size = checked_cast<size_t>(hdri.element_size());
+            uintmax_t e = 0;
+            const void *src;
+            size_t n;
+            while ((n = element_loop.read_batch(&src)) > 0)
             {
-                const void *src = element_loop.read();
-                hdri.linear_index_to_indices(e, &(index[0]));
-                bool in_sub_array = true;
-                for (size_t i = 0; i < index.size(); i++)
+                char *dst = static_cast<char *>(element_loop.out_batch(n));
+                size_t m = 0;
+                for (size_t j = 0; j < n; j++, e++)
                 {
-                    if (index[i] < low.value()[i] || index[i] > high.value()[i])
+                    hdri.linear_index_to_indices(e, &(index[0]));
+                    bool in_sub_array = true;
+                    for (size_t i = 0; i < index.size(); i++)
                     {
-                        in_sub_array = false;
-                        break;
+                        if (index[i] < low.value()[i] || index[i] > high.value()[i])
+                        {
+                            in_sub_array = false;
+                            break;
+                        }
+                    }
+                    if (in_sub_array)
+                    {
+                        std::memcpy(dst + m * element_size, static_cast<const char *>(src) + j * element_size, element_size);
+                        m++;
                     }
                 }
-                if (in_sub_array)
+                if (m > 0)
                 {
-                    element_loop.write(src);
+                    element_loop.write(dst, m);
                 }
             }
         }
@@ -22,6 +22,7 @@
 #include "config.h"
 
 #include <sstream>
+#include <cstring>
 #include <cstdio>
 #include <cctype>
 
@@ -126,23 +127,33 @@ extern "C" int gtatool_fill(int argc, char *argv[])
                 element_loop_t element_loop;
                 std::vector<uintmax_t> index(hdri.dimensions());
                 array_loop.start_element_loop(element_loop, hdri, hdro);
-                for (uintmax_t e = 0; e < hdro.elements(); e++)
+                size_t element_size = checked_cast<size_t>(hdro.element_size());
+                uintmax_t e = 0;
+                const void *src;
+                size_t n;
+                while ((n = element_loop.read_batch(&src)) > 0)
                 {
-                    const void *src = element_loop.read();
-                    hdro.linear_index_to_indices(e, &(index[0]));
-                    bool replace = true;
-                    if (!low.values().empty())
+                    char *dst = static_cast<char *>(element_loop.out_batch(n));
+                    for (size_t j = 0; j < n; j++, e++)
                     {
-                        for (size_t i = 0; i < index.size(); i++)
+                        hdro.linear_index_to_indices(e, &(index[0]));
+                        bool replace = true;
+                        if (!low.values().empty())
                         {
-                            if (index[i] < low.value()[i] || index[i] > high.value()[i])
+                            for (size_t i = 0; i < index.size(); i++)
                             {
-                                replace = false;
-                                break;
+                                if (index[i] < low.value()[i] || index[i] > high.value()[i])
+                                {
+                                    replace = false;
+                                    break;
+                                }
                             }
                         }
+                        std::memcpy(dst + j * element_size,
+                                replace ? v.ptr() : static_cast<const char *>(src) + j * element_size,
+                                element_size);
                     }
-                    element_loop.write(replace ? v.ptr() : src);
+                    element_loop.write(dst, n);
                 }
             }
         }
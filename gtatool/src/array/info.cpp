@@ -89,236 +89,248 @@ extern "C" int gtatool_info(int argc, char *argv[])
                 sum.resize(checked_cast<size_t>(hdr.components()), 0.0);
                 squaresum.resize(checked_cast<size_t>(hdr.components()), 0.0);
                 valid_values.resize(checked_cast<size_t>(hdr.components()), 0);
-                element_loop_t element_loop;
-                array_loop.start_element_loop(element_loop, hdr, hdr);
-                for (uintmax_t e = 0; e < hdr.elements(); e++)
+                union nodata_value_t
                 {
-                    const void *element = element_loop.read();
-                    for (uintmax_t c = 0; c < hdr.components(); c++)
-                    {
-                        union
-                        {
-                            int8_t int8_v;
-                            uint8_t uint8_v;
-                            int16_t int16_v;
-                            uint16_t uint16_v;
-                            int32_t int32_v;
-                            uint32_t uint32_v;
-                            int64_t int64_v;
-                            uint64_t uint64_v;
-#ifdef HAVE_INT128_T
-                            int128_t int128_v;
-#endif
-#ifdef HAVE_UINT128_T
-                            uint128_t uint128_v;
-#endif
-                            float float_v;
-                            double double_v;
-#ifdef HAVE_FLOAT128_T
-                            float128_t float128_v;
-#endif
-                        } nodata_value;
-                        bool have_nodata_value = false;
-                        const char* tagval = hdr.component_taglist(c).get("NO_DATA_VALUE");
-                        if (tagval)
-                        {
-                            switch (hdr.component_type(c))
-                            {
-                            case gta::int8:
-                                have_nodata_value = (str::to(tagval, &nodata_value.int8_v) == 0);
-                                break;
-                            case gta::uint8:
-                                have_nodata_value = (str::to(tagval, &nodata_value.uint8_v) == 0);
-                                break;
-                            case gta::int16:
-                                have_nodata_value = (str::to(tagval, &nodata_value.int16_v) == 0);
-                                break;
-                            case gta::uint16:
-                                have_nodata_value = (str::to(tagval, &nodata_value.uint16_v) == 0);
-                                break;
-                            case gta::int32:
-                                have_nodata_value = (str::to(tagval, &nodata_value.int32_v) == 0);
-                                break;
-                            case gta::uint32:
-                                have_nodata_value = (str::to(tagval, &nodata_value.uint32_v) == 0);
-                                break;
-                            case gta::int64:
-                                have_nodata_value = (str::to(tagval, &nodata_value.int64_v) == 0);
-                                break;
-                            case gta::uint64:
-                                have_nodata_value = (str::to(tagval, &nodata_value.uint64_v) == 0);
-                                break;
+                    int8_t int8_v;
+                    uint8_t uint8_v;
+                    int16_t int16_v;
+                    uint16_t uint16_v;
+                    int32_t int32_v;
+                    uint32_t uint32_v;
+                    int64_t int64_v;
+                    uint64_t uint64_v;
 #ifdef HAVE_INT128_T
-                            case gta::int128:
-                                have_nodata_value = (str::to(tagval, &nodata_value.int128_v) == 0);
-                                break;
+                    int128_t int128_v;
 #endif
 #ifdef HAVE_UINT128_T
-                            case gta::uint128:
-                                have_nodata_value = (str::to(tagval, &nodata_value.uint128_v) == 0);
-                                break;
+                    uint128_t uint128_v;
 #endif
-                            case gta::float32:
-                            case gta::cfloat32:
-                                have_nodata_value = (str::to(tagval, &nodata_value.float_v) == 0);
-                                break;
-                            case gta::float64:
-                            case gta::cfloat64:
-                                have_nodata_value = (str::to(tagval, &nodata_value.double_v) == 0);
-                                break;
+                    float float_v;
+                    double double_v;
 #ifdef HAVE_FLOAT128_T
-                            case gta::float128:
-                            case gta::cfloat128:
-                                have_nodata_value = (str::to(tagval, &nodata_value.double_v) == 0);
-                                break;
+                    float128_t float128_v;
 #endif
-                            default:
-                                throw exc(std::string("cannot handle NO_DATA_VALUE for component type ")
-                                        + type_to_string(hdr.component_type(c), hdr.component_size(c)));
-                                break;
-                            }
-                        }
-                        const void *component = hdr.component(element, c);
-                        double val = std::numeric_limits<double>::quiet_NaN();
+                };
+                std::vector<nodata_value_t> nodata_values(checked_cast<size_t>(hdr.components()));
+                std::vector<bool> have_nodata_values(checked_cast<size_t>(hdr.components()), false);
+                for (uintmax_t c = 0; c < hdr.components(); c++)
+                {
+                    const char* tagval = hdr.component_taglist(c).get("NO_DATA_VALUE");
+                    if (tagval)
+                    {
                         switch (hdr.component_type(c))
                         {
                         case gta::int8:
-                            {
-                                int8_t v;
-                                memcpy(&v, component, sizeof(int8_t));
-                                if (!have_nodata_value || v != nodata_value.int8_v)
-                                    val = v;
-                            }
+                            have_nodata_values[c] = (str::to(tagval, &nodata_values[c].int8_v) == 0);
                             break;
                         case gta::uint8:
-                            {
-                                uint8_t v;
-                                memcpy(&v, component, sizeof(uint8_t));
-                                if (!have_nodata_value || v != nodata_value.uint8_v)
-                                    val = v;
-                            }
+                            have_nodata_values[c] = (str::to(tagval, &nodata_values[c].uint8_v) == 0);
                             break;
                         case gta::int16:
-                            {
-                                int16_t v;
-                                memcpy(&v, component, sizeof(int16_t));
-                                if (!have_nodata_value || v != nodata_value.int16_v)
-                                    val = v;
-                            }
+                            have_nodata_values[c] = (str::to(tagval, &nodata_values[c].int16_v) == 0);
                             break;
                         case gta::uint16:
-                            {
-                                uint16_t v;
-                                memcpy(&v, component, sizeof(uint16_t));
-                                if (!have_nodata_value || v != nodata_value.uint16_v)
-                                    val = v;
-                            }
+                            have_nodata_values[c] = (str::to(tagval, &nodata_values[c].uint16_v) == 0);
                             break;
                         case gta::int32:
-                            {
-                                int32_t v;
-                                memcpy(&v, component, sizeof(int32_t));
-                                if (!have_nodata_value || v != nodata_value.int32_v)
-                                    val = v;
-                            }
+                            have_nodata_values[c] = (str::to(tagval, &nodata_values[c].int32_v) == 0);
                             break;
                         case gta::uint32:
-                            {
-                                uint32_t v;
-                                memcpy(&v, component, sizeof(uint32_t));
-                                if (!have_nodata_value || v != nodata_value.uint32_v)
-                                    val = v;
-                            }
+                            have_nodata_values[c] = (str::to(tagval, &nodata_values[c].uint32_v) == 0);
                             break;
                         case gta::int64:
-                            {
-                                int64_t v;
-                                memcpy(&v, component, sizeof(int64_t));
-                                if (!have_nodata_value || v != nodata_value.int64_v)
-                                    val = v;
-                            }
+                            have_nodata_values[c] = (str::to(tagval, &nodata_values[c].int64_v) == 0);
                             break;
                         case gta::uint64:
-                            {
-                                uint64_t v;
-                                memcpy(&v, component, sizeof(uint64_t));
-                                if (!have_nodata_value || v != nodata_value.uint64_v)
-                                    val = v;
-                            }
+                            have_nodata_values[c] = (str::to(tagval, &nodata_values[c].uint64_v) == 0);
                             break;
 #ifdef HAVE_INT128_T
                         case gta::int128:
-                            {
-                                int128_t v;
-                                memcpy(&v, component, sizeof(int128_t));
-                                if (!have_nodata_value || v != nodata_value.int128_v)
-                                    val = v;
-                            }
+                            have_nodata_values[c] = (str::to(tagval, &nodata_values[c].int128_v) == 0);
                             break;
 #endif
 #ifdef HAVE_UINT128_T
                         case gta::uint128:
-                            {
-                                uint128_t v;
-                                memcpy(&v, component, sizeof(uint128_t));
-                                if (!have_nodata_value || v != nodata_value.uint128_v)
-                                    val = v;
-                            }
+                            have_nodata_values[c] = (str::to(tagval, &nodata_values[c].uint128_v) == 0);
                             break;
 #endif
                         case gta::float32:
                         case gta::cfloat32:
-                            {
-                                float v;
-                                memcpy(&v, component, sizeof(float));
-                                if (!have_nodata_value || std::memcmp(&v, &nodata_value.float_v, sizeof(float)) != 0)
-                                    val = v;
-                            }
+                            have_nodata_values[c] = (str::to(tagval, &nodata_values[c].float_v) == 0);
                             break;
                         case gta::float64:
                         case gta::cfloat64:
-                            {
-                                double v;
-                                memcpy(&v, component, sizeof(double));
-                                if (!have_nodata_value || std::memcmp(&v, &nodata_value.double_v, sizeof(double)) != 0)
-                                    val = v;
-                            }
+                            have_nodata_values[c] = (str::to(tagval, &nodata_values[c].double_v) == 0);
                             break;
 #ifdef HAVE_FLOAT128_T
                         case gta::float128:
                         case gta::cfloat128:
-                            {
-                                float128_t v;
-                                memcpy(&v, component, sizeof(float128_t));
-                                if (!have_nodata_value || std::memcmp(&v, &nodata_value.double_v, sizeof(float128_t)) != 0)
-                                    val = v;
-                            }
+                            have_nodata_values[c] = (str::to(tagval, &nodata_values[c].double_v) == 0);
                             break;
 #endif
                         default:
-                            throw exc(std::string("cannot compute minimum/maximum for component type ")
+                            throw exc(std::string("cannot handle NO_DATA_VALUE for component type ")
                                     + type_to_string(hdr.component_type(c), hdr.component_size(c)));
                             break;
                         }
-                        if (std::isfinite(val))
+                    }
+                }
+                element_loop_t element_loop;
+                array_loop.start_element_loop(element_loop, hdr, hdr);
+                size_t element_size = checked_cast<size_t>(hdr.element_size());
+                const void *elements;
+                size_t n;
+                while ((n = element_loop.read_batch(&elements)) > 0)
+                {
+                    for (size_t j = 0; j < n; j++)
+                    {
+                        const void *element = static_cast<const char *>(elements) + j * element_size;
+                        for (uintmax_t c = 0; c < hdr.components(); c++)
                         {
-                            if (valid_values[c] == 0)
+                            const nodata_value_t &nodata_value = nodata_values[c];
+                            bool have_nodata_value = have_nodata_values[c];
+                            const void *component = hdr.component(element, c);
+                            double val = std::numeric_limits<double>::quiet_NaN();
+                            switch (hdr.component_type(c))
                             {
-                                minima[c] = val;
-                                maxima[c] = val;
-                                sum[c] = val;
-                                squaresum[c] = val * val;
+                            case gta::int8:
+                                {
+                                    int8_t v;
+                                    memcpy(&v, component, sizeof(int8_t));
+                                    if (!have_nodata_value || v != nodata_value.int8_v)
+                                        val = v;
+                                }
+                                break;
+                            case gta::uint8:
+                                {
+                                    uint8_t v;
+                                    memcpy(&v, component, sizeof(uint8_t));
+                                    if (!have_nodata_value || v != nodata_value.uint8_v)
+                                        val = v;
+                                }
+                                break;
+                            case gta::int16:
+                                {
+                                    int16_t v;
+                                    memcpy(&v, component, sizeof(int16_t));
+                                    if (!have_nodata_value || v != nodata_value.int16_v)
+                                        val = v;
+                                }
+                                break;
+                            case gta::uint16:
+                                {
+                                    uint16_t v;
+                                    memcpy(&v, component, sizeof(uint16_t));
+                                    if (!have_nodata_value || v != nodata_value.uint16_v)
+                                        val = v;
+                                }
+                                break;
+                            case gta::int32:
+                                {
+                                    int32_t v;
+                                    memcpy(&v, component, sizeof(int32_t));
+                                    if (!have_nodata_value || v != nodata_value.int32_v)
+                                        val = v;
+                                }
+                                break;
+                            case gta::uint32:
+                                {
+                                    uint32_t v;
+                                    memcpy(&v, component, sizeof(uint32_t));
+                                    if (!have_nodata_value || v != nodata_value.uint32_v)
+                                        val = v;
+                                }
+                                break;
+                            case gta::int64:
+                                {
+                                    int64_t v;
+                                    memcpy(&v, component, sizeof(int64_t));
+                                    if (!have_nodata_value || v != nodata_value.int64_v)
+                                        val = v;
+                                }
+                                break;
+                            case gta::uint64:
+                                {
+                                    uint64_t v;
+                                    memcpy(&v, component, sizeof(uint64_t));
+                                    if (!have_nodata_value || v != nodata_value.uint64_v)
+                                        val = v;
+                                }
+                                break;
+#ifdef HAVE_INT128_T
+                            case gta::int128:
+                                {
+                                    int128_t v;
+                                    memcpy(&v, component, sizeof(int128_t));
+                                    if (!have_nodata_value || v != nodata_value.int128_v)
+                                        val = v;
+                                }
+                                break;
+#endif
+#ifdef HAVE_UINT128_T
+                            case gta::uint128:
+                                {
+                                    uint128_t v;
+                                    memcpy(&v, component, sizeof(uint128_t));
+                                    if (!have_nodata_value || v != nodata_value.uint128_v)
+                                        val = v;
+                                }
+                                break;
+#endif
+                            case gta::float32:
+                            case gta::cfloat32:
+                                {
+                                    float v;
+                                    memcpy(&v, component, sizeof(float));
+                                    if (!have_nodata_value || std::memcmp(&v, &nodata_value.float_v, sizeof(float)) != 0)
+                                        val = v;
+                                }
+                                break;
+                            case gta::float64:
+                            case gta::cfloat64:
+                                {
+                                    double v;
+                                    memcpy(&v, component, sizeof(double));
+                                    if (!have_nodata_value || std::memcmp(&v, &nodata_value.double_v, sizeof(double)) != 0)
+                                        val = v;
+                                }
+                                break;
+#ifdef HAVE_FLOAT128_T
+                            case gta::float128:
+                            case gta::cfloat128:
+                                {
+                                    float128_t v;
+                                    memcpy(&v, component, sizeof(float128_t));
+                                    if (!have_nodata_value || std::memcmp(&v, &nodata_value.double_v, sizeof(float128_t)) != 0)
+                                        val = v;
+                                }
+                                break;
+#endif
+                            default:
+                                throw exc(std::string("cannot compute minimum/maximum for component type ")
+                                        + type_to_string(hdr.component_type(c), hdr.component_size(c)));
+                                break;
                             }
-                            else
+                            if (std::isfinite(val))
                             {
-                                if (val < minima[c])
+                                if (valid_values[c] == 0)
+                                {
                                     minima[c] = val;
-                                else if (val > maxima[c])
                                     maxima[c] = val;
-                                sum[c] += val;
-                                squaresum[c] += val * val;
+                                    sum[c] = val;
+                                    squaresum[c] = val * val;
+                                }
+                                else
+                                {
+                                    if (val < minima[c])
+                                        minima[c] = val;
+                                    else if (val > maxima[c])
+                                        maxima[c] = val;
+                                    sum[c] += val;
+                                    squaresum[c] += val * val;
+                                }
+                                valid_values[c]++;
                             }
-                            valid_values[c]++;
                         }
                     }
                 }
@@ -381,7 +393,14 @@ extern "C" int gtatool_info(int argc, char *argv[])
                      : hdr.compression() == gta::zlib6 ? "zlib level 6"
                      : hdr.compression() == gta::zlib7 ? "zlib level 7"
                      : hdr.compression() == gta::zlib8 ? "zlib level 8"
-                     : hdr.compression() == gta::zlib9 ? "zlib level 9" : "unknown"));
+                     : hdr.compression() == gta::zlib9 ? "zlib level 9"
+                     : hdr.compression() == gta::zstd ? "zstd default level"
+                     : hdr.compression() >= gta::zstd1 && hdr.compression() <= gta::zstd19
+                       ? "zstd level " + str::from(hdr.compression() - gta::zstd1 + 1)
+                     : hdr.compression() == gta::lz4 ? "lz4" : "unknown")
+                    + (hdr.filter() == gta::filter_shuffle ? ", filter: shuffle"
+                     : hdr.filter() == gta::filter_bitshuffle ? ", filter: bitshuffle"
+                     : hdr.filter() == gta::filter_delta ? ", filter: delta" : ""));
             if (hdr.components() > 0)
             {
                 msg::req(4, dimensions.str() + " elements of type " + components.str());
@@ -176,26 +176,37 @@ extern "C" int gtatool_merge(int argc, char *argv[])
             array_loops[0].write(hdro, nameo);
             if (hdro.data_size() > 0)
             {
-                std::vector<uintmax_t> indices(hdro.dimensions());
                 std::vector<element_loop_t> element_loops(arguments.size());
                 for (size_t i = 0; i < element_loops.size(); i++)
                 {
                     array_loops[i].start_element_loop(element_loops[i], hdri[i], hdro);
                 }
-                for (uintmax_t e = 0; e < hdro.elements(); e++)
+                // Consecutive elements that share the index in the merge dimension
+                // come from the same input, so copy them in runs.
+                uintmax_t stride = 1;
+                for (uintmax_t d = 0; d < dimension.value(); d++)
                 {
-                    hdro.linear_index_to_indices(e, &(indices[0]));
+                    stride *= hdro.dimension_size(d);
+                }
+                size_t max_run = element_loop_t::batch_size(hdro.element_size());
+                uintmax_t e = 0;
+                while (e < hdro.elements())
+                {
+                    uintmax_t index = (e / stride) % hdro.dimension_size(dimension.value());
                     uintmax_t dim = 0;
                     size_t j;
                     for (j = 0; j < arguments.size(); j++)
                     {
                         dim += hdri[j].dimension_size(dimension.value());
-                        if (indices[dimension.value()] < dim)
+                        if (index < dim)
                         {
                             break;
                         }
                     }
-                    element_loops[0].write(element_loops[j].read());
+                    uintmax_t run = stride - e % stride;
+                    size_t n = (run < max_run ? run : max_run);
+                    element_loops[0].write(element_loops[j].read(n), n);
+                    e += n;
                 }
             }
         }
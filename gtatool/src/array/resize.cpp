@@ -23,6 +23,7 @@
 
 #include <sstream>
 #include <cstdio>
+#include <cstring>
 #include <cctype>
 
 #include <gta/gta.hpp>
@@ -118,54 +119,67 @@ extern "C" int gtatool_resize(int argc, char *argv[])
             if (hdro.data_size() > 0)
             {
                 element_loop_t element_loop;
-                uintmax_t read_in_elements = 0;
                 std::vector<intmax_t> in_index(hdri.dimensions());
                 std::vector<uintmax_t> out_index(hdro.dimensions());
                 array_loop.start_element_loop(element_loop, hdri, hdro);
-                for (uintmax_t linear_out_index = 0; linear_out_index < hdro.elements(); linear_out_index++)
+                size_t element_size = checked_cast<size_t>(hdro.element_size());
+                size_t batch_size = element_loop_t::batch_size(hdro.element_size());
+                const void *in_batch = NULL;
+                uintmax_t in_batch_start = 0;   // linear index of the first element in in_batch
+                size_t in_batch_size = 0;
+                for (uintmax_t linear_out_index = 0; linear_out_index < hdro.elements();)
                 {
-                    hdro.linear_index_to_indices(linear_out_index, &(out_index[0]));
-                    bool from_input = true;
-                    for (uintmax_t i = 0; i < hdri.dimensions(); i++)
+                    size_t n = (hdro.elements() - linear_out_index < batch_size
+                            ? hdro.elements() - linear_out_index : batch_size);
+                    char *dst = static_cast<char *>(element_loop.out_batch(n));
+                    for (size_t j = 0; j < n; j++, linear_out_index++)
                     {
-                        if (!index.values().empty())
+                        hdro.linear_index_to_indices(linear_out_index, &(out_index[0]));
+                        bool from_input = true;
+                        for (uintmax_t i = 0; i < hdri.dimensions(); i++)
                         {
-                            in_index[i] = checked_sub(checked_cast<intmax_t>(out_index[i]), index.value()[i]);
+                            if (!index.values().empty())
+                            {
+                                in_index[i] = checked_sub(checked_cast<intmax_t>(out_index[i]), index.value()[i]);
+                            }
+                            else
+                            {
+                                in_index[i] = out_index[i];
+                            }
+                            if (in_index[i] < 0 || static_cast<uintmax_t>(in_index[i]) >= hdri.dimension_size(i))
+                            {
+                                from_input = false;
+                            }
                         }
-                        else
-                        {
-                            in_index[i] = out_index[i];
-                        }
-                        if (in_index[i] < 0 || static_cast<uintmax_t>(in_index[i]) >= hdri.dimension_size(i))
-                        {
-                            from_input = false;
-                        }
-                    }
-                    const void *src = NULL;
-                    if (from_input)
-                    {
-                        std::vector<uintmax_t> requested_in_index(in_index.size());
-                        for (size_t i = 0; i < requested_in_index.size(); i++)
+                        const void *src = NULL;
+                        if (from_input)
                         {
-                            requested_in_index[i] = in_index[i];
+                            std::vector<uintmax_t> requested_in_index(in_index.size());
+                            for (size_t i = 0; i < requested_in_index.size(); i++)
+                            {
+                                requested_in_index[i] = in_index[i];
+                            }
+                            uintmax_t requested_linear_in_index = hdri.indices_to_linear_index(&(requested_in_index[0]));
+                            // elements are guaranteed to be in ascending order
+                            while (requested_linear_in_index >= in_batch_start + in_batch_size)
+                            {
+                                in_batch_start += in_batch_size;
+                                in_batch_size = element_loop.read_batch(&in_batch);
+                            }
+                            src = static_cast<const char *>(in_batch)
+                                + (requested_linear_in_index - in_batch_start) * element_size;
                         }
-                        uintmax_t requested_linear_in_index = hdri.indices_to_linear_index(&(requested_in_index[0]));
-                        // elements are guaranteed to be in ascending order
-                        for (uintmax_t i = read_in_elements; i <= requested_linear_in_index; i++)
+                        else
                         {
-                            src = element_loop.read();
+                            src = v.ptr();
                         }
-                        read_in_elements = requested_linear_in_index + 1;
-                    }
-                    else
-                    {
-                        src = v.ptr();
+                        std::memcpy(dst + j * element_size, src, element_size);
                     }
-                    element_loop.write(src);
+                    element_loop.write(dst, n);
                 }
-                for (uintmax_t i = read_in_elements; i < hdri.elements(); i++)
+                // skip the remaining input elements
+                while (element_loop.read_batch(&in_batch) > 0)
                 {
-                    element_loop.read();
                 }
             }
         }
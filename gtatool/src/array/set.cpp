@@ -23,6 +23,7 @@
 
 #include <sstream>
 #include <cstdio>
+#include <cstring>
 #include <cctype>
 
 #include <gta/gta.hpp>
@@ -114,51 +115,63 @@ extern "C" int gtatool_set(int argc, char *argv[])
             {
                 element_loop_t element_loop;
                 element_loop_t element_loop_src;
-                uintmax_t read_src_elements = 0;
                 std::vector<intmax_t> src_index(hdr_src.dimensions());
                 std::vector<uintmax_t> out_index(hdro.dimensions());
                 array_loop.start_element_loop(element_loop, hdri, hdro);
                 array_loop_src.start_element_loop(element_loop_src, hdr_src, gta::header());
-                for (uintmax_t linear_out_index = 0; linear_out_index < hdro.elements(); linear_out_index++)
+                size_t element_size = checked_cast<size_t>(hdro.element_size());
+                const void *src_batch = NULL;
+                uintmax_t src_batch_start = 0;  // linear index of the first element in src_batch
+                size_t src_batch_size = 0;
+                uintmax_t linear_out_index = 0;
+                const void *batch;
+                size_t n;
+                while ((n = element_loop.read_batch(&batch)) > 0)
                 {
-                    hdro.linear_index_to_indices(linear_out_index, &(out_index[0]));
-                    bool from_src = true;
-                    for (uintmax_t i = 0; i < hdr_src.dimensions(); i++)
+                    char *dst = static_cast<char *>(element_loop.out_batch(n));
+                    std::memcpy(dst, batch, n * element_size);
+                    for (size_t j = 0; j < n; j++, linear_out_index++)
                     {
-                        if (!index.values().empty())
+                        hdro.linear_index_to_indices(linear_out_index, &(out_index[0]));
+                        bool from_src = true;
+                        for (uintmax_t i = 0; i < hdr_src.dimensions(); i++)
                         {
-                            src_index[i] = checked_sub(checked_cast<intmax_t>(out_index[i]), index.value()[i]);
+                            if (!index.values().empty())
+                            {
+                                src_index[i] = checked_sub(checked_cast<intmax_t>(out_index[i]), index.value()[i]);
+                            }
+                            else
+                            {
+                                src_index[i] = out_index[i];
+                            }
+                            if (src_index[i] < 0 || static_cast<uintmax_t>(src_index[i]) >= hdr_src.dimension_size(i))
+                            {
+                                from_src = false;
+                            }
                         }
-                        else
+                        if (from_src)
                         {
-                            src_index[i] = out_index[i];
+                            std::vector<uintmax_t> requested_src_index(src_index.size());
+                            for (size_t i = 0; i < requested_src_index.size(); i++)
+                            {
+                                requested_src_index[i] = src_index[i];
+                            }
+                            uintmax_t requested_linear_src_index = hdr_src.indices_to_linear_index(&(requested_src_index[0]));
+                            // elements are guaranteed to be in ascending order
+                            while (requested_linear_src_index >= src_batch_start + src_batch_size)
+                            {
+                                src_batch_start += src_batch_size;
+                                src_batch_size = element_loop_src.read_batch(&src_batch);
+                            }
+                            std::memcpy(dst + j * element_size, static_cast<const char *>(src_batch)
+                                    + (requested_linear_src_index - src_batch_start) * element_size, element_size);
                         }
-                        if (src_index[i] < 0 || static_cast<uintmax_t>(src_index[i]) >= hdr_src.dimension_size(i))
-                        {
-                            from_src = false;
-                        }
-                    }
-                    const void *src = element_loop.read();
-                    if (from_src)
-                    {
-                        std::vector<uintmax_t> requested_src_index(src_index.size());
-                        for (size_t i = 0; i < requested_src_index.size(); i++)
-                        {
-                            requested_src_index[i] = src_index[i];
-                        }
-                        uintmax_t requested_linear_src_index = hdr_src.indices_to_linear_index(&(requested_src_index[0]));
-                        // elements are guaranteed to be in ascending order
-                        for (uintmax_t i = read_src_elements; i <= requested_linear_src_index; i++)
-                        {
-                            src = element_loop_src.read();
-                        }
-                        read_src_elements = requested_linear_src_index + 1;
                     }
-                    element_loop.write(src);
+                    element_loop.write(dst, n);
                 }
-                for (uintmax_t i = read_src_elements; i < hdr_src.elements(); i++)
+                // skip the remaining input elements
+                while (element_loop_src.read_batch(&src_batch) > 0)
                 {
-                    element_loop_src.read();
                 }
             }
             array_loop_src.finish();
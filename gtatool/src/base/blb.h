@@ -133,6 +133,16 @@ public:
         _size = 0;
     }
 
+    void swap(blob& b) throw ()
+    {
+        size_t size = _size;
+        void* ptr = _ptr;
+        _size = b._size;
+        _ptr = b._ptr;
+        b._size = size;
+        b._ptr = ptr;
+    }
+
     void resize(size_t s)
     {
         _size = s;
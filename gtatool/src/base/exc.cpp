@@ -109,6 +109,22 @@ exc::~exc() throw ()
 {
 }
 
+exc &exc::operator=(const exc &e) throw ()
+{
+    _fallback = e._fallback;
+    _sys_errno = e._sys_errno;
+    try
+    {
+        _str = e._str;
+    }
+    catch (...)
+    {
+        _fallback = true;
+        _sys_errno = ENOMEM;
+    }
+    return *this;
+}
+
 bool exc::empty() const throw ()
 {
     return (_str.length() == 0 && _sys_errno == 0 && !_fallback);
@@ -65,6 +65,8 @@ class exc : public std::exception
         exc(const std::exception &e) throw ();
         ~exc() throw ();
 
+        exc &operator=(const exc &e) throw ();
+
         bool empty() const throw ();
         int sys_errno() const throw ();
         virtual const char *what() const throw ();
@@ -33,7 +33,9 @@ namespace msg
     static level_t _level = WRN;
     static int _columns = 80;
     static std::string _program_name("");
-    static std::string _category_name("");
+    // The category name is set per thread, so that threads that run different
+    // commands can mark their messages.
+    static __thread std::string *_category_name = NULL;
 
     /* Get / Set configuration */
 
@@ -97,12 +99,13 @@ namespace msg
 
     std::string category_name()
     {
-        return _category_name;
+        return (_category_name ? *_category_name : std::string());
     }
 
     void set_category_name(const std::string &n)
     {
-        _category_name = n;
+        delete _category_name;
+        _category_name = (n.empty() ? NULL : new std::string(n));
     }
 
     /* Print messages */
@@ -110,18 +113,19 @@ namespace msg
     static std::string prefix(level_t level)
     {
         static const char *_level_prefixes[] = { "[dbg] ", "[inf] ", "[wrn] ", "[err] ", "" };
+        std::string category = category_name();
 
-        if (!_program_name.empty() && !_category_name.empty())
+        if (!_program_name.empty() && !category.empty())
         {
-            return _program_name + ": " + _level_prefixes[level] + _category_name + ": ";
+            return _program_name + ": " + _level_prefixes[level] + category + ": ";
         }
-        else if (!_program_name.empty() && _category_name.empty())
+        else if (!_program_name.empty() && category.empty())
         {
             return _program_name + ": " + _level_prefixes[level];
         }
-        else if (_program_name.empty() && !_category_name.empty())
+        else if (_program_name.empty() && !category.empty())
         {
-            return _level_prefixes[level] + _category_name + ": ";
+            return _level_prefixes[level] + category + ": ";
         }
         else
         {
@@ -59,6 +59,8 @@ namespace msg
     void set_columns_from_env();
     std::string program_name();
     void set_program_name(const std::string &n);
+    // The category name applies to the calling thread only. Setting an empty
+    // name frees the memory used by the thread.
     std::string category_name();
     void set_category_name(const std::string &n);
 
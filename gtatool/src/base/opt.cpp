@@ -33,6 +33,7 @@
 #include "base/dbg.h"
 #include "base/msg.h"
 #include "base/opt.h"
+#include "base/pth.h"
 
 #include "base/gettext.h"
 #define _(string) gettext(string)
@@ -40,6 +41,10 @@
 
 namespace opt
 {
+    /* getopt_long() uses global state. Commands that run in different threads
+     * must not parse their options at the same time. */
+    static mutex getopt_mutex;
+
     bool parse(int argc, char *argv[],
             std::vector<option *> &options,
             int min_arguments, int max_arguments,
@@ -149,6 +154,7 @@ namespace opt
             option_was_seen[i] = false;
         }
         error = false;
+        mutex_locker getopt_lock(getopt_mutex);
         opterr = 0;
         optind = 1;
 #if defined HAVE_DECL_OPTRESET && HAVE_DECL_OPTRESET
@@ -101,6 +101,33 @@ public:
     friend class condition;
 };
 
+/*
+ * Scoped mutex lock
+ *
+ * Locks the mutex on construction and unlocks it on destruction, so that the
+ * mutex is also unlocked when an exception is thrown.
+ */
+
+class mutex_locker
+{
+private:
+    mutex& _mutex;
+
+    mutex_locker(const mutex_locker&);
+    mutex_locker& operator=(const mutex_locker&);
+
+public:
+    mutex_locker(mutex& m) : _mutex(m)
+    {
+        _mutex.lock();
+    }
+
+    ~mutex_locker()
+    {
+        _mutex.unlock();
+    }
+};
+
 
 /*
  * Wait condition
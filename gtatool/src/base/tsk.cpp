@@ -0,0 +1,472 @@
+/*
+ * Copyright (C) 2015
+ * Martin Lambers <marlam@marlam.de>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <vector>
+#include <algorithm>
+
+#if HAVE_SYSCONF
+#  include <unistd.h>
+#else
+#  include <windows.h>
+#endif
+
+#include "base/pth.h"
+#include "base/tsk.h"
+
+
+namespace tsk
+{
+    static unsigned int _threads = 0;
+
+    unsigned int processors()
+    {
+        static long n = -1;
+        if (n < 0)
+        {
+#if HAVE_SYSCONF
+            n = sysconf(_SC_NPROCESSORS_ONLN);
+#else
+            SYSTEM_INFO si;
+            GetSystemInfo(&si);
+            n = si.dwNumberOfProcessors;
+#endif
+            if (n < 1)
+            {
+                n = 1;
+            }
+        }
+        return n;
+    }
+
+    unsigned int threads()
+    {
+        return (_threads > 0 ? _threads : processors());
+    }
+
+    void set_threads(unsigned int n)
+    {
+        _threads = n;
+    }
+
+    /*
+     * The pool of worker threads.
+     *
+     * A single mutex protects all queues and task states. Tasks are expected to be
+     * coarse enough that this is not a bottleneck.
+     */
+
+    class pool;
+
+    class worker : public thread
+    {
+    private:
+        pool& _pool;
+        int _index;
+
+    public:
+        worker(pool& p, int index) : _pool(p), _index(index)
+        {
+        }
+
+        void run();
+    };
+
+    // The index of the worker that runs in this thread, or -1 if this thread is
+    // not a worker.
+    static __thread int _worker_index = -1;
+
+    class pool
+    {
+    private:
+        mutex _mutex;
+        condition _cond;
+        std::deque<task*> _queue;       // tasks from threads that are not workers
+        std::vector<std::deque<task*> > _worker_queues;
+        std::vector<worker*> _workers;
+
+        // Take the next task for the current thread, or return NULL. The mutex must
+        // be locked. Workers take the newest task from their own queue first, and
+        // steal the oldest task from other queues.
+        task* take()
+        {
+            task* t = NULL;
+            if (_worker_index >= 0 && !_worker_queues[_worker_index].empty())
+            {
+                t = _worker_queues[_worker_index].back();
+                _worker_queues[_worker_index].pop_back();
+            }
+            else if (!_queue.empty())
+            {
+                t = _queue.front();
+                _queue.pop_front();
+            }
+            else
+            {
+                size_t n = _worker_queues.size();
+                for (size_t i = 1; i <= n; i++)
+                {
+                    size_t j = (_worker_index + i) % n;
+                    if (!_worker_queues[j].empty())
+                    {
+                        t = _worker_queues[j].front();
+                        _worker_queues[j].pop_front();
+                        break;
+                    }
+                }
+            }
+            return t;
+        }
+
+        // Execute the task and mark it as finished. The mutex must be locked; it is
+        // unlocked while the task runs.
+        void execute(task* t)
+        {
+            _mutex.unlock();
+            try
+            {
+                t->run();
+            }
+            catch (exc& e)
+            {
+                t->_exception = e;
+            }
+            catch (std::exception& e)
+            {
+                t->_exception = e;
+            }
+            catch (...)
+            {
+                t->_exception = exc("unknown exception");
+            }
+            _mutex.lock();
+            group* g = t->_group;
+            if (!t->_exception.empty() && g->_exception.empty())
+            {
+                g->_exception = t->_exception;
+            }
+            t->_done = true;
+            g->_pending--;
+            _cond.wake_all();
+        }
+
+    public:
+        pool(int workers) : _mutex(), _cond(), _queue(), _worker_queues(workers), _workers()
+        {
+            for (int i = 0; i < workers; i++)
+            {
+                _workers.push_back(new worker(*this, i));
+                _workers.back()->start();
+            }
+        }
+
+        void run(group* g, task* t)
+        {
+            _mutex.lock();
+            t->_group = g;
+            t->_done = false;
+            t->_exception = exc();
+            g->_pending++;
+            if (_worker_index >= 0)
+            {
+                _worker_queues[_worker_index].push_back(t);
+            }
+            else
+            {
+                _queue.push_back(t);
+            }
+            _cond.wake_all();
+            _mutex.unlock();
+        }
+
+        bool done(const task* t)
+        {
+            _mutex.lock();
+            bool d = t->_done;
+            _mutex.unlock();
+            return d;
+        }
+
+        // Wait until the task t is finished or, if t is NULL, until all tasks of
+        // the group are finished. Execute other tasks in the meantime.
+        void wait(const group* g, const task* t)
+        {
+            _mutex.lock();
+            while (t ? !t->_done : g->_pending > 0)
+            {
+                task* u = take();
+                if (u)
+                {
+                    execute(u);
+                }
+                else
+                {
+                    _cond.wait(_mutex);
+                }
+            }
+            _mutex.unlock();
+        }
+
+        void work(int index)
+        {
+            _worker_index = index;
+            _mutex.lock();
+            for (;;)
+            {
+                task* t = take();
+                if (t)
+                {
+                    execute(t);
+                }
+                else
+                {
+                    _cond.wait(_mutex);
+                }
+            }
+        }
+    };
+
+    void worker::run()
+    {
+        _pool.work(_index);
+    }
+
+    // The pool is created on first use and lives until the process exits.
+    static mutex _pool_mutex;
+    static pool* _pool = NULL;
+
+    static pool& get_pool()
+    {
+        _pool_mutex.lock();
+        if (!_pool)
+        {
+            try
+            {
+                // The thread that waits for tasks is one of the threads.
+                _pool = new pool(threads() - 1);
+            }
+            catch (...)
+            {
+                _pool_mutex.unlock();
+                throw;
+            }
+        }
+        _pool_mutex.unlock();
+        return *_pool;
+    }
+
+    /*
+     * Task
+     */
+
+    task::task() : _group(NULL), _done(false), _exception()
+    {
+    }
+
+    task::~task()
+    {
+    }
+
+    /*
+     * Task group
+     */
+
+    group::group() : _pending(0), _exception()
+    {
+    }
+
+    group::~group()
+    {
+        if (_pool)
+        {
+            try
+            {
+                _pool->wait(this, NULL);
+            }
+            catch (...)
+            {
+            }
+        }
+    }
+
+    void group::run(task* t)
+    {
+        if (threads() <= 1)
+        {
+            t->_group = this;
+            t->_done = false;
+            t->_exception = exc();
+            try
+            {
+                t->run();
+            }
+            catch (exc& e)
+            {
+                t->_exception = e;
+            }
+            catch (std::exception& e)
+            {
+                t->_exception = e;
+            }
+            catch (...)
+            {
+                t->_exception = exc("unknown exception");
+            }
+            if (!t->_exception.empty() && _exception.empty())
+            {
+                _exception = t->_exception;
+            }
+            t->_done = true;
+        }
+        else
+        {
+            get_pool().run(this, t);
+        }
+    }
+
+    bool group::done(const task* t)
+    {
+        return (_pool ? _pool->done(t) : t->_done);
+    }
+
+    void group::wait(const task* t)
+    {
+        if (_pool)
+        {
+            _pool->wait(this, t);
+        }
+    }
+
+    void group::wait()
+    {
+        if (_pool)
+        {
+            _pool->wait(this, NULL);
+        }
+        if (!_exception.empty())
+        {
+            exc e(_exception);
+            _exception = exc();
+            throw e;
+        }
+    }
+
+    /*
+     * Parallel for loop
+     */
+
+    class range_task : public task
+    {
+    public:
+        range_function* f;
+        size_t begin;
+        size_t end;
+
+        range_task() : f(NULL), begin(0), end(0)
+        {
+        }
+
+        void run()
+        {
+            (*f)(begin, end);
+        }
+    };
+
+    void parallel_for(size_t begin, size_t end, range_function& f, size_t grain)
+    {
+        if (end <= begin)
+        {
+            return;
+        }
+        size_t n = end - begin;
+        grain = std::max(grain, static_cast<size_t>(1));
+        // Use more parts than threads so that uneven parts are balanced.
+        size_t parts = std::min(static_cast<size_t>(4) * threads(), n / grain + (n % grain > 0 ? 1 : 0));
+        if (parts <= 1)
+        {
+            f(begin, end);
+            return;
+        }
+        std::vector<range_task> tasks(parts);
+        group g;
+        for (size_t i = 0; i < parts; i++)
+        {
+            tasks[i].f = &f;
+            tasks[i].begin = begin + i * (n / parts) + std::min(i, n % parts);
+            tasks[i].end = tasks[i].begin + n / parts + (i < n % parts ? 1 : 0);
+            g.run(&tasks[i]);
+        }
+        g.wait();
+    }
+
+    /*
+     * Ordered pipeline
+     */
+
+    ordered_pipeline::ordered_pipeline(size_t max_tasks) :
+        _group(), _tasks(), _max_tasks(max_tasks > 0 ? max_tasks : 2 * threads())
+    {
+    }
+
+    ordered_pipeline::~ordered_pipeline()
+    {
+        try
+        {
+            _group.wait();
+        }
+        catch (...)
+        {
+        }
+        for (size_t i = 0; i < _tasks.size(); i++)
+        {
+            delete _tasks[i];
+        }
+    }
+
+    void ordered_pipeline::push(task* t)
+    {
+        _tasks.push_back(t);
+        _group.run(t);
+    }
+
+    task* ordered_pipeline::pop(bool wait)
+    {
+        if (_tasks.empty())
+        {
+            return NULL;
+        }
+        task* t = _tasks.front();
+        if (!_group.done(t))
+        {
+            if (!wait)
+            {
+                return NULL;
+            }
+            _group.wait(t);
+        }
+        _tasks.pop_front();
+        if (!t->exception().empty())
+        {
+            exc e(t->exception());
+            delete t;
+            throw e;
+        }
+        return t;
+    }
+}
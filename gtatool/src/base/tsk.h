@@ -0,0 +1,176 @@
+/*
+ * Copyright (C) 2015
+ * Martin Lambers <marlam@marlam.de>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file tsk.h
+ *
+ * Tasks that are executed by a process-wide pool of worker threads.
+ *
+ * Each worker thread has its own task queue. Tasks that are submitted from a
+ * worker thread go into its own queue, and idle workers steal tasks from the
+ * queues of other workers. A thread that waits for tasks executes queued tasks
+ * in the meantime, so tasks can submit and wait for other tasks.
+ */
+
+#ifndef TSK_H
+#define TSK_H
+
+#include <cstddef>
+#include <deque>
+
+#include "base/exc.h"
+
+
+namespace tsk
+{
+    /* Number of threads */
+
+    // The number of processors that are online.
+    unsigned int processors();
+    // The number of threads that work on tasks, including a thread that waits
+    // for tasks. The default is the number of processors.
+    unsigned int threads();
+    // Set the number of threads. This must be done before the first task is run.
+    void set_threads(unsigned int n);
+
+    class group;
+
+    /*
+     * Task
+     *
+     * Implement the run() function in a subclass. Exceptions should be derived
+     * from std::exception; they are stored in the task. Other exceptions are
+     * stored as an unknown exception.
+     */
+
+    class task
+    {
+    private:
+        group *_group;
+        bool _done;
+        exc _exception;
+
+        friend class group;
+        friend class pool;
+
+    public:
+        task();
+        virtual ~task();
+
+        virtual void run() = 0;
+
+        // Get an exception that the run() function might have thrown.
+        const exc& exception() const
+        {
+            return _exception;
+        }
+    };
+
+    /*
+     * Task group
+     *
+     * A group runs tasks in the pool and waits for them. The tasks are not
+     * owned by the group and must exist until they are finished.
+     */
+
+    class group
+    {
+    private:
+        size_t _pending;
+        exc _exception;
+
+        friend class pool;
+
+    public:
+        group();
+        // Waits for the remaining tasks, but does not throw.
+        ~group();
+
+        // Run the task. If there is only one thread, the task is executed
+        // immediately.
+        void run(task* t);
+        // Return whether the given task of this group is finished.
+        bool done(const task* t);
+        // Wait until the given task of this group is finished.
+        void wait(const task* t);
+        // Wait until all tasks of this group are finished, and rethrow the
+        // exception of the first task that failed.
+        void wait();
+    };
+
+    /*
+     * Parallel for loop
+     *
+     * Split the range [begin, end) into parts of at least grain indices and
+     * call the function for each part, in parallel. Returns when all parts
+     * are done, and rethrows the first exception.
+     */
+
+    class range_function
+    {
+    public:
+        virtual ~range_function() {}
+        virtual void operator()(size_t begin, size_t end) = 0;
+    };
+
+    void parallel_for(size_t begin, size_t end, range_function& f, size_t grain = 1);
+
+    /*
+     * Ordered pipeline
+     *
+     * Tasks are run in parallel, but they are taken out of the pipeline in the
+     * order in which they were put in. This is useful for processing a stream
+     * of independent items whose results must be written in order.
+     */
+
+    class ordered_pipeline
+    {
+    private:
+        group _group;
+        std::deque<task*> _tasks;
+        size_t _max_tasks;
+
+    public:
+        // The maximum number of tasks in the pipeline defaults to two per thread.
+        ordered_pipeline(size_t max_tasks = 0);
+        // Waits for the remaining tasks and deletes them.
+        ~ordered_pipeline();
+
+        bool empty() const
+        {
+            return _tasks.empty();
+        }
+
+        // Return whether the pipeline has reached its maximum number of tasks.
+        bool full() const
+        {
+            return _tasks.size() >= _max_tasks;
+        }
+
+        // Put a task into the pipeline and run it. The pipeline owns the task.
+        void push(task* t);
+
+        // Take the oldest task out of the pipeline. If it is not finished, wait
+        // for it if wait is true, or return NULL otherwise. NULL is also returned
+        // if the pipeline is empty. The caller owns the returned task. If the task
+        // failed, it is deleted and its exception is thrown instead.
+        task* pop(bool wait = true);
+    };
+}
+
+#endif
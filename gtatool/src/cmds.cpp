@@ -126,6 +126,7 @@ CMD_DECL(gui)
 CMD_DECL(help)
 CMD_DECL(info)
 CMD_DECL(merge)
+CMD_DECL(pipeline)
 CMD_DECL(resize)
 CMD_DECL(set)
 CMD_DECL(stream_extract)
@@ -252,6 +253,8 @@ static cmd_t cmds[] =
             "Show information about arrays"),
     CMD("merge",             cmd_array,      merge,             true,          BUILTIN,
             "Merge arrays into larger arrays"),
+    CMD("pipeline",          cmd_misc,       pipeline,          true,          BUILTIN,
+            "Run commands in a pipeline within one process"),
     CMD("resize",            cmd_array,      resize,            true,          BUILTIN,
             "Resize arrays"),
     CMD("set",               cmd_array,      set,               true,          BUILTIN,
@@ -156,31 +156,43 @@ extern "C" int gtatool_component_add(int argc, char *argv[])
             array_loop.write(hdro, nameo);
             element_loop_t element_loop;
             array_loop.start_element_loop(element_loop, hdri, hdro);
-            blob element_out(checked_cast<size_t>(hdro.element_size()));
             size_t old_comp_pre_size = 0;
             for (uintmax_t i = 0; i < hdro_new_comp_index; i++)
             {
                 old_comp_pre_size += hdro.component_size(i);
             }
-            for (uintmax_t e = 0; e < hdro.elements(); e++)
+            size_t element_size_in = checked_cast<size_t>(hdri.element_size());
+            size_t element_size_out = checked_cast<size_t>(hdro.element_size());
+            uintmax_t remaining = hdro.elements();
+            while (remaining > 0)
             {
-                const void *element_in = NULL;
-                if (hdri.element_size() > 0)
+                size_t n = element_loop_t::batch_size(element_size_out);
+                if (n > remaining)
+                    n = remaining;
+                const char *elements_in = NULL;
+                if (element_size_in > 0)
                 {
-                    element_in = element_loop.read();
+                    elements_in = static_cast<const char *>(element_loop.read(n));
                 }
-                if (element_in)
+                char *elements_out = static_cast<char *>(element_loop.out_batch(n));
+                for (size_t j = 0; j < n; j++)
                 {
-                    std::memcpy(element_out.ptr(), element_in, old_comp_pre_size);
+                    const char *element_in = elements_in + j * element_size_in;
+                    char *element_out = elements_out + j * element_size_out;
+                    if (elements_in)
+                    {
+                        std::memcpy(element_out, element_in, old_comp_pre_size);
+                    }
+                    std::memcpy(element_out + old_comp_pre_size, comp_values.ptr(), hdrt.element_size());
+                    if (elements_in)
+                    {
+                        std::memcpy(element_out + old_comp_pre_size + hdrt.element_size(),
+                                element_in + old_comp_pre_size,
+                                element_size_in - old_comp_pre_size);
+                    }
                 }
-                std::memcpy(element_out.ptr(old_comp_pre_size), comp_values.ptr(), hdrt.element_size());
-                if (element_in)
-                {
-                    std::memcpy(element_out.ptr(old_comp_pre_size + hdrt.element_size()),
-                            static_cast<const char *>(element_in) + old_comp_pre_size,
-                            hdri.element_size() - old_comp_pre_size);
-                }
-                element_loop.write(element_out.ptr());
+                element_loop.write(elements_out, n);
+                remaining -= n;
             }
         }
         array_loop.finish();
@@ -58,31 +58,22 @@ extern "C" void gtatool_component_compute_help(void)
             "Example: component-compute -e 'c3 = 0.2126 * c0 + 0.7152 * c1 + 0.0722 * c2' rgba.gta > rgb+lum.gta");
 }
 
-extern "C" int gtatool_component_compute(int argc, char *argv[])
+class component_computer_t : public array_processor_t
 {
-    std::vector<opt::option *> options;
-    opt::info help("help", '\0', opt::optional);
-    options.push_back(&help);
-    opt::string expressions("expression", 'e', opt::required);
-    options.push_back(&expressions);
-    std::vector<std::string> arguments;
-    if (!opt::parse(argc, argv, options, -1, -1, arguments))
-    {
-        return 1;
-    }
-    if (help.value())
+private:
+    const std::vector<std::string> &_expressions;
+
+public:
+    component_computer_t(const std::vector<std::string> &expressions) :
+        _expressions(expressions)
     {
-        gtatool_component_compute_help();
-        return 0;
     }
 
-    try
+    void process(array_loop_t &array_loop, gta::header &hdri, const std::string &namei)
     {
-        array_loop_t array_loop;
-        gta::header hdri, hdro;
-        std::string namei, nameo;
-        array_loop.start(arguments, "");
-        while (array_loop.read(hdri, namei))
+        // The parser exceptions are not std::exceptions; convert them so that
+        // they can be reported from worker threads.
+        try
         {
             // Set up variables
             std::vector<double> comp_vars;
@@ -128,8 +119,8 @@ extern "C" int gtatool_component_compute(int argc, char *argv[])
             std::vector<uintmax_t> index_vars_orig(hdri.dimensions());
             std::vector<double> index_vars(hdri.dimensions());
             std::vector<mu::Parser> parsers;
-            parsers.resize(expressions.values().size());
-            for (size_t p = 0; p < expressions.values().size(); p++)
+            parsers.resize(_expressions.size());
+            for (size_t p = 0; p < _expressions.size(); p++)
             {
                 size_t comp_vars_index = 0;
                 for (uintmax_t i = 0; i < hdri.components(); i++)
@@ -151,301 +142,336 @@ extern "C" int gtatool_component_compute(int argc, char *argv[])
                     parsers[p].DefineVar(std::string("d") + str::from(i), &(dim_vars[i]));
                     parsers[p].DefineVar(std::string("i") + str::from(i), &(index_vars[i]));
                 }
-                parsers[p].SetExpr(expressions.values()[p]);
+                parsers[p].SetExpr(_expressions[p]);
             }
 
-            hdro = hdri;
+            gta::header hdro = hdri;
             hdro.set_compression(gta::none);
+            std::string nameo;
             array_loop.write(hdro, nameo);
             if (hdro.data_size() > 0)
             {
                 element_loop_t element_loop;
                 array_loop.start_element_loop(element_loop, hdri, hdro);
-                blob element(checked_cast<size_t>(hdri.element_size()));
-                for (uintmax_t e = 0; e < hdro.elements(); e++)
+                size_t element_size = checked_cast<size_t>(hdri.element_size());
+                uintmax_t e = 0;
+                const void *src;
+                size_t n;
+                while ((n = element_loop.read_batch(&src)) > 0)
                 {
-                    std::memcpy(element.ptr(), element_loop.read(), hdri.element_size());
-                    // set the variables
-                    components_var = hdri.components();
-                    dimensions_var = hdri.dimensions();
-                    for (uintmax_t i = 0; i < hdri.dimensions(); i++)
-                    {
-                        dim_vars[i] = hdri.dimension_size(i);
-                    }
-                    hdri.linear_index_to_indices(e, &(index_vars_orig[0]));
-                    for (uintmax_t i = 0; i < hdri.dimensions(); i++)
+                    char *dst = static_cast<char *>(element_loop.out_batch(n));
+                    std::memcpy(dst, src, n * element_size);
+                    for (size_t j = 0; j < n; j++, e++)
                     {
-                        index_vars[i] = index_vars_orig[i];
-                    }
-                    size_t comp_var_index = 0;
-                    for (uintmax_t i = 0; i < hdri.components(); i++)
-                    {
-                        switch (hdri.component_type(i))
+                        void *element = dst + j * element_size;
+                        // set the variables
+                        components_var = hdri.components();
+                        dimensions_var = hdri.dimensions();
+                        for (uintmax_t i = 0; i < hdri.dimensions(); i++)
                         {
-                        case gta::int8:
-                            {
-                                int8_t v;
-                                std::memcpy(&v, hdri.component(element.ptr(), i), sizeof(int8_t));
-                                comp_vars[comp_var_index++] = v;
-                            }
-                            break;
-                        case gta::uint8:
-                            {
-                                uint8_t v;
-                                std::memcpy(&v, hdri.component(element.ptr(), i), sizeof(uint8_t));
-                                comp_vars[comp_var_index++] = v;
-                            }
-                            break;
-                        case gta::int16:
-                            {
-                                int16_t v;
-                                std::memcpy(&v, hdri.component(element.ptr(), i), sizeof(int16_t));
-                                comp_vars[comp_var_index++] = v;
-                            }
-                            break;
-                        case gta::uint16:
-                            {
-                                uint16_t v;
-                                std::memcpy(&v, hdri.component(element.ptr(), i), sizeof(uint16_t));
-                                comp_vars[comp_var_index++] = v;
-                            }
-                            break;
-                        case gta::int32:
-                            {
-                                int32_t v;
-                                std::memcpy(&v, hdri.component(element.ptr(), i), sizeof(int32_t));
-                                comp_vars[comp_var_index++] = v;
-                            }
-                            break;
-                        case gta::uint32:
-                            {
-                                uint32_t v;
-                                std::memcpy(&v, hdri.component(element.ptr(), i), sizeof(uint32_t));
-                                comp_vars[comp_var_index++] = v;
-                            }
-                            break;
-                        case gta::int64:
-                            {
-                                int64_t v;
-                                std::memcpy(&v, hdri.component(element.ptr(), i), sizeof(int64_t));
-                                comp_vars[comp_var_index++] = v;
-                            }
-                            break;
-                        case gta::uint64:
-                            {
-                                uint64_t v;
-                                std::memcpy(&v, hdri.component(element.ptr(), i), sizeof(uint64_t));
-                                comp_vars[comp_var_index++] = v;
-                            }
-                            break;
+                            dim_vars[i] = hdri.dimension_size(i);
+                        }
+                        hdri.linear_index_to_indices(e, &(index_vars_orig[0]));
+                        for (uintmax_t i = 0; i < hdri.dimensions(); i++)
+                        {
+                            index_vars[i] = index_vars_orig[i];
+                        }
+                        size_t comp_var_index = 0;
+                        for (uintmax_t i = 0; i < hdri.components(); i++)
+                        {
+                            switch (hdri.component_type(i))
+                            {
+                            case gta::int8:
+                                {
+                                    int8_t v;
+                                    std::memcpy(&v, hdri.component(element, i), sizeof(int8_t));
+                                    comp_vars[comp_var_index++] = v;
+                                }
+                                break;
+                            case gta::uint8:
+                                {
+                                    uint8_t v;
+                                    std::memcpy(&v, hdri.component(element, i), sizeof(uint8_t));
+                                    comp_vars[comp_var_index++] = v;
+                                }
+                                break;
+                            case gta::int16:
+                                {
+                                    int16_t v;
+                                    std::memcpy(&v, hdri.component(element, i), sizeof(int16_t));
+                                    comp_vars[comp_var_index++] = v;
+                                }
+                                break;
+                            case gta::uint16:
+                                {
+                                    uint16_t v;
+                                    std::memcpy(&v, hdri.component(element, i), sizeof(uint16_t));
+                                    comp_vars[comp_var_index++] = v;
+                                }
+                                break;
+                            case gta::int32:
+                                {
+                                    int32_t v;
+                                    std::memcpy(&v, hdri.component(element, i), sizeof(int32_t));
+                                    comp_vars[comp_var_index++] = v;
+                                }
+                                break;
+                            case gta::uint32:
+                                {
+                                    uint32_t v;
+                                    std::memcpy(&v, hdri.component(element, i), sizeof(uint32_t));
+                                    comp_vars[comp_var_index++] = v;
+                                }
+                                break;
+                            case gta::int64:
+                                {
+                                    int64_t v;
+                                    std::memcpy(&v, hdri.component(element, i), sizeof(int64_t));
+                                    comp_vars[comp_var_index++] = v;
+                                }
+                                break;
+                            case gta::uint64:
+                                {
+                                    uint64_t v;
+                                    std::memcpy(&v, hdri.component(element, i), sizeof(uint64_t));
+                                    comp_vars[comp_var_index++] = v;
+                                }
+                                break;
 #ifdef HAVE_INT128_T
-                        case gta::int128:
-                            {
-                                int128_t v;
-                                std::memcpy(&v, hdri.component(element.ptr(), i), sizeof(int128_t));
-                                comp_vars[comp_var_index++] = v;
-                            }
-                            break;
+                            case gta::int128:
+                                {
+                                    int128_t v;
+                                    std::memcpy(&v, hdri.component(element, i), sizeof(int128_t));
+                                    comp_vars[comp_var_index++] = v;
+                                }
+                                break;
 #endif
 #ifdef HAVE_UINT128_T
-                        case gta::uint128:
-                            {
-                                uint128_t v;
-                                std::memcpy(&v, hdri.component(element.ptr(), i), sizeof(uint128_t));
-                                comp_vars[comp_var_index++] = v;
-                            }
-                            break;
+                            case gta::uint128:
+                                {
+                                    uint128_t v;
+                                    std::memcpy(&v, hdri.component(element, i), sizeof(uint128_t));
+                                    comp_vars[comp_var_index++] = v;
+                                }
+                                break;
 #endif
-                        case gta::float32:
-                            {
-                                float v;
-                                std::memcpy(&v, hdri.component(element.ptr(), i), sizeof(float));
-                                comp_vars[comp_var_index++] = v;
-                            }
-                            break;
-                        case gta::float64:
-                            {
-                                double v;
-                                std::memcpy(&v, hdri.component(element.ptr(), i), sizeof(double));
-                                comp_vars[comp_var_index++] = v;
-                            }
-                            break;
+                            case gta::float32:
+                                {
+                                    float v;
+                                    std::memcpy(&v, hdri.component(element, i), sizeof(float));
+                                    comp_vars[comp_var_index++] = v;
+                                }
+                                break;
+                            case gta::float64:
+                                {
+                                    double v;
+                                    std::memcpy(&v, hdri.component(element, i), sizeof(double));
+                                    comp_vars[comp_var_index++] = v;
+                                }
+                                break;
 #ifdef HAVE_FLOAT128_T
-                        case gta::float128:
-                            {
-                                float128_t v;
-                                std::memcpy(&v, hdri.component(element.ptr(), i), sizeof(float128_t));
-                                comp_vars[comp_var_index++] = v;
-                            }
-                            break;
+                            case gta::float128:
+                                {
+                                    float128_t v;
+                                    std::memcpy(&v, hdri.component(element, i), sizeof(float128_t));
+                                    comp_vars[comp_var_index++] = v;
+                                }
+                                break;
 #endif
-                        case gta::cfloat32:
-                            {
-                                float v[2];
-                                std::memcpy(v, hdri.component(element.ptr(), i), 2 * sizeof(float));
-                                comp_vars[comp_var_index++] = v[0];
-                                comp_vars[comp_var_index++] = v[1];
-                            }
-                            break;
-                        case gta::cfloat64:
-                            {
-                                double v[2];
-                                std::memcpy(v, hdri.component(element.ptr(), i), 2 * sizeof(double));
-                                comp_vars[comp_var_index++] = v[0];
-                                comp_vars[comp_var_index++] = v[1];
-                            }
-                            break;
+                            case gta::cfloat32:
+                                {
+                                    float v[2];
+                                    std::memcpy(v, hdri.component(element, i), 2 * sizeof(float));
+                                    comp_vars[comp_var_index++] = v[0];
+                                    comp_vars[comp_var_index++] = v[1];
+                                }
+                                break;
+                            case gta::cfloat64:
+                                {
+                                    double v[2];
+                                    std::memcpy(v, hdri.component(element, i), 2 * sizeof(double));
+                                    comp_vars[comp_var_index++] = v[0];
+                                    comp_vars[comp_var_index++] = v[1];
+                                }
+                                break;
 #ifdef HAVE_FLOAT128_T
-                        case gta::cfloat128:
-                            {
-                                float128_t v[2];
-                                std::memcpy(v, hdri.component(element.ptr(), i), 2 * sizeof(float128_t));
-                                comp_vars[comp_var_index++] = v[0];
-                                comp_vars[comp_var_index++] = v[1];
-                            }
-                            break;
+                            case gta::cfloat128:
+                                {
+                                    float128_t v[2];
+                                    std::memcpy(v, hdri.component(element, i), 2 * sizeof(float128_t));
+                                    comp_vars[comp_var_index++] = v[0];
+                                    comp_vars[comp_var_index++] = v[1];
+                                }
+                                break;
 #endif
-                        default:
-                            // cannot happen
-                            assert(false);
-                            break;
+                            default:
+                                // cannot happen
+                                assert(false);
+                                break;
+                            }
                         }
-                    }
-                    // evaluate the expressions
-                    for (size_t p = 0; p < parsers.size(); p++)
-                    {
-                        parsers[p].Eval();
-                    }
-                    // read back the component variables
-                    comp_var_index = 0;
-                    for (uintmax_t i = 0; i < hdro.components(); i++)
-                    {
-                        switch (hdro.component_type(i))
+                        // evaluate the expressions
+                        for (size_t p = 0; p < parsers.size(); p++)
                         {
-                        case gta::int8:
-                            {
-                                int8_t v = comp_vars[comp_var_index++];
-                                std::memcpy(hdri.component(element.ptr(), i), &v, sizeof(int8_t));
-                            }
-                            break;
-                        case gta::uint8:
-                            {
-                                uint8_t v = comp_vars[comp_var_index++];
-                                std::memcpy(hdri.component(element.ptr(), i), &v, sizeof(uint8_t));
-                            }
-                            break;
-                        case gta::int16:
-                            {
-                                int16_t v = comp_vars[comp_var_index++];
-                                std::memcpy(hdri.component(element.ptr(), i), &v, sizeof(int16_t));
-                            }
-                            break;
-                        case gta::uint16:
-                            {
-                                uint16_t v = comp_vars[comp_var_index++];
-                                std::memcpy(hdri.component(element.ptr(), i), &v, sizeof(uint16_t));
-                            }
-                            break;
-                        case gta::int32:
-                            {
-                                int32_t v = comp_vars[comp_var_index++];
-                                std::memcpy(hdri.component(element.ptr(), i), &v, sizeof(int32_t));
-                            }
-                            break;
-                        case gta::uint32:
-                            {
-                                uint32_t v = comp_vars[comp_var_index++];
-                                std::memcpy(hdri.component(element.ptr(), i), &v, sizeof(uint32_t));
-                            }
-                            break;
-                        case gta::int64:
-                            {
-                                int64_t v = comp_vars[comp_var_index++];
-                                std::memcpy(hdri.component(element.ptr(), i), &v, sizeof(int64_t));
-                            }
-                            break;
-                        case gta::uint64:
-                            {
-                                uint64_t v = comp_vars[comp_var_index++];
-                                std::memcpy(hdri.component(element.ptr(), i), &v, sizeof(uint64_t));
-                            }
-                            break;
+                            parsers[p].Eval();
+                        }
+                        // read back the component variables
+                        comp_var_index = 0;
+                        for (uintmax_t i = 0; i < hdro.components(); i++)
+                        {
+                            switch (hdro.component_type(i))
+                            {
+                            case gta::int8:
+                                {
+                                    int8_t v = comp_vars[comp_var_index++];
+                                    std::memcpy(hdri.component(element, i), &v, sizeof(int8_t));
+                                }
+                                break;
+                            case gta::uint8:
+                                {
+                                    uint8_t v = comp_vars[comp_var_index++];
+                                    std::memcpy(hdri.component(element, i), &v, sizeof(uint8_t));
+                                }
+                                break;
+                            case gta::int16:
+                                {
+                                    int16_t v = comp_vars[comp_var_index++];
+                                    std::memcpy(hdri.component(element, i), &v, sizeof(int16_t));
+                                }
+                                break;
+                            case gta::uint16:
+                                {
+                                    uint16_t v = comp_vars[comp_var_index++];
+                                    std::memcpy(hdri.component(element, i), &v, sizeof(uint16_t));
+                                }
+                                break;
+                            case gta::int32:
+                                {
+                                    int32_t v = comp_vars[comp_var_index++];
+                                    std::memcpy(hdri.component(element, i), &v, sizeof(int32_t));
+                                }
+                                break;
+                            case gta::uint32:
+                                {
+                                    uint32_t v = comp_vars[comp_var_index++];
+                                    std::memcpy(hdri.component(element, i), &v, sizeof(uint32_t));
+                                }
+                                break;
+                            case gta::int64:
+                                {
+                                    int64_t v = comp_vars[comp_var_index++];
+                                    std::memcpy(hdri.component(element, i), &v, sizeof(int64_t));
+                                }
+                                break;
+                            case gta::uint64:
+                                {
+                                    uint64_t v = comp_vars[comp_var_index++];
+                                    std::memcpy(hdri.component(element, i), &v, sizeof(uint64_t));
+                                }
+                                break;
 #ifdef HAVE_INT128_T
-                        case gta::int128:
-                            {
-                                int128_t v = comp_vars[comp_var_index++];
-                                std::memcpy(hdri.component(element.ptr(), i), &v, sizeof(int128_t));
-                            }
-                            break;
+                            case gta::int128:
+                                {
+                                    int128_t v = comp_vars[comp_var_index++];
+                                    std::memcpy(hdri.component(element, i), &v, sizeof(int128_t));
+                                }
+                                break;
 #endif
 #ifdef HAVE_UINT128_T
-                        case gta::uint128:
-                            {
-                                uint128_t v = comp_vars[comp_var_index++];
-                                std::memcpy(hdri.component(element.ptr(), i), &v, sizeof(uint128_t));
-                            }
-                            break;
+                            case gta::uint128:
+                                {
+                                    uint128_t v = comp_vars[comp_var_index++];
+                                    std::memcpy(hdri.component(element, i), &v, sizeof(uint128_t));
+                                }
+                                break;
 #endif
-                        case gta::float32:
-                            {
-                                float v = comp_vars[comp_var_index++];
-                                std::memcpy(hdri.component(element.ptr(), i), &v, sizeof(float));
-                            }
-                            break;
-                        case gta::float64:
-                            {
-                                double v = comp_vars[comp_var_index++];
-                                std::memcpy(hdri.component(element.ptr(), i), &v, sizeof(double));
-                            }
-                            break;
+                            case gta::float32:
+                                {
+                                    float v = comp_vars[comp_var_index++];
+                                    std::memcpy(hdri.component(element, i), &v, sizeof(float));
+                                }
+                                break;
+                            case gta::float64:
+                                {
+                                    double v = comp_vars[comp_var_index++];
+                                    std::memcpy(hdri.component(element, i), &v, sizeof(double));
+                                }
+                                break;
 #ifdef HAVE_FLOAT128_T
-                        case gta::float128:
-                            {
-                                float128_t v = comp_vars[comp_var_index++];
-                                std::memcpy(hdri.component(element.ptr(), i), &v, sizeof(float128_t));
-                            }
-                            break;
+                            case gta::float128:
+                                {
+                                    float128_t v = comp_vars[comp_var_index++];
+                                    std::memcpy(hdri.component(element, i), &v, sizeof(float128_t));
+                                }
+                                break;
 #endif
-                        case gta::cfloat32:
-                            {
-                                float v[2] = { static_cast<float>(comp_vars[comp_var_index]), static_cast<float>(comp_vars[comp_var_index + 1]) };
-                                comp_var_index += 2;
-                                std::memcpy(hdri.component(element.ptr(), i), v, 2 * sizeof(float));
-                            }
-                            break;
-                        case gta::cfloat64:
-                            {
-                                double v[2] = { comp_vars[comp_var_index], comp_vars[comp_var_index + 1] };
-                                comp_var_index += 2;
-                                std::memcpy(hdri.component(element.ptr(), i), v, 2 * sizeof(double));
-                            }
-                            break;
+                            case gta::cfloat32:
+                                {
+                                    float v[2] = { static_cast<float>(comp_vars[comp_var_index]), static_cast<float>(comp_vars[comp_var_index + 1]) };
+                                    comp_var_index += 2;
+                                    std::memcpy(hdri.component(element, i), v, 2 * sizeof(float));
+                                }
+                                break;
+                            case gta::cfloat64:
+                                {
+                                    double v[2] = { comp_vars[comp_var_index], comp_vars[comp_var_index + 1] };
+                                    comp_var_index += 2;
+                                    std::memcpy(hdri.component(element, i), v, 2 * sizeof(double));
+                                }
+                                break;
 #ifdef HAVE_FLOAT128_T
-                        case gta::cfloat128:
-                            {
-                                float128_t v[2] = { comp_vars[comp_var_index], comp_vars[comp_var_index + 1] };
-                                comp_var_index += 2;
-                                std::memcpy(hdri.component(element.ptr(), i), v, 2 * sizeof(float128_t));
-                            }
-                            break;
+                            case gta::cfloat128:
+                                {
+                                    float128_t v[2] = { comp_vars[comp_var_index], comp_vars[comp_var_index + 1] };
+                                    comp_var_index += 2;
+                                    std::memcpy(hdri.component(element, i), v, 2 * sizeof(float128_t));
+                                }
+                                break;
 #endif
-                        default:
-                            // cannot happen
-                            assert(false);
-                            break;
+                            default:
+                                // cannot happen
+                                assert(false);
+                                break;
+                            }
                         }
                     }
-                    element_loop.write(element.ptr());
+                    element_loop.write(dst, n);
                 }
             }
         }
-        array_loop.finish();
+        catch (mu::Parser::exception_type &e)
+        {
+            throw exc(e.GetMsg());
+        }
     }
-    catch (mu::Parser::exception_type &e)
+};
+
+extern "C" int gtatool_component_compute(int argc, char *argv[])
+{
+    std::vector<opt::option *> options;
+    opt::info help("help", '\0', opt::optional);
+    options.push_back(&help);
+    opt::string expressions("expression", 'e', opt::required);
+    options.push_back(&expressions);
+    std::vector<std::string> arguments;
+    if (!opt::parse(argc, argv, options, -1, -1, arguments))
     {
-        msg::err_txt(e.GetMsg());
         return 1;
     }
+    if (help.value())
+    {
+        gtatool_component_compute_help();
+        return 0;
+    }
+
+    try
+    {
+        array_loop_t array_loop;
+        array_loop.start(arguments, "");
+        component_computer_t computer(expressions.values());
+        array_loop.process(computer);
+        array_loop.finish();
+    }
     catch (std::exception &e)
     {
         msg::err_txt("%s", e.what());
@@ -37,6 +37,7 @@
 #include "base/fio.h"
 #include "base/str.h"
 #include "base/chk.h"
+#include "base/tsk.h"
 
 /* Get maximum-width types before including lib.h */
 #if !defined(HAVE_INT128_T) && defined(HAVE___INT128)
@@ -796,6 +797,116 @@ extern "C" void gtatool_component_convert_help(void)
             "Example: component-convert -c uint8,uint8,uint8 hdr.gta > rgb.gta");
 }
 
+class element_converter_t : public tsk::range_function
+{
+private:
+    const gta::header &_hdri;
+    const gta::header &_hdro;
+    size_t _element_size_in;
+    size_t _element_size_out;
+    bool _normalize;
+
+public:
+    const void *src;
+    void *dst;
+
+    element_converter_t(const gta::header &hdri, const gta::header &hdro, bool normalize) :
+        _hdri(hdri), _hdro(hdro),
+        _element_size_in(checked_cast<size_t>(hdri.element_size())),
+        _element_size_out(checked_cast<size_t>(hdro.element_size())),
+        _normalize(normalize), src(NULL), dst(NULL)
+    {
+    }
+
+    // Convert the elements begin to end-1 of src to dst.
+    void operator()(size_t begin, size_t end)
+    {
+        for (size_t j = begin; j < end; j++)
+        {
+            const void *element_in = static_cast<const char *>(src) + j * _element_size_in;
+            void *element_out = static_cast<char *>(dst) + j * _element_size_out;
+            for (uintmax_t i = 0; i < _hdro.components(); i++)
+            {
+                convert(_hdro.component(element_out, i),
+                        _hdro.component_type(i),
+                        _hdri.component(element_in, i),
+                        _hdri.component_type(i),
+                        _normalize);
+            }
+        }
+    }
+};
+
+class component_converter_t : public array_processor_t
+{
+private:
+    const std::vector<gta::type> &_comp_types;
+    const std::vector<uintmax_t> &_comp_sizes;
+    bool _normalize;
+
+public:
+    component_converter_t(const std::vector<gta::type> &comp_types,
+            const std::vector<uintmax_t> &comp_sizes, bool normalize) :
+        _comp_types(comp_types), _comp_sizes(comp_sizes), _normalize(normalize)
+    {
+    }
+
+    void process(array_loop_t &array_loop, gta::header &hdri, const std::string &namei)
+    {
+        if (hdri.components() != _comp_types.size())
+        {
+            throw exc(namei + ": number of components does not match");
+        }
+        for (uintmax_t i = 0; i < hdri.components(); i++)
+        {
+            if (hdri.component_type(i) == gta::blob)
+            {
+                throw exc(namei + ": conversion from type "
+                        + type_to_string(hdri.component_type(i), hdri.component_size(i))
+                        + " is currently not supported");
+            }
+            if (false
+#ifndef HAVE_INT128_T
+                    || hdri.component_type(i) == gta::int128
+#endif
+#ifndef HAVE_UINT128_T
+                    || hdri.component_type(i) == gta::uint128
+#endif
+#ifndef HAVE_FLOAT128_T
+                    || hdri.component_type(i) == gta::float128
+                    || hdri.component_type(i) == gta::cfloat128
+#endif
+               )
+            {
+                throw exc(namei + ": conversion from type "
+                        + type_to_string(hdri.component_type(i), hdri.component_size(i))
+                        + " is not supported on this platform");
+            }
+        }
+
+        // Convert components
+        gta::header hdro = hdri;
+        hdro.set_compression(gta::none);
+        hdro.set_components(_comp_types.size(), &(_comp_types[0]), _comp_sizes.size() == 0 ? NULL : &(_comp_sizes[0]));
+        for (uintmax_t i = 0; i < hdro.components(); i++)
+        {
+            hdro.component_taglist(i) = hdri.component_taglist(i);
+        }
+        std::string nameo;
+        array_loop.write(hdro, nameo);
+        element_loop_t element_loop;
+        array_loop.start_element_loop(element_loop, hdri, hdro);
+        element_converter_t element_converter(hdri, hdro, _normalize);
+        size_t n;
+        while ((n = element_loop.read_batch(&element_converter.src)) > 0)
+        {
+            element_converter.dst = element_loop.out_batch(n);
+            tsk::parallel_for(0, n, element_converter, 1024);
+            element_loop.write(element_converter.dst, n);
+        }
+    }
+};
+
 extern "C" int gtatool_component_convert(int argc, char *argv[])
 {
     std::vector<opt::option *> options;
@@ -849,68 +960,9 @@ extern "C" int gtatool_component_convert(int argc, char *argv[])
         }
 
         array_loop_t array_loop;
-        gta::header hdri, hdro;
-        std::string namei, nameo;
         array_loop.start(arguments, "");
-        while (array_loop.read(hdri, namei))
-        {
-            if (hdri.components() != comp_types.size())
-            {
-                throw exc(namei + ": number of components does not match");
-            }
-            for (uintmax_t i = 0; i < hdri.components(); i++)
-            {
-                if (hdri.component_type(i) == gta::blob)
-                {
-                    throw exc(namei + ": conversion from type "
-                            + type_to_string(hdri.component_type(i), hdri.component_size(i))
-                            + " is currently not supported");
-                }
-                if (false
-#ifndef HAVE_INT128_T
-                        || hdri.component_type(i) == gta::int128
-#endif
-#ifndef HAVE_UINT128_T
-                        || hdri.component_type(i) == gta::uint128
-#endif
-#ifndef HAVE_FLOAT128_T
-                        || hdri.component_type(i) == gta::float128
-                        || hdri.component_type(i) == gta::cfloat128
-#endif
-                   )
-                {
-                    throw exc(namei + ": conversion from type "
-                            + type_to_string(hdri.component_type(i), hdri.component_size(i))
-                            + " is not supported on this platform");
-                }
-            }
-
-            // Convert components
-            hdro = hdri;
-            hdro.set_compression(gta::none);
-            hdro.set_components(comp_types.size(), &(comp_types[0]), comp_sizes.size() == 0 ? NULL : &(comp_sizes[0]));
-            for (uintmax_t i = 0; i < hdro.components(); i++)
-            {
-                hdro.component_taglist(i) = hdri.component_taglist(i);
-            }
-            array_loop.write(hdro, nameo);
-            element_loop_t element_loop;
-            array_loop.start_element_loop(element_loop, hdri, hdro);
-            blob element_out(checked_cast<size_t>(hdro.element_size()));
-            for (uintmax_t e = 0; e < hdro.elements(); e++)
-            {
-                const void *src = element_loop.read();
-                for (uintmax_t i = 0; i < hdro.components(); i++)
-                {
-                    convert(hdro.component(element_out.ptr(), i),
-                            hdro.component_type(i),
-                            hdri.component(src, i),
-                            hdri.component_type(i),
-                            normalize.value());
-                }
-                element_loop.write(element_out.ptr());
-            }
-        }
+        component_converter_t converter(comp_types, comp_sizes, normalize.value());
+        array_loop.process(converter);
         array_loop.finish();
     }
     catch (std::exception &e)
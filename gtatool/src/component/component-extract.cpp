@@ -149,20 +149,17 @@ extern "C" int gtatool_component_extract(int argc, char *argv[])
             {
                 element_loop_t element_loop;
                 array_loop.start_element_loop(element_loop, hdri, hdro);
-                blob element_out(checked_cast<size_t>(hdro.element_size()));
-                for (uintmax_t e = 0; e < hdro.elements(); e++)
+                // Only the kept components are copied out of the input data
+                size_t batch_size = element_loop_t::batch_size(hdri.element_size());
+                for (uintmax_t e = 0; e < hdro.elements();)
                 {
-                    const void *element_in = element_loop.read();
-                    for (uintmax_t i = 0; i < hdro.components(); i++)
-                    {
-                        std::memcpy(hdro.component(element_out.ptr(), i),
-                                hdri.component(element_in, hdro_comp_indices[i]),
-                                hdro.component_size(i));
-                    }
+                    size_t n = (hdro.elements() - e < batch_size ? hdro.elements() - e : batch_size);
+                    const void *elements_out = element_loop.read_components(hdro_comp_indices, n);
                     if (hdro.data_size() > 0)
                     {
-                        element_loop.write(element_out.ptr());
+                        element_loop.write(elements_out, n);
                     }
+                    e += n;
                 }
             }
         }
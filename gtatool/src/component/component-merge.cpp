@@ -149,18 +149,34 @@ extern "C" int gtatool_component_merge(int argc, char *argv[])
             {
                 element_loop_t element_loop;
                 array_loops[0].start_element_loop(element_loop, hdris[0], hdro);
-                blob element_out(checked_cast<size_t>(hdro.element_size()));
-                for (uintmax_t e = 0; e < hdro.elements(); e++)
+                size_t element_size_out = checked_cast<size_t>(hdro.element_size());
+                std::vector<const char *> elements_in(arguments.size());
+                uintmax_t remaining = hdro.elements();
+                while (remaining > 0)
                 {
-                    void *p = element_out.ptr();
-                    std::memcpy(p, element_loop.read(), hdris[0].element_size());
-                    p = static_cast<void *>(static_cast<char *>(p) + hdris[0].element_size());
+                    // the output elements are the largest ones, so a batch of them
+                    // is never smaller than a batch of input elements
+                    size_t n = element_loop_t::batch_size(element_size_out);
+                    if (n > remaining)
+                        n = remaining;
+                    elements_in[0] = static_cast<const char *>(element_loop.read(n));
                     for (size_t i = 1; i < arguments.size(); i++)
                     {
-                        std::memcpy(p, element_loops[i].read(), hdris[i].element_size());
-                        p = static_cast<void *>(static_cast<char *>(p) + hdris[i].element_size());
+                        elements_in[i] = static_cast<const char *>(element_loops[i].read(n));
                     }
-                    element_loop.write(element_out.ptr());
+                    char *elements_out = static_cast<char *>(element_loop.out_batch(n));
+                    for (size_t j = 0; j < n; j++)
+                    {
+                        char *p = elements_out + j * element_size_out;
+                        for (size_t i = 0; i < arguments.size(); i++)
+                        {
+                            size_t element_size_in = checked_cast<size_t>(hdris[i].element_size());
+                            std::memcpy(p, elements_in[i] + j * element_size_in, element_size_in);
+                            p += element_size_in;
+                        }
+                    }
+                    element_loop.write(elements_out, n);
+                    remaining -= n;
                 }
             }
         }
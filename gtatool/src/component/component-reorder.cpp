@@ -24,6 +24,7 @@
 #include <sstream>
 #include <cstdio>
 #include <cctype>
+#include <algorithm>
 
 #include <gta/gta.hpp>
 
@@ -124,24 +125,18 @@ extern "C" int gtatool_component_reorder(int argc, char *argv[])
             {
                 element_loop_t element_loop;
                 array_loop.start_element_loop(element_loop, hdri, hdro);
-                blob element_out(checked_cast<size_t>(hdro.element_size()));
-                for (uintmax_t e = 0; e < hdro.elements(); e++)
+                uintmax_t remaining = hdro.elements();
+                while (remaining > 0)
                 {
-                    const void *element_in = element_loop.read();
-                    if (!indices.value().empty())
-                    {
-                        for (uintmax_t i = 0; i < hdro.components(); i++)
-                        {
-                            std::memcpy(hdro.component(element_out.ptr(), i),
-                                    hdri.component(element_in, indices.value()[i]),
-                                hdro.component_size(i));
-                        }
-                    }
-                    else
-                    {
-                        std::memcpy(element_out.ptr(), element_in, hdro.element_size());
-                    }
-                    element_loop.write(element_out.ptr());
+                    size_t n = element_loop_t::batch_size(std::max(hdri.element_size(), hdro.element_size()));
+                    if (n > remaining)
+                        n = remaining;
+                    // the input elements are reordered while reading
+                    const void *elements = (indices.value().empty()
+                            ? element_loop.read(n)
+                            : element_loop.read_components(indices.value(), n));
+                    element_loop.write(elements, n);
+                    remaining -= n;
                 }
             }
         }
@@ -121,17 +121,24 @@ extern "C" int gtatool_component_set(int argc, char *argv[])
             {
                 element_loop_t element_loop;
                 array_loop.start_element_loop(element_loop, hdri, hdro);
-                blob element(checked_cast<size_t>(hdri.element_size()));
-                for (uintmax_t e = 0; e < hdro.elements(); e++)
+                size_t element_size = checked_cast<size_t>(hdri.element_size());
+                const void *src;
+                size_t n;
+                while ((n = element_loop.read_batch(&src)) > 0)
                 {
-                    std::memcpy(element.ptr(), element_loop.read(), hdri.element_size());
-                    for (size_t i = 0; i < current_indices.size(); i++)
+                    char *dst = static_cast<char *>(element_loop.out_batch(n));
+                    std::memcpy(dst, src, n * element_size);
+                    for (size_t j = 0; j < n; j++)
                     {
-                        void *component_dst = hdri.component(element.ptr(), current_indices[i]);
-                        void *component_src = hdrt.component(comp_values.ptr(), i);
-                        memcpy(component_dst, component_src, hdri.component_size(current_indices[i]));
+                        void *element = dst + j * element_size;
+                        for (size_t i = 0; i < current_indices.size(); i++)
+                        {
+                            void *component_dst = hdri.component(element, current_indices[i]);
+                            void *component_src = hdrt.component(comp_values.ptr(), i);
+                            memcpy(component_dst, component_src, hdri.component_size(current_indices[i]));
+                        }
                     }
-                    element_loop.write(element.ptr());
+                    element_loop.write(dst, n);
                 }
             }
         }
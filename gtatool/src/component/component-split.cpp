@@ -125,23 +125,24 @@ extern "C" int gtatool_component_split(int argc, char *argv[])
             {
                 element_loop_t element_loop;
                 array_loop.start_element_loop(element_loop, hdri, hdro);
-                for (uintmax_t e = 0; e < hdri.elements(); e++)
+                // Each component is read into its own buffer, from which it is written as a whole
+                size_t batch_size = element_loop_t::batch_size(hdri.element_size());
+                std::vector<blob> comp_bufs(hdros.size());
+                std::vector<void *> comp_ptrs(hdros.size());
+                for (size_t i = 0; i < hdros.size(); i++)
                 {
-                    const void *element = element_loop.read();
-                    if (hdros.size() > 0)
+                    comp_bufs[i].resize(batch_size, checked_cast<size_t>(hdros[i].element_size()));
+                    comp_ptrs[i] = comp_bufs[i].ptr();
+                }
+                for (uintmax_t e = 0; e < hdri.elements();)
+                {
+                    size_t n = (hdri.elements() - e < batch_size ? hdri.elements() - e : batch_size);
+                    element_loop.read_components(comp_indices, comp_ptrs.size() > 0 ? &(comp_ptrs[0]) : NULL, n);
+                    for (size_t i = 0; i < hdros.size(); i++)
                     {
-                        size_t out_index = 0;
-                        size_t out_comp_offset = 0;
-                        for (uintmax_t i = 0; i < hdri.components(); i++)
-                        {
-                            if (i == comp_indices[out_index])
-                            {
-                                tmpeloops[out_index].write(static_cast<const char *>(element) + out_comp_offset);
-                                out_index++;
-                            }
-                            out_comp_offset += hdri.component_size(i);
-                        }
+                        tmpeloops[i].write(comp_bufs[i].ptr(), n);
                     }
+                    e += n;
                 }
             }
             // Combine the GTA data to a single output stream
@@ -133,12 +133,18 @@ extern "C" int gtatool_from_raw(int argc, char *argv[])
             {
                 element_loop_t element_loop;
                 array_loop.start_element_loop(element_loop, hdr, hdr);
-                blob element(checked_cast<size_t>(hdr.element_size()));
-                for (uintmax_t e = 0; e < hdr.elements(); e++)
+                size_t element_size = checked_cast<size_t>(hdr.element_size());
+                const void *src;
+                size_t m;
+                while ((m = element_loop.read_batch(&src)) > 0)
                 {
-                    std::memcpy(element.ptr(), element_loop.read(1), hdr.element_size());
-                    swap_element_endianness(hdr, element.ptr());
-                    element_loop.write(element.ptr());
+                    char *dst = static_cast<char *>(element_loop.out_batch(m));
+                    std::memcpy(dst, src, m * element_size);
+                    for (size_t j = 0; j < m; j++)
+                    {
+                        swap_element_endianness(hdr, dst + j * element_size);
+                    }
+                    element_loop.write(dst, m);
                 }
             }
             if (array_post_skip.value() > 0)
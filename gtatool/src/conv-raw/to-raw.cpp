@@ -96,12 +96,18 @@ extern "C" int gtatool_to_raw(int argc, char *argv[])
             {
                 element_loop_t element_loop;
                 array_loop.start_element_loop(element_loop, hdri, hdro);
-                blob element(checked_cast<size_t>(hdri.element_size()));
-                for (uintmax_t e = 0; e < hdri.elements(); e++)
+                size_t element_size = checked_cast<size_t>(hdri.element_size());
+                const void *src;
+                size_t n;
+                while ((n = element_loop.read_batch(&src)) > 0)
                 {
-                    std::memcpy(element.ptr(), element_loop.read(1), hdri.element_size());
-                    swap_element_endianness(hdri, element.ptr());
-                    element_loop.write(element.ptr());
+                    char *dst = static_cast<char *>(element_loop.out_batch(n));
+                    std::memcpy(dst, src, n * element_size);
+                    for (size_t j = 0; j < n; j++)
+                    {
+                        swap_element_endianness(hdri, dst + j * element_size);
+                    }
+                    element_loop.write(dst, n);
                 }
             }
         }
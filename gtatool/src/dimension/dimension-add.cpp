@@ -121,9 +121,11 @@ extern "C" int gtatool_dimension_add(int argc, char *argv[])
                 {
                     element_loop_t element_loop;
                     array_loop.start_element_loop(element_loop, hdri, hdro);
-                    for (uintmax_t i = 0; i < hdri.elements(); i++)
+                    const void *elements;
+                    size_t n;
+                    while ((n = element_loop.read_batch(&elements)) > 0)
                     {
-                        element_loop.write(element_loop.read());
+                        element_loop.write(elements, n);
                     }
                 }
             }
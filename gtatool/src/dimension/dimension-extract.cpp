@@ -23,6 +23,7 @@
 
 #include <sstream>
 #include <cstdio>
+#include <cstring>
 #include <cctype>
 
 #include <gta/gta.hpp>
@@ -114,14 +115,32 @@ extern "C" int gtatool_dimension_extract(int argc, char *argv[])
             {
                 element_loop_t element_loop;
                 array_loop.start_element_loop(element_loop, hdri, hdro);
-                std::vector<uintmax_t> indices(hdri.dimensions());
-                for (uintmax_t i = 0; i < hdri.elements(); i++)
+                // Element i has index (i / stride) % size in dimension dim
+                uintmax_t stride = 1;
+                for (uintmax_t i = 0; i < dim; i++)
                 {
-                    const void *e = element_loop.read();
-                    hdri.linear_index_to_indices(i, &(indices[0]));
-                    if (indices[dim] == ind)
+                    stride *= hdri.dimension_size(i);
+                }
+                uintmax_t size = hdri.dimension_size(dim);
+                size_t element_size = checked_cast<size_t>(hdri.element_size());
+                uintmax_t i = 0;
+                const void *src;
+                size_t n;
+                while ((n = element_loop.read_batch(&src)) > 0)
+                {
+                    char *dst = static_cast<char *>(element_loop.out_batch(n));
+                    size_t m = 0;
+                    for (size_t j = 0; j < n; j++, i++)
+                    {
+                        if ((i / stride) % size == ind)
+                        {
+                            std::memcpy(dst + m * element_size, static_cast<const char *>(src) + j * element_size, element_size);
+                            m++;
+                        }
+                    }
+                    if (m > 0)
                     {
-                        element_loop.write(e);
+                        element_loop.write(dst, m);
                     }
                 }
             }
@@ -47,6 +47,17 @@ extern "C" void gtatool_dimension_flatten_help(void)
             "will result in an element that stores X,Y,R,G,B values in the one-dimensional output array.");
 }
 
+/* Store the coordinates of input element e as uint64 values at the start of the output element */
+static void prepend(const gta::header &hdri, uintmax_t e, std::vector<uintmax_t> &index, char *element_out)
+{
+    hdri.linear_index_to_indices(e, &(index[0]));
+    for (size_t i = 0; i < index.size(); i++)
+    {
+        uint64_t coordinate = checked_cast<uint64_t>(index[i]);
+        std::memcpy(element_out + i * sizeof(uint64_t), &coordinate, sizeof(uint64_t));
+    }
+}
+
 extern "C" int gtatool_dimension_flatten(int argc, char *argv[])
 {
     std::vector<opt::option *> options;
@@ -70,7 +81,6 @@ extern "C" int gtatool_dimension_flatten(int argc, char *argv[])
         array_loop_t array_loop;
         gta::header hdri, hdro;
         std::string namei, nameo;
-        blob eo;
         std::vector<uintmax_t> index;
 
         array_loop.start(arguments, "");
@@ -101,32 +111,37 @@ extern "C" int gtatool_dimension_flatten(int argc, char *argv[])
                 {
                     hdro.component_taglist(hdri.dimensions() + c) = hdri.component_taglist(c);
                 }
-                eo.resize(checked_cast<size_t>(hdro.element_size()));
                 index.resize(hdri.dimensions());
             }
             array_loop.write(hdro, nameo);
             if (hdro.data_size() > 0)
             {
+                element_loop_t element_loop;
+                array_loop.start_element_loop(element_loop, hdri, hdro);
+                size_t element_size_in = checked_cast<size_t>(hdri.element_size());
+                size_t element_size_out = checked_cast<size_t>(hdro.element_size());
                 if (hdri.element_size() > 0)
                 {
-                    element_loop_t element_loop;
-                    array_loop.start_element_loop(element_loop, hdri, hdro);
-                    for (uintmax_t e = 0; e < hdro.elements(); e++)
+                    uintmax_t e = 0;
+                    const void *src;
+                    size_t n;
+                    while ((n = element_loop.read_batch(&src)) > 0)
                     {
                         if (prepend_coordinates.value())
                         {
-                            hdri.linear_index_to_indices(e, &(index[0]));
-                            for (size_t i = 0; i < index.size(); i++)
+                            char *dst = static_cast<char *>(element_loop.out_batch(n));
+                            for (size_t j = 0; j < n; j++, e++)
                             {
-                                eo.ptr<uint64_t>()[i] = checked_cast<uint64_t>(index[i]);
+                                char *element_out = dst + j * element_size_out;
+                                prepend(hdri, e, index, element_out);
+                                std::memcpy(element_out + element_size_out - element_size_in,
+                                        static_cast<const char *>(src) + j * element_size_in, element_size_in);
                             }
-                            std::memcpy(eo.ptr(hdro.element_size() - hdri.element_size()),
-                                    element_loop.read(), hdri.element_size());
-                            element_loop.write(eo.ptr());
+                            element_loop.write(dst, n);
                         }
                         else
                         {
-                            element_loop.write(element_loop.read());
+                            element_loop.write(src, n);
                         }
                     }
                 }
@@ -134,16 +149,16 @@ extern "C" int gtatool_dimension_flatten(int argc, char *argv[])
                 {
                     // There were no element components, and now there are only the prepended
                     // coordinates. Generate them.
-                    element_loop_t element_loop;
-                    array_loop.start_element_loop(element_loop, hdri, hdro);
-                    for (uintmax_t e = 0; e < hdro.elements(); e++)
+                    size_t batch_size = element_loop_t::batch_size(hdro.element_size());
+                    for (uintmax_t e = 0; e < hdro.elements();)
                     {
-                        hdri.linear_index_to_indices(e, &(index[0]));
-                        for (size_t i = 0; i < index.size(); i++)
+                        size_t n = (hdro.elements() - e < batch_size ? hdro.elements() - e : batch_size);
+                        char *dst = static_cast<char *>(element_loop.out_batch(n));
+                        for (size_t j = 0; j < n; j++, e++)
                         {
-                            eo.ptr<uint64_t>()[i] = checked_cast<uint64_t>(index[i]);
+                            prepend(hdri, e, index, dst + j * element_size_out);
                         }
-                        element_loop.write(eo.ptr());
+                        element_loop.write(dst, n);
                     }
                 }
             }
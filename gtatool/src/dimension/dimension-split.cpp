@@ -133,24 +133,39 @@ extern "C" int gtatool_dimension_split(int argc, char *argv[])
                 uintmax_t tmpf_index = 0;
                 element_loop_t element_loop;
                 array_loop.start_element_loop(element_loop, hdri, hdro);
-                blob element(checked_cast<size_t>(hdri.element_size()));
-                std::vector<uintmax_t> indices(hdri.dimensions());
-                for (uintmax_t i = 0; i < hdri.elements(); i++)
+                size_t element_size = checked_cast<size_t>(hdri.element_size());
+                uintmax_t stride = 1;
+                for (uintmax_t d = 0; d < dim; d++)
                 {
-                    const void *e = element_loop.read();
-                    hdri.linear_index_to_indices(i, &(indices[0]));
-                    uintmax_t j = indices[dim];
-                    if (!tmpf || tmpf_index != j)
+                    stride *= hdri.dimension_size(d);
+                }
+                uintmax_t e = 0;
+                const void *elements;
+                size_t n;
+                while ((n = element_loop.read_batch(&elements)) > 0)
+                {
+                    // write runs of consecutive elements that share the same index in dimension dim
+                    size_t k = 0;
+                    while (k < n)
                     {
-                        if (tmpf)
+                        uintmax_t j = (e / stride) % dim_size;
+                        uintmax_t run = stride - e % stride;
+                        size_t m = (run < n - k ? run : n - k);
+                        if (!tmpf || tmpf_index != j)
                         {
-                            fio::close(tmpf, tmpf_name);
+                            if (tmpf)
+                            {
+                                fio::close(tmpf, tmpf_name);
+                            }
+                            tmpf_name = tempdir + "/" + str::from(j);
+                            tmpf = fio::open(tmpf_name, "a");
+                            tmpf_index = j;
                         }
-                        tmpf_name = tempdir + "/" + str::from(j);
-                        tmpf = fio::open(tmpf_name, "a");
-                        tmpf_index = j;
+                        fio::write(static_cast<const char *>(elements) + k * element_size,
+                                element_size, m, tmpf, tmpf_name);
+                        e += m;
+                        k += m;
                     }
-                    fio::write(e, element.size(), 1, tmpf, tmpf_name);
                 }
                 if (tmpf)
                 {
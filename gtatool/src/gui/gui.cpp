@@ -330,6 +330,12 @@ ArrayWidget::ArrayWidget(size_t index, gta::header *header, QWidget *parent)
     _compression_combobox->addItem("Zlib level 7");
     _compression_combobox->addItem("Zlib level 8");
     _compression_combobox->addItem("Zlib level 9");
+    _compression_combobox->addItem("Zstd default level");
+    for (int level = 1; level <= 19; level++)
+    {
+        _compression_combobox->addItem(QString("Zstd level %1").arg(level));
+    }
+    _compression_combobox->addItem("LZ4");
     _compression_combobox->setCurrentIndex(header->compression());
     connect(_compression_combobox, SIGNAL(activated(int)), this, SLOT(compression_changed(int)));
     layout->addWidget(_compression_combobox, 3, 1, 1, 2);
@@ -1073,10 +1079,12 @@ private:
     int _cmd_index;
     int _argc;
     char **_argv;
+    FILE *_std_out;
+    FILE *_std_in;
 
 public:
-    CmdThread(int cmd_index, int argc, char **argv)
-        : _cmd_index(cmd_index), _argc(argc), _argv(argv)
+    CmdThread(int cmd_index, int argc, char **argv, FILE *std_out, FILE *std_in)
+        : _cmd_index(cmd_index), _argc(argc), _argv(argv), _std_out(std_out), _std_in(std_in)
     {
     }
     ~CmdThread()
@@ -1086,6 +1094,9 @@ public:
     int retval;
     void run()
     {
+        // the standard streams of commands are thread-local
+        gtatool_stdout = _std_out;
+        gtatool_stdin = _std_in;
         retval = cmd_run(_cmd_index, _argc, _argv);
     }
 };
@@ -1167,7 +1178,7 @@ int GUI::run(const std::string &cmd, const std::vector<std::string> &args,
     mbox->setLayout(mbox_layout);
     mbox->show();
     QApplication::setOverrideCursor(QCursor(Qt::WaitCursor));
-    CmdThread cmd_thread(cmd_index, argv.size() - 1, &(argv[0]));
+    CmdThread cmd_thread(cmd_index, argv.size() - 1, &(argv[0]), gtatool_stdout, gtatool_stdin);
     cmd_thread.start();
     while (!cmd_thread.isFinished())
     {
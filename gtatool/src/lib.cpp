@@ -22,9 +22,11 @@
 #include "config.h"
 
 #include <limits>
+#include <algorithm>
 #include <sstream>
 #include <cstring>
 #include <cstddef>
+#include <deque>
 
 #include "base/str.h"
 #include "base/fio.h"
@@ -32,14 +34,16 @@
 #include "base/chk.h"
 #include "base/end.h"
 #include "base/dbg.h"
+#include "base/pth.h"
+#include "base/tsk.h"
 
 #include "lib.h"
 
 char *program_name = NULL;
 int* gtatool_argc = NULL;
 char** gtatool_argv = NULL;
-FILE *gtatool_stdin = NULL;
-FILE *gtatool_stdout = NULL;
+__thread FILE *gtatool_stdin = NULL;
+__thread FILE *gtatool_stdout = NULL;
 
 
 std::string type_to_string(const gta::type t, const uintmax_t size)
@@ -526,46 +530,1268 @@ std::string to_utf8(const std::string &s)
     return r;
 }
 
+/*
+ * Arrays in memory
+ */
+
+__thread array_pipe_t *gtatool_stdin_pipe = NULL;
+__thread array_pipe_t *gtatool_stdout_pipe = NULL;
+
+static size_t _memory_budget = static_cast<size_t>(256) * 1024 * 1024;
+
+size_t memory_budget()
+{
+    return _memory_budget;
+}
+
+void set_memory_budget(size_t bytes)
+{
+    _memory_budget = bytes;
+}
+
+/* Limits the number of bytes that are reserved at the same time. */
+class memory_budget_t
+{
+private:
+    mutex _mutex;
+    condition _cond;
+    const size_t _max;
+    size_t _used;
+
+public:
+    memory_budget_t(size_t max) : _mutex(), _cond(), _max(max), _used(0)
+    {
+    }
+
+    size_t max() const
+    {
+        return _max;
+    }
+
+    // Reserve n bytes. If they are not available, wait until they are if wait is
+    // true, or return false otherwise. Return false if n exceeds the budget.
+    bool reserve(size_t n, bool wait)
+    {
+        if (n > _max)
+        {
+            return false;
+        }
+        mutex_locker locker(_mutex);
+        while (_used > _max - n)
+        {
+            if (!wait)
+            {
+                return false;
+            }
+            _cond.wait(_mutex);
+        }
+        _used += n;
+        return true;
+    }
+
+    void release(size_t n)
+    {
+        mutex_locker locker(_mutex);
+        _used -= n;
+        _cond.wake_all();
+    }
+};
+
+/* An array in memory: its header, and its data as it follows the header in a
+ * stream. The header always describes data in host endianness, so the data of
+ * an uncompressed array can be used directly. The data may also be kept in a
+ * temporary file instead. */
+class memory_array_t
+{
+private:
+    memory_array_t(const memory_array_t &);
+    memory_array_t &operator=(const memory_array_t &);
+
+public:
+    gta::header header;
+    blob data;                  // the data; the blob may be larger
+    size_t size;                // the size of the data
+    FILE *file;                 // a temporary file with the data instead of the blob, or NULL
+    memory_budget_t *budget;    // the budget in which the data is reserved, or NULL
+    size_t reserved;            // the number of bytes reserved in the budget
+
+    memory_array_t(const gta::header &hdr) :
+        header(), data(), size(0), file(NULL), budget(NULL), reserved(0)
+    {
+        // Build a new header instead of copying hdr: a copy of a header that was
+        // read from a stream with the other endianness would describe data with
+        // that endianness.
+        std::vector<gta::type> types(checked_cast<size_t>(hdr.components()));
+        std::vector<uintmax_t> sizes(types.size());
+        for (size_t i = 0; i < types.size(); i++)
+        {
+            types[i] = hdr.component_type(i);
+            sizes[i] = hdr.component_size(i);
+        }
+        header.set_components(types.size(),
+                types.size() > 0 ? &(types[0]) : NULL,
+                sizes.size() > 0 ? &(sizes[0]) : NULL);
+        std::vector<uintmax_t> dim_sizes(checked_cast<size_t>(hdr.dimensions()));
+        for (size_t i = 0; i < dim_sizes.size(); i++)
+        {
+            dim_sizes[i] = hdr.dimension_size(i);
+        }
+        header.set_dimensions(dim_sizes.size(), dim_sizes.size() > 0 ? &(dim_sizes[0]) : NULL);
+        header.global_taglist() = hdr.global_taglist();
+        for (size_t i = 0; i < types.size(); i++)
+        {
+            header.component_taglist(i) = hdr.component_taglist(i);
+        }
+        for (size_t i = 0; i < dim_sizes.size(); i++)
+        {
+            header.dimension_taglist(i) = hdr.dimension_taglist(i);
+        }
+        header.set_compression(hdr.compression());
+        header.set_filter(hdr.filter());
+        header.set_compression_threads(hdr.compression_threads());
+        header.set_decompression_threads(hdr.decompression_threads());
+    }
+
+    ~memory_array_t()
+    {
+        if (file)
+        {
+            std::fclose(file);
+        }
+        set_budget(NULL, 0);
+    }
+
+    // Let the data count against the given budget, in which n bytes are reserved.
+    void set_budget(memory_budget_t *b, size_t n)
+    {
+        if (budget)
+        {
+            budget->release(reserved);
+        }
+        budget = b;
+        reserved = n;
+    }
+
+    // Whether the data is uncompressed and in memory, so that it can be used directly.
+    bool direct() const
+    {
+        return (!file && header.compression() == gta::none);
+    }
+
+    // Make room for n more bytes of data.
+    void grow(size_t n)
+    {
+        if (data.size() - size < n)
+        {
+            data.resize(std::max(checked_add(size, n), data.size() + data.size() / 2));
+        }
+    }
+
+    // Move the data into a temporary file.
+    void spill()
+    {
+        FILE *f = fio::tempfile();
+        try
+        {
+            fio::write(data.ptr(), 1, size, f);
+            fio::rewind(f);
+        }
+        catch (...)
+        {
+            std::fclose(f);
+            throw;
+        }
+        file = f;
+        data.free();
+        set_budget(NULL, 0);
+    }
+
+    // Open a stream that reads the data, or that appends to it. It must be closed
+    // with close_stream().
+    FILE *open_stream(bool write);
+    void close_stream(FILE *f, bool write);
+};
+
+#if HAVE_FOPENCOOKIE
+/* A stream that reads the data of an array in memory, or that appends to it. */
+class memory_array_stream_t
+{
+private:
+    memory_array_t *_array;
+    size_t _pos;
+
+    static ssize_t read(void *cookie, char *buf, size_t size)
+    {
+        memory_array_stream_t *s = static_cast<memory_array_stream_t *>(cookie);
+        size_t n = std::min(size, s->_array->size - s->_pos);
+        std::memcpy(buf, s->_array->data.ptr<char>(s->_pos), n);
+        s->_pos += n;
+        return n;
+    }
+
+    static ssize_t write(void *cookie, const char *buf, size_t size)
+    {
+        memory_array_stream_t *s = static_cast<memory_array_stream_t *>(cookie);
+        try
+        {
+            s->_array->grow(size);
+        }
+        catch (...)
+        {
+            errno = ENOMEM;
+            return 0;
+        }
+        std::memcpy(s->_array->data.ptr<char>(s->_array->size), buf, size);
+        s->_array->size += size;
+        s->_pos = s->_array->size;
+        return size;
+    }
+
+    static int seek(void *cookie, off64_t *offset, int whence)
+    {
+        memory_array_stream_t *s = static_cast<memory_array_stream_t *>(cookie);
+        off64_t base = (whence == SEEK_SET ? 0 : whence == SEEK_CUR ? s->_pos : s->_array->size);
+        if ((*offset < 0 && -*offset > base) || (*offset > 0 && *offset > static_cast<off64_t>(s->_array->size) - base))
+        {
+            errno = EINVAL;
+            return -1;
+        }
+        s->_pos = base + *offset;
+        *offset = s->_pos;
+        return 0;
+    }
+
+    static int close(void *cookie)
+    {
+        delete static_cast<memory_array_stream_t *>(cookie);
+        return 0;
+    }
+
+public:
+    static FILE *open(memory_array_t *a, bool write)
+    {
+        memory_array_stream_t *s = new memory_array_stream_t;
+        s->_array = a;
+        s->_pos = 0;
+        cookie_io_functions_t functions = { read, memory_array_stream_t::write, seek, close };
+        FILE *f = fopencookie(s, write ? "w" : "r", functions);
+        if (!f)
+        {
+            int e = errno;
+            delete s;
+            throw exc(std::string("Cannot access array data: ") + std::strerror(e), e);
+        }
+        return f;
+    }
+};
+#endif
+
+FILE *memory_array_t::open_stream(bool write)
+{
+    if (!file)
+    {
+#if HAVE_FOPENCOOKIE
+        return memory_array_stream_t::open(this, write);
+#else
+        // without memory streams, the data must be in a file
+        (void)write;
+        spill();
+#endif
+    }
+    return file;
+}
+
+void memory_array_t::close_stream(FILE *f, bool write)
+{
+    if (f != file)
+    {
+        fio::close(f);
+    }
+    else if (write)
+    {
+        size = checked_cast<size_t>(fio::tell(file));
+        fio::rewind(file);
+    }
+    else
+    {
+        fio::rewind(file);
+    }
+}
+
+/* A part of the contents of an array pipe: an array, or bytes that were written
+ * to the stream of the write end. */
+class array_pipe_segment_t
+{
+public:
+    memory_array_t *array;
+    blob bytes;
+    size_t size;
+    size_t pos;
+
+    array_pipe_segment_t(memory_array_t *a) : array(a), bytes(), size(0), pos(0)
+    {
+    }
+
+    ~array_pipe_segment_t()
+    {
+        delete array;
+    }
+};
+
+/* Appends the bytes of an encoded header to a blob. */
+class blob_io_t : public gta::custom_io
+{
+private:
+    blob &_blob;
+    size_t &_size;
+
+public:
+    blob_io_t(blob &b, size_t &size) : _blob(b), _size(size)
+    {
+    }
+
+    size_t write(const void *buffer, size_t size, bool *error)
+    {
+        try
+        {
+            if (_blob.size() - _size < size)
+            {
+                _blob.resize(checked_add(_size, size));
+            }
+        }
+        catch (...)
+        {
+            errno = ENOMEM;
+            *error = true;
+            return 0;
+        }
+        std::memcpy(_blob.ptr<char>(_size), buffer, size);
+        _size += size;
+        return size;
+    }
+};
+
+class array_pipe_t
+{
+private:
+    static const size_t _bytes_capacity = 1024 * 1024;
+
+    mutex _mutex;
+    condition _cond;
+    std::deque<array_pipe_segment_t *> _segments;
+    size_t _bytes;                      // the number of unread bytes
+    memory_budget_t _own_budget;
+    memory_budget_t *_budget;           // the budget for the arrays in the pipe
+    bool _wait;                         // whether to wait for room in the budget
+    bool _peeking;                      // whether the stream reader only wants bytes
+    bool _reader_closed;
+    bool _writer_closed;
+
+    array_pipe_t(const array_pipe_t &);
+    array_pipe_t &operator=(const array_pipe_t &);
+
+    // Encode the array of the segment for a reader of the stream. The mutex must
+    // be locked.
+    void encode(array_pipe_segment_t *seg)
+    {
+        memory_array_t *a = seg->array;
+        blob_io_t io(seg->bytes, seg->size);
+        a->header.write_to(io);
+        seg->bytes.resize(checked_add(seg->size, a->size));
+        if (a->file)
+        {
+            fio::read(seg->bytes.ptr(seg->size), 1, a->size, a->file);
+        }
+        else if (a->size > 0)
+        {
+            std::memcpy(seg->bytes.ptr(seg->size), a->data.ptr(), a->size);
+        }
+        seg->size += a->size;
+        _bytes += seg->size;
+        seg->array = NULL;
+        delete a;
+    }
+
+    // Read bytes from the pipe, encoding arrays as necessary. Returns 0 at the end,
+    // and also at an array when peeking. Never reads across segments, so that
+    // the stream does not buffer bytes of arrays that were not asked for.
+    size_t read_bytes(char *buf, size_t size)
+    {
+        mutex_locker locker(_mutex);
+        while (_segments.empty() && !_writer_closed)
+        {
+            _cond.wait(_mutex);
+        }
+        if (_segments.empty() || (_peeking && _segments.front()->array))
+        {
+            return 0;
+        }
+        array_pipe_segment_t *seg = _segments.front();
+        if (seg->array)
+        {
+            encode(seg);
+        }
+        size_t n = std::min(size, seg->size - seg->pos);
+        std::memcpy(buf, seg->bytes.ptr<char>(seg->pos), n);
+        seg->pos += n;
+        _bytes -= n;
+        if (seg->pos == seg->size)
+        {
+            _segments.pop_front();
+            delete seg;
+        }
+        _cond.wake_all();
+        return n;
+    }
+
+    // Write bytes to the pipe. Returns less than size if the reader closed the pipe.
+    size_t write_bytes(const char *buf, size_t size)
+    {
+        mutex_locker locker(_mutex);
+        size_t written = 0;
+        while (written < size)
+        {
+            while (_bytes >= _bytes_capacity && !_reader_closed)
+            {
+                _cond.wait(_mutex);
+            }
+            if (_reader_closed)
+            {
+                break;
+            }
+            array_pipe_segment_t *seg = (_segments.empty() ? NULL : _segments.back());
+            if (!seg || seg->array || seg->size == seg->bytes.size())
+            {
+                seg = new array_pipe_segment_t(NULL);
+                try
+                {
+                    seg->bytes.resize(_bytes_capacity);
+                    _segments.push_back(seg);
+                }
+                catch (...)
+                {
+                    delete seg;
+                    throw;
+                }
+            }
+            size_t n = std::min(size - written, seg->bytes.size() - seg->size);
+            std::memcpy(seg->bytes.ptr<char>(seg->size), buf + written, n);
+            seg->size += n;
+            _bytes += n;
+            written += n;
+            _cond.wake_all();
+        }
+        return written;
+    }
+
+#if HAVE_FOPENCOOKIE
+    static ssize_t read_cookie(void *cookie, char *buf, size_t size)
+    {
+        try
+        {
+            return static_cast<array_pipe_t *>(cookie)->read_bytes(buf, size);
+        }
+        catch (...)
+        {
+            errno = (errno == 0 ? EIO : errno);
+            return -1;
+        }
+    }
+
+    static ssize_t write_cookie(void *cookie, const char *buf, size_t size)
+    {
+        size_t n;
+        try
+        {
+            n = static_cast<array_pipe_t *>(cookie)->write_bytes(buf, size);
+        }
+        catch (...)
+        {
+            errno = ENOMEM;
+            return 0;
+        }
+        if (n < size)
+        {
+            errno = EPIPE;
+        }
+        return n;
+    }
+
+    // Close one end, and delete the pipe when both ends are closed.
+    static int close_cookie(void *cookie, bool reader)
+    {
+        array_pipe_t *p = static_cast<array_pipe_t *>(cookie);
+        if (p->close(reader))
+        {
+            delete p;
+        }
+        return 0;
+    }
+
+    static int close_reader_cookie(void *cookie)
+    {
+        return close_cookie(cookie, true);
+    }
+
+    static int close_writer_cookie(void *cookie)
+    {
+        return close_cookie(cookie, false);
+    }
+
+    friend array_pipe_t *array_pipe_open(FILE **read_end, FILE **write_end);
+#endif
+
+public:
+    // A pipe between commands. Writing an array waits for room in the memory
+    // budget; arrays that are larger than the whole budget go through the stream.
+    array_pipe_t() :
+        _mutex(), _cond(), _segments(), _bytes(0),
+        _own_budget(memory_budget()), _budget(&_own_budget), _wait(true), _peeking(false),
+        _reader_closed(false), _writer_closed(false)
+    {
+    }
+
+    // A pipe whose arrays are reserved in the given budget. The data of arrays
+    // that do not fit into it is kept in temporary files.
+    array_pipe_t(memory_budget_t *budget) :
+        _mutex(), _cond(), _segments(), _bytes(0),
+        _own_budget(0), _budget(budget), _wait(false), _peeking(false),
+        _reader_closed(false), _writer_closed(false)
+    {
+    }
+
+    ~array_pipe_t()
+    {
+        for (size_t i = 0; i < _segments.size(); i++)
+        {
+            delete _segments[i];
+        }
+    }
+
+    // Create an array to put into the pipe, or return NULL if the array must be
+    // written to the stream instead.
+    memory_array_t *new_array(const gta::header &header)
+    {
+        memory_array_t *a = new memory_array_t(header);
+        try
+        {
+            uintmax_t size = header.data_size();
+            if (size <= std::numeric_limits<size_t>::max() && _budget->reserve(size, _wait))
+            {
+                a->set_budget(_budget, size);
+            }
+            else if (_wait)
+            {
+                delete a;
+                a = NULL;
+            }
+            else
+            {
+                a->file = fio::tempfile();
+            }
+        }
+        catch (...)
+        {
+            delete a;
+            throw;
+        }
+        return a;
+    }
+
+    // Append an array to the pipe. The pipe owns the array, even if this fails.
+    void put(memory_array_t *a)
+    {
+        array_pipe_segment_t *seg = NULL;
+        try
+        {
+            if (!a->file && a->budget != _budget)
+            {
+                // the array moves from another budget into this one
+                size_t n = std::min(a->size, _budget->max());
+                if (_budget->reserve(n, _wait))
+                {
+                    a->set_budget(_budget, n);
+                }
+                else
+                {
+                    a->spill();
+                }
+            }
+            seg = new array_pipe_segment_t(a);
+        }
+        catch (...)
+        {
+            delete a;
+            throw;
+        }
+        mutex_locker locker(_mutex);
+        if (_reader_closed)
+        {
+            delete seg;
+            throw exc(std::string("Cannot write output: ") + std::strerror(EPIPE), EPIPE);
+        }
+        try
+        {
+            _segments.push_back(seg);
+        }
+        catch (...)
+        {
+            delete seg;
+            throw;
+        }
+        _cond.wake_all();
+    }
+
+    // While peeking, reading the stream of the read end returns only bytes that
+    // were written to the stream, and reports the end of the stream at an array.
+    void set_peeking(bool peeking)
+    {
+        mutex_locker locker(_mutex);
+        _peeking = peeking;
+    }
+
+    // Take the next array out of the pipe. Return NULL if there is no array
+    // before the end of the pipe or before bytes that were written to the stream.
+    memory_array_t *get()
+    {
+        mutex_locker locker(_mutex);
+        while (_segments.empty() && !_writer_closed)
+        {
+            _cond.wait(_mutex);
+        }
+        memory_array_t *a = NULL;
+        if (!_segments.empty() && _segments.front()->array)
+        {
+            array_pipe_segment_t *seg = _segments.front();
+            a = seg->array;
+            seg->array = NULL;
+            _segments.pop_front();
+            delete seg;
+            _cond.wake_all();
+        }
+        return a;
+    }
+
+    // Close one end of the pipe. Returns whether both ends are closed.
+    bool close(bool reader)
+    {
+        mutex_locker locker(_mutex);
+        if (reader)
+        {
+            _reader_closed = true;
+            // nobody reads the remaining contents; this releases their memory
+            for (size_t i = 0; i < _segments.size(); i++)
+            {
+                delete _segments[i];
+            }
+            _segments.clear();
+            _bytes = 0;
+        }
+        else
+        {
+            _writer_closed = true;
+        }
+        _cond.wake_all();
+        return (_reader_closed && _writer_closed);
+    }
+};
+
+#if HAVE_FOPENCOOKIE
+array_pipe_t *array_pipe_open(FILE **read_end, FILE **write_end)
+{
+    array_pipe_t *p = new array_pipe_t;
+    cookie_io_functions_t read_functions = { array_pipe_t::read_cookie, NULL, NULL, array_pipe_t::close_reader_cookie };
+    cookie_io_functions_t write_functions = { NULL, array_pipe_t::write_cookie, NULL, array_pipe_t::close_writer_cookie };
+    *read_end = fopencookie(p, "r", read_functions);
+    if (!*read_end)
+    {
+        delete p;
+        throw exc(std::string("Cannot create pipe: ") + std::strerror(errno), errno);
+    }
+    *write_end = fopencookie(p, "w", write_functions);
+    if (!*write_end)
+    {
+        int e = errno;
+        // closing both ends deletes the pipe
+        std::fclose(*read_end);
+        array_pipe_t::close_writer_cookie(p);
+        throw exc(std::string("Cannot create pipe: ") + std::strerror(e), e);
+    }
+    return p;
+}
+#endif
+
+
+/* A batch of elements that is passed between threads. */
+class element_batch_t
+{
+public:
+    blob buf;
+    size_t n;
+
+    element_batch_t() : buf(), n(0)
+    {
+    }
+};
+
+/* A bounded queue of element batches. A fixed number of batches circulates
+ * between the free and the full list, so the producer blocks when the consumer
+ * falls behind. After abort(), all waiting and future get calls return NULL. */
+class element_batch_queue_t
+{
+private:
+    mutex _mutex;
+    condition _cond;
+    std::vector<element_batch_t> _batches;
+    std::deque<element_batch_t *> _free;
+    std::deque<element_batch_t *> _full;
+    bool _aborted;
+
+    element_batch_t *get(std::deque<element_batch_t *> &list)
+    {
+        _mutex.lock();
+        while (list.empty() && !_aborted)
+        {
+            _cond.wait(_mutex);
+        }
+        element_batch_t *batch = NULL;
+        if (!_aborted)
+        {
+            batch = list.front();
+            list.pop_front();
+        }
+        _mutex.unlock();
+        return batch;
+    }
+
+    void put(std::deque<element_batch_t *> &list, element_batch_t *batch)
+    {
+        _mutex.lock();
+        list.push_back(batch);
+        _cond.wake_all();
+        _mutex.unlock();
+    }
+
+public:
+    element_batch_queue_t(size_t batches, size_t batch_bytes) :
+        _mutex(), _cond(), _batches(batches), _free(), _full(), _aborted(false)
+    {
+        for (size_t i = 0; i < _batches.size(); i++)
+        {
+            _batches[i].buf.resize(batch_bytes);
+            _free.push_back(&(_batches[i]));
+        }
+    }
+
+    element_batch_t *get_free()
+    {
+        return get(_free);
+    }
+
+    element_batch_t *get_full()
+    {
+        return get(_full);
+    }
+
+    void put_free(element_batch_t *batch)
+    {
+        put(_free, batch);
+    }
+
+    void put_full(element_batch_t *batch)
+    {
+        put(_full, batch);
+    }
+
+    void abort()
+    {
+        _mutex.lock();
+        _aborted = true;
+        _cond.wake_all();
+        _mutex.unlock();
+    }
+};
+
+/* Enough batches for one being filled, one being processed, and one in the queue. */
+static const size_t element_queue_batches = 3;
+
+/* Reads and decodes the input elements of an array in a separate thread. */
+class element_reader_t : public thread
+{
+private:
+    const gta::header _header;
+    const std::string _name;
+    FILE *_file;
+    const size_t _element_size;
+    const size_t _batch_size;
+    element_batch_queue_t _queue;
+    // consumer side
+    bool _started;
+    element_batch_t *_batch;
+    size_t _batch_pos;
+    uintmax_t _elements_taken;
+    blob _buf;
+
+    void next_batch()
+    {
+        if (_elements_taken == _header.elements())
+        {
+            // the thread is done and will not deliver another batch
+            throw exc(_name + ": unexpected end of array data");
+        }
+        if (_batch)
+        {
+            _queue.put_free(_batch);
+        }
+        _batch = _queue.get_full();
+        _batch_pos = 0;
+        if (!_batch)
+        {
+            finish();
+            throw exc(_name + ": cannot read array elements");
+        }
+        _elements_taken += _batch->n;
+        if (_elements_taken == _header.elements())
+        {
+            // the thread is done; this makes sure that the input file position is
+            // at the end of the array data
+            finish();
+        }
+    }
+
+public:
+    element_reader_t(const gta::header &header, const std::string &name, FILE *file, size_t batch_size) :
+        _header(header), _name(name), _file(file),
+        _element_size(checked_cast<size_t>(header.element_size())), _batch_size(batch_size),
+        _queue(element_queue_batches, checked_mul(batch_size, _element_size)),
+        _started(false), _batch(NULL), _batch_pos(0), _elements_taken(0), _buf()
+    {
+    }
+
+    void run()
+    {
+        try
+        {
+            gta::io_state state;
+            uintmax_t remaining = _header.elements();
+            while (remaining > 0)
+            {
+                element_batch_t *batch = _queue.get_free();
+                if (!batch)
+                {
+                    break;
+                }
+                batch->n = (remaining < _batch_size ? remaining : _batch_size);
+                _header.read_elements(state, _file, batch->n, batch->buf.ptr());
+                remaining -= batch->n;
+                _queue.put_full(batch);
+            }
+        }
+        catch (...)
+        {
+            _queue.abort();
+            throw;
+        }
+    }
+
+    /* The number of elements that can be read without copying. */
+    size_t available()
+    {
+        if (!_started)
+        {
+            _started = true;
+            start();
+        }
+        if (!_batch || _batch_pos == _batch->n)
+        {
+            next_batch();
+        }
+        return _batch->n - _batch_pos;
+    }
+
+    const void *read(size_t n)
+    {
+        if (n <= available())
+        {
+            const void *elements = _batch->buf.ptr(_batch_pos * _element_size);
+            _batch_pos += n;
+            return elements;
+        }
+        // the elements span more than one batch
+        if (_buf.size() < checked_mul(n, _element_size))
+        {
+            _buf.resize(n * _element_size);
+        }
+        size_t i = 0;
+        while (i < n)
+        {
+            size_t m = std::min(n - i, available());
+            std::memcpy(_buf.ptr(i * _element_size), _batch->buf.ptr(_batch_pos * _element_size), m * _element_size);
+            _batch_pos += m;
+            i += m;
+        }
+        return _buf.ptr();
+    }
+
+    void stop() throw ()
+    {
+        _queue.abort();
+        try
+        {
+            wait();
+        }
+        catch (...)
+        {
+        }
+    }
+};
+
+/* Encodes and writes the output elements of an array in a separate thread. */
+class element_writer_t : public thread
+{
+private:
+    const gta::header _header;
+    const std::string _name;
+    FILE *_file;
+    const size_t _element_size;
+    const size_t _batch_size;
+    element_batch_queue_t _queue;
+    // producer side
+    bool _started;
+    element_batch_t *_batch;
+    uintmax_t _elements_given;
+
+public:
+    element_writer_t(const gta::header &header, const std::string &name, FILE *file, size_t batch_size) :
+        _header(header), _name(name), _file(file),
+        _element_size(checked_cast<size_t>(header.element_size())), _batch_size(batch_size),
+        _queue(element_queue_batches, checked_mul(batch_size, _element_size)),
+        _started(false), _batch(NULL), _elements_given(0)
+    {
+    }
+
+    void run()
+    {
+        try
+        {
+            gta::io_state state;
+            uintmax_t remaining = _header.elements();
+            while (remaining > 0)
+            {
+                element_batch_t *batch = _queue.get_full();
+                if (!batch)
+                {
+                    break;
+                }
+                _header.write_elements(state, _file, batch->n, batch->buf.ptr());
+                remaining -= batch->n;
+                _queue.put_free(batch);
+            }
+        }
+        catch (...)
+        {
+            _queue.abort();
+            throw;
+        }
+    }
+
+    void write(const void *elements, size_t n)
+    {
+        if (n > _header.elements() - _elements_given)
+        {
+            throw exc(_name + ": too many array elements");
+        }
+        if (!_started)
+        {
+            _started = true;
+            start();
+        }
+        const char *src = static_cast<const char *>(elements);
+        while (n > 0)
+        {
+            if (!_batch)
+            {
+                _batch = _queue.get_free();
+                if (!_batch)
+                {
+                    finish();
+                    throw exc(_name + ": cannot write array elements");
+                }
+                _batch->n = 0;
+            }
+            size_t m = std::min(n, _batch_size - _batch->n);
+            std::memcpy(_batch->buf.ptr(_batch->n * _element_size), src, m * _element_size);
+            _batch->n += m;
+            _elements_given += m;
+            src += m * _element_size;
+            n -= m;
+            if (_batch->n == _batch_size || _elements_given == _header.elements())
+            {
+                _queue.put_full(_batch);
+                _batch = NULL;
+            }
+        }
+        if (_elements_given == _header.elements())
+        {
+            // wait until all elements are written, and report errors
+            finish();
+        }
+    }
+
+    void stop() throw ()
+    {
+        _queue.abort();
+        try
+        {
+            wait();
+        }
+        catch (...)
+        {
+        }
+    }
+};
+
 const size_t element_loop_t::_max_iobuf_size = 1024 * 1024;
 
-element_loop_t::element_loop_t() throw ()
-    : _header_in(), _name_in(), _file_in(NULL), _state_in(),
-    _header_out(), _name_out(), _file_out(NULL), _state_out(), _buf()
+element_loop_t::element_loop_t() throw ()
+    : _header_in(), _name_in(), _file_in(NULL), _state_in(),
+    _header_out(), _name_out(), _file_out(NULL), _state_out(), _buf(), _buf_out(),
+    _batch_size(1), _elements_read(0), _reader(NULL), _writer(NULL),
+    _array_in(NULL), _array_out(NULL)
+{
+}
+
+element_loop_t::~element_loop_t()
+{
+    stop();
+}
+
+void element_loop_t::stop() throw ()
+{
+    if (_reader)
+    {
+        _reader->stop();
+        delete _reader;
+        _reader = NULL;
+    }
+    if (_writer)
+    {
+        _writer->stop();
+        delete _writer;
+        _writer = NULL;
+    }
+}
+
+void element_loop_t::start(
+        const gta::header &header_in, const std::string &name_in, FILE *file_in,
+        const gta::header &header_out, const std::string &name_out, FILE *file_out)
+{
+    stop();
+    _header_in = header_in;
+    _name_in = name_in;
+    _file_in = file_in;
+    _state_in = gta::io_state();
+    _header_out = header_out;
+    _name_out = name_out;
+    _file_out = file_out;
+    _state_out = gta::io_state();
+    _buf.resize(0);
+    _buf_out.resize(0);
+    _batch_size = batch_size(std::max(_header_in.element_size(), _header_out.element_size()));
+    _elements_read = 0;
+    _array_in = NULL;
+    _array_out = NULL;
+}
+
+/* The reader and writer threads are only used for arrays that are larger than
+ * one batch. They are created on the first read or write, because many commands
+ * use an element loop only in one direction. */
+
+bool element_loop_t::threaded_in()
+{
+    if (!_reader && !_array_in && _header_in.data_size() > _max_iobuf_size)
+    {
+        _reader = new element_reader_t(_header_in, _name_in, _file_in, _batch_size);
+    }
+    return (_reader != NULL);
+}
+
+bool element_loop_t::threaded_out()
+{
+    if (!_writer && !_array_out && _header_out.data_size() > _max_iobuf_size)
+    {
+        _writer = new element_writer_t(_header_out, _name_out, _file_out, _batch_size);
+    }
+    return (_writer != NULL);
+}
+
+const void *element_loop_t::read(size_t n)
+{
+    const void *elements;
+    if (_array_in)
+    {
+        if (n > _header_in.elements() - _elements_read)
+        {
+            throw exc(_name_in + ": unexpected end of array data");
+        }
+        // the elements are used in place
+        elements = _array_in->data.ptr(checked_cast<size_t>(_elements_read * _header_in.element_size()));
+    }
+    else if (threaded_in())
+    {
+        elements = _reader->read(n);
+    }
+    else
+    {
+        if (_buf.size() < checked_cast<size_t>(n * _header_in.element_size()))
+        {
+            _buf.resize(n * _header_in.element_size());
+        }
+        _header_in.read_elements(_state_in, _file_in, n, _buf.ptr());
+        elements = _buf.ptr();
+    }
+    _elements_read += n;
+    return elements;
+}
+
+/* Copy the given components of n elements to the buffers, with the given strides. */
+static void gather_components(const gta::header &header, const void *elements, size_t n,
+        const std::vector<uintmax_t> &components, void *const *buffers, const size_t *strides)
+{
+    size_t element_size = checked_cast<size_t>(header.element_size());
+    for (size_t i = 0; i < components.size(); i++)
+    {
+        size_t offset = static_cast<const char *>(header.component(elements, components[i]))
+            - static_cast<const char *>(elements);
+        size_t size = checked_cast<size_t>(header.component_size(components[i]));
+        size_t stride = (strides ? strides[i] : size);
+        const char *src = static_cast<const char *>(elements) + offset;
+        char *dst = static_cast<char *>(buffers[i]);
+        for (size_t j = 0; j < n; j++)
+        {
+            std::memcpy(dst, src, size);
+            src += element_size;
+            dst += stride;
+        }
+    }
+}
+
+void element_loop_t::read_components(const std::vector<uintmax_t> &components, void *const *buffers, size_t n)
 {
+    if (_array_in || threaded_in())
+    {
+        for (size_t i = 0; i < components.size(); i++)
+        {
+            if (components[i] >= _header_in.components())
+            {
+                throw exc(_name_in + ": array has no component " + str::from(components[i]));
+            }
+        }
+        gather_components(_header_in, read(n), n, components, buffers, NULL);
+        return;
+    }
+    _header_in.read_element_components(_state_in, _file_in, n,
+            components.size(), components.size() > 0 ? &(components[0]) : NULL, buffers);
+    _elements_read += n;
 }
 
-element_loop_t::~element_loop_t()
+const void *element_loop_t::read_components(const std::vector<uintmax_t> &components, size_t n)
 {
+    std::vector<void *> buffers(components.size());
+    std::vector<size_t> strides(components.size());
+    size_t element_size = 0;
+    for (size_t i = 0; i < components.size(); i++)
+    {
+        if (components[i] >= _header_in.components())
+        {
+            throw exc(_name_in + ": array has no component " + str::from(components[i]));
+        }
+        element_size += checked_cast<size_t>(_header_in.component_size(components[i]));
+    }
+    if (_buf.size() < checked_cast<size_t>(n * element_size))
+    {
+        _buf.resize(n * element_size);
+    }
+    size_t offset = 0;
+    for (size_t i = 0; i < components.size(); i++)
+    {
+        buffers[i] = _buf.ptr(offset);
+        strides[i] = element_size;
+        offset += checked_cast<size_t>(_header_in.component_size(components[i]));
+    }
+    if (_array_in || threaded_in())
+    {
+        gather_components(_header_in, read(n), n, components,
+                components.size() > 0 ? &(buffers[0]) : NULL,
+                components.size() > 0 ? &(strides[0]) : NULL);
+        return _buf.ptr();
+    }
+    _header_in.read_element_components(_state_in, _file_in, n,
+            components.size(), components.size() > 0 ? &(components[0]) : NULL,
+            components.size() > 0 ? &(buffers[0]) : NULL,
+            components.size() > 0 ? &(strides[0]) : NULL);
+    _elements_read += n;
+    return _buf.ptr();
 }
 
-void element_loop_t::start(
-        const gta::header &header_in, const std::string &name_in, FILE *file_in,
-        const gta::header &header_out, const std::string &name_out, FILE *file_out)
+void element_loop_t::write(const void *element, size_t n)
 {
-    _header_in = header_in;
-    _name_in = name_in;
-    _file_in = file_in;
-    _state_in = gta::io_state();
-    _header_out = header_out;
-    _name_out = name_out;
-    _file_out = file_out;
-    _state_out = gta::io_state();
-    _buf.resize(0);
+    if (_array_out)
+    {
+        size_t element_size = checked_cast<size_t>(_header_out.element_size());
+        if (n > (_header_out.data_size() - _array_out->size) / std::max(element_size, static_cast<size_t>(1)))
+        {
+            throw exc(_name_out + ": too many array elements");
+        }
+        // the elements may already be in place; see out_batch()
+        void *dst = _array_out->data.ptr(_array_out->size);
+        if (dst != element)
+        {
+            std::memmove(dst, element, n * element_size);
+        }
+        _array_out->size += n * element_size;
+    }
+    else if (threaded_out())
+    {
+        _writer->write(element, n);
+    }
+    else
+    {
+        _header_out.write_elements(_state_out, _file_out, n, element);
+    }
 }
 
-const void *element_loop_t::read(size_t n)
+size_t element_loop_t::read_batch(const void **elements)
 {
-    if (_buf.size() < checked_cast<size_t>(n * _header_in.element_size()))
+    uintmax_t remaining = _header_in.elements() - _elements_read;
+    size_t n = (remaining < _batch_size ? remaining : _batch_size);
+    if (n > 0 && threaded_in())
     {
-        _buf.resize(n * _header_in.element_size());
+        // use the batches of the reader thread to avoid copying
+        n = std::min(n, _reader->available());
     }
-    _header_in.read_elements(_state_in, _file_in, n, _buf.ptr());
-    return _buf.ptr();
+    *elements = (n > 0 ? read(n) : NULL);
+    return n;
 }
 
-void element_loop_t::write(const void *element, size_t n)
+void *element_loop_t::out_batch(size_t n)
+{
+    if (_array_out && n <= (_header_out.data_size() - _array_out->size)
+            / std::max(checked_cast<size_t>(_header_out.element_size()), static_cast<size_t>(1)))
+    {
+        // let the command produce the elements in place
+        return _array_out->data.ptr(_array_out->size);
+    }
+    if (_buf_out.size() < checked_cast<size_t>(n * _header_out.element_size()))
+    {
+        _buf_out.resize(n * _header_out.element_size());
+    }
+    return _buf_out.ptr();
+}
+
+size_t element_loop_t::batch_size(uintmax_t element_size)
 {
-    _header_out.write_elements(_state_out, _file_out, n, element);
+    return (element_size == 0 || element_size >= _max_iobuf_size ? 1 : _max_iobuf_size / element_size);
 }
 
 const std::string array_loop_t::_stdin_name = "standard input";
@@ -576,12 +1802,22 @@ array_loop_t::array_loop_t() throw ()
     _file_in(NULL), _file_out(NULL),
     _filename_index(0), _file_index_in(0),
     _index_in(0), _index_out(0),
-    _array_name_in(), _array_name_out()
+    _array_name_in(), _array_name_out(),
+    _pipe_in(NULL), _pipe_out(NULL), _array_in(NULL), _array_out(NULL),
+    _array_in_file(NULL), _array_out_file(NULL), _job(false)
 {
 }
 
 array_loop_t::~array_loop_t()
 {
+    release_array_in();
+    try
+    {
+        commit_array_out();
+    }
+    catch (...)
+    {
+    }
     if (_file_in && _file_in != gtatool_stdin)
     {
         try
@@ -620,6 +1856,7 @@ void array_loop_t::start(const std::vector<std::string> &filenames_in,
     if (_filenames_in.size() == 0)
     {
         _file_in = gtatool_stdin;
+        _pipe_in = gtatool_stdin_pipe;
     }
     else
     {
@@ -628,6 +1865,7 @@ void array_loop_t::start(const std::vector<std::string> &filenames_in,
     if (_filename_out.length() == 0)
     {
         _file_out = gtatool_stdout;
+        _pipe_out = gtatool_stdout_pipe;
     }
     else
     {
@@ -637,6 +1875,8 @@ void array_loop_t::start(const std::vector<std::string> &filenames_in,
 
 void array_loop_t::finish()
 {
+    commit_array_out();
+    release_array_in();
     if (_file_out && _file_out != gtatool_stdout)
     {
         FILE *f = _file_out;
@@ -655,34 +1895,145 @@ void array_loop_t::finish()
 
 const std::string &array_loop_t::filename_in() throw ()
 {
-    return (_file_in == gtatool_stdin ? _stdin_name : _filenames_in[_filename_index]);
+    return (_filenames_in.size() == 0 ? _stdin_name : _filenames_in[_filename_index]);
 }
 
 const std::string &array_loop_t::filename_out() throw ()
 {
-    return (_file_out == gtatool_stdout ? _stdout_name : _filename_out);
+    return (_filename_out.length() == 0 ? _stdout_name : _filename_out);
+}
+
+FILE *array_loop_t::file_in()
+{
+    if (_array_in)
+    {
+        if (!_array_in_file)
+        {
+            _array_in_file = _array_in->open_stream(false);
+        }
+        return _array_in_file;
+    }
+    return _file_in;
+}
+
+FILE *array_loop_t::file_out()
+{
+    if (_array_out)
+    {
+        if (!_array_out_file)
+        {
+            _array_out_file = _array_out->open_stream(true);
+        }
+        return _array_out_file;
+    }
+    return _file_out;
+}
+
+void array_loop_t::release_array_in() throw ()
+{
+    if (_array_in_file && _array_in_file != _array_in->file)
+    {
+        std::fclose(_array_in_file);
+    }
+    _array_in_file = NULL;
+    delete _array_in;
+    _array_in = NULL;
+}
+
+void array_loop_t::commit_array_out()
+{
+    if (!_array_out)
+    {
+        return;
+    }
+    memory_array_t *a = _array_out;
+    FILE *f = _array_out_file;
+    _array_out = NULL;
+    _array_out_file = NULL;
+    try
+    {
+        if (f)
+        {
+            a->close_stream(f, true);
+        }
+        if (a->header.compression() == gta::none && a->size != a->header.data_size())
+        {
+            throw exc("incomplete array data");
+        }
+        // arrays and bytes written to the stream must stay in order
+        if (_file_out)
+        {
+            fio::flush(_file_out, filename_out());
+        }
+    }
+    catch (std::exception &e)
+    {
+        delete a;
+        throw exc(_array_name_out + ": " + e.what());
+    }
+    _pipe_out->put(a);
 }
 
 bool array_loop_t::read(gta::header &header_in, std::string &name_in)
 {
-    while (!fio::has_more(_file_in, filename_in()))
+    release_array_in();
+    if (_pipe_in)
     {
-        if (_filenames_in.size() == 0)
+        // Bytes that were written to the stream come first. The stream may
+        // already have buffered some of them.
+        int c;
+        _pipe_in->set_peeking(true);
+        try
         {
-            return false;
+            c = fio::getc(_file_in, filename_in());
+        }
+        catch (...)
+        {
+            _pipe_in->set_peeking(false);
+            throw;
+        }
+        _pipe_in->set_peeking(false);
+        if (c != EOF)
+        {
+            fio::ungetc(c, _file_in, filename_in());
         }
         else
         {
-            if (_filename_index + 1 == _filenames_in.size())
+            std::clearerr(_file_in);
+            _array_in = _pipe_in->get();
+            if (!_array_in)
+            {
+                return false;
+            }
+            _array_name_in = filename_in() + " array " + str::from(_file_index_in);
+            name_in = _array_name_in;
+            header_in = _array_in->header;
+            _file_index_in++;
+            _index_in++;
+            return true;
+        }
+    }
+    else
+    {
+        while (!fio::has_more(_file_in, filename_in()))
+        {
+            if (_filenames_in.size() == 0)
             {
                 return false;
             }
-            FILE *f = _file_in;
-            _file_in = NULL;
-            fio::close(f, filename_in());
-            _filename_index++;
-            _file_in = fio::open(_filenames_in.at(_filename_index), "r");
-            _file_index_in = 0;
+            else
+            {
+                if (_filename_index + 1 == _filenames_in.size())
+                {
+                    return false;
+                }
+                FILE *f = _file_in;
+                _file_in = NULL;
+                fio::close(f, filename_in());
+                _filename_index++;
+                _file_in = fio::open(_filenames_in.at(_filename_index), "r");
+                _file_index_in = 0;
+            }
         }
     }
     _array_name_in = filename_in() + " array " + str::from(_file_index_in);
@@ -702,15 +2053,25 @@ bool array_loop_t::read(gta::header &header_in, std::string &name_in)
 
 void array_loop_t::write(const gta::header &header_out, std::string &name_out)
 {
-    if (fio::isatty(_file_out))
+    commit_array_out();
+    if (!_pipe_out && fio::isatty(_file_out))
     {
         throw exc("refusing to write to a tty");
     }
-    _array_name_out = filename_out() + " array " + str::from(_index_out);
+    // The place of the output arrays of a task of process() is only known when
+    // they are written.
+    _array_name_out = filename_out() + (_job ? " array for " + _array_name_in : " array " + str::from(_index_out));
     name_out = _array_name_out;
     try
     {
-        header_out.write_to(_file_out);
+        if (_pipe_out)
+        {
+            _array_out = _pipe_out->new_array(header_out);
+        }
+        if (!_array_out)
+        {
+            header_out.write_to(_file_out);
+        }
     }
     catch (std::exception &e)
     {
@@ -721,6 +2082,11 @@ void array_loop_t::write(const gta::header &header_out, std::string &name_out)
 
 void array_loop_t::skip_data(const gta::header &header_in)
 {
+    if (_array_in)
+    {
+        // the data is dropped together with the array
+        return;
+    }
     try
     {
         header_in.skip_data(_file_in);
@@ -733,9 +2099,42 @@ void array_loop_t::skip_data(const gta::header &header_in)
 
 void array_loop_t::copy_data(const gta::header &header_in, const gta::header &header_out)
 {
+    copy_data(header_in, *this, header_out);
+}
+
+void array_loop_t::copy_data(const gta::header &header_in, array_loop_t &array_loop_out, const gta::header &header_out)
+{
+    // Arrays in memory whose data was not accessed through a stream yet
+    memory_array_t *in = (_array_in_file ? NULL : _array_in);
+    memory_array_t *out = (array_loop_out._array_out_file ? NULL : array_loop_out._array_out);
+    bool hand_over = (in && out && !in->file && !out->file && out->size == 0
+            && in->header.compression() == out->header.compression()
+            && (in->header.compression() == gta::none || in->header.filter() == out->header.filter()));
+    if (!hand_over && in && in->direct())
+    {
+        array_loop_out.write_data(header_out, in->data.ptr());
+        return;
+    }
     try
     {
-        header_in.copy_data(_file_in, header_out, _file_out);
+        if (hand_over)
+        {
+            // pass the data on without copying it
+            out->data.swap(in->data);
+            out->size = in->size;
+            in->size = 0;
+        }
+        else if (out && out->direct() && out->size == 0)
+        {
+            size_t size = checked_cast<size_t>(header_out.data_size());
+            out->grow(size);
+            header_in.read_data(file_in(), out->data.ptr());
+            out->size = size;
+        }
+        else
+        {
+            header_in.copy_data(file_in(), header_out, array_loop_out.file_out());
+        }
     }
     catch (std::exception &e)
     {
@@ -743,11 +2142,25 @@ void array_loop_t::copy_data(const gta::header &header_in, const gta::header &he
     }
 }
 
-void array_loop_t::copy_data(const gta::header &header_in, const array_loop_t &array_loop_out, gta::header &header_out)
+void array_loop_t::read_data(const gta::header &header_in, void *data)
 {
     try
     {
-        header_in.copy_data(_file_in, header_out, array_loop_out._file_out);
+        if (_array_in && _array_in->direct() && !_array_in_file)
+        {
+            if (header_in.data_size() != _array_in->size)
+            {
+                throw exc("invalid array data");
+            }
+            if (_array_in->size > 0)
+            {
+                std::memcpy(data, _array_in->data.ptr(), _array_in->size);
+            }
+        }
+        else
+        {
+            header_in.read_data(file_in(), data);
+        }
     }
     catch (std::exception &e)
     {
@@ -755,11 +2168,24 @@ void array_loop_t::copy_data(const gta::header &header_in, const array_loop_t &a
     }
 }
 
-void array_loop_t::read_data(const gta::header &header_in, void *data)
+void array_loop_t::write_data(const gta::header &header_out, const void *data)
 {
     try
     {
-        header_in.read_data(_file_in, data);
+        if (_array_out && _array_out->direct() && !_array_out_file && _array_out->size == 0)
+        {
+            size_t size = checked_cast<size_t>(header_out.data_size());
+            _array_out->grow(size);
+            if (size > 0)
+            {
+                std::memcpy(_array_out->data.ptr(), data, size);
+            }
+            _array_out->size = size;
+        }
+        else
+        {
+            header_out.write_data(file_out(), data);
+        }
     }
     catch (std::exception &e)
     {
@@ -767,23 +2193,256 @@ void array_loop_t::read_data(const gta::header &header_in, void *data)
     }
 }
 
-void array_loop_t::write_data(const gta::header &header_out, const void *data)
+void array_loop_t::start_element_loop(element_loop_t &element_loop,
+        const gta::header &header_in, const gta::header &header_out)
 {
+    // Uncompressed arrays in memory are read and written in place.
+    memory_array_t *in = (_array_in && _array_in->direct() && !_array_in_file ? _array_in : NULL);
+    memory_array_t *out = (_array_out && _array_out->direct() && !_array_out_file
+            && _array_out->size == 0 ? _array_out : NULL);
+    if (out)
+    {
+        out->grow(checked_cast<size_t>(header_out.data_size()));
+    }
+    element_loop.start(header_in, _array_name_in, in ? NULL : file_in(),
+            header_out, _array_name_out, out ? NULL : file_out());
+    element_loop._array_in = in;
+    element_loop._array_out = out;
+}
+
+/* An input array that is processed as a task in array_loop_t::process(). */
+class array_job_t : public tsk::task
+{
+public:
+    array_processor_t &processor;
+    std::string name_in;
+    std::string filename_in;
+    std::string filename_out;
+    uintmax_t index;
+    memory_array_t *array_in;   // the input array
+    array_pipe_t arrays_out;    // the output arrays
+
+    array_job_t(array_processor_t &p, memory_budget_t *budget) :
+        processor(p), name_in(), filename_in(), filename_out(), index(0),
+        array_in(NULL), arrays_out(budget)
+    {
+    }
+
+    ~array_job_t()
+    {
+        delete array_in;
+    }
+
+    void run()
+    {
+        // Let the processor work on an array loop that reads the input array and
+        // writes the output arrays in memory.
+        array_loop_t array_loop;
+        array_loop._filenames_in.push_back(filename_in);
+        array_loop._filename_out = filename_out;
+        array_loop._index_in = index + 1;
+        array_loop._array_name_in = name_in;
+        array_loop._pipe_out = &arrays_out;
+        array_loop._job = true;
+        array_loop._array_in = array_in;
+        array_in = NULL;
+        gta::header header_in = array_loop._array_in->header;
+        processor.process(array_loop, header_in, name_in);
+        // this frees the input array before the job is committed
+        array_loop.finish();
+        arrays_out.close(false);
+    }
+};
+
+memory_array_t *array_loop_t::take_array_in(const gta::header &header_in, memory_budget_t *budget)
+{
+    memory_array_t *a;
+    if (_array_in && !_array_in_file)
+    {
+        // the array is already in memory
+        a = _array_in;
+        _array_in = NULL;
+        return a;
+    }
+    a = new memory_array_t(header_in);
     try
     {
-        header_out.write_data(_file_out, data);
+        uintmax_t size = header_in.data_size();
+        if (size <= std::numeric_limits<size_t>::max() && budget->reserve(size, false))
+        {
+            a->set_budget(budget, size);
+        }
+        else
+        {
+            a->file = fio::tempfile();
+        }
+        if (a->direct())
+        {
+            a->grow(size);
+            header_in.read_data(file_in(), a->data.ptr());
+            a->size = size;
+        }
+        else
+        {
+            // copy compressed data as it is; the job decompresses it
+            FILE *f = a->open_stream(true);
+            try
+            {
+                header_in.copy_data(file_in(), a->header, f);
+            }
+            catch (...)
+            {
+                if (f != a->file)
+                {
+                    std::fclose(f);
+                }
+                throw;
+            }
+            a->close_stream(f, true);
+        }
     }
     catch (std::exception &e)
     {
+        delete a;
         throw exc(_array_name_in + ": " + e.what());
     }
+    return a;
 }
 
-void array_loop_t::start_element_loop(element_loop_t &element_loop,
-        const gta::header &header_in, const gta::header &header_out)
+void array_loop_t::write_array(memory_array_t *a)
+{
+    _array_name_out = filename_out() + " array " + str::from(_index_out);
+    if (_pipe_out)
+    {
+        try
+        {
+            if (_file_out)
+            {
+                fio::flush(_file_out, filename_out());
+            }
+        }
+        catch (...)
+        {
+            delete a;
+            throw;
+        }
+        _pipe_out->put(a);
+    }
+    else
+    {
+        try
+        {
+            a->header.write_to(_file_out);
+            if (a->file)
+            {
+                blob buf(std::min(a->size, static_cast<size_t>(1024 * 1024)));
+                for (size_t i = 0; i < a->size; i += buf.size())
+                {
+                    size_t n = std::min(buf.size(), a->size - i);
+                    fio::read(buf.ptr(), 1, n, a->file);
+                    fio::write(buf.ptr(), 1, n, _file_out, filename_out());
+                }
+            }
+            else if (a->size > 0)
+            {
+                fio::write(a->data.ptr(), 1, a->size, _file_out, filename_out());
+            }
+        }
+        catch (std::exception &e)
+        {
+            delete a;
+            throw exc(_array_name_out + ": " + e.what());
+        }
+        delete a;
+    }
+    _index_out++;
+}
+
+void array_loop_t::commit_job(array_job_t *job)
+{
+    // A processor may write any number of output arrays for one input array.
+    memory_array_t *a;
+    while ((a = job->arrays_out.get()))
+    {
+        write_array(a);
+    }
+}
+
+void array_loop_t::process(array_processor_t &processor)
 {
-    element_loop.start(header_in, _array_name_in, _file_in,
-            header_out, _array_name_out, _file_out);
+    gta::header header_in;
+    std::string name_in;
+
+    // Process the first array directly. This avoids the buffering overhead
+    // if there is only one array.
+    if (!read(header_in, name_in))
+    {
+        return;
+    }
+    processor.process(*this, header_in, name_in);
+    if (tsk::threads() <= 1)
+    {
+        while (read(header_in, name_in))
+        {
+            processor.process(*this, header_in, name_in);
+        }
+        return;
+    }
+    if (!read(header_in, name_in))
+    {
+        return;
+    }
+    if (!_pipe_out && fio::isatty(_file_out))
+    {
+        throw exc("refusing to write to a tty");
+    }
+    commit_array_out();
+
+    // The input data and the output arrays of the jobs are kept in memory as
+    // long as they fit into the budget, and in temporary files otherwise. The
+    // pipeline limits the number of jobs so that they do not grow without
+    // bounds when the output is slow.
+    memory_budget_t budget(memory_budget());
+    tsk::ordered_pipeline jobs;
+    bool more = true;
+    while (more || !jobs.empty())
+    {
+        array_job_t *job;
+        if (more)
+        {
+            job = new array_job_t(processor, &budget);
+            try
+            {
+                job->name_in = name_in;
+                job->filename_in = filename_in();
+                job->filename_out = filename_out();
+                job->index = _index_in - 1;
+                job->array_in = take_array_in(header_in, &budget);
+            }
+            catch (...)
+            {
+                delete job;
+                throw;
+            }
+            jobs.push(job);
+            more = read(header_in, name_in);
+        }
+        // Commit finished jobs in input order. Wait for a job if the pipeline
+        // is full or if there is no more input.
+        while ((job = static_cast<array_job_t *>(jobs.pop(jobs.full() || !more))))
+        {
+            try
+            {
+                commit_job(job);
+            }
+            catch (...)
+            {
+                delete job;
+                throw;
+            }
+            delete job;
+        }
+    }
 }
 
 void buffer_data(const gta::header &header, FILE *f, gta::header &buf_header, FILE **buf_f)
@@ -71,9 +71,41 @@ extern char** gtatool_argv;
  * the standard streams need not be lvalues.
  * To keep things simple, we only use gtatool_stdin and gtatool_stdout in the
  * command implementations, and set these variables from main.cpp (command line
- * interface) and gui.cpp (GUI interface). */
-extern FILE *gtatool_stdin;
-extern FILE *gtatool_stdout;
+ * interface) and gui.cpp (GUI interface).
+ * The variables are thread-local so that commands can run in different threads
+ * with different streams (see the pipeline command). A thread that runs a
+ * command must set them first. */
+extern __thread FILE *gtatool_stdin;
+extern __thread FILE *gtatool_stdout;
+
+/* Arrays that are passed between commands in memory.
+ * Commands that run in the same process, like the commands of the pipeline
+ * command, can be connected with an array pipe instead of a byte stream. An
+ * array_loop_t that writes to an array pipe hands over each array as a header
+ * and a data blob, and an array_loop_t that reads from it takes them over
+ * without decoding anything. Both ends of the pipe are also FILE streams, so
+ * that commands that read or write the stream directly still work; arrays are
+ * only encoded when such a command reads them.
+ * The data of the arrays in a pipe is limited by the memory budget. */
+class memory_budget_t;
+class memory_array_t;
+class array_pipe_t;
+
+#if HAVE_FOPENCOOKIE
+/* Create an array pipe. Both ends must be closed with fclose(); this deletes
+ * the pipe. */
+array_pipe_t *array_pipe_open(FILE **read_end, FILE **write_end);
+#endif
+
+/* The array pipes behind gtatool_stdin and gtatool_stdout, or NULL if these
+ * are ordinary streams. Like those, they are thread-local. */
+extern __thread array_pipe_t *gtatool_stdin_pipe;
+extern __thread array_pipe_t *gtatool_stdout_pipe;
+
+/* The maximum size of array data that is kept in memory: by each array pipe,
+ * and by the tasks of each array_loop_t::process(). Set it before commands run. */
+size_t memory_budget();
+void set_memory_budget(size_t bytes);
 
 /* Convert GTA type identifiers to strings and back */
 std::string type_to_string(const gta::type t, const uintmax_t size);
@@ -97,7 +129,17 @@ std::string to_utf8(const std::string &s);
 
 /* Loop over all input and output array elements.
  * This loop provides input/output buffering for filtering commands that
- * work on array element level. */
+ * work on array element level.
+ * Commands should process the elements in batches with read_batch() and
+ * out_batch() instead of one at a time, because the overhead of each read and
+ * write dominates the runtime for arrays with small elements.
+ * For arrays larger than one batch, the input elements are read and decoded by
+ * a separate thread while the command processes previous batches, and the
+ * output elements are encoded and written by another thread. The last write
+ * waits until all output elements were written.
+ * Uncompressed arrays in memory are read and written in place, without threads. */
+class element_reader_t;
+class element_writer_t;
 class element_loop_t
 {
 private:
@@ -113,6 +155,26 @@ private:
     gta::io_state _state_out;
 
     blob _buf;
+    blob _buf_out;
+    size_t _batch_size;
+    uintmax_t _elements_read;
+
+    element_reader_t *_reader;
+    element_writer_t *_writer;
+
+    // Arrays in memory whose data is used directly instead of the files; see
+    // array_loop_t::start_element_loop().
+    memory_array_t *_array_in;
+    memory_array_t *_array_out;
+    friend class array_loop_t;
+
+    void stop() throw ();
+    bool threaded_in();
+    bool threaded_out();
+
+    // An element loop owns its threads and cannot be copied.
+    element_loop_t(const element_loop_t &);
+    element_loop_t &operator=(const element_loop_t &);
 
 public:
     element_loop_t() throw ();
@@ -122,7 +184,42 @@ public:
             const gta::header &header_out, const std::string &name_out, FILE *file_out);
 
     const void *read(size_t n = 1);
+    /* Read n elements, but only the given components. The values of each component are
+     * tightly packed in the corresponding buffer; see gta_read_element_components(). */
+    void read_components(const std::vector<uintmax_t> &components, void *const *buffers, size_t n = 1);
+    /* Read n elements, but only the given components. The result has the layout of
+     * elements that consist of these components in the given order. */
+    const void *read_components(const std::vector<uintmax_t> &components, size_t n = 1);
     void write(const void *element, size_t n = 1);
+
+    /* Read the next batch of input elements, let *elements point to them, and return
+     * their number, or 0 if all input elements were read. The batch is valid until
+     * the next read. */
+    size_t read_batch(const void **elements);
+    /* Return a buffer for n output elements, e.g. for the results of a batch.
+     * The buffer is valid until the next call. */
+    void *out_batch(size_t n);
+
+    /* The number of elements of the given size to process at once. */
+    static size_t batch_size(uintmax_t element_size);
+};
+
+class array_loop_t;
+class array_job_t;
+
+/* The part of a filtering command that handles one input array.
+ * Implement process() in a subclass, and pass an object to array_loop_t::process().
+ * Since different arrays may be processed by different threads at the same
+ * time, process() must not modify state that is shared between arrays. */
+class array_processor_t
+{
+public:
+    virtual ~array_processor_t()
+    {
+    }
+
+    // Process the given input array and write the output array(s) with array_loop.
+    virtual void process(array_loop_t &array_loop, gta::header &header_in, const std::string &name_in) = 0;
 };
 
 /* Loop over all input and output arrays.
@@ -148,6 +245,23 @@ private:
     std::string _array_name_in;
     std::string _array_name_out;
 
+    // Arrays in memory, if the input or output is an array pipe (or if this loop
+    // is a task of process()). The streams give access to their data.
+    array_pipe_t *_pipe_in;
+    array_pipe_t *_pipe_out;
+    memory_array_t *_array_in;
+    memory_array_t *_array_out;
+    FILE *_array_in_file;
+    FILE *_array_out_file;
+    bool _job;                  // whether this loop is a task of process()
+
+    void release_array_in() throw ();
+    void commit_array_out();
+    memory_array_t *take_array_in(const gta::header &header_in, memory_budget_t *budget);
+    void write_array(memory_array_t *a);
+    void commit_job(array_job_t *job);
+    friend class array_job_t;
+
 public:
     array_loop_t() throw ();
     ~array_loop_t();
@@ -170,20 +284,24 @@ public:
 
     void skip_data(const gta::header &header_in);
     void copy_data(const gta::header &header_in, const gta::header &header_out);
-    void copy_data(const gta::header &header_in, const array_loop_t &array_loop_out, gta::header &header_out);
+    void copy_data(const gta::header &header_in, array_loop_t &array_loop_out, const gta::header &header_out);
     void read_data(const gta::header &header_in, void *data);
     void write_data(const gta::header &header_out, const void *data);
     void start_element_loop(element_loop_t &element_loop, const gta::header &header_in, const gta::header &header_out);
 
-    FILE *file_in() const throw ()
-    {
-        return _file_in;
-    }
-
-    FILE *file_out() const throw ()
-    {
-        return _file_out;
-    }
+    /* Read all input arrays and process them with the given processor.
+     * If there is more than one input array, the arrays after the first are
+     * processed as parallel tasks (see base/tsk.h). Their input data and their
+     * output arrays are kept in memory as long as they fit into the memory
+     * budget, and in temporary files otherwise. The output arrays are written
+     * in input order. */
+    void process(array_processor_t &processor);
+
+    /* The streams to read the current input array data from and to write the
+     * current output array data to. For arrays in memory, these are streams
+     * that access the data of the array; they are valid until the next array. */
+    FILE *file_in();
+    FILE *file_out();
 
     uintmax_t index_in() const throw ()
     {
@@ -23,6 +23,7 @@
 #include "config.h"
 
 #include <cstring>
+#include <limits>
 #include <locale.h>
 
 #if W32
@@ -38,6 +39,8 @@
 #include "base/msg.h"
 #include "base/opt.h"
 #include "base/dbg.h"
+#include "base/str.h"
+#include "base/tsk.h"
 
 #include "lib.h"
 #include "cmds.h"
@@ -101,7 +104,7 @@ extern "C" int gtatool_help(int argc, char *argv[])
     if (arguments.size() == 0)
     {
         msg::req_txt(
-                "Usage: %s [-q|--quiet] [-v|--verbose] <command> [argument...]",
+                "Usage: %s [-q|--quiet] [-v|--verbose] [-j|--threads N] [-m|--memory MiB] <command> [argument...]",
                 program_name);
         cmd_category_t categories[] = {
             cmd_stream,
@@ -243,8 +246,45 @@ int main(int argc, char *argv[])
             argv_cmd_index++;
             msg::set_level(msg::DBG);
         }
+        const char *threads_arg = NULL;
+        if (argc > argv_cmd_index + 2 && (strcmp(argv[argv_cmd_index], "-j") == 0
+                    || strcmp(argv[argv_cmd_index], "--threads") == 0))
+        {
+            threads_arg = argv[argv_cmd_index + 1];
+            argv_cmd_index += 2;
+        }
+        else if (argc > argv_cmd_index + 1 && strncmp(argv[argv_cmd_index], "--threads=", 10) == 0)
+        {
+            threads_arg = argv[argv_cmd_index] + 10;
+            argv_cmd_index++;
+        }
+        const char *memory_arg = NULL;
+        if (argc > argv_cmd_index + 2 && (strcmp(argv[argv_cmd_index], "-m") == 0
+                    || strcmp(argv[argv_cmd_index], "--memory") == 0))
+        {
+            memory_arg = argv[argv_cmd_index + 1];
+            argv_cmd_index += 2;
+        }
+        else if (argc > argv_cmd_index + 1 && strncmp(argv[argv_cmd_index], "--memory=", 9) == 0)
+        {
+            memory_arg = argv[argv_cmd_index] + 9;
+            argv_cmd_index++;
+        }
+        unsigned int threads = 0;
+        unsigned long memory = 0;
         int cmd_index = cmd_find(argv[argv_cmd_index]);
-        if (cmd_index < 0)
+        if (threads_arg && (!str::to(threads_arg, &threads) || threads < 1))
+        {
+            msg::err("invalid number of threads: %s", threads_arg);
+            exitcode = 1;
+        }
+        else if (memory_arg && (!str::to(memory_arg, &memory)
+                    || memory > std::numeric_limits<size_t>::max() / (1024 * 1024)))
+        {
+            msg::err("invalid memory size: %s", memory_arg);
+            exitcode = 1;
+        }
+        else if (cmd_index < 0)
         {
             msg::err("command unknown: %s", argv[argv_cmd_index]);
             exitcode = 1;
@@ -257,6 +297,11 @@ int main(int argc, char *argv[])
         else
         {
             msg::set_program_name(msg::program_name() + " " + argv[argv_cmd_index]);
+            tsk::set_threads(threads);
+            if (memory_arg)
+            {
+                set_memory_budget(memory * 1024 * 1024);
+            }
             cmd_open(cmd_index);
             gtatool_argc = &argc;
             gtatool_argv = argv;
@@ -0,0 +1,327 @@
+/*
+ * This file is part of gtatool, a tool to manipulate Generic Tagged Arrays
+ * (GTAs).
+ *
+ * Copyright (C) 2016
+ * Martin Lambers <marlam@marlam.de>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+#include <cctype>
+#include <cerrno>
+
+#if !HAVE_FOPENCOOKIE
+# if W32
+#  include <io.h>
+#  include <fcntl.h>
+# else
+#  include <unistd.h>
+# endif
+#endif
+
+#include "base/msg.h"
+#include "base/opt.h"
+#include "base/pth.h"
+#include "base/str.h"
+
+#include "lib.h"
+#include "cmds.h"
+
+
+extern "C" void gtatool_pipeline_help(void)
+{
+    msg::req_txt(
+            "pipeline '<command> [<argument>...] [; <command> [<argument>...]]...'\n"
+            "\n"
+            "Runs the given commands like a shell pipeline, but within one process: each command runs "
+            "in its own thread, and the arrays that each command writes are passed to the next command "
+            "in memory, without encoding and decoding them. "
+            "The first command reads standard input, and the last command writes standard output.\n"
+            "Commands and their arguments are separated by white space. Use quotes or a backslash "
+            "to include white space or ';' in an argument.\n"
+            "Messages of a command are marked with its position in the pipeline and its name.\n"
+            "The stream-foreach command cannot write to the next command of a pipeline.\n"
+            "Example: pipeline 'component-convert -c float32 img.gta ; dimension-reorder -i 1,0 ; compress' > out.gta");
+}
+
+#if !HAVE_FOPENCOOKIE
+/* Fall back to a pipe of the operating system. */
+static void os_pipe_open(FILE **read_end, FILE **write_end)
+{
+    int fds[2];
+# if W32
+    if (_pipe(fds, 1024 * 1024, _O_BINARY) != 0)
+# else
+    if (::pipe(fds) != 0)
+# endif
+    {
+        throw exc(std::string("Cannot create pipe: ") + std::strerror(errno), errno);
+    }
+    *read_end = fdopen(fds[0], "rb");
+    *write_end = fdopen(fds[1], "wb");
+    if (!*read_end || !*write_end)
+    {
+        int e = errno;
+        if (*read_end)
+        {
+            std::fclose(*read_end);
+        }
+        else
+        {
+            ::close(fds[0]);
+        }
+        if (*write_end)
+        {
+            std::fclose(*write_end);
+        }
+        else
+        {
+            ::close(fds[1]);
+        }
+        throw exc(std::string("Cannot create pipe: ") + std::strerror(e), e);
+    }
+}
+#endif
+
+/* A command of the pipeline, running in its own thread. */
+class pipeline_stage_t : public thread
+{
+public:
+    int cmd_index;
+    std::vector<std::string> args;
+    std::string category;       // marks the messages of this command
+    FILE *file_in;
+    FILE *file_out;
+    array_pipe_t *pipe_in;
+    array_pipe_t *pipe_out;
+    bool close_in;
+    bool close_out;
+    int retval;
+
+    pipeline_stage_t() : cmd_index(-1), args(), category(),
+        file_in(NULL), file_out(NULL), pipe_in(NULL), pipe_out(NULL), close_in(false), close_out(false), retval(1)
+    {
+    }
+
+    void close_files()
+    {
+        if (close_out)
+        {
+            close_out = false;
+            if (std::fclose(file_out) != 0 && retval == 0)
+            {
+                msg::err_txt("Cannot write output: %s", std::strerror(errno));
+                retval = 1;
+            }
+        }
+        if (close_in)
+        {
+            close_in = false;
+            std::fclose(file_in);
+        }
+    }
+
+    void run()
+    {
+        msg::set_category_name(category);
+        gtatool_stdin = file_in;
+        gtatool_stdout = file_out;
+        gtatool_stdin_pipe = pipe_in;
+        gtatool_stdout_pipe = pipe_out;
+        std::vector<char *> argv;
+        for (size_t i = 0; i < args.size(); i++)
+        {
+            argv.push_back(const_cast<char *>(args[i].c_str()));
+        }
+        argv.push_back(NULL);
+        retval = cmd_run(cmd_index, argv.size() - 1, &(argv[0]));
+        // Let the neighbor commands know that this command is done.
+        close_files();
+        gtatool_stdin_pipe = NULL;
+        gtatool_stdout_pipe = NULL;
+        msg::set_category_name("");
+    }
+};
+
+/* Split the pipeline description into commands and their arguments. */
+static std::vector<std::vector<std::string> > split_pipeline(const std::string &s)
+{
+    std::vector<std::vector<std::string> > commands(1);
+    std::string word;
+    bool in_word = false;
+    char quote = '\0';
+    for (size_t i = 0; i < s.length(); i++)
+    {
+        char c = s[i];
+        if (quote)
+        {
+            if (c == quote)
+            {
+                quote = '\0';
+            }
+            else if (c == '\\' && quote == '"' && i + 1 < s.length())
+            {
+                word.push_back(s[++i]);
+            }
+            else
+            {
+                word.push_back(c);
+            }
+        }
+        else if (c == '\'' || c == '"')
+        {
+            quote = c;
+            in_word = true;
+        }
+        else if (c == '\\' && i + 1 < s.length())
+        {
+            word.push_back(s[++i]);
+            in_word = true;
+        }
+        else if (c == ';' || std::isspace(static_cast<unsigned char>(c)))
+        {
+            if (in_word)
+            {
+                commands.back().push_back(word);
+                word.clear();
+                in_word = false;
+            }
+            if (c == ';')
+            {
+                commands.push_back(std::vector<std::string>());
+            }
+        }
+        else
+        {
+            word.push_back(c);
+            in_word = true;
+        }
+    }
+    if (quote)
+    {
+        throw exc("unterminated quote in pipeline");
+    }
+    if (in_word)
+    {
+        commands.back().push_back(word);
+    }
+    return commands;
+}
+
+extern "C" int gtatool_pipeline(int argc, char *argv[])
+{
+    std::vector<opt::option *> options;
+    opt::info help("help", '\0', opt::optional);
+    options.push_back(&help);
+    std::vector<std::string> arguments;
+    if (!opt::parse(argc, argv, options, 1, 1, arguments))
+    {
+        return 1;
+    }
+    if (help.value())
+    {
+        gtatool_pipeline_help();
+        return 0;
+    }
+
+    std::vector<pipeline_stage_t> stages;
+    try
+    {
+        std::vector<std::vector<std::string> > commands = split_pipeline(arguments[0]);
+        stages.resize(commands.size());
+        for (size_t i = 0; i < commands.size(); i++)
+        {
+            if (commands[i].size() == 0)
+            {
+                throw exc("empty command in pipeline");
+            }
+            stages[i].args = commands[i];
+            stages[i].category = str::asprintf("%d %s", static_cast<int>(i + 1), commands[i][0].c_str());
+            stages[i].cmd_index = cmd_find(commands[i][0].c_str());
+            if (stages[i].cmd_index < 0)
+            {
+                throw exc(std::string("command unknown: ") + commands[i][0]);
+            }
+            else if (!cmd_is_available(stages[i].cmd_index))
+            {
+                throw exc(std::string("command ") + commands[i][0]
+                        + " is not available in this version of " + PACKAGE_NAME);
+            }
+        }
+        stages[0].file_in = gtatool_stdin;
+        for (size_t i = 0; i < stages.size() - 1; i++)
+        {
+#if HAVE_FOPENCOOKIE
+            stages[i].pipe_out = array_pipe_open(&(stages[i + 1].file_in), &(stages[i].file_out));
+            stages[i + 1].pipe_in = stages[i].pipe_out;
+#else
+            os_pipe_open(&(stages[i + 1].file_in), &(stages[i].file_out));
+#endif
+            stages[i].close_out = true;
+            stages[i + 1].close_in = true;
+        }
+        stages.back().file_out = gtatool_stdout;
+    }
+    catch (std::exception &e)
+    {
+        msg::err_txt("%s", e.what());
+        for (size_t i = 0; i < stages.size(); i++)
+        {
+            stages[i].close_files();
+        }
+        return 1;
+    }
+
+    for (size_t i = 0; i < stages.size(); i++)
+    {
+        cmd_open(stages[i].cmd_index);
+    }
+    size_t started = 0;
+    try
+    {
+        for (; started < stages.size(); started++)
+        {
+            stages[started].start();
+        }
+    }
+    catch (std::exception &e)
+    {
+        msg::err_txt("%s", e.what());
+        for (size_t i = started; i < stages.size(); i++)
+        {
+            stages[i].close_files();
+        }
+    }
+    int retval = (started < stages.size() ? 1 : 0);
+    for (size_t i = 0; i < started; i++)
+    {
+        stages[i].wait();
+        if (stages[i].retval != 0)
+        {
+            retval = 1;
+        }
+    }
+    for (size_t i = 0; i < stages.size(); i++)
+    {
+        cmd_close(stages[i].cmd_index);
+    }
+    return retval;
+}
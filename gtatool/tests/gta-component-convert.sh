@@ -17,6 +17,19 @@ $GTA create -d 10,10 -c float32,float32,float32 -v 42,42,42 "$TMPD"/b.gta
 $GTA component-convert -c float32,float32,float32 < "$TMPD"/a.gta > "$TMPD"/xb.gta
 cmp "$TMPD"/b.gta "$TMPD"/xb.gta
 
+# Arrays larger than one batch are read and written by separate threads
+$GTA create -d 1000,500 -c int8,int16,cfloat32 -v 42,42,42,0 "$TMPD"/large-a.gta
+$GTA create -d 1000,500 -c float32,float32,float32 -v 42,42,42 "$TMPD"/large-b.gta
+$GTA compress -m zlib "$TMPD"/large-a.gta "$TMPD"/a.gta "$TMPD"/large-a.gta > "$TMPD"/large-aaa.gta
+cat "$TMPD"/large-b.gta "$TMPD"/b.gta "$TMPD"/large-b.gta > "$TMPD"/large-bbb.gta
+$GTA component-convert -c float32,float32,float32 "$TMPD"/large-aaa.gta > "$TMPD"/large-xbbb.gta
+cmp "$TMPD"/large-bbb.gta "$TMPD"/large-xbbb.gta
+$GTA -j 4 component-convert -c float32,float32,float32 "$TMPD"/large-aaa.gta > "$TMPD"/large-xbbb.gta
+cmp "$TMPD"/large-bbb.gta "$TMPD"/large-xbbb.gta
+# Data of parallel tasks that exceeds the memory budget is kept in temporary files
+$GTA -j 4 -m 1 component-convert -c float32,float32,float32 "$TMPD"/large-aaa.gta > "$TMPD"/large-xbbb.gta
+cmp "$TMPD"/large-bbb.gta "$TMPD"/large-xbbb.gta
+
 $GTA create -c uint8 -n5 > "$TMPD"/empty0.gta
 $GTA component-convert -c int16 "$TMPD"/empty0.gta > "$TMPD"/t.gta
 $GTA component-convert -c uint8 "$TMPD"/t.gta > "$TMPD"/xempty0.gta
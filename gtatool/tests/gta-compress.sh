@@ -21,6 +21,20 @@ for i in zlib bzip2 xz zlib1 zlib2 zlib3 zlib4 zlib5 zlib6 zlib7 zlib8 zlib9; do
 	cmp "$TMPD"/a.gta "$TMPD"/a-$i-u.gta
 done
 
+# These methods are only available if libgta was built with them
+for i in zstd zstd1 zstd19 lz4; do
+	if $GTA compress --method=$i "$TMPD"/a.gta > "$TMPD"/a-$i.gta 2> /dev/null; then
+		$GTA uncompress "$TMPD"/a-$i.gta > "$TMPD"/a-$i-u.gta
+		cmp "$TMPD"/a.gta "$TMPD"/a-$i-u.gta
+	fi
+done
+
+for i in shuffle bitshuffle delta; do
+	$GTA compress --method=zlib --filter=$i "$TMPD"/a.gta > "$TMPD"/a-$i.gta
+	$GTA uncompress "$TMPD"/a-$i.gta > "$TMPD"/a-$i-u.gta
+	cmp "$TMPD"/a.gta "$TMPD"/a-$i-u.gta
+done
+
 $GTA create -d 10 -n5 > "$TMPD"/empty0.gta
 $GTA create -c uint8 -n5 > "$TMPD"/empty1.gta
 $GTA compress "$TMPD"/empty0.gta > "$TMPD"/zempty0.gta
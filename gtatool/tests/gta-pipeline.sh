@@ -0,0 +1,46 @@
+#!/usr/bin/env bash
+
+# Copyright (C) 2016
+# Martin Lambers <marlam@marlam.de>
+#
+# Copying and distribution of this file, with or without modification, are
+# permitted in any medium without royalty provided the copyright notice and this
+# notice are preserved. This file is offered as-is, without any warranty.
+
+set -e
+
+TMPD="`mktemp -d tmp-\`basename $0 .sh\`.XXXXXX`"
+
+$GTA create -d 1000,500 -c int8,int16,cfloat32 -v 42,42,42,0 "$TMPD"/a.gta
+$GTA create -d 10,10 -c int8,int16,cfloat32 -v 42,42,42,0 "$TMPD"/b.gta
+cat "$TMPD"/a.gta "$TMPD"/b.gta "$TMPD"/a.gta > "$TMPD"/aba.gta
+
+$GTA pipeline --help 2> "$TMPD"/help.txt
+
+$GTA component-convert -c float32,float32,float32 "$TMPD"/aba.gta \
+    | $GTA dimension-reorder -i 1,0 | $GTA compress -m zlib > "$TMPD"/x.gta
+$GTA pipeline 'component-convert -c float32,float32,float32 ; dimension-reorder -i 1,0 ; compress -m zlib' \
+    < "$TMPD"/aba.gta > "$TMPD"/y.gta
+cmp "$TMPD"/x.gta "$TMPD"/y.gta
+$GTA -j 4 pipeline "component-convert -c 'float32,float32,float32' \"$TMPD\"/aba.gta;dimension-reorder -i 1,0;compress -m zlib" \
+    > "$TMPD"/z.gta
+cmp "$TMPD"/x.gta "$TMPD"/z.gta
+# Arrays that exceed the memory budget are passed on as a byte stream
+$GTA -m 1 pipeline 'component-convert -c float32,float32,float32 ; dimension-reorder -i 1,0 ; compress -m zlib' \
+    < "$TMPD"/aba.gta > "$TMPD"/w.gta
+cmp "$TMPD"/x.gta "$TMPD"/w.gta
+# Commands that read the stream directly get the arrays encoded
+$GTA pipeline "component-convert -c float32,float32,float32 ; dimension-reorder -i 1,0 ; stream-foreach \"$GTA compress -m zlib\"" \
+    < "$TMPD"/aba.gta > "$TMPD"/v.gta
+cmp "$TMPD"/x.gta "$TMPD"/v.gta
+
+$GTA pipeline 'stream-merge' < "$TMPD"/b.gta > "$TMPD"/xb.gta
+cmp "$TMPD"/b.gta "$TMPD"/xb.gta
+
+for p in 'stream-merge ; component-convert -c uint8' 'stream-merge ; unknown-command' 'stream-merge ; ; stream-merge'; do
+	if $GTA pipeline "$p" < "$TMPD"/aba.gta > "$TMPD"/t.gta 2> /dev/null; then
+		exit 1
+	fi
+done
+
+rm -r "$TMPD"
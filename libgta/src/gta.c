@@ -33,6 +33,24 @@
 #ifndef _MSC_VER
 #   include <unistd.h>
 #endif
+#if HAVE_PREADV
+#   include <sys/uio.h>
+#endif
+#if HAVE_MMAP
+#   include <sys/types.h>
+#   include <sys/stat.h>
+#   include <sys/mman.h>
+#endif
+#if HAVE_PTHREAD
+#   include <pthread.h>
+#endif
+
+#if defined __SSE2__
+#   include <emmintrin.h>
+#endif
+#if defined __SSSE3__
+#   include <tmmintrin.h>
+#endif
 
 #include <zlib.h>
 
@@ -46,6 +64,14 @@
 #endif
 #include <lzma.h>
 
+#if HAVE_LIBZSTD
+#   include <zstd.h>
+#   include <zstd_errors.h>
+#endif
+#if HAVE_LIBLZ4
+#   include <lz4.h>
+#endif
+
 #define GTA_BUILD
 #include "gta/gta.h"
 
@@ -129,28 +155,65 @@ gta_uintmax_overflow(uintmax_t a, uintmax_t b)
  */
 
 
+/* A block of the tag list arena. Blocks are never reallocated, so strings stay
+ * where they were put until they are removed. */
+typedef struct gta_arena_block_struct
+{
+    struct gta_arena_block_struct *prev;
+    struct gta_arena_block_struct *next;
+    size_t size;                // Bytes used, including garbage
+    size_t capacity;
+    size_t garbage;             // Bytes of replaced or removed strings
+    char data[];
+} gta_arena_block_t;
+
+/* A tag in a tag list: its name and value in the arena, the blocks that hold
+ * them, and the hash of its name. */
+typedef struct
+{
+    char *name;
+    char *value;
+    gta_arena_block_t *name_block;
+    gta_arena_block_t *value_block;
+    uint32_t hash;
+} gta_tag_t;
+
 struct gta_internal_taglist_struct
 {
-    /* A tag list is both an unsorted list, with new entries appended to its
-     * end, and a sorted list according to strcmp(), with sorted[0] giving the
-     * index of the first entry, sorted[1] of the second and so on.
-     * This means that tags are stored in the GTA in the order in which they
-     * were set (which is not strictly necessary, but nice), and that a tag list
-     * can be searched for specific entries via fast binary search nevertheless.
-     * We keep track of the total size that the tag list requires when written
-     * to a GTA file in the encoded_size value. */
+    /* All names and values of a tag list are stored null-terminated in an
+     * arena that consists of a list of blocks. Tags are kept in the order in
+     * which they were set (which is not strictly necessary, but nice), and an
+     * open addressing hash table maps names to tag indices. Strings that were
+     * replaced or removed stay in their block as garbage until the whole
+     * block is garbage; live strings are never moved. Without garbage, the
+     * blocks hold exactly the encoding of the tag list in a GTA file, minus
+     * the final terminator. */
     ssize_t entries;
-    size_t size;
-    char **names;
-    char **values;
-    ssize_t *sorted;
-    size_t encoded_size;
+    size_t size;                // Capacity of tags
+    gta_tag_t *tags;
+    gta_arena_block_t *arena;   // First block
+    gta_arena_block_t *arena_last;      // Last block; new strings are appended here
+    size_t arena_size;          // Bytes used in all blocks, including garbage
+    size_t arena_garbage;       // Bytes of replaced or removed strings in all blocks
+    ssize_t *index;             // Hash table of tag indices; -1 marks empty slots
+    size_t index_size;          // Zero or a power of two
+    uintmax_t changes;          // Number of modifications; see the encoded header cache
 };
 
+/* A run of values of equal width within an array element whose endianness must be
+ * swapped. A swap plan consists of such runs, computed once from the component types. */
+typedef struct
+{
+    uintmax_t offset;           // Offset of the first value in the element
+    size_t width;               // Width of each value: 2, 4, 8, or 16 bytes
+    uintmax_t count;            // Number of values
+} gta_swap_run_t;
+
 struct gta_internal_header_struct
 {
     bool host_endianness;
     gta_compression_t compression;
+    gta_filter_t filter;
 
     gta_taglist_t *global_taglist;
 
@@ -159,12 +222,73 @@ struct gta_internal_header_struct
     uintmax_t *component_blob_sizes;
     gta_taglist_t **component_taglists;
     uintmax_t element_size;
+    uintmax_t *component_offsets;       // components + 1 entries; the last one is element_size
+    gta_swap_run_t *swap_runs;
+    size_t swap_runs_count;
 
     size_t dimensions;
     uintmax_t *dimension_sizes;
     gta_taglist_t **dimension_taglists;
+    uintmax_t elements;
+    uintmax_t data_size;
+
+    /* Number of chunks to compress in parallel when writing data, and to
+     * decompress in parallel when reading data. This is not part of the file
+     * format; 0 and 1 both mean serial operation. */
+    unsigned int compression_threads;
+    unsigned int decompression_threads;
+
+    /* The header as written by gta_write_header(), or NULL. Writing the same
+     * header again then is a single write. The encoding is dropped when the
+     * header is modified, and it is outdated when the total number of changes
+     * of the tag lists differs from encoded_changes, because the tag lists
+     * can be modified without the header knowing. */
+    void *encoded;
+    size_t encoded_size;
+    uintmax_t encoded_changes;
+};
+
+struct gta_internal_chunk_index_struct
+{
+    uintmax_t data_size;        // Size of the uncompressed data
+    size_t chunks;              // Number of chunks, without the last, empty chunk
+    size_t size;                // Allocated size of the offset arrays
+    uintmax_t *data_offsets;    // Offset of each chunk in the uncompressed data
+    uintmax_t *file_offsets;    // Offset of each chunk in the input, relative to the first data byte
 };
 
+struct gta_internal_mapping_struct
+{
+    void *start;                // Start of the mapped region, or of the buffer
+    size_t length;              // Length of the mapped region, or of the buffer
+    const void *data;           // Start of the array data
+    bool mapped;                // Whether the data is mapped or was read into a buffer
+};
+
+/* Compression and decompression streams that are kept across chunks, so that
+ * their setup cost is paid once instead of once per chunk. The streams are
+ * set up on first use and reset for each following chunk. A codec must only
+ * be used by one thread at a time. */
+typedef struct
+{
+    bool deflate_ready;         // Whether deflate is initialized
+    int deflate_level;          // The compression level that deflate is initialized for
+    z_stream deflate;
+    bool inflate_ready;         // Whether inflate is initialized
+    z_stream inflate;
+    lzma_stream xz_encoder;
+    lzma_stream xz_decoder;
+#if HAVE_LIBZSTD
+    ZSTD_CCtx *zstd_encoder;    // Created on first use
+    ZSTD_DCtx *zstd_decoder;    // Created on first use
+#endif
+#if HAVE_LIBLZ4
+    void *lz4_state;            // Compression state; allocated on first use
+#endif
+    void *filter_buffer;        // Buffer for filtered chunk data; allocated on first use
+    size_t filter_buffer_size;  // Size of the filter buffer
+} gta_codec_t;
+
 struct gta_internal_io_state_struct
 {
     int io_type;                // 0 = undecided, 1 = input, 2 = output
@@ -172,8 +296,16 @@ struct gta_internal_io_state_struct
     uintmax_t counter;          // Number of elements that were already read or written.
     void *chunk;                // The current chunk (if GTA is compressed) of buffer (if uncompressed)
     size_t chunk_size;          // Size of the chunk
+    size_t chunk_capacity;      // Allocated size of the chunk buffer; it is reused for the following chunks
     size_t chunk_index;         // Current index inside the chunk
     uintmax_t already_read;     // Only for input of uncompressed GTA: number of bytes that were already read
+    unsigned int compression_threads; // Only for output: overrides the header setting if nonzero
+    void **pending_chunks;      // Only for output with parallel compression: full chunks waiting to be written
+    size_t pending_chunks_count;// Number of pending chunks
+    struct gta_internal_workers_struct *workers; // Only for output with parallel compression: compression threads
+    unsigned int decompression_threads; // Only for input: overrides the header setting if nonzero
+    struct gta_internal_readahead_struct *readahead; // Only for input with parallel decompression: read-ahead queue
+    gta_codec_t codec;          // Compression or decompression streams for chunks processed by the calling thread
 };
 
 
@@ -205,7 +337,255 @@ gta_version(int *GTA_RESTRICT major, int *GTA_RESTRICT minor, int *GTA_RESTRICT
 
 /*
  *
- * Custom input/output functions for files and file descriptors.
+ * Memory management
+ *
+ */
+
+
+/* The allocator. All memory that libgta allocates is obtained through these functions. */
+static void *(*gta_malloc_fn)(size_t) = malloc;
+static void *(*gta_realloc_fn)(void *, size_t) = realloc;
+static void (*gta_free_fn)(void *) = free;
+
+/* The pool of unused chunk buffers. Each buffer has the maximum chunk size. */
+static void **gta_pool_buffers = NULL;
+static size_t gta_pool_buffers_count = 0;
+static size_t gta_pool_size = 0;
+#if HAVE_PTHREAD
+static pthread_mutex_t gta_pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+/* Protects the encoded header caches, which are filled by functions that take a const header. */
+#if HAVE_PTHREAD
+static pthread_mutex_t gta_encoded_header_mutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+static inline GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NOTHROW
+void *
+gta_malloc(size_t size)
+{
+    void *ptr = gta_malloc_fn(size);
+    if (!ptr)
+    {
+        errno = ENOMEM;
+    }
+    return ptr;
+}
+
+static inline GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NOTHROW
+void *
+gta_realloc(void *ptr, size_t size)
+{
+    void *new_ptr = gta_realloc_fn(ptr, size);
+    if (!new_ptr)
+    {
+        errno = ENOMEM;
+    }
+    return new_ptr;
+}
+
+static inline GTA_ATTR_NOTHROW
+void
+gta_free(void *ptr)
+{
+    if (ptr)
+    {
+        gta_free_fn(ptr);
+    }
+}
+
+/* Chunk buffers store their capacity in front of the data, so that they can be recycled when freed.
+ * The union keeps the data aligned like memory returned by malloc(). */
+typedef union
+{
+    size_t capacity;
+    uintmax_t u;
+    long double d;
+    void *p;
+} gta_chunk_prefix_t;
+
+static GTA_ATTR_NOTHROW
+void
+gta_pool_lock(void)
+{
+#if HAVE_PTHREAD
+    pthread_mutex_lock(&gta_pool_mutex);
+#endif
+}
+
+static GTA_ATTR_NOTHROW
+void
+gta_pool_unlock(void)
+{
+#if HAVE_PTHREAD
+    pthread_mutex_unlock(&gta_pool_mutex);
+#endif
+}
+
+static GTA_ATTR_NOTHROW
+void
+gta_encoded_header_lock(void)
+{
+#if HAVE_PTHREAD
+    pthread_mutex_lock(&gta_encoded_header_mutex);
+#endif
+}
+
+static GTA_ATTR_NOTHROW
+void
+gta_encoded_header_unlock(void)
+{
+#if HAVE_PTHREAD
+    pthread_mutex_unlock(&gta_encoded_header_mutex);
+#endif
+}
+
+/**
+ * \brief               Allocate a buffer for chunk data.
+ * \param size          The size of the buffer.
+ * \return              The buffer, or NULL.
+ *
+ * If the buffer pool is enabled, buffers for more than half of the maximum chunk size, and up to it, are
+ * taken from the pool, or allocated with the maximum chunk size so that they can later
+ * be put into the pool. Chunk buffers must be freed with gta_free_chunk().
+ */
+static GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NOTHROW
+void *
+gta_alloc_chunk(size_t size)
+{
+    gta_chunk_prefix_t *prefix = NULL;
+    size_t capacity = size;
+
+    if (size > gta_max_chunk_size / 2 && size <= gta_max_chunk_size)
+    {
+        gta_pool_lock();
+        if (gta_pool_size > 0)
+        {
+            capacity = gta_max_chunk_size;
+            if (gta_pool_buffers_count > 0)
+            {
+                prefix = gta_pool_buffers[--gta_pool_buffers_count];
+            }
+        }
+        gta_pool_unlock();
+    }
+    if (!prefix)
+    {
+        prefix = gta_malloc(sizeof(gta_chunk_prefix_t) + capacity);
+        if (!prefix)
+        {
+            return NULL;
+        }
+        prefix->capacity = capacity;
+    }
+    return prefix + 1;
+}
+
+/**
+ * \brief               Free a chunk buffer.
+ * \param chunk         The buffer returned by gta_alloc_chunk(), or NULL.
+ *
+ * Buffers with the maximum chunk size are put into the buffer pool if it is not full.
+ */
+static GTA_ATTR_NOTHROW
+void
+gta_free_chunk(void *chunk)
+{
+    if (!chunk)
+    {
+        return;
+    }
+    gta_chunk_prefix_t *prefix = (gta_chunk_prefix_t *)chunk - 1;
+    if (prefix->capacity == gta_max_chunk_size)
+    {
+        gta_pool_lock();
+        if (gta_pool_buffers_count < gta_pool_size)
+        {
+            gta_pool_buffers[gta_pool_buffers_count++] = prefix;
+            prefix = NULL;
+        }
+        gta_pool_unlock();
+    }
+    gta_free(prefix);
+}
+
+void
+gta_set_allocator(void *(*malloc_fn)(size_t), void *(*realloc_fn)(void *, size_t), void (*free_fn)(void *))
+{
+    gta_pool_lock();
+    for (size_t i = 0; i < gta_pool_buffers_count; i++)
+    {
+        gta_free(gta_pool_buffers[i]);
+    }
+    gta_free(gta_pool_buffers);
+    gta_pool_buffers = NULL;
+    gta_pool_buffers_count = 0;
+    gta_pool_size = 0;
+    if (malloc_fn && realloc_fn && free_fn)
+    {
+        gta_malloc_fn = malloc_fn;
+        gta_realloc_fn = realloc_fn;
+        gta_free_fn = free_fn;
+    }
+    else
+    {
+        gta_malloc_fn = malloc;
+        gta_realloc_fn = realloc;
+        gta_free_fn = free;
+    }
+    gta_pool_unlock();
+}
+
+gta_result_t
+gta_set_buffer_pool_size(size_t buffers)
+{
+    gta_result_t retval = GTA_OK;
+
+    if (gta_size_overflow(buffers, sizeof(void *)))
+    {
+        return GTA_OVERFLOW;
+    }
+    gta_pool_lock();
+    while (gta_pool_buffers_count > buffers)
+    {
+        gta_free(gta_pool_buffers[--gta_pool_buffers_count]);
+    }
+    if (buffers == 0)
+    {
+        gta_free(gta_pool_buffers);
+        gta_pool_buffers = NULL;
+        gta_pool_size = 0;
+    }
+    else
+    {
+        void **pool_buffers = gta_realloc(gta_pool_buffers, buffers * sizeof(void *));
+        if (pool_buffers)
+        {
+            gta_pool_buffers = pool_buffers;
+            gta_pool_size = buffers;
+        }
+        else
+        {
+            retval = GTA_SYSTEM_ERROR;
+        }
+    }
+    gta_pool_unlock();
+    return retval;
+}
+
+size_t
+gta_get_buffer_pool_size(void)
+{
+    gta_pool_lock();
+    size_t buffers = gta_pool_size;
+    gta_pool_unlock();
+    return buffers;
+}
+
+
+/*
+ *
+ * Custom input/output functions for files, file descriptors, and memory buffers.
  *
  */
 
@@ -345,11 +725,144 @@ void gta_seek_fd(intptr_t userdata, intmax_t offset, int whence, int *GTA_RESTRI
     return;
 }
 
+/* A memory buffer that is read from. The offset may lie beyond the end of the
+ * buffer after seeking; reading there returns no data, as with a file. */
+typedef struct
+{
+    const char *buffer;
+    size_t size;
+    uintmax_t offset;
+} gta_memory_input_t;
+
+/* A memory buffer that is appended to. It is allocated with gta_realloc(). */
+typedef struct
+{
+    char *buffer;
+    size_t size;
+    size_t capacity;
+} gta_memory_output_t;
+
+static GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NOTHROW
+size_t
+gta_read_memory(intptr_t userdata, void *GTA_RESTRICT buffer, size_t size, int *GTA_RESTRICT error)
+{
+    gta_memory_input_t *m = (gta_memory_input_t *)userdata;
+    size_t r = 0;
+    (void)error;
+    if (m->offset < m->size)
+    {
+        r = m->size - m->offset;
+        if (r > size)
+        {
+            r = size;
+        }
+        memcpy(buffer, m->buffer + m->offset, r);
+        m->offset += r;
+    }
+    return r;
+}
+
+static GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NOTHROW
+size_t
+gta_write_memory(intptr_t userdata, const void *GTA_RESTRICT buffer, size_t size, int *GTA_RESTRICT error)
+{
+    gta_memory_output_t *m = (gta_memory_output_t *)userdata;
+    if (size > m->capacity - m->size)
+    {
+        // Grow geometrically, so that appending many small pieces takes linear time
+        size_t capacity = (m->capacity > gta_bufsize_inc ? m->capacity : gta_bufsize_inc);
+        while (capacity - m->size < size)
+        {
+            if (capacity > SIZE_MAX / 2)
+            {
+                capacity = SIZE_MAX;
+                break;
+            }
+            capacity *= 2;
+        }
+        if (capacity - m->size < size)
+        {
+            errno = ENOMEM;
+            *error = true;
+            return 0;
+        }
+        char *tmp_ptr = gta_realloc(m->buffer, capacity);
+        if (!tmp_ptr)
+        {
+            errno = ENOMEM;
+            *error = true;
+            return 0;
+        }
+        m->buffer = tmp_ptr;
+        m->capacity = capacity;
+    }
+    memcpy(m->buffer + m->size, buffer, size);
+    m->size += size;
+    return size;
+}
+
+static GTA_ATTR_NOTHROW
+void gta_seek_memory(intptr_t userdata, intmax_t offset, int whence, int *GTA_RESTRICT error)
+{
+    gta_memory_input_t *m = (gta_memory_input_t *)userdata;
+    uintmax_t base = (whence == SEEK_SET ? 0 : whence == SEEK_CUR ? m->offset : m->size);
+    uintmax_t delta = (offset < 0 ? -(uintmax_t)offset : (uintmax_t)offset);
+    if (offset < 0 ? delta > base : delta > UINTMAX_MAX - base)
+    {
+        errno = EINVAL;
+        *error = true;
+        return;
+    }
+    m->offset = (offset < 0 ? base - delta : base + delta);
+}
+
+/**
+ * \brief               Access input data in place.
+ * \param read_fn       The custom input function.
+ * \param userdata      A parameter to the custom input function.
+ * \param size          The number of bytes.
+ * \return              A pointer to the next \a size bytes of input, or NULL.
+ *
+ * If the input is a memory buffer that holds at least \a size more bytes, these are
+ * consumed and a pointer to them is returned, so that they need not be copied.
+ * Otherwise, no input is consumed and NULL is returned; the caller then uses \a read_fn.
+ */
+static GTA_ATTR_NOTHROW
+const void *
+gta_peek_memory(gta_read_t read_fn, intptr_t userdata, size_t size)
+{
+    if (read_fn != gta_read_memory)
+    {
+        return NULL;
+    }
+    gta_memory_input_t *m = (gta_memory_input_t *)userdata;
+    if (m->offset > m->size || size > m->size - m->offset)
+    {
+        return NULL;
+    }
+    const void *p = m->buffer + m->offset;
+    m->offset += size;
+    return p;
+}
+
+/* Whether a pointer was returned by gta_peek_memory() for this input, and must therefore not be freed. */
+static GTA_ATTR_NOTHROW
+bool
+gta_is_peeked_memory(const void *ptr, gta_read_t read_fn, intptr_t userdata)
+{
+    if (read_fn != gta_read_memory || !ptr)
+    {
+        return false;
+    }
+    const gta_memory_input_t *m = (const gta_memory_input_t *)userdata;
+    return ((const char *)ptr >= m->buffer && (const char *)ptr < m->buffer + m->size);
+}
+
 static GTA_ATTR_NOTHROW
 gta_result_t gta_readskip(gta_read_t read_fn, intptr_t userdata, uintmax_t s)
 {
     gta_result_t retval = GTA_OK;
-    void *trash = malloc(s < gta_max_chunk_size ? s : gta_max_chunk_size);
+    void *trash = gta_alloc_chunk(s < gta_max_chunk_size ? s : gta_max_chunk_size);
     if (!trash)
     {
         retval = GTA_SYSTEM_ERROR;
@@ -373,7 +886,7 @@ gta_result_t gta_readskip(gta_read_t read_fn, intptr_t userdata, uintmax_t s)
         s -= x;
     }
 exit:
-    free(trash);
+    gta_free_chunk(trash);
     return retval;
 }
 
@@ -385,36 +898,342 @@ exit:
  */
 
 
-static GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NOTHROW
-gta_result_t
-gta_compress(void **dst, size_t *dst_size, const void *src, size_t src_size, gta_compression_t compression)
+static GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW
+void
+gta_init_codec(gta_codec_t *GTA_RESTRICT codec)
 {
-    void* tmp_ptr;
-    gta_result_t retval = GTA_OK;
+    const lzma_stream lzma_stream_init = LZMA_STREAM_INIT;
+    codec->deflate_ready = false;
+    codec->deflate_level = 0;
+    codec->inflate_ready = false;
+    codec->xz_encoder = lzma_stream_init;
+    codec->xz_decoder = lzma_stream_init;
+#if HAVE_LIBZSTD
+    codec->zstd_encoder = NULL;
+    codec->zstd_decoder = NULL;
+#endif
+#if HAVE_LIBLZ4
+    codec->lz4_state = NULL;
+#endif
+    codec->filter_buffer = NULL;
+    codec->filter_buffer_size = 0;
+}
 
-    switch (compression)
+static GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW
+void
+gta_free_codec(gta_codec_t *GTA_RESTRICT codec)
+{
+    if (codec->deflate_ready)
     {
-    case GTA_NONE:
-        {
-            *dst = malloc(src_size);
-            if (!*dst)
-            {
-                retval = GTA_SYSTEM_ERROR;
-                break;
-            }
-            memcpy(*dst, src, src_size);
-            *dst_size = src_size;
-        }
-        break;
+        deflateEnd(&codec->deflate);
+    }
+    if (codec->inflate_ready)
+    {
+        inflateEnd(&codec->inflate);
+    }
+    lzma_end(&codec->xz_encoder);
+    lzma_end(&codec->xz_decoder);
+#if HAVE_LIBZSTD
+    ZSTD_freeCCtx(codec->zstd_encoder);
+    ZSTD_freeDCtx(codec->zstd_decoder);
+#endif
+#if HAVE_LIBLZ4
+    gta_free(codec->lz4_state);
+#endif
+    gta_free_chunk(codec->filter_buffer);
+    gta_init_codec(codec);
+}
 
-    case GTA_ZLIB:
-    case GTA_ZLIB1:
-    case GTA_ZLIB2:
-    case GTA_ZLIB3:
-    case GTA_ZLIB4:
-    case GTA_ZLIB5:
-    case GTA_ZLIB6:
-    case GTA_ZLIB7:
+/* Return the ZSTD compression level for a compression method, 0 for the default
+ * level (GTA_ZSTD), or -1 if the method is not a ZSTD method. */
+static GTA_ATTR_CONST GTA_ATTR_NOTHROW
+int
+gta_zstd_level(int compression)
+{
+    if (compression == GTA_ZSTD)
+    {
+        return 0;
+    }
+    else if (compression >= GTA_ZSTD1 && compression <= GTA_ZSTD19)
+    {
+        return compression - GTA_ZSTD1 + 1;
+    }
+    else
+    {
+        return -1;
+    }
+}
+
+/* Check if a compression method is known and if this build of libgta supports it. */
+static GTA_ATTR_CONST GTA_ATTR_NOTHROW
+bool
+gta_compression_is_supported(int compression)
+{
+    if (compression >= GTA_NONE && compression <= GTA_ZLIB9)
+    {
+        return true;
+    }
+#if HAVE_LIBZSTD
+    if (gta_zstd_level(compression) >= 0)
+    {
+        return true;
+    }
+#endif
+#if HAVE_LIBLZ4
+    if (compression == GTA_LZ4)
+    {
+        return true;
+    }
+#endif
+    return false;
+}
+
+/* The compression byte of the header and of each chunk stores the compression
+ * method in its lower 6 bits and the pre-filter in its upper 2 bits. */
+static inline GTA_ATTR_CONST GTA_ATTR_NOTHROW
+int
+gta_chunk_method(uint8_t compression)
+{
+    return compression & 0x3f;
+}
+
+static inline GTA_ATTR_CONST GTA_ATTR_NOTHROW
+gta_filter_t
+gta_chunk_filter(uint8_t compression)
+{
+    return compression >> 6;
+}
+
+static inline GTA_ATTR_CONST GTA_ATTR_NOTHROW
+uint8_t
+gta_chunk_compression(int method, gta_filter_t filter)
+{
+    return method | (filter << 6);
+}
+
+/* Return the stride of the pre-filters for the data chunks of an array, which is its
+ * element size. Elements that do not fit into a chunk are left unchanged by the filters,
+ * so larger element sizes are clamped. */
+static inline GTA_ATTR_NONNULL_ALL GTA_ATTR_PURE GTA_ATTR_NOTHROW
+size_t
+gta_filter_stride(const gta_header_t *GTA_RESTRICT header)
+{
+    return (header->element_size < gta_max_chunk_size ? header->element_size : gta_max_chunk_size);
+}
+
+/* Compress with ZSTD; see gta_compress(). */
+static GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW
+gta_result_t
+gta_compress_zstd(gta_codec_t *GTA_RESTRICT codec,
+        void *dst, size_t *dst_size, const void *src, size_t src_size, int level)
+{
+#if HAVE_LIBZSTD
+    size_t r;
+
+    if (!codec->zstd_encoder)
+    {
+        codec->zstd_encoder = ZSTD_createCCtx();
+        if (!codec->zstd_encoder)
+        {
+            errno = ENOMEM;
+            return GTA_SYSTEM_ERROR;
+        }
+    }
+    // This resets the context for a new frame, but keeps its memory.
+    r = ZSTD_compressCCtx(codec->zstd_encoder, dst, *dst_size, src, src_size, level);
+    if (ZSTD_isError(r))
+    {
+        if (ZSTD_getErrorCode(r) == ZSTD_error_dstSize_tooSmall)
+        {
+            return GTA_OVERFLOW;
+        }
+        errno = (ZSTD_getErrorCode(r) == ZSTD_error_memory_allocation ? ENOMEM : EINVAL);
+        return GTA_SYSTEM_ERROR;
+    }
+    *dst_size = r;
+    return GTA_OK;
+#else
+    (void)codec;
+    (void)dst;
+    (void)dst_size;
+    (void)src;
+    (void)src_size;
+    (void)level;
+    return GTA_UNSUPPORTED_DATA;
+#endif
+}
+
+/* Uncompress ZSTD data; see gta_uncompress(). */
+static GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW
+gta_result_t
+gta_uncompress_zstd(gta_codec_t *GTA_RESTRICT codec,
+        void *dst, size_t dst_size, const void *src, size_t src_size)
+{
+#if HAVE_LIBZSTD
+    size_t r;
+
+    if (!codec->zstd_decoder)
+    {
+        codec->zstd_decoder = ZSTD_createDCtx();
+        if (!codec->zstd_decoder)
+        {
+            errno = ENOMEM;
+            return GTA_SYSTEM_ERROR;
+        }
+    }
+    r = ZSTD_decompressDCtx(codec->zstd_decoder, dst, dst_size, src, src_size);
+    if (ZSTD_isError(r))
+    {
+        if (ZSTD_getErrorCode(r) == ZSTD_error_memory_allocation)
+        {
+            errno = ENOMEM;
+            return GTA_SYSTEM_ERROR;
+        }
+        else if (ZSTD_getErrorCode(r) == ZSTD_error_dstSize_tooSmall)
+        {
+            return GTA_OVERFLOW;
+        }
+        return GTA_INVALID_DATA;
+    }
+    if (r != dst_size)
+    {
+        return GTA_INVALID_DATA;
+    }
+    return GTA_OK;
+#else
+    (void)codec;
+    (void)dst;
+    (void)dst_size;
+    (void)src;
+    (void)src_size;
+    return GTA_UNSUPPORTED_DATA;
+#endif
+}
+
+/* Compress with LZ4; see gta_compress(). */
+static GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW
+gta_result_t
+gta_compress_lz4(gta_codec_t *GTA_RESTRICT codec,
+        void *dst, size_t *dst_size, const void *src, size_t src_size)
+{
+#if HAVE_LIBLZ4
+    int lz4_compressed_size = (*dst_size > INT_MAX ? INT_MAX : *dst_size);
+    int r;
+
+    if (src_size > LZ4_MAX_INPUT_SIZE)
+    {
+        // Data type overflow
+        return GTA_OVERFLOW;
+    }
+    if (!codec->lz4_state)
+    {
+        codec->lz4_state = gta_malloc(LZ4_sizeofState());
+        if (!codec->lz4_state)
+        {
+            return GTA_SYSTEM_ERROR;
+        }
+    }
+    r = LZ4_compress_fast_extState(codec->lz4_state, src, dst, src_size, lz4_compressed_size, 1);
+    if (r <= 0)
+    {
+        // the output buffer is full
+        return GTA_OVERFLOW;
+    }
+    *dst_size = r;
+    return GTA_OK;
+#else
+    (void)codec;
+    (void)dst;
+    (void)dst_size;
+    (void)src;
+    (void)src_size;
+    return GTA_UNSUPPORTED_DATA;
+#endif
+}
+
+/* Uncompress LZ4 data; see gta_uncompress(). */
+static GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW
+gta_result_t
+gta_uncompress_lz4(void *dst, size_t dst_size, const void *src, size_t src_size)
+{
+#if HAVE_LIBLZ4
+    int lz4_compressed_size = src_size;
+    int lz4_uncompressed_size = dst_size;
+    int r;
+
+    if ((size_t)lz4_compressed_size != src_size || (size_t)lz4_uncompressed_size != dst_size
+            || lz4_compressed_size < 0 || lz4_uncompressed_size < 0)
+    {
+        // Data type overflow
+        return GTA_OVERFLOW;
+    }
+    r = LZ4_decompress_safe(src, dst, lz4_compressed_size, lz4_uncompressed_size);
+    if (r != lz4_uncompressed_size)
+    {
+        // negative values indicate malformed input
+        return GTA_INVALID_DATA;
+    }
+    return GTA_OK;
+#else
+    (void)dst;
+    (void)dst_size;
+    (void)src;
+    (void)src_size;
+    return GTA_UNSUPPORTED_DATA;
+#endif
+}
+
+/**
+ * \brief               Compress data into a buffer of limited size.
+ * \param codec         The codec whose streams are reused, or NULL to use temporary streams.
+ * \param dst           The buffer for the compressed data.
+ * \param dst_size      The size of \a dst. Returns the size of the compressed data.
+ * \param src           The data.
+ * \param src_size      The size of the data.
+ * \param compression   The compression method.
+ * \return              \a GTA_OK, \a GTA_OVERFLOW (if the compressed data does not fit into \a dst),
+ *                      \a GTA_UNSUPPORTED_DATA (if the method is not available), or \a GTA_SYSTEM_ERROR.
+ *
+ * Compressing into a buffer that only has the size that is still useful avoids allocating
+ * a worst-case buffer, and stops early for incompressible data.
+ * The output does not depend on whether the streams of \a codec were used before.
+ */
+static GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NOTHROW
+gta_result_t
+gta_compress(gta_codec_t *codec,
+        void *dst, size_t *dst_size, const void *src, size_t src_size, gta_compression_t compression)
+{
+    gta_result_t retval = GTA_OK;
+    gta_codec_t tmp_codec;
+
+    if (!codec)
+    {
+        gta_init_codec(&tmp_codec);
+        codec = &tmp_codec;
+    }
+
+    switch (compression)
+    {
+    case GTA_NONE:
+        {
+            if (*dst_size < src_size)
+            {
+                retval = GTA_OVERFLOW;
+                break;
+            }
+            memcpy(dst, src, src_size);
+            *dst_size = src_size;
+        }
+        break;
+
+    case GTA_ZLIB:
+    case GTA_ZLIB1:
+    case GTA_ZLIB2:
+    case GTA_ZLIB3:
+    case GTA_ZLIB4:
+    case GTA_ZLIB5:
+    case GTA_ZLIB6:
+    case GTA_ZLIB7:
     case GTA_ZLIB8:
     case GTA_ZLIB9:
         {
@@ -429,165 +1248,182 @@ gta_compress(void **dst, size_t *dst_size, const void *src, size_t src_size, gta
                     : compression == GTA_ZLIB8 ? 8
                     : compression == GTA_ZLIB9 ? 9
                     : Z_DEFAULT_COMPRESSION);
+            z_stream *strm = &codec->deflate;
             int zlib_r;
-            uLong zlib_uncompressed_size = src_size;
-            uLongf zlib_compressed_size;
+            uInt zlib_uncompressed_size = src_size;
+            uInt zlib_compressed_size = *dst_size;
 
-            size_t max_compression_overhead = src_size / 10 + 12;
-            if (src_size > SIZE_MAX - max_compression_overhead)
+            if (zlib_uncompressed_size != src_size || zlib_compressed_size != *dst_size)
             {
+                // Data type overflow
                 retval = GTA_OVERFLOW;
                 break;
             }
-            zlib_compressed_size = src_size + max_compression_overhead;
-            if (zlib_uncompressed_size != src_size || zlib_compressed_size != src_size + max_compression_overhead)
+            if (codec->deflate_ready && codec->deflate_level != zlib_level)
             {
-                // Data type overflow
-                retval = GTA_OVERFLOW;
-                break;
+                deflateEnd(strm);
+                codec->deflate_ready = false;
             }
-            *dst = malloc(zlib_compressed_size);
-            if (!*dst)
+            if (codec->deflate_ready)
             {
-                retval = GTA_SYSTEM_ERROR;
-                break;
+                zlib_r = deflateReset(strm);
+            }
+            else
+            {
+                // These are the parameters that compress2() uses
+                strm->zalloc = Z_NULL;
+                strm->zfree = Z_NULL;
+                strm->opaque = Z_NULL;
+                zlib_r = deflateInit(strm, zlib_level);
+                codec->deflate_ready = (zlib_r == Z_OK);
+                codec->deflate_level = zlib_level;
             }
-            zlib_r = compress2(*dst, &zlib_compressed_size, src, zlib_uncompressed_size, zlib_level);
             if (zlib_r != Z_OK)
             {
-                free(*dst);
-                // of the possible errors Z_MEM_ERROR, Z_BUF_ERROR, Z_STREAM_ERROR,
                 // only Z_MEM_ERROR can happen here
                 errno = ENOMEM;
                 retval = GTA_SYSTEM_ERROR;
                 break;
             }
-            *dst_size = zlib_compressed_size;
-            tmp_ptr = realloc(*dst, *dst_size);
-            if (!tmp_ptr)
+            strm->next_in = (Bytef *)src;
+            strm->avail_in = zlib_uncompressed_size;
+            strm->next_out = dst;
+            strm->avail_out = zlib_compressed_size;
+            zlib_r = deflate(strm, Z_FINISH);
+            if (zlib_r == Z_OK || zlib_r == Z_BUF_ERROR)
+            {
+                // the output buffer is full
+                retval = GTA_OVERFLOW;
+                break;
+            }
+            if (zlib_r != Z_STREAM_END)
             {
-                free(*dst);
+                errno = EINVAL;
                 retval = GTA_SYSTEM_ERROR;
                 break;
             }
-            *dst = tmp_ptr;
+            *dst_size = zlib_compressed_size - strm->avail_out;
         }
         break;
 
     case GTA_BZIP2:
         {
-            size_t max_compression_overhead = src_size / 100 + 600;
-            if (src_size > SIZE_MAX - max_compression_overhead)
-            {
-                retval = GTA_OVERFLOW;
-                break;
-            }
+            // libbz2 has no way to reset a stream, so there is nothing to reuse.
             unsigned int bz2_uncompressed_size = src_size;
-            unsigned int bz2_compressed_size = src_size + max_compression_overhead;
-            if (bz2_uncompressed_size != src_size || bz2_compressed_size != src_size + max_compression_overhead)
+            unsigned int bz2_compressed_size = *dst_size;
+            if (bz2_uncompressed_size != src_size || bz2_compressed_size != *dst_size)
             {
                 // Data type overflow
                 retval = GTA_OVERFLOW;
                 break;
             }
-            *dst = malloc(bz2_compressed_size);
-            if (!*dst)
-            {
-                retval = GTA_SYSTEM_ERROR;
-                break;
-            }
             int r = BZ2_bzBuffToBuffCompress(
-                    *dst, &bz2_compressed_size,
+                    dst, &bz2_compressed_size,
                     (char *)src, bz2_uncompressed_size,
                     9, 0, 0);
-            if (r != BZ_OK)
+            if (r == BZ_OUTBUFF_FULL)
             {
-                // of the possible errors BZ_CONFIG_ERROR, BZ_PARAM_ERROR,
-                // BZ_MEM_ERROR, BZ_OUTBUFF_FULL, only BZ_MEM_ERROR can happen here.
-                errno = ENOMEM;
-                retval = GTA_SYSTEM_ERROR;
+                retval = GTA_OVERFLOW;
                 break;
             }
-            *dst_size = bz2_compressed_size;
-            tmp_ptr = realloc(*dst, *dst_size);
-            if (!tmp_ptr)
+            if (r != BZ_OK)
             {
-                free(*dst);
+                // of the remaining errors BZ_CONFIG_ERROR, BZ_PARAM_ERROR,
+                // BZ_MEM_ERROR, only BZ_MEM_ERROR can happen here.
+                errno = ENOMEM;
                 retval = GTA_SYSTEM_ERROR;
                 break;
             }
-            *dst = tmp_ptr;
+            *dst_size = bz2_compressed_size;
         }
         break;
 
     case GTA_XZ:
         {
-            lzma_stream strm = LZMA_STREAM_INIT;
-            void *buf;
-            size_t buf_size;
+            lzma_stream *strm = &codec->xz_encoder;
             lzma_ret r;
 
-            buf_size = lzma_stream_buffer_bound(src_size);
-            if (buf_size == 0)
-            {
-                retval = GTA_OVERFLOW;
-                break;
-            }
-            buf = malloc(buf_size);
-            if (!buf)
-            {
-                retval = GTA_SYSTEM_ERROR;
-                break;
-            }
-            strm.next_in = src;
-            strm.avail_in = src_size;
-            strm.next_out = buf;
-            strm.avail_out = buf_size;
-            r = lzma_easy_encoder(&strm, LZMA_PRESET_DEFAULT, LZMA_CHECK_NONE);
+            // Initializing a stream that was used before reuses its memory.
+            r = lzma_easy_encoder(strm, LZMA_PRESET_DEFAULT, LZMA_CHECK_NONE);
             if (r != LZMA_OK)
             {
-                errno = EINVAL;
+                errno = (r == LZMA_MEM_ERROR ? ENOMEM : EINVAL);
                 retval = GTA_SYSTEM_ERROR;
                 break;
             }
-            r = lzma_code(&strm, LZMA_RUN);
-            if (r != LZMA_OK)
+            strm->next_in = src;
+            strm->avail_in = src_size;
+            strm->next_out = dst;
+            strm->avail_out = *dst_size;
+            do
             {
-                lzma_end(&strm);
-                errno = EINVAL;
-                retval = GTA_SYSTEM_ERROR;
-                break;
+                r = lzma_code(strm, LZMA_FINISH);
             }
-            r = lzma_code(&strm, LZMA_FINISH);
+            while (r == LZMA_OK && strm->avail_out > 0);
             if (r != LZMA_STREAM_END)
             {
-                lzma_end(&strm);
-                errno = EINVAL;
-                retval = GTA_SYSTEM_ERROR;
-                break;
-            }
-            *dst_size = strm.total_out;
-            *dst = realloc(buf, *dst_size);
-            if (!*dst)
-            {
-                free(buf);
-                lzma_end(&strm);
-                retval = GTA_SYSTEM_ERROR;
+                if (r == LZMA_OK || r == LZMA_BUF_ERROR)
+                {
+                    retval = GTA_OVERFLOW;
+                }
+                else
+                {
+                    errno = EINVAL;
+                    retval = GTA_SYSTEM_ERROR;
+                }
                 break;
             }
-            lzma_end(&strm);
+            *dst_size -= strm->avail_out;
+        }
+        break;
+
+    case GTA_LZ4:
+        retval = gta_compress_lz4(codec, dst, dst_size, src, src_size);
+        break;
+
+    default:
+        if (gta_zstd_level(compression) >= 0)
+        {
+            retval = gta_compress_zstd(codec, dst, dst_size, src, src_size, gta_zstd_level(compression));
+        }
+        else
+        {
+            retval = GTA_UNSUPPORTED_DATA;
         }
         break;
     }
 
+    if (codec == &tmp_codec)
+    {
+        gta_free_codec(&tmp_codec);
+    }
     return retval;
 }
 
+/**
+ * \brief               Uncompress data.
+ * \param codec         The codec whose streams are reused, or NULL to use temporary streams.
+ * \param dst           The buffer for the uncompressed data.
+ * \param dst_size      The size of the uncompressed data.
+ * \param src           The compressed data.
+ * \param src_size      The size of the compressed data.
+ * \param compression   The compression method.
+ * \return              \a GTA_OK, \a GTA_OVERFLOW, \a GTA_INVALID_DATA, \a GTA_UNSUPPORTED_DATA
+ *                      (if the method is not available), or \a GTA_SYSTEM_ERROR.
+ */
 static GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NOTHROW
 gta_result_t
-gta_uncompress(void *dst, size_t dst_size, const void *src, size_t src_size, gta_compression_t compression)
+gta_uncompress(gta_codec_t *codec,
+        void *dst, size_t dst_size, const void *src, size_t src_size, gta_compression_t compression)
 {
     gta_result_t retval = GTA_OK;
+    gta_codec_t tmp_codec;
+
+    if (!codec)
+    {
+        gta_init_codec(&tmp_codec);
+        codec = &tmp_codec;
+    }
 
     switch (compression)
     {
@@ -613,9 +1449,10 @@ gta_uncompress(void *dst, size_t dst_size, const void *src, size_t src_size, gta
     case GTA_ZLIB8:
     case GTA_ZLIB9:
         {
+            z_stream *strm = &codec->inflate;
             int zlib_r;
-            uLong zlib_compressed_size = src_size;
-            uLongf zlib_uncompressed_size = dst_size;
+            uInt zlib_compressed_size = src_size;
+            uInt zlib_uncompressed_size = dst_size;
 
             if (zlib_compressed_size != src_size || zlib_uncompressed_size != dst_size)
             {
@@ -623,8 +1460,32 @@ gta_uncompress(void *dst, size_t dst_size, const void *src, size_t src_size, gta
                 retval = GTA_OVERFLOW;
                 break;
             }
-            zlib_r = uncompress(dst, &zlib_uncompressed_size, src, zlib_compressed_size);
+            if (codec->inflate_ready)
+            {
+                zlib_r = inflateReset(strm);
+            }
+            else
+            {
+                strm->zalloc = Z_NULL;
+                strm->zfree = Z_NULL;
+                strm->opaque = Z_NULL;
+                strm->next_in = Z_NULL;
+                strm->avail_in = 0;
+                zlib_r = inflateInit(strm);
+                codec->inflate_ready = (zlib_r == Z_OK);
+            }
             if (zlib_r != Z_OK)
+            {
+                errno = ENOMEM;
+                retval = GTA_SYSTEM_ERROR;
+                break;
+            }
+            strm->next_in = (Bytef *)src;
+            strm->avail_in = zlib_compressed_size;
+            strm->next_out = dst;
+            strm->avail_out = zlib_uncompressed_size;
+            zlib_r = inflate(strm, Z_FINISH);
+            if (zlib_r != Z_STREAM_END)
             {
                 if (zlib_r == Z_MEM_ERROR)
                 {
@@ -632,18 +1493,18 @@ gta_uncompress(void *dst, size_t dst_size, const void *src, size_t src_size, gta
                     retval = GTA_SYSTEM_ERROR;
                     break;
                 }
-                else if (zlib_r == Z_BUF_ERROR)
+                else if ((zlib_r == Z_BUF_ERROR || zlib_r == Z_OK) && strm->avail_out == 0)
                 {
                     retval = GTA_OVERFLOW;
                     break;
                 }
-                else // zlib_r == Z_DATA_ERROR or unknown error
+                else // Z_DATA_ERROR, Z_NEED_DICT, or truncated data
                 {
                     retval = GTA_INVALID_DATA;
                     break;
                 }
             }
-            if (zlib_uncompressed_size != dst_size)
+            if (strm->avail_out != 0)
             {
                 retval = GTA_INVALID_DATA;
                 break;
@@ -688,56 +1549,582 @@ gta_uncompress(void *dst, size_t dst_size, const void *src, size_t src_size, gta
 
     case GTA_XZ:
         {
-            lzma_stream strm = LZMA_STREAM_INIT;
+            lzma_stream *strm = &codec->xz_decoder;
             lzma_ret r;
 
-            strm.next_in = src;
-            strm.avail_in = src_size;
-            strm.next_out = dst;
-            strm.avail_out = dst_size;
-            r = lzma_stream_decoder(&strm, gta_max_chunk_size, 0);
+            // Initializing a stream that was used before reuses its memory.
+            r = lzma_stream_decoder(strm, gta_max_chunk_size, 0);
             if (r != LZMA_OK)
             {
                 errno = (r == LZMA_MEM_ERROR ? ENOMEM : EINVAL);
                 retval = GTA_SYSTEM_ERROR;
                 break;
             }
-            r = lzma_code(&strm, LZMA_RUN);
+            strm->next_in = src;
+            strm->avail_in = src_size;
+            strm->next_out = dst;
+            strm->avail_out = dst_size;
+            r = lzma_code(strm, LZMA_RUN);
             if (r != LZMA_STREAM_END)
             {
-                lzma_end(&strm);
                 retval = GTA_INVALID_DATA;
                 break;
             }
-            if (strm.total_out != dst_size)
+            if (strm->avail_out != 0)
             {
-                lzma_end(&strm);
                 retval = GTA_INVALID_DATA;
                 break;
             }
-            lzma_end(&strm);
+        }
+        break;
+
+    case GTA_LZ4:
+        retval = gta_uncompress_lz4(dst, dst_size, src, src_size);
+        break;
+
+    default:
+        if (gta_zstd_level(compression) >= 0)
+        {
+            retval = gta_uncompress_zstd(codec, dst, dst_size, src, src_size);
+        }
+        else
+        {
+            retval = GTA_UNSUPPORTED_DATA;
         }
         break;
     }
 
+    if (codec == &tmp_codec)
+    {
+        gta_free_codec(&tmp_codec);
+    }
     return retval;
 }
 
 
 /*
  *
- * Endianness Functions
+ * Pre-filters
  *
  */
 
 
+#if defined __SSE2__
 /**
- * \brief               Find out if the data needs endianness swapping.
- * \param header        The header.
- * \return              Whether the data needs endianness swapping.
+ * \brief               Split 16 elements into byte planes.
+ * \param planes        Returns the byte planes: plane j holds byte j of each element.
+ * \param src           The elements.
+ * \param width         The element size: 2, 4, or 8 bytes.
  */
-static inline GTA_ATTR_NONNULL_ALL GTA_ATTR_PURE GTA_ATTR_NOTHROW
-bool
+static inline GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW
+void
+gta_shuffle_block(__m128i *GTA_RESTRICT planes, const unsigned char *GTA_RESTRICT src, size_t width)
+{
+    __m128i x[8], u[8], v[8];
+    for (size_t k = 0; k < width; k++)
+    {
+        x[k] = _mm_loadu_si128((const __m128i *)(src + 16 * k));
+    }
+    // Interleaving bytes of vector pairs repeatedly gathers the bytes of equal position.
+    for (size_t k = 0; k < width; k += 2)
+    {
+        u[k] = _mm_unpacklo_epi8(x[k], x[k + 1]);
+        u[k + 1] = _mm_unpackhi_epi8(x[k], x[k + 1]);
+    }
+    for (size_t k = 0; k < width; k += 2)
+    {
+        v[k] = _mm_unpacklo_epi8(u[k], u[k + 1]);
+        v[k + 1] = _mm_unpackhi_epi8(u[k], u[k + 1]);
+    }
+    if (width == 2)
+    {
+        u[0] = _mm_unpacklo_epi8(v[0], v[1]);
+        u[1] = _mm_unpackhi_epi8(v[0], v[1]);
+        planes[0] = _mm_unpacklo_epi8(u[0], u[1]);
+        planes[1] = _mm_unpackhi_epi8(u[0], u[1]);
+    }
+    else if (width == 4)
+    {
+        for (size_t k = 0; k < 4; k += 2)
+        {
+            u[k] = _mm_unpacklo_epi8(v[k], v[k + 1]);
+            u[k + 1] = _mm_unpackhi_epi8(v[k], v[k + 1]);
+        }
+        planes[0] = _mm_unpacklo_epi64(u[0], u[2]);
+        planes[1] = _mm_unpackhi_epi64(u[0], u[2]);
+        planes[2] = _mm_unpacklo_epi64(u[1], u[3]);
+        planes[3] = _mm_unpackhi_epi64(u[1], u[3]);
+    }
+    else
+    {
+        for (size_t k = 0; k < 2; k++)
+        {
+            __m128i w0 = _mm_unpacklo_epi32(v[k], v[k + 2]);
+            __m128i w1 = _mm_unpackhi_epi32(v[k], v[k + 2]);
+            __m128i w2 = _mm_unpacklo_epi32(v[k + 4], v[k + 6]);
+            __m128i w3 = _mm_unpackhi_epi32(v[k + 4], v[k + 6]);
+            planes[4 * k + 0] = _mm_unpacklo_epi64(w0, w2);
+            planes[4 * k + 1] = _mm_unpackhi_epi64(w0, w2);
+            planes[4 * k + 2] = _mm_unpacklo_epi64(w1, w3);
+            planes[4 * k + 3] = _mm_unpackhi_epi64(w1, w3);
+        }
+    }
+}
+
+/**
+ * \brief               Join byte planes into 16 elements; the inverse of gta_shuffle_block().
+ * \param dst           The elements.
+ * \param planes        The byte planes.
+ * \param width         The element size: 2, 4, or 8 bytes.
+ */
+static inline GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW
+void
+gta_unshuffle_block(unsigned char *GTA_RESTRICT dst, const __m128i *GTA_RESTRICT planes, size_t width)
+{
+    __m128i *d = (__m128i *)dst;
+    if (width == 2)
+    {
+        _mm_storeu_si128(d + 0, _mm_unpacklo_epi8(planes[0], planes[1]));
+        _mm_storeu_si128(d + 1, _mm_unpackhi_epi8(planes[0], planes[1]));
+    }
+    else if (width == 4)
+    {
+        __m128i a = _mm_unpacklo_epi8(planes[0], planes[1]);
+        __m128i b = _mm_unpacklo_epi8(planes[2], planes[3]);
+        _mm_storeu_si128(d + 0, _mm_unpacklo_epi16(a, b));
+        _mm_storeu_si128(d + 1, _mm_unpackhi_epi16(a, b));
+        a = _mm_unpackhi_epi8(planes[0], planes[1]);
+        b = _mm_unpackhi_epi8(planes[2], planes[3]);
+        _mm_storeu_si128(d + 2, _mm_unpacklo_epi16(a, b));
+        _mm_storeu_si128(d + 3, _mm_unpackhi_epi16(a, b));
+    }
+    else
+    {
+        __m128i a[4];
+        for (size_t h = 0; h < 2; h++)
+        {
+            for (size_t k = 0; k < 4; k++)
+            {
+                a[k] = (h == 0 ? _mm_unpacklo_epi8(planes[2 * k], planes[2 * k + 1])
+                        : _mm_unpackhi_epi8(planes[2 * k], planes[2 * k + 1]));
+            }
+            __m128i b0 = _mm_unpacklo_epi16(a[0], a[1]);
+            __m128i b1 = _mm_unpacklo_epi16(a[2], a[3]);
+            _mm_storeu_si128(d + 4 * h + 0, _mm_unpacklo_epi32(b0, b1));
+            _mm_storeu_si128(d + 4 * h + 1, _mm_unpackhi_epi32(b0, b1));
+            b0 = _mm_unpackhi_epi16(a[0], a[1]);
+            b1 = _mm_unpackhi_epi16(a[2], a[3]);
+            _mm_storeu_si128(d + 4 * h + 2, _mm_unpacklo_epi32(b0, b1));
+            _mm_storeu_si128(d + 4 * h + 3, _mm_unpackhi_epi32(b0, b1));
+        }
+    }
+}
+#endif
+
+/**
+ * \brief               Transpose an 8x8 bit matrix.
+ * \param x             The matrix; byte i is row i, and bit j of a byte is column j.
+ * \return              The transposed matrix.
+ */
+static inline GTA_ATTR_CONST GTA_ATTR_NOTHROW
+uint64_t
+gta_transpose_bits(uint64_t x)
+{
+    uint64_t t;
+    t = (x ^ (x >> 7)) & UINT64_C(0x00AA00AA00AA00AA);
+    x = x ^ t ^ (t << 7);
+    t = (x ^ (x >> 14)) & UINT64_C(0x0000CCCC0000CCCC);
+    x = x ^ t ^ (t << 14);
+    t = (x ^ (x >> 28)) & UINT64_C(0x00000000F0F0F0F0);
+    x = x ^ t ^ (t << 28);
+    return x;
+}
+
+/**
+ * \brief               Byte-shuffle chunk data.
+ * \param dst           The buffer for the filtered data.
+ * \param src           The chunk data.
+ * \param size          The size of the chunk data.
+ * \param width         The element size.
+ *
+ * Byte j of each of the n complete elements in the chunk is stored at dst[j * n + i],
+ * followed by the remaining bytes of an incomplete element, if any.\n
+ * Where SSE2 is available, 16 elements of size 2, 4, or 8 are processed at once.
+ */
+static GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW
+void
+gta_shuffle(unsigned char *GTA_RESTRICT dst, const unsigned char *GTA_RESTRICT src, size_t size, size_t width)
+{
+    size_t n = size / width;
+    size_t i = 0;
+#if defined __SSE2__
+    if (width == 2 || width == 4 || width == 8)
+    {
+        __m128i planes[8];
+        for (; n - i >= 16; i += 16)
+        {
+            gta_shuffle_block(planes, src + i * width, width);
+            for (size_t j = 0; j < width; j++)
+            {
+                _mm_storeu_si128((__m128i *)(dst + j * n + i), planes[j]);
+            }
+        }
+    }
+#endif
+    for (size_t j = 0; j < width; j++)
+    {
+        for (size_t k = i; k < n; k++)
+        {
+            dst[j * n + k] = src[k * width + j];
+        }
+    }
+    memcpy(dst + n * width, src + n * width, size - n * width);
+}
+
+/* Revert gta_shuffle(). */
+static GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW
+void
+gta_unshuffle(unsigned char *GTA_RESTRICT dst, const unsigned char *GTA_RESTRICT src, size_t size, size_t width)
+{
+    size_t n = size / width;
+    size_t i = 0;
+#if defined __SSE2__
+    if (width == 2 || width == 4 || width == 8)
+    {
+        __m128i planes[8];
+        for (; n - i >= 16; i += 16)
+        {
+            for (size_t j = 0; j < width; j++)
+            {
+                planes[j] = _mm_loadu_si128((const __m128i *)(src + j * n + i));
+            }
+            gta_unshuffle_block(dst + i * width, planes, width);
+        }
+    }
+#endif
+    for (size_t j = 0; j < width; j++)
+    {
+        for (size_t k = i; k < n; k++)
+        {
+            dst[k * width + j] = src[j * n + k];
+        }
+    }
+    memcpy(dst + n * width, src + n * width, size - n * width);
+}
+
+/**
+ * \brief               Bit-shuffle chunk data.
+ * \param dst           The buffer for the filtered data.
+ * \param src           The chunk data.
+ * \param size          The size of the chunk data.
+ * \param width         The element size.
+ *
+ * The n complete elements in the chunk are rounded down to a multiple of 8. Bit b of byte j
+ * of these elements forms bit plane 8 * j + b, which is stored at dst[(8 * j + b) * n / 8], with
+ * bit i % 8 of byte i / 8 of the plane taken from element i. The remaining bytes follow unchanged.\n
+ * Where SSE2 is available, 16 elements of size 1, 2, 4, or 8 are processed at once.
+ */
+static GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW
+void
+gta_bitshuffle(unsigned char *GTA_RESTRICT dst, const unsigned char *GTA_RESTRICT src, size_t size, size_t width)
+{
+    size_t n = size / width / 8 * 8;
+    size_t plane_size = n / 8;
+    size_t i = 0;
+#if defined __SSE2__
+    if (width == 1 || width == 2 || width == 4 || width == 8)
+    {
+        __m128i planes[8];
+        for (; n - i >= 16; i += 16)
+        {
+            if (width == 1)
+            {
+                planes[0] = _mm_loadu_si128((const __m128i *)(src + i));
+            }
+            else
+            {
+                gta_shuffle_block(planes, src + i * width, width);
+            }
+            for (size_t j = 0; j < width; j++)
+            {
+                // The sign bits of the bytes give the highest bit plane; shift for the lower ones.
+                __m128i v = planes[j];
+                for (int b = 7; b >= 0; b--)
+                {
+                    int mask = _mm_movemask_epi8(v);
+                    unsigned char *p = dst + (8 * j + b) * plane_size + i / 8;
+                    p[0] = mask & 0xff;
+                    p[1] = mask >> 8;
+                    v = _mm_slli_epi16(v, 1);
+                }
+            }
+        }
+    }
+#endif
+    for (; i < n; i += 8)
+    {
+        for (size_t j = 0; j < width; j++)
+        {
+            uint64_t x = 0;
+            for (size_t t = 0; t < 8; t++)
+            {
+                x |= (uint64_t)src[(i + t) * width + j] << (8 * t);
+            }
+            x = gta_transpose_bits(x);
+            for (size_t b = 0; b < 8; b++)
+            {
+                dst[(8 * j + b) * plane_size + i / 8] = x >> (8 * b);
+            }
+        }
+    }
+    memcpy(dst + n * width, src + n * width, size - n * width);
+}
+
+/* Revert gta_bitshuffle(). */
+static GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW
+void
+gta_unbitshuffle(unsigned char *GTA_RESTRICT dst, const unsigned char *GTA_RESTRICT src, size_t size, size_t width)
+{
+    size_t n = size / width / 8 * 8;
+    size_t plane_size = n / 8;
+    size_t i = 0;
+#if defined __SSE2__
+    if (width == 1 || width == 2 || width == 4 || width == 8)
+    {
+        const __m128i bits = _mm_set_epi8(-128, 64, 32, 16, 8, 4, 2, 1, -128, 64, 32, 16, 8, 4, 2, 1);
+        __m128i planes[8];
+        for (; n - i >= 16; i += 16)
+        {
+            for (size_t j = 0; j < width; j++)
+            {
+                // Expand the 16 bits of each bit plane to 16 bytes, and merge them.
+                __m128i v = _mm_setzero_si128();
+                for (size_t b = 0; b < 8; b++)
+                {
+                    const unsigned char *p = src + (8 * j + b) * plane_size + i / 8;
+                    __m128i m = _mm_unpacklo_epi64(_mm_set1_epi8(p[0]), _mm_set1_epi8(p[1]));
+                    m = _mm_cmpeq_epi8(_mm_and_si128(m, bits), bits);
+                    v = _mm_or_si128(v, _mm_and_si128(m, _mm_set1_epi8((char)(1u << b))));
+                }
+                planes[j] = v;
+            }
+            if (width == 1)
+            {
+                _mm_storeu_si128((__m128i *)(dst + i), planes[0]);
+            }
+            else
+            {
+                gta_unshuffle_block(dst + i * width, planes, width);
+            }
+        }
+    }
+#endif
+    for (; i < n; i += 8)
+    {
+        for (size_t j = 0; j < width; j++)
+        {
+            uint64_t x = 0;
+            for (size_t b = 0; b < 8; b++)
+            {
+                x |= (uint64_t)src[(8 * j + b) * plane_size + i / 8] << (8 * b);
+            }
+            x = gta_transpose_bits(x);
+            for (size_t t = 0; t < 8; t++)
+            {
+                dst[(i + t) * width + j] = x >> (8 * t);
+            }
+        }
+    }
+    memcpy(dst + n * width, src + n * width, size - n * width);
+}
+
+/**
+ * \brief               Delta-encode chunk data.
+ * \param dst           The buffer for the filtered data.
+ * \param src           The chunk data.
+ * \param size          The size of the chunk data.
+ * \param width         The element size.
+ *
+ * Each byte is replaced by its difference (modulo 256) to the byte at the same position
+ * in the preceding element. The first element is stored unchanged.
+ */
+static GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW
+void
+gta_delta(unsigned char *GTA_RESTRICT dst, const unsigned char *GTA_RESTRICT src, size_t size, size_t width)
+{
+    size_t k = (width < size ? width : size);
+    memcpy(dst, src, k);
+#if defined __SSE2__
+    for (; size - k >= 16; k += 16)
+    {
+        __m128i a = _mm_loadu_si128((const __m128i *)(src + k));
+        __m128i b = _mm_loadu_si128((const __m128i *)(src + k - width));
+        _mm_storeu_si128((__m128i *)(dst + k), _mm_sub_epi8(a, b));
+    }
+#endif
+    for (; k < size; k++)
+    {
+        dst[k] = src[k] - src[k - width];
+    }
+}
+
+#if defined __SSE2__
+/**
+ * \brief               Compute 16 bytes of the running sums that revert gta_delta().
+ * \param v             The 16 delta-encoded bytes.
+ * \param prev          The 16 decoded bytes that precede them.
+ * \param width         The element size: 1, 2, 4, or 8 bytes.
+ * \return              The 16 decoded bytes.
+ */
+static inline GTA_ATTR_CONST GTA_ATTR_NOTHROW
+__m128i
+gta_undelta_vector(__m128i v, __m128i prev, size_t width)
+{
+    // Sum the bytes of equal position within the vector, and add the last decoded element.
+    switch (width)
+    {
+    case 1:
+        v = _mm_add_epi8(v, _mm_slli_si128(v, 1));
+        v = _mm_add_epi8(v, _mm_slli_si128(v, 2));
+        v = _mm_add_epi8(v, _mm_slli_si128(v, 4));
+        v = _mm_add_epi8(v, _mm_slli_si128(v, 8));
+        prev = _mm_unpackhi_epi8(prev, prev);
+        prev = _mm_shufflehi_epi16(prev, _MM_SHUFFLE(3, 3, 3, 3));
+        prev = _mm_shuffle_epi32(prev, _MM_SHUFFLE(3, 3, 3, 3));
+        break;
+    case 2:
+        v = _mm_add_epi8(v, _mm_slli_si128(v, 2));
+        v = _mm_add_epi8(v, _mm_slli_si128(v, 4));
+        v = _mm_add_epi8(v, _mm_slli_si128(v, 8));
+        prev = _mm_shufflehi_epi16(prev, _MM_SHUFFLE(3, 3, 3, 3));
+        prev = _mm_shuffle_epi32(prev, _MM_SHUFFLE(3, 3, 3, 3));
+        break;
+    case 4:
+        v = _mm_add_epi8(v, _mm_slli_si128(v, 4));
+        v = _mm_add_epi8(v, _mm_slli_si128(v, 8));
+        prev = _mm_shuffle_epi32(prev, _MM_SHUFFLE(3, 3, 3, 3));
+        break;
+    default:
+        v = _mm_add_epi8(v, _mm_slli_si128(v, 8));
+        prev = _mm_unpackhi_epi64(prev, prev);
+        break;
+    }
+    return _mm_add_epi8(v, prev);
+}
+#endif
+
+/* Revert gta_delta(). Where SSE2 is available, 16 bytes are decoded at once. */
+static GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW
+void
+gta_undelta(unsigned char *GTA_RESTRICT dst, const unsigned char *GTA_RESTRICT src, size_t size, size_t width)
+{
+    size_t k = (width < size ? width : size);
+    memcpy(dst, src, k);
+#if defined __SSE2__
+    if (width >= 16)
+    {
+        for (; size - k >= 16; k += 16)
+        {
+            __m128i a = _mm_loadu_si128((const __m128i *)(src + k));
+            __m128i b = _mm_loadu_si128((const __m128i *)(dst + k - width));
+            _mm_storeu_si128((__m128i *)(dst + k), _mm_add_epi8(a, b));
+        }
+    }
+    else if (width == 1 || width == 2 || width == 4 || width == 8)
+    {
+        for (; k < 16 && k < size; k++)
+        {
+            dst[k] = src[k] + dst[k - width];
+        }
+        for (; size - k >= 16; k += 16)
+        {
+            __m128i a = _mm_loadu_si128((const __m128i *)(src + k));
+            __m128i prev = _mm_loadu_si128((const __m128i *)(dst + k - 16));
+            _mm_storeu_si128((__m128i *)(dst + k), gta_undelta_vector(a, prev, width));
+        }
+    }
+#endif
+    for (; k < size; k++)
+    {
+        dst[k] = src[k] + dst[k - width];
+    }
+}
+
+/**
+ * \brief               Apply a pre-filter to chunk data.
+ * \param filter        The pre-filter; must not be \a GTA_FILTER_NONE.
+ * \param dst           The buffer for the filtered data.
+ * \param src           The chunk data.
+ * \param size          The size of the chunk data.
+ * \param width         The element size.
+ */
+static GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW
+void
+gta_filter(gta_filter_t filter, void *GTA_RESTRICT dst, const void *GTA_RESTRICT src, size_t size, size_t width)
+{
+    switch (filter)
+    {
+    case GTA_FILTER_SHUFFLE:
+        gta_shuffle(dst, src, size, width);
+        break;
+    case GTA_FILTER_BITSHUFFLE:
+        gta_bitshuffle(dst, src, size, width);
+        break;
+    default:
+        gta_delta(dst, src, size, width);
+        break;
+    }
+}
+
+/* Revert gta_filter(). */
+static GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW
+void
+gta_unfilter(gta_filter_t filter, void *GTA_RESTRICT dst, const void *GTA_RESTRICT src, size_t size, size_t width)
+{
+    switch (filter)
+    {
+    case GTA_FILTER_SHUFFLE:
+        gta_unshuffle(dst, src, size, width);
+        break;
+    case GTA_FILTER_BITSHUFFLE:
+        gta_unbitshuffle(dst, src, size, width);
+        break;
+    default:
+        gta_undelta(dst, src, size, width);
+        break;
+    }
+}
+
+/* Return a buffer of at least the given size for filtered chunk data. It is kept in
+ * the codec for the following chunks. */
+static GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW
+void *
+gta_get_filter_buffer(gta_codec_t *GTA_RESTRICT codec, size_t size)
+{
+    if (codec->filter_buffer_size < size)
+    {
+        gta_free_chunk(codec->filter_buffer);
+        codec->filter_buffer = gta_alloc_chunk(size);
+        codec->filter_buffer_size = (codec->filter_buffer ? size : 0);
+    }
+    return codec->filter_buffer;
+}
+
+
+/*
+ *
+ * Endianness Functions
+ *
+ */
+
+
+/**
+ * \brief               Find out if the data needs endianness swapping.
+ * \param header        The header.
+ * \return              Whether the data needs endianness swapping.
+ */
+static inline GTA_ATTR_NONNULL_ALL GTA_ATTR_PURE GTA_ATTR_NOTHROW
+bool
 gta_data_needs_endianness_swapping(const gta_header_t *header)
 {
     return !(header->host_endianness);
@@ -815,20 +2202,18 @@ gta_swap_endianness_128(void *GTA_RESTRICT ptr)
 }
 
 /**
- * \brief               Swap the endianness of a component.
- * \param header        The header.
- * \param i             The component index.
- * \param component     The component.
- *
- * Swaps the endianness of a the given component.\n
- * Components of type \a GTA_BLOB are assumed to be independent of endianness,
- * and are therefore not altered.
+ * \brief               Get the layout of the values in a component that need endianness swapping.
+ * \param type          The component type.
+ * \param width         The width of each value, or 0 if the type does not depend on endianness.
+ * \param count         The number of values.
  */
-static inline GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW
+static GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW
 void
-gta_swap_component_endianness(const gta_header_t *header, uintmax_t i, void *GTA_RESTRICT component)
+gta_get_component_swap_layout(gta_type_t type, size_t *GTA_RESTRICT width, uintmax_t *GTA_RESTRICT count)
 {
-    switch (header->component_types[i])
+    *width = 0;
+    *count = 1;
+    switch (type)
     {
     case GTA_BLOB:
     case GTA_INT8:
@@ -836,136 +2221,462 @@ gta_swap_component_endianness(const gta_header_t *header, uintmax_t i, void *GTA
         break;
     case GTA_INT16:
     case GTA_UINT16:
-        gta_swap_endianness_16(component);
+        *width = 2;
         break;
     case GTA_INT32:
     case GTA_UINT32:
     case GTA_FLOAT32:
-        gta_swap_endianness_32(component);
+        *width = 4;
         break;
     case GTA_INT64:
     case GTA_UINT64:
     case GTA_FLOAT64:
-        gta_swap_endianness_64(component);
+        *width = 8;
         break;
     case GTA_INT128:
     case GTA_UINT128:
     case GTA_FLOAT128:
-        gta_swap_endianness_128(component);
+        *width = 16;
         break;
     case GTA_CFLOAT32:
-        gta_swap_endianness_32(component);
-        gta_swap_endianness_32((char *)component + 4);
+        *width = 4;
+        *count = 2;
         break;
     case GTA_CFLOAT64:
-        gta_swap_endianness_64(component);
-        gta_swap_endianness_64((char *)component + 8);
+        *width = 8;
+        *count = 2;
         break;
     case GTA_CFLOAT128:
-        gta_swap_endianness_128(component);
-        gta_swap_endianness_128((char *)component + 16);
+        *width = 16;
+        *count = 2;
         break;
     }
 }
 
 /**
- * \brief               Swap the endianness of an array element.
- * \param header        The header.
- * \param element       The array element.
+ * \brief               Compute the component offsets and the swap plan for an element layout.
+ * \param components    The number of components.
+ * \param types         The component types.
+ * \param blob_sizes    The sizes of the blob components.
+ * \param offsets       The component offsets.
+ * \param runs          The swap runs.
+ * \param runs_count    The number of swap runs.
+ * \return              \a GTA_OK or \a GTA_SYSTEM_ERROR.
  *
- * This function corrects the endianness for all components of the given array element.\n
- * Components of type \a GTA_BLOB are assumed to be independent of endianness,
- * and are therefore not altered.
+ * The offset table has \a components + 1 entries, so that the size of component i
+ * is offsets[i + 1] - offsets[i]. It is NULL if there are no components.
+ * Adjacent components whose values have the same width are fused into a single run,
+ * so that for example an element of three float32 components becomes one run of three
+ * 32 bit values. Components of type \a GTA_BLOB are assumed to be independent of endianness.
  */
-static inline GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW
-void
-gta_swap_element_endianness(const gta_header_t *header, void *GTA_RESTRICT element)
+static GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL2(4, 5) GTA_ATTR_NONNULL1(6) GTA_ATTR_NOTHROW
+gta_result_t
+gta_create_element_layout(size_t components, const uint8_t *GTA_RESTRICT types, const uintmax_t *GTA_RESTRICT blob_sizes,
+        uintmax_t *GTA_RESTRICT *GTA_RESTRICT offsets,
+        gta_swap_run_t *GTA_RESTRICT *GTA_RESTRICT runs, size_t *GTA_RESTRICT runs_count)
 {
-    char *ptr = element;
+    uintmax_t *o = NULL;
+    gta_swap_run_t *r = NULL;
+    size_t n = 0;
+    uintmax_t offset = 0;
     size_t blob_size_index = 0;
-    for (uintmax_t i = 0; i < header->components; i++)
+
+    if (components > 0)
     {
-        gta_swap_component_endianness(header, i, ptr);
-        switch (header->component_types[i])
+        if (components > SIZE_MAX - 1 || gta_size_overflow(components + 1, sizeof(uintmax_t)))
         {
-        case GTA_BLOB:
-            ptr += header->component_blob_sizes[blob_size_index++];
-            break;
-        case GTA_INT8:
-        case GTA_UINT8:
-            ptr += 1;
-            break;
-        case GTA_INT16:
-        case GTA_UINT16:
-            ptr += 2;
-            break;
-        case GTA_INT32:
-        case GTA_UINT32:
-        case GTA_FLOAT32:
-            ptr += 4;
-            break;
-        case GTA_INT64:
-        case GTA_UINT64:
-        case GTA_FLOAT64:
-        case GTA_CFLOAT32:
-            ptr += 8;
-            break;
-        case GTA_INT128:
-        case GTA_UINT128:
-        case GTA_FLOAT128:
-        case GTA_CFLOAT64:
-            ptr += 16;
-            break;
-        case GTA_CFLOAT128:
-            ptr += 32;
-            break;
+            return GTA_SYSTEM_ERROR;
+        }
+        o = gta_malloc((components + 1) * sizeof(uintmax_t));
+        r = gta_malloc(components * sizeof(gta_swap_run_t));
+        if (!o || !r)
+        {
+            gta_free(o);
+            gta_free(r);
+            return GTA_SYSTEM_ERROR;
+        }
+    }
+    for (size_t i = 0; i < components; i++)
+    {
+        size_t width;
+        uintmax_t count;
+        o[i] = offset;
+        gta_get_component_swap_layout(types[i], &width, &count);
+        if (width > 0)
+        {
+            if (n > 0 && r[n - 1].width == width && r[n - 1].offset + r[n - 1].count * width == offset)
+            {
+                r[n - 1].count += count;
+            }
+            else
+            {
+                r[n].offset = offset;
+                r[n].width = width;
+                r[n].count = count;
+                n++;
+            }
+            offset += count * width;
         }
+        else if (types[i] == GTA_BLOB)
+        {
+            offset += blob_sizes[blob_size_index++];
+        }
+        else
+        {
+            offset += 1;
+        }
+    }
+    if (components > 0)
+    {
+        o[components] = offset;
+    }
+    if (n == 0)
+    {
+        gta_free(r);
+        r = NULL;
     }
+    *offsets = o;
+    *runs = r;
+    *runs_count = n;
+    return GTA_OK;
 }
 
+#if defined __SSE2__
+/**
+ * \brief               Swap the endianness of all values in a vector.
+ * \param v             The vector.
+ * \param width         The width of each value: 2, 4, 8, or 16 bytes.
+ * \return              The vector with swapped values.
+ */
+static inline GTA_ATTR_CONST GTA_ATTR_NOTHROW
+__m128i
+gta_swap_endianness_vector(__m128i v, size_t width)
+{
+#if defined __SSSE3__
+    const __m128i mask =
+          width == 2 ? _mm_set_epi8(14, 15, 12, 13, 10, 11, 8, 9, 6, 7, 4, 5, 2, 3, 0, 1)
+        : width == 4 ? _mm_set_epi8(12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3)
+        : width == 8 ? _mm_set_epi8(8, 9, 10, 11, 12, 13, 14, 15, 0, 1, 2, 3, 4, 5, 6, 7)
+        : _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    return _mm_shuffle_epi8(v, mask);
+#else
+    v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+    if (width == 4)
+    {
+        v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+        v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+    }
+    else if (width >= 8)
+    {
+        v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(0, 1, 2, 3));
+        v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(0, 1, 2, 3));
+        if (width == 16)
+        {
+            v = _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2));
+        }
+    }
+    return v;
+#endif
+}
+#endif
 
-/*
+/**
+ * \brief               Swap the endianness of consecutive values of the same width.
+ * \param ptr           The first value.
+ * \param width         The width of each value: 2, 4, 8, or 16 bytes.
+ * \param n             The number of values.
  *
- * Read and Write Chunks
+ * Where SSE2 is available, 16 bytes are swapped at once with vector byte shuffles.
+ */
+static GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW
+void
+gta_swap_endianness_n(void *GTA_RESTRICT ptr, size_t width, uintmax_t n)
+{
+    unsigned char *p = ptr;
+    uintmax_t i = 0;
+    switch (width)
+    {
+    case 2:
+#if defined __SSE2__
+        for (; n - i >= 8; i += 8)
+        {
+            __m128i v = _mm_loadu_si128((const __m128i *)(p + 2 * i));
+            _mm_storeu_si128((__m128i *)(p + 2 * i), gta_swap_endianness_vector(v, 2));
+        }
+#endif
+        for (; i < n; i++)
+        {
+            gta_swap_endianness_16(p + 2 * i);
+        }
+        break;
+    case 4:
+#if defined __SSE2__
+        for (; n - i >= 4; i += 4)
+        {
+            __m128i v = _mm_loadu_si128((const __m128i *)(p + 4 * i));
+            _mm_storeu_si128((__m128i *)(p + 4 * i), gta_swap_endianness_vector(v, 4));
+        }
+#endif
+        for (; i < n; i++)
+        {
+            gta_swap_endianness_32(p + 4 * i);
+        }
+        break;
+    case 8:
+#if defined __SSE2__
+        for (; n - i >= 2; i += 2)
+        {
+            __m128i v = _mm_loadu_si128((const __m128i *)(p + 8 * i));
+            _mm_storeu_si128((__m128i *)(p + 8 * i), gta_swap_endianness_vector(v, 8));
+        }
+#endif
+        for (; i < n; i++)
+        {
+            gta_swap_endianness_64(p + 8 * i);
+        }
+        break;
+    case 16:
+#if defined __SSE2__
+        for (; i < n; i++)
+        {
+            __m128i v = _mm_loadu_si128((const __m128i *)(p + 16 * i));
+            _mm_storeu_si128((__m128i *)(p + 16 * i), gta_swap_endianness_vector(v, 16));
+        }
+#endif
+        for (; i < n; i++)
+        {
+            gta_swap_endianness_128(p + 16 * i);
+        }
+        break;
+    }
+}
+
+/**
+ * \brief               Swap the endianness of array elements.
+ * \param header        The header.
+ * \param elements      The array elements.
+ * \param n             The number of elements.
  *
+ * This function corrects the endianness for all components of the given array elements,
+ * using the swap plan of the header.\n
+ * Components of type \a GTA_BLOB are assumed to be independent of endianness,
+ * and are therefore not altered.
  */
+static GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW
+void
+gta_swap_elements_endianness(const gta_header_t *header, void *GTA_RESTRICT elements, uintmax_t n)
+{
+    const gta_swap_run_t *runs = header->swap_runs;
+    char *ptr = elements;
+    if (header->swap_runs_count == 0)
+    {
+        return;
+    }
+    if (header->swap_runs_count == 1 && runs[0].offset == 0
+            && runs[0].count * runs[0].width == header->element_size)
+    {
+        // The elements consist of values of equal width only: swap the whole buffer at once
+        gta_swap_endianness_n(ptr, runs[0].width, n * runs[0].count);
+        return;
+    }
+    for (uintmax_t i = 0; i < n; i++)
+    {
+        for (size_t j = 0; j < header->swap_runs_count; j++)
+        {
+            gta_swap_endianness_n(ptr + runs[j].offset, runs[j].width, runs[j].count);
+        }
+        ptr += header->element_size;
+    }
+}
 
+/* A selected component for column projection: where its values are in an element,
+ * and where they go in the output. */
+typedef struct
+{
+    uintmax_t offset;           // Offset of the component in the element
+    size_t size;                // Size of the component
+    char *dst;                  // Destination of the component of the first element
+    size_t stride;              // Distance between the destinations of consecutive elements
+    size_t swap_width;          // Width of each value for endianness swapping, or 0
+    uintmax_t swap_count;       // Number of values in the component
+} gta_gather_t;
 
 /**
- * \brief               Read a data chunk.
+ * \brief               Create the gather plan for a component selection.
  * \param header        The header.
- * \param chunk         The buffer for the chunk (will be allocated).
- * \param chunk_size    The size of the chunk.
+ * \param count         The number of selected components.
+ * \param components    The indices of the selected components, or NULL if \a count is 0.
+ * \param buffers       The output buffers of the selected components, or NULL if \a count is 0.
+ * \param strides       The distances between consecutive elements in the output buffers, or NULL.
+ * \param gathers       The gather plan.
+ * \return              \a GTA_OK, \a GTA_INVALID_DATA, or \a GTA_SYSTEM_ERROR.
+ *
+ * If \a strides is NULL, the values of each component are tightly packed.
+ */
+static GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL2(1, 6) GTA_ATTR_NOTHROW
+gta_result_t
+gta_create_gather(const gta_header_t *GTA_RESTRICT header, size_t count, const uintmax_t *GTA_RESTRICT components,
+        void *const *GTA_RESTRICT buffers, const size_t *GTA_RESTRICT strides,
+        gta_gather_t *GTA_RESTRICT *GTA_RESTRICT gathers)
+{
+    // The plan is never NULL, even if no components are selected
+    if (gta_size_overflow(count > 0 ? count : 1, sizeof(gta_gather_t)))
+    {
+        return GTA_SYSTEM_ERROR;
+    }
+    gta_gather_t *g = gta_malloc((count > 0 ? count : 1) * sizeof(gta_gather_t));
+    if (!g)
+    {
+        return GTA_SYSTEM_ERROR;
+    }
+    for (size_t k = 0; k < count; k++)
+    {
+        uintmax_t i = components[k];
+        if (i >= header->components || !buffers[k])
+        {
+            gta_free(g);
+            return GTA_INVALID_DATA;
+        }
+        g[k].offset = header->component_offsets[i];
+        g[k].size = header->component_offsets[i + 1] - header->component_offsets[i];
+        g[k].dst = buffers[k];
+        g[k].stride = (strides ? strides[k] : g[k].size);
+        gta_get_component_swap_layout(header->component_types[i], &(g[k].swap_width), &(g[k].swap_count));
+    }
+    *gathers = g;
+    return GTA_OK;
+}
+
+/**
+ * \brief               Copy selected components out of element data.
+ * \param header        The header.
+ * \param gathers       The gather plan.
+ * \param count         The number of entries in the gather plan.
+ * \param src           The element data.
+ * \param pos           The position of \a src in the data of all elements of the request.
+ * \param len           The size of \a src.
+ *
+ * The element data does not need to start or end at an element boundary; each selected
+ * component receives the part of its values that is contained in \a src.
+ */
+static GTA_ATTR_NONNULL3(1, 2, 4) GTA_ATTR_NOTHROW
+void
+gta_gather_bytes(const gta_header_t *GTA_RESTRICT header, const gta_gather_t *GTA_RESTRICT gathers, size_t count,
+        const void *GTA_RESTRICT src, uintmax_t pos, size_t len)
+{
+    const char *s = src;
+    uintmax_t element_size = header->element_size;
+    uintmax_t end = pos + len;
+    uintmax_t e = pos / element_size;
+
+    for (uintmax_t element_start = e * element_size; element_start < end; element_start += element_size, e++)
+    {
+        for (size_t k = 0; k < count; k++)
+        {
+            const gta_gather_t *g = gathers + k;
+            uintmax_t lo = element_start + g->offset;
+            uintmax_t hi = lo + g->size;
+            char *dst = g->dst + e * g->stride;
+            if (lo >= pos && hi <= end)
+            {
+                // The usual case: the complete component is available
+                const char *p = s + (lo - pos);
+                switch (g->size)
+                {
+                case 1:
+                    *dst = *p;
+                    break;
+                case 2:
+                    memcpy(dst, p, 2);
+                    break;
+                case 4:
+                    memcpy(dst, p, 4);
+                    break;
+                case 8:
+                    memcpy(dst, p, 8);
+                    break;
+                default:
+                    memcpy(dst, p, g->size);
+                    break;
+                }
+            }
+            else
+            {
+                uintmax_t l = (lo > pos ? lo : pos);
+                uintmax_t h = (hi < end ? hi : end);
+                if (l < h)
+                {
+                    memcpy(dst + (l - lo), s + (l - pos), h - l);
+                }
+            }
+        }
+    }
+}
+
+/**
+ * \brief               Swap the endianness of gathered components.
+ * \param gathers       The gather plan.
+ * \param count         The number of entries in the gather plan.
+ * \param n             The number of elements.
+ */
+static GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW
+void
+gta_swap_gathered_endianness(const gta_gather_t *GTA_RESTRICT gathers, size_t count, uintmax_t n)
+{
+    for (size_t k = 0; k < count; k++)
+    {
+        const gta_gather_t *g = gathers + k;
+        if (g->swap_width == 0)
+        {
+            continue;
+        }
+        if (g->stride == g->size)
+        {
+            // Tightly packed: swap all values at once
+            gta_swap_endianness_n(g->dst, g->swap_width, n * g->swap_count);
+        }
+        else
+        {
+            for (uintmax_t e = 0; e < n; e++)
+            {
+                gta_swap_endianness_n(g->dst + e * g->stride, g->swap_width, g->swap_count);
+            }
+        }
+    }
+}
+
+/**
+ * \brief               Read the head of a data chunk.
+ * \param header        The header.
+ * \param chunk_size    The uncompressed size of the chunk (0 for the last, empty chunk).
+ * \param compression   The compression type of the chunk.
+ * \param raw_size      The size of the raw chunk data that follows the head.
  * \param read_fn       The custom input function.
  * \param userdata      A parameter to the custom input function.
- * \return              \a GTA_OK, \a GTA_UNSUPPORTED_DATA, \a GTA_UNEXPECTED_EOF, or \a GTA_SYSTEM_ERROR.
+ * \return              \a GTA_OK, \a GTA_INVALID_DATA, \a GTA_UNSUPPORTED_DATA, \a GTA_UNEXPECTED_EOF, or \a GTA_SYSTEM_ERROR.
  */
 static GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL
 gta_result_t
-gta_read_chunk(const gta_header_t *GTA_RESTRICT header,
-        void *GTA_RESTRICT *chunk, size_t *chunk_size,
+gta_read_chunk_head(const gta_header_t *GTA_RESTRICT header,
+        size_t *GTA_RESTRICT chunk_size, uint8_t *GTA_RESTRICT compression, size_t *GTA_RESTRICT raw_size,
         gta_read_t read_fn, intptr_t userdata)
 {
     int error = false;
     uint64_t size_uncompressed;
-    uint8_t compression;
     uint64_t size_compressed;
-    void *chunk_compressed = NULL;
-    gta_result_t retval = GTA_OK;
     size_t r;
 
-    *chunk = NULL;
     *chunk_size = 0;
+    *compression = GTA_NONE;
+    *raw_size = 0;
     r = read_fn(userdata, &size_uncompressed, sizeof(uint64_t), &error);
     if (error)
     {
-        retval = GTA_SYSTEM_ERROR;
-        goto exit;
+        return GTA_SYSTEM_ERROR;
     }
     if (r < sizeof(uint64_t))
     {
-        retval = GTA_UNEXPECTED_EOF;
-        goto exit;
+        return GTA_UNEXPECTED_EOF;
     }
     if (gta_data_needs_endianness_swapping(header))
     {
@@ -973,76 +2684,45 @@ gta_read_chunk(const gta_header_t *GTA_RESTRICT header,
     }
     if (size_uncompressed > gta_max_chunk_size)
     {
-        retval = GTA_UNSUPPORTED_DATA;
-        goto exit;
+        return GTA_UNSUPPORTED_DATA;
     }
     if (size_uncompressed == 0)
     {
         // the last, empty chunk
-        retval = GTA_OK;
-        goto exit;
-    }
-    *chunk_size = size_uncompressed;
-    *chunk = malloc(*chunk_size);
-    if (!*chunk)
-    {
-        retval = GTA_SYSTEM_ERROR;
-        goto exit;
+        return GTA_OK;
     }
-    r = read_fn(userdata, &compression, sizeof(uint8_t), &error);
+    r = read_fn(userdata, compression, sizeof(uint8_t), &error);
     if (error)
     {
-        retval = GTA_SYSTEM_ERROR;
-        goto exit;
+        return GTA_SYSTEM_ERROR;
     }
     if (r < sizeof(uint8_t))
     {
-        retval = GTA_UNEXPECTED_EOF;
-        goto exit;
+        return GTA_UNEXPECTED_EOF;
     }
-    if (compression != GTA_NONE
-            && compression != GTA_ZLIB
-            && compression != GTA_ZLIB1
-            && compression != GTA_ZLIB2
-            && compression != GTA_ZLIB3
-            && compression != GTA_ZLIB4
-            && compression != GTA_ZLIB5
-            && compression != GTA_ZLIB6
-            && compression != GTA_ZLIB7
-            && compression != GTA_ZLIB8
-            && compression != GTA_ZLIB9
-            && compression != GTA_BZIP2
-            && compression != GTA_XZ)
+    if (!gta_compression_is_supported(gta_chunk_method(*compression)))
     {
-        retval = GTA_UNSUPPORTED_DATA;
-        goto exit;
+        return GTA_UNSUPPORTED_DATA;
     }
-    if (compression == GTA_NONE)
+    if (gta_chunk_method(*compression) == GTA_NONE && gta_chunk_filter(*compression) != GTA_FILTER_NONE)
     {
-        r = read_fn(userdata, *chunk, *chunk_size, &error);
-        if (error)
-        {
-            retval = GTA_SYSTEM_ERROR;
-            goto exit;
-        }
-        if (r < *chunk_size)
-        {
-            retval = GTA_UNEXPECTED_EOF;
-            goto exit;
-        }
+        // Uncompressed chunks are never filtered
+        return GTA_INVALID_DATA;
+    }
+    if (*compression == GTA_NONE)
+    {
+        size_compressed = size_uncompressed;
     }
     else
     {
         r = read_fn(userdata, &size_compressed, sizeof(uint64_t), &error);
         if (error)
         {
-            retval = GTA_SYSTEM_ERROR;
-            goto exit;
+            return GTA_SYSTEM_ERROR;
         }
         if (r < sizeof(uint64_t))
         {
-            retval = GTA_UNEXPECTED_EOF;
-            goto exit;
+            return GTA_UNEXPECTED_EOF;
         }
         if (gta_data_needs_endianness_swapping(header))
         {
@@ -1052,3307 +2732,6638 @@ gta_read_chunk(const gta_header_t *GTA_RESTRICT header,
         {
             // A compressed chunk is always smaller than an uncompressed chunk,
             // or else it would not have been compressed! See specification.
-            retval = GTA_INVALID_DATA;
-            goto exit;
+            return GTA_INVALID_DATA;
         }
         if (size_compressed == 0)
         {
-            retval = GTA_INVALID_DATA;
-            goto exit;
-        }
-        chunk_compressed = malloc(size_compressed);
-        if (!chunk_compressed)
-        {
-            retval = GTA_SYSTEM_ERROR;
-            goto exit;
-        }
-        r = read_fn(userdata, chunk_compressed, size_compressed, &error);
-        if (error)
-        {
-            retval = GTA_SYSTEM_ERROR;
-            goto exit;
-        }
-        if (r < size_compressed)
-        {
-            retval = GTA_UNEXPECTED_EOF;
-            goto exit;
-        }
-        retval = gta_uncompress(*chunk, *chunk_size,
-                chunk_compressed, size_compressed, compression);
-        if (retval != GTA_OK)
-        {
-            goto exit;
+            return GTA_INVALID_DATA;
         }
-        free(chunk_compressed);
-        chunk_compressed = NULL;
-    }
-
-exit:
-    free(chunk_compressed);
-    if (retval != GTA_OK)
-    {
-        free(*chunk);
-        *chunk = NULL;
-        *chunk_size = 0;
     }
-    return retval;
+    *chunk_size = size_uncompressed;
+    *raw_size = size_compressed;
+    return GTA_OK;
 }
 
 /**
- * \brief               Skip a data chunk.
+ * \brief               Read the raw data of a data chunk, without decompressing it.
  * \param header        The header.
- * \param chunk_size    The size of the skipped chunk.
+ * \param chunk_size    The uncompressed size of the chunk (0 for the last, empty chunk).
+ * \param compression   The compression type of the chunk.
+ * \param raw           The buffer for the raw chunk data (will be allocated).
+ * \param raw_size      The size of the raw chunk data.
  * \param read_fn       The custom input function.
- * \param seek_fn       The custom seek function, or NULL for non-seekable input.
- * \param userdata      A parameter to the custom input/seek functions.
+ * \param userdata      A parameter to the custom input function.
  * \return              \a GTA_OK, \a GTA_UNSUPPORTED_DATA, \a GTA_UNEXPECTED_EOF, or \a GTA_SYSTEM_ERROR.
+ *
+ * If \a compression is \a GTA_NONE, the raw data is the chunk itself.
  */
-static GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL3(1, 2, 3)
+static GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL
 gta_result_t
-gta_skip_chunk(const gta_header_t *GTA_RESTRICT header, size_t *chunk_size,
-        gta_read_t read_fn, gta_seek_t seek_fn, intptr_t userdata)
+gta_read_raw_chunk(const gta_header_t *GTA_RESTRICT header,
+        size_t *GTA_RESTRICT chunk_size, uint8_t *GTA_RESTRICT compression,
+        void **raw, size_t *GTA_RESTRICT raw_size,
+        gta_read_t read_fn, intptr_t userdata)
 {
     int error = false;
-    uint64_t size_uncompressed;
-    uint8_t compression;
-    uint64_t size_compressed;
-    void *trash = NULL;
-    gta_result_t retval = GTA_OK;
+    gta_result_t retval;
     size_t r;
 
-    r = read_fn(userdata, &size_uncompressed, sizeof(uint64_t), &error);
-    if (error)
+    *raw = NULL;
+    retval = gta_read_chunk_head(header, chunk_size, compression, raw_size, read_fn, userdata);
+    if (retval != GTA_OK || *chunk_size == 0)
     {
-        retval = GTA_SYSTEM_ERROR;
         goto exit;
     }
-    if (r < sizeof(uint64_t))
+    *raw = gta_alloc_chunk(*raw_size);
+    if (!*raw)
     {
-        retval = GTA_UNEXPECTED_EOF;
+        retval = GTA_SYSTEM_ERROR;
         goto exit;
     }
-    if (gta_data_needs_endianness_swapping(header))
+    r = read_fn(userdata, *raw, *raw_size, &error);
+    if (error)
     {
-        gta_swap_endianness_64(&size_uncompressed);
+        retval = GTA_SYSTEM_ERROR;
+        goto exit;
     }
-    if (size_uncompressed > gta_max_chunk_size)
+    if (r < *raw_size)
     {
-        retval = GTA_UNSUPPORTED_DATA;
+        retval = GTA_UNEXPECTED_EOF;
         goto exit;
     }
-    if (size_uncompressed == 0)
+
+exit:
+    if (retval != GTA_OK)
     {
-        // the last, empty chunk
+        gta_free_chunk(*raw);
+        *raw = NULL;
+        *raw_size = 0;
         *chunk_size = 0;
-        retval = GTA_OK;
-        goto exit;
     }
-    *chunk_size = size_uncompressed;
-    r = read_fn(userdata, &compression, sizeof(uint8_t), &error);
-    if (error)
+    return retval;
+}
+
+/**
+ * \brief               Uncompress the raw data of a data chunk and revert its pre-filter.
+ * \param codec         The codec to decompress with, or NULL.
+ * \param chunk         The buffer for the chunk.
+ * \param chunk_size    The uncompressed size of the chunk.
+ * \param raw           The raw chunk data.
+ * \param raw_size      The size of the raw chunk data.
+ * \param compression   The compression type of the chunk; must not be \a GTA_NONE.
+ * \param stride        The element size for array data, or 0 for header data, which is never filtered.
+ * \return              \a GTA_OK, \a GTA_OVERFLOW, \a GTA_INVALID_DATA, \a GTA_UNSUPPORTED_DATA, or \a GTA_SYSTEM_ERROR.
+ */
+static GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL2(2, 4)
+gta_result_t
+gta_uncompress_chunk(gta_codec_t *codec, void *GTA_RESTRICT chunk, size_t chunk_size,
+        const void *GTA_RESTRICT raw, size_t raw_size, uint8_t compression, size_t stride)
+{
+    gta_filter_t filter = gta_chunk_filter(compression);
+    gta_codec_t tmp_codec;
+    gta_result_t retval;
+
+    if (filter == GTA_FILTER_NONE)
     {
-        retval = GTA_SYSTEM_ERROR;
-        goto exit;
+        return gta_uncompress(codec, chunk, chunk_size, raw, raw_size, compression);
     }
-    if (r < sizeof(uint8_t))
+    if (stride == 0)
     {
-        retval = GTA_UNEXPECTED_EOF;
-        goto exit;
+        return GTA_INVALID_DATA;
     }
-    if (compression != GTA_NONE
-            && compression != GTA_ZLIB
-            && compression != GTA_ZLIB1
-            && compression != GTA_ZLIB2
-            && compression != GTA_ZLIB3
-            && compression != GTA_ZLIB4
-            && compression != GTA_ZLIB5
-            && compression != GTA_ZLIB6
-            && compression != GTA_ZLIB7
-            && compression != GTA_ZLIB8
-            && compression != GTA_ZLIB9
-            && compression != GTA_BZIP2
-            && compression != GTA_XZ)
+    if (!codec)
     {
-        retval = GTA_UNSUPPORTED_DATA;
-        goto exit;
+        gta_init_codec(&tmp_codec);
+        codec = &tmp_codec;
     }
-    if (compression == GTA_NONE)
+    void *filtered = gta_get_filter_buffer(codec, chunk_size);
+    if (!filtered)
     {
-        if (seek_fn)
-        {
-            seek_fn(userdata, *chunk_size, SEEK_CUR, &error);
-            if (error)
-            {
-                retval = GTA_SYSTEM_ERROR;
-                goto exit;
-            }
-        }
-        else
-        {
-            retval = gta_readskip(read_fn, userdata, *chunk_size);
-            if (retval != GTA_OK)
-            {
-                goto exit;
-            }
-        }
+        retval = GTA_SYSTEM_ERROR;
     }
     else
     {
-        r = read_fn(userdata, &size_compressed, sizeof(uint64_t), &error);
-        if (error)
-        {
-            retval = GTA_SYSTEM_ERROR;
-            goto exit;
-        }
-        if (r < sizeof(uint64_t))
-        {
-            retval = GTA_UNEXPECTED_EOF;
-            goto exit;
-        }
-        if (gta_data_needs_endianness_swapping(header))
-        {
-            gta_swap_endianness_64(&size_compressed);
-        }
-        if (size_compressed > size_uncompressed)
-        {
-            // A compressed chunk is always smaller than an uncompressed chunk,
-            // or else it would not have been compressed! See specification.
-            retval = GTA_INVALID_DATA;
-            goto exit;
-        }
-        if (size_compressed == 0)
-        {
-            retval = GTA_INVALID_DATA;
-            goto exit;
-        }
-        if (seek_fn)
-        {
-            seek_fn(userdata, size_compressed, SEEK_CUR, &error);
-            if (error)
-            {
-                retval = GTA_SYSTEM_ERROR;
-                goto exit;
-            }
-        }
-        else
+        retval = gta_uncompress(codec, filtered, chunk_size, raw, raw_size, gta_chunk_method(compression));
+        if (retval == GTA_OK)
         {
-            retval = gta_readskip(read_fn, userdata, size_compressed);
-            if (retval != GTA_OK)
-            {
-                goto exit;
-            }
+            gta_unfilter(filter, chunk, filtered, chunk_size, stride);
         }
     }
-
-exit:
-    free(trash);
-    if (retval != GTA_OK)
+    if (codec == &tmp_codec)
     {
-        *chunk_size = 0;
+        gta_free_codec(&tmp_codec);
     }
     return retval;
 }
 
 /**
- * \brief               Write a data chunk.
- * \param header        The header.
- * \param chunk         The chunk buffer.
- * \param chunk_size    The size of the chunk.
- * \param write_fn      The custom output function.
- * \param userdata      A parameter to the custom output function.
- * \return              \a GTA_OK, \a GTA_UNSUPPORTED_DATA (if the chunk size larger than the limit), or \a GTA_SYSTEM_ERROR.
+ * \brief               Decompress the raw data of a data chunk.
+ * \param codec         The codec to decompress with, or NULL.
+ * \param stride        The element size for array data, or 0 for header data; see gta_uncompress_chunk().
+ * \param chunk         The buffer for the chunk (will be allocated).
+ * \param chunk_size    The uncompressed size of the chunk.
+ * \param compression   The compression type of the chunk.
+ * \param raw           The raw chunk data, as returned by gta_read_raw_chunk(). It is freed or reused for \a chunk.
+ * \param raw_size      The size of the raw chunk data.
+ * \return              \a GTA_OK, \a GTA_INVALID_DATA, or \a GTA_SYSTEM_ERROR.
+ *
+ * This function does not perform any input/output, so it can be called for several chunks at the same time,
+ * as long as each call uses its own codec.
  */
-static GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL1(1)
+static GTA_ATTR_WARN_UNUSED_RESULT
 gta_result_t
-gta_write_chunk(const gta_header_t *GTA_RESTRICT header,
-        const void *GTA_RESTRICT chunk, size_t chunk_size,
-        gta_write_t write_fn, intptr_t userdata)
+gta_decompress_raw_chunk(gta_codec_t *codec, size_t stride, void *GTA_RESTRICT *chunk, size_t chunk_size,
+        uint8_t compression, void *raw, size_t raw_size)
 {
-    int error = false;
-    uint64_t size_uncompressed = chunk_size;
-    uint8_t output_compression;
-    uint64_t size_compressed;
-    void *compressed = NULL;
-    size_t compressed_size = 0;
-    gta_result_t retval = GTA_OK;
-    size_t r;
+    gta_result_t retval;
 
-    if (chunk_size > gta_max_chunk_size)
-    {
-        retval = GTA_UNSUPPORTED_DATA;
-        goto exit;
-    }
-    errno = 0;
-    r = write_fn(userdata, &size_uncompressed, sizeof(uint64_t), &error);
-    if (error || r < sizeof(uint64_t))
+    *chunk = NULL;
+    if (compression == GTA_NONE)
     {
-        if (errno == 0)
-        {
-            errno = EIO;
-        }
-        retval = GTA_SYSTEM_ERROR;
-        goto exit;
+        *chunk = raw;
+        return GTA_OK;
     }
-    if (chunk_size == 0)
+    *chunk = gta_alloc_chunk(chunk_size);
+    if (!*chunk)
     {
-        retval = GTA_OK;
-        goto exit;
+        gta_free_chunk(raw);
+        return GTA_SYSTEM_ERROR;
     }
-    if (header->compression == GTA_NONE)
+    retval = gta_uncompress_chunk(codec, *chunk, chunk_size, raw, raw_size, compression, stride);
+    gta_free_chunk(raw);
+    if (retval != GTA_OK)
     {
-        output_compression = GTA_NONE;
+        gta_free_chunk(*chunk);
+        *chunk = NULL;
     }
-    else
+    return retval;
+}
+
+/**
+ * \brief               Read a data chunk.
+ * \param header        The header.
+ * \param codec         The codec to decompress with, or NULL.
+ * \param stride        The element size for array data, or 0 for header data; see gta_uncompress_chunk().
+ * \param chunk         The buffer for the chunk (will be allocated).
+ * \param chunk_size    The size of the chunk.
+ * \param read_fn       The custom input function.
+ * \param userdata      A parameter to the custom input function.
+ * \return              \a GTA_OK, \a GTA_UNSUPPORTED_DATA, \a GTA_UNEXPECTED_EOF, or \a GTA_SYSTEM_ERROR.
+ */
+static GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL3(1, 4, 5)
+gta_result_t
+gta_read_chunk(const gta_header_t *GTA_RESTRICT header, gta_codec_t *codec, size_t stride,
+        void *GTA_RESTRICT *chunk, size_t *chunk_size,
+        gta_read_t read_fn, intptr_t userdata)
+{
+    uint8_t compression;
+    void *raw;
+    const void *src;
+    size_t raw_size;
+    gta_result_t retval;
+
+    *chunk = NULL;
+    if (read_fn != gta_read_memory)
     {
-        retval = gta_compress(&compressed, &compressed_size,
-                chunk, chunk_size, header->compression);
-        if (retval != GTA_OK)
-        {
-            goto exit;
-        }
-        if (compressed_size + sizeof(uint64_t) >= chunk_size)
-        {
-            free(compressed);
-            compressed = NULL;
-            output_compression = GTA_NONE;
-        }
-        else
+        retval = gta_read_raw_chunk(header, chunk_size, &compression, &raw, &raw_size, read_fn, userdata);
+        if (retval != GTA_OK || *chunk_size == 0)
         {
-            output_compression = header->compression;
+            return retval;
         }
+        retval = gta_decompress_raw_chunk(codec, stride, chunk, *chunk_size, compression, raw, raw_size);
     }
-    errno = 0;
-    r = write_fn(userdata, &output_compression, sizeof(uint8_t), &error);
-    if (error || r < sizeof(uint8_t))
+    else
     {
-        if (errno == 0)
+        // Decompress directly from the input buffer instead of copying the raw data first
+        retval = gta_read_chunk_head(header, chunk_size, &compression, &raw_size, read_fn, userdata);
+        if (retval == GTA_OK && *chunk_size == 0)
         {
-            errno = EIO;
+            return GTA_OK;
         }
-        retval = GTA_SYSTEM_ERROR;
-        goto exit;
-    }
-    if (output_compression == GTA_NONE)
-    {
-        errno = 0;
-        r = write_fn(userdata, chunk, chunk_size, &error);
-        if (error || r < chunk_size)
+        if (retval == GTA_OK)
         {
-            if (errno == 0)
+            src = gta_peek_memory(read_fn, userdata, raw_size);
+            *chunk = (src ? gta_alloc_chunk(*chunk_size) : NULL);
+            if (!src)
             {
-                errno = EIO;
+                retval = GTA_UNEXPECTED_EOF;
             }
-            retval = GTA_SYSTEM_ERROR;
-            goto exit;
-        }
-    }
-    else
-    {
-        size_compressed = compressed_size;
-        errno = 0;
-        r = write_fn(userdata, &size_compressed, sizeof(uint64_t), &error);
-        if (error || r < sizeof(uint64_t))
-        {
-            if (errno == 0)
+            else if (!*chunk)
             {
-                errno = EIO;
+                retval = GTA_SYSTEM_ERROR;
             }
-            retval = GTA_SYSTEM_ERROR;
-            goto exit;
-        }
-        errno = 0;
-        r = write_fn(userdata, compressed, compressed_size, &error);
-        if (error || r < compressed_size)
-        {
-            if (errno == 0)
+            else if (compression == GTA_NONE)
             {
-                errno = EIO;
+                memcpy(*chunk, src, raw_size);
+            }
+            else
+            {
+                retval = gta_uncompress_chunk(codec, *chunk, *chunk_size, src, raw_size, compression, stride);
             }
-            retval = GTA_SYSTEM_ERROR;
-            goto exit;
         }
-        free(compressed);
-        compressed = NULL;
     }
-
-exit:
-    free(compressed);
+    if (retval != GTA_OK)
+    {
+        gta_free_chunk(*chunk);
+        *chunk = NULL;
+        *chunk_size = 0;
+    }
     return retval;
 }
 
+/* A unit of work for the worker threads, such as the compression of one chunk.
+ * It is embedded as the first member of the structure that describes the work. */
+typedef struct gta_internal_task_struct
+{
+    void (*run)(struct gta_internal_task_struct *task, gta_codec_t *codec);
+    struct gta_internal_task_struct *next;      // Next task in the queue
+    bool done;                  // Whether the task is finished
+} gta_task_t;
+
+/* A set of worker threads that run tasks in the order in which they were queued.
+ * Each worker has its own codec, which is kept for all tasks that it runs. The
+ * threads are created once and used until the workers are destroyed, so that a
+ * long read or write does not pay for thread creation per chunk. */
+typedef struct gta_internal_workers_struct
+{
+#if HAVE_PTHREAD
+    pthread_mutex_t mutex;
+    pthread_cond_t work_cond;   // Signaled when a task is queued or the workers must quit
+    pthread_cond_t done_cond;   // Signaled when a task is finished
+    pthread_t *threads;
+    size_t threads_count;
+#endif
+    gta_task_t *first;          // The queue of tasks that are not started yet
+    gta_task_t *last;
+    bool quit;
+} gta_workers_t;
 
-/*
- *
- * Initialize and Deinitialize Tag Lists
- *
- */
-
+#if HAVE_PTHREAD
 
+/* Take the first task from the queue, or return NULL. The mutex must be locked. */
 static GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW
-void
-gta_create_taglist(gta_taglist_t *GTA_RESTRICT taglist)
+gta_task_t *
+gta_take_task(gta_workers_t *workers)
 {
-    taglist->entries = 0;
-    taglist->size = 0;
-    taglist->names = NULL;
-    taglist->values = NULL;
-    taglist->sorted = NULL;
-    taglist->encoded_size = 1;
+    gta_task_t *task = workers->first;
+    if (task)
+    {
+        workers->first = task->next;
+        if (!workers->first)
+        {
+            workers->last = NULL;
+        }
+    }
+    return task;
 }
 
-static GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW
+/* Run a task that was taken from the queue. The mutex must be locked; it is unlocked while the task runs. */
+static GTA_ATTR_NONNULL_ALL
 void
-gta_destroy_taglist(gta_taglist_t *GTA_RESTRICT taglist)
+gta_run_taken_task(gta_workers_t *workers, gta_task_t *task, gta_codec_t *codec)
 {
-    for (ssize_t i = 0; i < taglist->entries; i++)
-    {
-        free(taglist->names[i]);
-        free(taglist->values[i]);
-    }
-    free(taglist->names);
-    free(taglist->values);
-    free(taglist->sorted);
+    pthread_mutex_unlock(&workers->mutex);
+    task->run(task, codec);
+    pthread_mutex_lock(&workers->mutex);
+    task->done = true;
+    pthread_cond_broadcast(&workers->done_cond);
 }
 
-
-/*
- *
- * Access Tag Lists
- *
- */
-
-/**
- * \brief                               Check if a string is valid UTF-8 and fulfills some given requirements.
- * \param s                             The string.
- * \param allow_control_characters      Whether the string is allowed to contain control characters.
- * \param allow_equal_sign              Whether the string is allowed to contain the equal sign '='.
- * \param allow_empty_string            Whether the string is allowed to be empty.
- * \return                              True if the string is valid UTF-8 and fulfills the given requirements, false otherwise.
- */
-static GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL
-bool
-gta_check_utf8(const char *s, bool allow_control_characters, bool allow_equal_sign, bool allow_empty_string)
+static GTA_ATTR_NONNULL_ALL
+void *
+gta_worker(void *p)
 {
-    const unsigned char *data = (const unsigned char *)s;
-    size_t i = 0;
-    int multibyte_case = 0;
-    int continuation_bytes = 0;
-    unsigned int multibyte_val = 0;
-    bool error = false;
+    gta_workers_t *workers = p;
+    gta_codec_t codec;
 
+    gta_init_codec(&codec);
+    pthread_mutex_lock(&workers->mutex);
     for (;;)
     {
-        unsigned char c = data[i++];
-        if (c < 0x80)
-        {
-            if (continuation_bytes > 0)
-            {
-                error = true;
-                break;
-            }
-            else if (c == 0x00)
-            {
-                if (i == 1 && !allow_empty_string)
-                {
-                    error = true;
-                }
-                break;
-            }
-            else
-            {
-                if ((c < 0x20 || c == 0x7f) && !allow_control_characters)
-                {
-                    error = true;
-                    break;
-                }
-                if (c == '=' && !allow_equal_sign)
-                {
-                    error = true;
-                    break;
-                }
-            }
-        }
-        else if (c < 0xc0)
+        gta_task_t *task = gta_take_task(workers);
+        if (task)
         {
-            if (continuation_bytes > 0)
-            {
-                multibyte_val = (multibyte_val << 6u) | (c & 0x3f);
-                continuation_bytes--;
-                if (continuation_bytes == 0)
-                {
-                    if ((multibyte_case == 2 && multibyte_val < 0x80)
-                            || (multibyte_case == 3 && multibyte_val < 0x800)
-                            || (multibyte_case == 4 && multibyte_val < 0x10000)
-                            || multibyte_val > 0x10ffff)
-                    {
-                        error = true;
-                        break;
-                    }
-                }
-            }
-            else
-            {
-                error = true;
-                break;
-            }
+            gta_run_taken_task(workers, task, &codec);
         }
-        else if (c < 0xc2)
+        else if (workers->quit)
         {
-            error = true;
             break;
         }
-        else if (c < 0xe0)
-        {
-            if (continuation_bytes == 0)
-            {
-                multibyte_case = 2;
-                multibyte_val = (c & 0x1f);
-                continuation_bytes = 1;
-            }
-            else
-            {
-                error = true;
-                break;
-            }
-        }
-        else if (c < 0xf0)
-        {
-            if (continuation_bytes == 0)
-            {
-                multibyte_case = 3;
-                multibyte_val = (c & 0x0f);
-                continuation_bytes = 2;
-            }
-            else
-            {
-                error = true;
-                break;
-            }
-        }
-        else if (c < 0xf5)
-        {
-            if (continuation_bytes == 0)
-            {
-                multibyte_case = 4;
-                multibyte_val = (c & 0x07);
-                continuation_bytes = 3;
-            }
-            else
-            {
-                error = true;
-                break;
-            }
-        }
-        else // (c <= 0xff)
+        else
         {
-            error = true;
-            break;
+            pthread_cond_wait(&workers->work_cond, &workers->mutex);
         }
     }
-
-    return !error;
+    pthread_mutex_unlock(&workers->mutex);
+    gta_free_codec(&codec);
+    return NULL;
 }
 
-/**
- * \brief Check if a string is a valid tag name.
- * \param name  The string.
- * \return      True if the string is a valid tag name, false otherwise.
- */
-static GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL
-bool
-gta_check_tag_name(const char *name)
-{
-    return gta_check_utf8(name, false, false, false);
-}
+#endif
 
 /**
- * \brief Check if a string is a valid tag value.
- * \param value The string.
- * \return      True if the string is a valid tag value, false otherwise.
+ * \brief               Start worker threads.
+ * \param threads       The number of threads.
+ * \return              The workers, or NULL.
+ *
+ * Returns NULL if threads are not supported or \a threads is zero. Tasks must
+ * then be run by the calling thread, which gta_submit_task() does automatically.
+ * If fewer threads than requested can be created, the workers are still usable,
+ * because a thread that waits for a task runs queued tasks itself.
  */
-static GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL
-bool
-gta_check_tag_value(const char *value)
-{
-    return gta_check_utf8(value, false, true, true);
-}
-
-uintmax_t
-gta_get_tags(const gta_taglist_t *GTA_RESTRICT taglist)
-{
-    return taglist->entries;
-}
-
-const char *
-gta_get_tag_name(const gta_taglist_t *GTA_RESTRICT taglist, uintmax_t i)
-{
-    return taglist->names[i];
-}
-
-const char *
-gta_get_tag_value(const gta_taglist_t *GTA_RESTRICT taglist, uintmax_t i)
-{
-    return taglist->values[i];
-}
-
-const char *
-gta_get_tag(const gta_taglist_t *GTA_RESTRICT taglist, const char *GTA_RESTRICT name)
+static GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NOTHROW
+gta_workers_t *
+gta_create_workers(unsigned int threads)
 {
-    ssize_t a = 0;
-    ssize_t b = taglist->entries - 1;
+#if HAVE_PTHREAD
+    gta_workers_t *workers;
 
-    while (b >= a)
+    if (threads == 0 || gta_size_overflow(threads, sizeof(pthread_t)))
     {
-        ssize_t c = (a + b) / 2;
-        ssize_t d = taglist->sorted[c];
-        int cmp = strcmp(taglist->names[d], name);
-        if (cmp < 0)
-        {
-            a = c + 1;
-        }
-        else if (cmp > 0)
-        {
-            b = c - 1;
-        }
-        else
-        {
-            return taglist->values[d];
-        }
+        return NULL;
     }
-    return NULL;
-}
-
-gta_result_t
-gta_set_tag(gta_taglist_t *GTA_RESTRICT taglist, const char *GTA_RESTRICT name, const char *GTA_RESTRICT value)
-{
-    if (!gta_check_tag_name(name) || !gta_check_tag_value(value))
+    workers = gta_malloc(sizeof(gta_workers_t));
+    if (!workers)
     {
-        return GTA_INVALID_DATA;
+        return NULL;
     }
-    size_t newnam_size = strlen(name) + 1;
-    size_t newval_size = strlen(value) + 1;
-
-    ssize_t a = 0;
-    ssize_t b = taglist->entries - 1;
-
-    while (b >= a)
+    workers->threads = gta_malloc(threads * sizeof(pthread_t));
+    if (!workers->threads)
     {
-        ssize_t c = (a + b) / 2;
-        ssize_t d = taglist->sorted[c];
-        int cmp = strcmp(taglist->names[d], name);
-        if (cmp < 0)
-        {
-            a = c + 1;
-        }
-        else if (cmp > 0)
-        {
-            b = c - 1;
-        }
-        else
-        {
-            size_t oldval_size = strlen(taglist->values[d]) + 1;
-            char *newval = malloc(newval_size);
-            if (!newval)
-            {
-                return GTA_SYSTEM_ERROR;
-            }
-            memcpy(newval, value, newval_size);
-            free(taglist->values[d]);
-            taglist->values[d] = newval;
-            taglist->encoded_size = taglist->encoded_size - oldval_size + newval_size;
-            return GTA_OK;
-        }
+        gta_free(workers);
+        return NULL;
     }
-
-    if ((size_t)taglist->entries == taglist->size)
+    if (pthread_mutex_init(&workers->mutex, NULL) != 0)
     {
-        if (taglist->entries == SSIZE_MAX
-                || taglist->size > SIZE_MAX - gta_bufsize_inc
-                || gta_size_overflow(taglist->size + gta_bufsize_inc, sizeof(char *))
-                || gta_size_overflow(taglist->size + gta_bufsize_inc, sizeof(ssize_t)))
-        {
-            return GTA_OVERFLOW;
-        }
-        taglist->size += gta_bufsize_inc;
-        char **old_names = taglist->names;
-        char **old_values = taglist->values;
-        ssize_t *old_sorted = taglist->sorted;
-        taglist->names = malloc((size_t)taglist->size * sizeof(char *));
-        taglist->values = malloc((size_t)taglist->size * sizeof(char *));
-        taglist->sorted = malloc((size_t)taglist->size * sizeof(ssize_t));
-        if (!taglist->names || !taglist->values || !taglist->sorted)
-        {
-            free(taglist->names);
-            free(taglist->values);
-            free(taglist->sorted);
-            taglist->names = old_names;
-            taglist->values = old_values;
-            taglist->sorted = old_sorted;
-            return GTA_SYSTEM_ERROR;
-        }
-        if (old_names)
-        {
-            memcpy(taglist->names, old_names, (size_t)(taglist->size - gta_bufsize_inc) * sizeof(char *));
-            free(old_names);
-        }
-        if (old_values)
-        {
-            memcpy(taglist->values, old_values, (size_t)(taglist->size - gta_bufsize_inc) * sizeof(char *));
-            free(old_values);
-        }
-        if (old_sorted)
-        {
-            memcpy(taglist->sorted, old_sorted, (size_t)(taglist->size - gta_bufsize_inc) * sizeof(ssize_t));
-            free(old_sorted);
-        }
+        gta_free(workers->threads);
+        gta_free(workers);
+        return NULL;
     }
-
-    char *newnam = malloc(newnam_size);
-    char *newval = malloc(newval_size);
-    if (!newnam || !newval)
+    if (pthread_cond_init(&workers->work_cond, NULL) != 0)
     {
-        free(newnam);
-        free(newval);
-        return GTA_SYSTEM_ERROR;
+        pthread_mutex_destroy(&workers->mutex);
+        gta_free(workers->threads);
+        gta_free(workers);
+        return NULL;
     }
-    memcpy(newnam, name, newnam_size);
-    memcpy(newval, value, newval_size);
-
-    taglist->names[taglist->entries] = newnam;
-    taglist->values[taglist->entries] = newval;
-    taglist->encoded_size += newnam_size + newval_size;
-    taglist->entries++;
-    for (ssize_t i = taglist->entries - 1; i > a; i--)
+    if (pthread_cond_init(&workers->done_cond, NULL) != 0)
     {
-        taglist->sorted[i] = taglist->sorted[i - 1];
+        pthread_cond_destroy(&workers->work_cond);
+        pthread_mutex_destroy(&workers->mutex);
+        gta_free(workers->threads);
+        gta_free(workers);
+        return NULL;
     }
-    taglist->sorted[a] = taglist->entries - 1;
-    return GTA_OK;
+    workers->threads_count = 0;
+    workers->first = NULL;
+    workers->last = NULL;
+    workers->quit = false;
+    while (workers->threads_count < threads
+            && pthread_create(&workers->threads[workers->threads_count], NULL, gta_worker, workers) == 0)
+    {
+        workers->threads_count++;
+    }
+    return workers;
+#else
+    (void)threads;
+    return NULL;
+#endif
 }
 
-gta_result_t
-gta_unset_tag(gta_taglist_t *GTA_RESTRICT taglist, const char *GTA_RESTRICT name)
+/* Stop the worker threads and free the workers. All submitted tasks must be finished. */
+static GTA_ATTR_NOTHROW
+void
+gta_destroy_workers(gta_workers_t *workers)
 {
-    ssize_t a = 0;
-    ssize_t b = taglist->entries - 1;
-
-    while (b >= a)
+#if HAVE_PTHREAD
+    if (workers)
     {
-        ssize_t c = (a + b) / 2;
-        ssize_t d = taglist->sorted[c];
-        int cmp = strcmp(taglist->names[d], name);
-        if (cmp < 0)
+        pthread_mutex_lock(&workers->mutex);
+        workers->quit = true;
+        pthread_cond_broadcast(&workers->work_cond);
+        pthread_mutex_unlock(&workers->mutex);
+        for (size_t t = 0; t < workers->threads_count; t++)
         {
-            a = c + 1;
+            pthread_join(workers->threads[t], NULL);
         }
-        else if (cmp > 0)
+        pthread_cond_destroy(&workers->done_cond);
+        pthread_cond_destroy(&workers->work_cond);
+        pthread_mutex_destroy(&workers->mutex);
+        gta_free(workers->threads);
+        gta_free(workers);
+    }
+#else
+    (void)workers;
+#endif
+}
+
+/**
+ * \brief               Submit a task to the workers.
+ * \param workers       The workers, or NULL.
+ * \param task          The task; its run function must be set.
+ * \param codec         The codec of the calling thread.
+ *
+ * Without workers, the task is run immediately by the calling thread.
+ * Every submitted task must be waited for with gta_wait_task().
+ */
+static GTA_ATTR_NONNULL1(2)
+void
+gta_submit_task(gta_workers_t *workers, gta_task_t *task, gta_codec_t *codec)
+{
+    task->next = NULL;
+    task->done = false;
+#if HAVE_PTHREAD
+    if (workers)
+    {
+        pthread_mutex_lock(&workers->mutex);
+        if (workers->last)
         {
-            b = c - 1;
+            workers->last->next = task;
         }
         else
         {
-            size_t oldnam_size = strlen(taglist->names[d]) + 1;
-            size_t oldval_size = strlen(taglist->values[d]) + 1;
-            free(taglist->names[d]);
-            free(taglist->values[d]);
-            for (ssize_t i = d; i < taglist->entries - 1; i++)
+            workers->first = task;
+        }
+        workers->last = task;
+        pthread_cond_signal(&workers->work_cond);
+        pthread_mutex_unlock(&workers->mutex);
+        return;
+    }
+#else
+    (void)workers;
+#endif
+    task->run(task, codec);
+    task->done = true;
+}
+
+/**
+ * \brief               Wait for a task to finish.
+ * \param workers       The workers that the task was submitted to, or NULL.
+ * \param task          The task.
+ * \param codec         The codec of the calling thread.
+ *
+ * While waiting, the calling thread runs queued tasks itself, using its codec.
+ */
+static GTA_ATTR_NONNULL1(2)
+void
+gta_wait_task(gta_workers_t *workers, gta_task_t *task, gta_codec_t *codec)
+{
+#if HAVE_PTHREAD
+    if (workers)
+    {
+        pthread_mutex_lock(&workers->mutex);
+        while (!task->done)
+        {
+            gta_task_t *t = gta_take_task(workers);
+            if (t)
             {
-                taglist->names[i] = taglist->names[i + 1];
-                taglist->values[i] = taglist->values[i + 1];
+                gta_run_taken_task(workers, t, codec);
             }
-            bool d_seen = false;
-            for (ssize_t i = 0; i < taglist->entries - 1; i++)
+            else
             {
-                ssize_t e = taglist->sorted[d_seen ? i + 1 : i];
-                if (!d_seen && e == d)
-                {
-                    d_seen = true;
-                    e = taglist->sorted[i + 1];
-                }
-                taglist->sorted[i] = (e > d ? e - 1 : e);
+                pthread_cond_wait(&workers->done_cond, &workers->mutex);
             }
-            taglist->encoded_size -= oldnam_size + oldval_size;
-            // TODO: Shrink the array if there are too many unused entries?
-            taglist->entries--;
-            return GTA_OK;
         }
+        pthread_mutex_unlock(&workers->mutex);
     }
-    return GTA_OK;
+#else
+    (void)workers;
+    (void)task;
+    (void)codec;
+#endif
 }
 
+/* One chunk in the read-ahead queue. */
+typedef struct
+{
+    gta_task_t task;            // The decompression of the chunk
+    size_t chunk_size;          // Uncompressed size; 0 for the last, empty chunk
+    uint8_t compression;        // Compression type of the raw data
+    size_t stride;              // Element size for the pre-filter
+    void *raw;                  // Raw data; freed by the decompression
+    size_t raw_size;            // Size of the raw data
+    void *chunk;                // The decompressed chunk
+    gta_result_t retval;        // Result of reading and decompressing
+    int errno_value;            // Value of errno after reading and decompressing
+} gta_readahead_slot_t;
+
+/* A queue of chunks that were already read, and that are decompressed in the background. */
+typedef struct gta_internal_readahead_struct
+{
+    gta_readahead_slot_t *slots;
+    size_t slots_count;         // Maximum number of chunks in the queue
+    size_t first;               // Index of the first chunk in the queue
+    size_t queued;              // Number of chunks in the queue
+    bool end;                   // Whether the last, empty chunk was already read (or reading failed)
+    gta_workers_t *workers;     // The decompression threads, or NULL
+    gta_codec_t codec;          // For chunks that the reading thread decompresses itself
+} gta_readahead_t;
+
+static GTA_ATTR_NONNULL1(1)
 void
-gta_unset_all_tags(gta_taglist_t *GTA_RESTRICT taglist)
+gta_run_readahead_slot(gta_task_t *task, gta_codec_t *codec)
 {
-    gta_destroy_taglist(taglist);
-    gta_create_taglist(taglist);
+    gta_readahead_slot_t *slot = (gta_readahead_slot_t *)task;
+
+    errno = 0;
+    slot->retval = gta_decompress_raw_chunk(codec, slot->stride, &slot->chunk, slot->chunk_size,
+            slot->compression, slot->raw, slot->raw_size);
+    slot->raw = NULL;
+    slot->errno_value = errno;
 }
 
-gta_result_t
-gta_clone_taglist(gta_taglist_t *GTA_RESTRICT dst_taglist,
-        const gta_taglist_t *GTA_RESTRICT src_taglist)
+/* Create a read-ahead queue for the given number of chunks, with one decompression thread per chunk.
+ * The threads are kept until the last chunk was taken from the queue. */
+static GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NOTHROW
+gta_readahead_t *
+gta_create_readahead(unsigned int threads)
 {
-    gta_taglist_t tmp_taglist;
-    gta_create_taglist(&tmp_taglist);
-    for (uintmax_t i = 0; i < gta_get_tags(src_taglist); i++)
+    gta_readahead_t *readahead;
+
+    if (gta_size_overflow(threads, sizeof(gta_readahead_slot_t)))
+    {
+        errno = ENOMEM;
+        return NULL;
+    }
+    readahead = gta_malloc(sizeof(gta_readahead_t));
+    if (!readahead)
+    {
+        return NULL;
+    }
+    readahead->slots = gta_malloc(threads * sizeof(gta_readahead_slot_t));
+    if (!readahead->slots)
+    {
+        gta_free(readahead);
+        return NULL;
+    }
+    readahead->slots_count = threads;
+    readahead->first = 0;
+    readahead->queued = 0;
+    readahead->end = false;
+    readahead->workers = gta_create_workers(threads);
+    gta_init_codec(&readahead->codec);
+    return readahead;
+}
+
+/* Wait for the decompression of a chunk in the queue to finish. */
+static GTA_ATTR_NONNULL_ALL
+void
+gta_readahead_wait(gta_readahead_t *readahead, gta_readahead_slot_t *slot)
+{
+    gta_wait_task(readahead->workers, &slot->task, &readahead->codec);
+}
+
+static GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW
+void
+gta_destroy_readahead(gta_readahead_t *GTA_RESTRICT readahead)
+{
+    for (size_t i = 0; i < readahead->queued; i++)
+    {
+        gta_readahead_slot_t *slot = &(readahead->slots[(readahead->first + i) % readahead->slots_count]);
+        gta_readahead_wait(readahead, slot);
+        gta_free_chunk(slot->raw);
+        gta_free_chunk(slot->chunk);
+    }
+    gta_destroy_workers(readahead->workers);
+    gta_free_codec(&readahead->codec);
+    gta_free(readahead->slots);
+    gta_free(readahead);
+}
+
+/* Clone a read-ahead queue. This waits for the decompression of all queued chunks to finish. */
+static GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW
+gta_readahead_t *
+gta_clone_readahead(const gta_readahead_t *GTA_RESTRICT src_readahead)
+{
+    // Waiting for the decompression does not change the logical state of the source queue.
+    gta_readahead_t *src = (gta_readahead_t *)src_readahead;
+    gta_readahead_t *readahead = gta_create_readahead(src->slots_count);
+    if (!readahead)
     {
-        gta_result_t r = gta_set_tag(&tmp_taglist,
-                gta_get_tag_name(src_taglist, i),
-                gta_get_tag_value(src_taglist, i));
-        if (r != GTA_OK)
+        return NULL;
+    }
+    for (size_t i = 0; i < src->queued; i++)
+    {
+        gta_readahead_slot_t *src_slot = &(src->slots[(src->first + i) % src->slots_count]);
+        gta_readahead_slot_t *slot = &(readahead->slots[i]);
+        gta_readahead_wait(src, src_slot);
+        *slot = *src_slot;
+        slot->raw = NULL;
+        slot->chunk = NULL;
+        if (src_slot->chunk)
         {
-            gta_destroy_taglist(&tmp_taglist);
-            return r;
+            slot->chunk = gta_alloc_chunk(src_slot->chunk_size);
+            if (!slot->chunk)
+            {
+                gta_destroy_readahead(readahead);
+                return NULL;
+            }
+            memcpy(slot->chunk, src_slot->chunk, src_slot->chunk_size);
         }
+        readahead->queued++;
     }
-    gta_destroy_taglist(dst_taglist);
-    memcpy(dst_taglist, &tmp_taglist, sizeof(gta_taglist_t));
-    return GTA_OK;
+    readahead->end = src->end;
+    return readahead;
 }
 
-
-/*
- *
- * Initialization and Deinitialization of Headers
+/**
+ * \brief               Fill the read-ahead queue.
+ * \param header        The header.
+ * \param readahead     The read-ahead queue.
+ * \param read_fn       The custom input function.
+ * \param userdata      A parameter to the custom input function.
  *
+ * Reads chunks until the queue is full or the last, empty chunk was read, and queues
+ * their decompression for the worker threads. Errors are stored in the queue and
+ * reported when the corresponding chunk is taken from the queue.
  */
+static GTA_ATTR_NONNULL1(1)
+void
+gta_fill_readahead(const gta_header_t *GTA_RESTRICT header, gta_readahead_t *GTA_RESTRICT readahead,
+        gta_read_t read_fn, intptr_t userdata)
+{
+    while (!readahead->end && readahead->queued < readahead->slots_count)
+    {
+        gta_readahead_slot_t *slot = &(readahead->slots[
+                (readahead->first + readahead->queued) % readahead->slots_count]);
+        readahead->queued++;
+        slot->task.run = gta_run_readahead_slot;
+        slot->task.done = true;
+        slot->chunk = NULL;
+        slot->stride = gta_filter_stride(header);
+        errno = 0;
+        slot->retval = gta_read_raw_chunk(header, &slot->chunk_size, &slot->compression,
+                &slot->raw, &slot->raw_size, read_fn, userdata);
+        slot->errno_value = errno;
+        if (slot->retval != GTA_OK || slot->chunk_size == 0)
+        {
+            readahead->end = true;
+            break;
+        }
+        if (slot->compression == GTA_NONE)
+        {
+            slot->chunk = slot->raw;
+            slot->raw = NULL;
+            continue;
+        }
+        gta_submit_task(readahead->workers, &slot->task, &readahead->codec);
+    }
+}
 
-
+/**
+ * \brief               Take the next chunk from the read-ahead queue.
+ * \param header        The header.
+ * \param readahead     The read-ahead queue.
+ * \param chunk         The chunk (ownership is transferred to the caller).
+ * \param chunk_size    The size of the chunk.
+ * \param read_fn       The custom input function.
+ * \param userdata      A parameter to the custom input function.
+ * \return              \a GTA_OK, \a GTA_INVALID_DATA, \a GTA_UNSUPPORTED_DATA, \a GTA_UNEXPECTED_EOF, or \a GTA_SYSTEM_ERROR.
+ *
+ * This is the read-ahead equivalent of gta_read_chunk().
+ * After taking the chunk, the queue is refilled, so that the following chunks
+ * are decompressed while the caller processes this one.
+ */
+static GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL
 gta_result_t
-gta_create_header(gta_header_t *GTA_RESTRICT *GTA_RESTRICT header)
+gta_read_chunk_readahead(const gta_header_t *GTA_RESTRICT header, gta_readahead_t *GTA_RESTRICT readahead,
+        void **chunk, size_t *chunk_size,
+        gta_read_t read_fn, intptr_t userdata)
 {
-    *header = malloc(sizeof(gta_header_t));
-    if (!*header)
+    gta_readahead_slot_t *slot;
+
+    *chunk = NULL;
+    *chunk_size = 0;
+    gta_fill_readahead(header, readahead, read_fn, userdata);
+    if (readahead->queued == 0)
     {
-        return GTA_SYSTEM_ERROR;
+        // the caller wants to read beyond the last, empty chunk
+        return GTA_INVALID_DATA;
     }
-    gta_header_t *GTA_RESTRICT hdr = *header;
-    hdr->host_endianness = true;
-    hdr->compression = GTA_NONE;
-    hdr->global_taglist = malloc(sizeof(gta_taglist_t));
-    if (!hdr->global_taglist)
+    slot = &(readahead->slots[readahead->first]);
+    gta_readahead_wait(readahead, slot);
+    readahead->first = (readahead->first + 1) % readahead->slots_count;
+    readahead->queued--;
+    if (readahead->end && readahead->queued == 0)
     {
-        free(hdr);
-        return GTA_SYSTEM_ERROR;
+        // Nothing is left to decompress
+        gta_destroy_workers(readahead->workers);
+        readahead->workers = NULL;
     }
-    gta_create_taglist(hdr->global_taglist);
-    hdr->components = 0;
-    hdr->component_types = NULL;
-    hdr->component_blob_sizes = NULL;
-    hdr->component_taglists = NULL;
-    hdr->element_size = 0;
-    hdr->dimensions = 0;
-    hdr->dimension_sizes = NULL;
-    hdr->dimension_taglists = NULL;
+    if (slot->retval != GTA_OK)
+    {
+        gta_free_chunk(slot->chunk);
+        errno = slot->errno_value;
+        return slot->retval;
+    }
+    *chunk = slot->chunk;
+    *chunk_size = slot->chunk_size;
+    gta_fill_readahead(header, readahead, read_fn, userdata);
     return GTA_OK;
 }
 
+/**
+ * \brief               Skip a data chunk.
+ * \param header        The header.
+ * \param chunk_size    The size of the skipped chunk.
+ * \param encoded_size  The number of input bytes that the skipped chunk occupies.
+ * \param read_fn       The custom input function.
+ * \param seek_fn       The custom seek function, or NULL for non-seekable input.
+ * \param userdata      A parameter to the custom input/seek functions.
+ * \return              \a GTA_OK, \a GTA_UNSUPPORTED_DATA, \a GTA_UNEXPECTED_EOF, or \a GTA_SYSTEM_ERROR.
+ */
+static GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL3(1, 2, 4)
 gta_result_t
-gta_clone_header(gta_header_t *GTA_RESTRICT dst_header,
-        const gta_header_t *GTA_RESTRICT src_header)
+gta_skip_chunk(const gta_header_t *GTA_RESTRICT header, size_t *chunk_size, uintmax_t *encoded_size,
+        gta_read_t read_fn, gta_seek_t seek_fn, intptr_t userdata)
 {
-    gta_result_t retval;
-    gta_header_t *temp_header;
+    int error = false;
+    uint64_t size_uncompressed;
+    uint8_t compression;
+    uint64_t size_compressed;
+    gta_result_t retval = GTA_OK;
+    size_t r;
 
-    retval = gta_create_header(&temp_header);
-    if (retval != GTA_OK)
+    r = read_fn(userdata, &size_uncompressed, sizeof(uint64_t), &error);
+    if (error)
     {
-        return retval;
+        retval = GTA_SYSTEM_ERROR;
+        goto exit;
     }
-
-    temp_header->host_endianness = src_header->host_endianness;
-    temp_header->compression = src_header->compression;
-    for (uintmax_t i = 0; i < gta_get_tags(src_header->global_taglist); i++)
+    if (r < sizeof(uint64_t))
     {
-        retval = gta_set_tag(temp_header->global_taglist,
-                gta_get_tag_name(src_header->global_taglist, i),
-                gta_get_tag_value(src_header->global_taglist, i));
-        if (retval != GTA_OK)
-        {
-            goto exit;
-        }
+        retval = GTA_UNEXPECTED_EOF;
+        goto exit;
     }
-    gta_type_t *types = malloc(src_header->components * sizeof(gta_type_t));
-    if (!types)
+    if (gta_data_needs_endianness_swapping(header))
+    {
+        gta_swap_endianness_64(&size_uncompressed);
+    }
+    if (size_uncompressed > gta_max_chunk_size)
+    {
+        retval = GTA_UNSUPPORTED_DATA;
+        goto exit;
+    }
+    *encoded_size = sizeof(uint64_t);
+    if (size_uncompressed == 0)
+    {
+        // the last, empty chunk
+        *chunk_size = 0;
+        retval = GTA_OK;
+        goto exit;
+    }
+    *chunk_size = size_uncompressed;
+    r = read_fn(userdata, &compression, sizeof(uint8_t), &error);
+    if (error)
     {
         retval = GTA_SYSTEM_ERROR;
         goto exit;
     }
-    for (uintmax_t i = 0; i < src_header->components; i++)
+    if (r < sizeof(uint8_t))
     {
-        types[i] = src_header->component_types[i];
+        retval = GTA_UNEXPECTED_EOF;
+        goto exit;
     }
-    retval = gta_set_components(temp_header, src_header->components,
-            types, src_header->component_blob_sizes);
-    free(types);
-    if (retval != GTA_OK)
+    if (!gta_compression_is_supported(gta_chunk_method(compression)))
     {
+        retval = GTA_UNSUPPORTED_DATA;
         goto exit;
     }
-    for (uintmax_t i = 0; i < src_header->components; i++)
+    if (gta_chunk_method(compression) == GTA_NONE && gta_chunk_filter(compression) != GTA_FILTER_NONE)
+    {
+        retval = GTA_INVALID_DATA;
+        goto exit;
+    }
+    if (compression == GTA_NONE)
     {
-        for (uintmax_t j = 0; j < gta_get_tags(src_header->component_taglists[i]); j++)
+        *encoded_size += sizeof(uint8_t) + *chunk_size;
+        if (seek_fn)
         {
-            retval = gta_set_tag(temp_header->component_taglists[i],
-                    gta_get_tag_name(src_header->component_taglists[i], j),
-                    gta_get_tag_value(src_header->component_taglists[i], j));
-            if (retval != GTA_OK)
+            seek_fn(userdata, *chunk_size, SEEK_CUR, &error);
+            if (error)
             {
+                retval = GTA_SYSTEM_ERROR;
                 goto exit;
             }
         }
-    }
-    retval = gta_set_dimensions(temp_header, src_header->dimensions, src_header->dimension_sizes);
-    if (retval != GTA_OK)
-    {
-        goto exit;
-    }
-    for (uintmax_t i = 0; i < src_header->dimensions; i++)
-    {
-        for (uintmax_t j = 0; j < gta_get_tags(src_header->dimension_taglists[i]); j++)
+        else
         {
-            retval = gta_set_tag(temp_header->dimension_taglists[i],
-                    gta_get_tag_name(src_header->dimension_taglists[i], j),
-                    gta_get_tag_value(src_header->dimension_taglists[i], j));
+            retval = gta_readskip(read_fn, userdata, *chunk_size);
             if (retval != GTA_OK)
             {
                 goto exit;
             }
         }
     }
-
-exit:
-    if (retval == GTA_OK)
+    else
     {
-        gta_destroy_taglist(dst_header->global_taglist);
-        free(dst_header->global_taglist);
-        free(dst_header->component_types);
-        free(dst_header->component_blob_sizes);
-        for (uintmax_t i = 0; i < dst_header->components; i++)
+        r = read_fn(userdata, &size_compressed, sizeof(uint64_t), &error);
+        if (error)
         {
-            gta_destroy_taglist(dst_header->component_taglists[i]);
-            free(dst_header->component_taglists[i]);
+            retval = GTA_SYSTEM_ERROR;
+            goto exit;
         }
-        free(dst_header->component_taglists);
-        free(dst_header->dimension_sizes);
-        for (uintmax_t i = 0; i < dst_header->dimensions; i++)
+        if (r < sizeof(uint64_t))
         {
-            gta_destroy_taglist(dst_header->dimension_taglists[i]);
-            free(dst_header->dimension_taglists[i]);
+            retval = GTA_UNEXPECTED_EOF;
+            goto exit;
         }
-        free(dst_header->dimension_taglists);
-        memcpy(dst_header, temp_header, sizeof(gta_header_t));
-    }
-    else
-    {
-        if (temp_header->global_taglist)
+        if (gta_data_needs_endianness_swapping(header))
         {
-            gta_destroy_taglist(temp_header->global_taglist);
-            free(temp_header->global_taglist);
+            gta_swap_endianness_64(&size_compressed);
         }
-        free(temp_header->component_types);
-        free(temp_header->component_blob_sizes);
-        if (temp_header->component_taglists)
+        if (size_compressed > size_uncompressed)
         {
-            for (uintmax_t i = 0; i < temp_header->components; i++)
+            // A compressed chunk is always smaller than an uncompressed chunk,
+            // or else it would not have been compressed! See specification.
+            retval = GTA_INVALID_DATA;
+            goto exit;
+        }
+        if (size_compressed == 0)
+        {
+            retval = GTA_INVALID_DATA;
+            goto exit;
+        }
+        *encoded_size += sizeof(uint8_t) + sizeof(uint64_t) + size_compressed;
+        if (seek_fn)
+        {
+            seek_fn(userdata, size_compressed, SEEK_CUR, &error);
+            if (error)
             {
-                gta_destroy_taglist(temp_header->component_taglists[i]);
-                free(temp_header->component_taglists[i]);
+                retval = GTA_SYSTEM_ERROR;
+                goto exit;
             }
         }
-        free(temp_header->component_taglists);
-        free(temp_header->dimension_sizes);
-        if (temp_header->dimension_taglists)
+        else
         {
-            for (uintmax_t i = 0; i < temp_header->dimensions; i++)
+            retval = gta_readskip(read_fn, userdata, size_compressed);
+            if (retval != GTA_OK)
             {
-                gta_destroy_taglist(temp_header->dimension_taglists[i]);
-                free(temp_header->dimension_taglists[i]);
+                goto exit;
             }
-            free(temp_header->dimension_taglists);
         }
     }
-    free(temp_header);
-    return retval;
-}
 
-void
-gta_destroy_header(gta_header_t *GTA_RESTRICT header)
-{
-    gta_destroy_taglist(header->global_taglist);
-    free(header->global_taglist);
-    free(header->component_types);
-    free(header->component_blob_sizes);
-    for (uintmax_t i = 0; i < header->components; i++)
-    {
-        gta_destroy_taglist(header->component_taglists[i]);
-        free(header->component_taglists[i]);
-    }
-    free(header->component_taglists);
-    free(header->dimension_sizes);
-    for (uintmax_t i = 0; i < header->dimensions; i++)
+exit:
+    if (retval != GTA_OK)
     {
-        gta_destroy_taglist(header->dimension_taglists[i]);
-        free(header->dimension_taglists[i]);
+        *chunk_size = 0;
     }
-    free(header->dimension_taglists);
-    free(header);
+    return retval;
 }
 
-
-/*
- *
- * Read and Write Headers
+/**
+ * \brief                       Compress a data chunk for output.
+ * \param header                The header.
+ * \param codec                 The codec to compress with, or NULL.
+ * \param stride                The element size for array data, or 0 for header data, which is never filtered.
+ * \param chunk                 The chunk buffer.
+ * \param chunk_size            The size of the chunk.
+ * \param output_compression    Returns the compression type that the chunk is stored with.
+ * \param compressed            Returns the compressed chunk, or NULL if the chunk is stored uncompressed.
+ * \param compressed_size       Returns the size of the compressed chunk.
+ * \return                      \a GTA_OK, \a GTA_OVERFLOW, \a GTA_UNSUPPORTED_DATA, or \a GTA_SYSTEM_ERROR.
  *
+ * For array data, the pre-filter of the header is applied before compression.
+ * A chunk that is stored uncompressed is never filtered.\n
+ * This function does not perform any input/output and does not modify the header,
+ * so it can be called for several chunks of the same header at the same time,
+ * as long as each call uses its own codec.
  */
-
-
-static GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW
+static GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL1(1)
 gta_result_t
-gta_append_element_to_array(
-        void **array, size_t *array_size, size_t *array_elements,
-        const void *element, size_t element_size)
+gta_compress_chunk(const gta_header_t *GTA_RESTRICT header, gta_codec_t *codec, size_t stride,
+        const void *GTA_RESTRICT chunk, size_t chunk_size,
+        uint8_t *GTA_RESTRICT output_compression,
+        void **compressed, size_t *GTA_RESTRICT compressed_size)
 {
-    if (*array_elements == *array_size)
+    gta_filter_t filter = (stride > 0 ? header->filter : GTA_FILTER_NONE);
+    const void *input = chunk;
+    gta_codec_t tmp_codec;
+    gta_result_t retval;
+
+    *compressed = NULL;
+    *compressed_size = 0;
+    if (chunk_size == 0 || header->compression == GTA_NONE)
     {
-        void *tmp_ptr;
-        if (*array_size > SIZE_MAX - gta_bufsize_inc
-                || gta_size_overflow(*array_size + gta_bufsize_inc, element_size))
-        {
-            return GTA_OVERFLOW;
-        }
-        *array_size += gta_bufsize_inc;
-        tmp_ptr = realloc(*array, *array_size * element_size);
-        if (!tmp_ptr)
+        *output_compression = GTA_NONE;
+        return GTA_OK;
+    }
+    // The compressed chunk is only useful if it is smaller than the uncompressed chunk
+    // including the additional size field.
+    if (chunk_size <= sizeof(uint64_t) + 1)
+    {
+        *output_compression = GTA_NONE;
+        return GTA_OK;
+    }
+    if (filter > GTA_FILTER_DELTA)
+    {
+        return GTA_UNSUPPORTED_DATA;
+    }
+    if (!codec)
+    {
+        gta_init_codec(&tmp_codec);
+        codec = &tmp_codec;
+    }
+    if (filter != GTA_FILTER_NONE)
+    {
+        void *filtered = gta_get_filter_buffer(codec, chunk_size);
+        if (!filtered)
         {
-            free(*array);
-            return GTA_SYSTEM_ERROR;
+            retval = GTA_SYSTEM_ERROR;
+            goto exit;
         }
-        *array = tmp_ptr;
+        gta_filter(filter, filtered, chunk, chunk_size, stride);
+        input = filtered;
     }
-    void *dst = (char *)(*array) + *array_elements * element_size;
-    memcpy(dst, element, element_size);
-    (*array_elements)++;
-    return GTA_OK;
-}
+    *compressed = gta_alloc_chunk(chunk_size - sizeof(uint64_t) - 1);
+    if (!*compressed)
+    {
+        retval = GTA_SYSTEM_ERROR;
+        goto exit;
+    }
+    *compressed_size = chunk_size - sizeof(uint64_t) - 1;
+    retval = gta_compress(codec, *compressed, compressed_size, input, chunk_size, header->compression);
+    if (retval == GTA_OVERFLOW)
+    {
+        gta_free_chunk(*compressed);
+        *compressed = NULL;
+        *compressed_size = 0;
+        *output_compression = GTA_NONE;
+        retval = GTA_OK;
+        goto exit;
+    }
+    if (retval != GTA_OK)
+    {
+        gta_free_chunk(*compressed);
+        *compressed = NULL;
+        *compressed_size = 0;
+        goto exit;
+    }
+    *output_compression = gta_chunk_compression(header->compression, filter);
 
-static GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL
-gta_result_t
-gta_read_blob_from_chunk(const gta_header_t *GTA_RESTRICT header, gta_read_t read_fn, intptr_t userdata,
-        void **chunk, size_t *chunk_size, size_t *chunk_index,
-        void *blob, size_t blob_size)
-{
-    gta_result_t retval = GTA_OK;
-    char *cblob = blob;
-    char *cchunk = *chunk;
-    for (size_t i = 0; i < blob_size; i++)
+exit:
+    if (codec == &tmp_codec)
     {
-        if (*chunk_index == *chunk_size)
-        {
-            free(*chunk);
-            *chunk = NULL;
-            retval = gta_read_chunk(header, chunk, chunk_size, read_fn, userdata);
-            if (retval != GTA_OK)
-            {
-                return retval;
-            }
-            if (*chunk_size == 0)
-            {
-                return GTA_INVALID_DATA;
-            }
-            *chunk_index = 0;
-            cchunk = *chunk;
-        }
-        cblob[i] = cchunk[(*chunk_index)++];
+        gta_free_codec(&tmp_codec);
     }
     return retval;
 }
 
-static GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL
+/**
+ * \brief                       Write a data chunk that was prepared with gta_compress_chunk().
+ * \param chunk                 The chunk buffer.
+ * \param chunk_size            The size of the chunk.
+ * \param output_compression    The compression type that the chunk is stored with.
+ * \param compressed            The compressed chunk, or NULL.
+ * \param compressed_size       The size of the compressed chunk.
+ * \param write_fn              The custom output function.
+ * \param userdata              A parameter to the custom output function.
+ * \return                      \a GTA_OK or \a GTA_SYSTEM_ERROR.
+ */
+static GTA_ATTR_WARN_UNUSED_RESULT
 gta_result_t
-gta_read_taglist_from_chunk(const gta_header_t *GTA_RESTRICT header, gta_read_t read_fn, intptr_t userdata,
-        void **chunk, size_t *chunk_size, size_t *chunk_index,
-        gta_taglist_t **taglist)
+gta_emit_chunk(const void *GTA_RESTRICT chunk, size_t chunk_size,
+        uint8_t output_compression, const void *GTA_RESTRICT compressed, size_t compressed_size,
+        gta_write_t write_fn, intptr_t userdata)
 {
-    void *name = NULL;
-    size_t name_len = 0;
-    size_t name_size = 0;
-    void *value = NULL;
-    size_t value_len = 0;
-    size_t value_size = 0;
-    bool in_name = true;
-    gta_result_t retval = GTA_OK;
+    int error = false;
+    uint64_t size_uncompressed = chunk_size;
+    uint64_t size_compressed;
+    size_t r;
 
-    *taglist = malloc(sizeof(gta_taglist_t));
-    if (!*taglist)
+    errno = 0;
+    r = write_fn(userdata, &size_uncompressed, sizeof(uint64_t), &error);
+    if (error || r < sizeof(uint64_t))
     {
+        if (errno == 0)
+        {
+            errno = EIO;
+        }
         return GTA_SYSTEM_ERROR;
     }
-    gta_create_taglist(*taglist);
-    for (;;)
+    if (chunk_size == 0)
     {
-        char c;
-        retval = gta_read_blob_from_chunk(header, read_fn, userdata,
-                chunk, chunk_size, chunk_index, &c, sizeof(char));
-        if (retval != GTA_OK)
-        {
-            goto exit;
-        }
-        if (in_name && name_len == 0 && c == '\0')
+        return GTA_OK;
+    }
+    errno = 0;
+    r = write_fn(userdata, &output_compression, sizeof(uint8_t), &error);
+    if (error || r < sizeof(uint8_t))
+    {
+        if (errno == 0)
         {
-            break;
+            errno = EIO;
         }
-        if (in_name)
+        return GTA_SYSTEM_ERROR;
+    }
+    if (output_compression == GTA_NONE)
+    {
+        errno = 0;
+        r = write_fn(userdata, chunk, chunk_size, &error);
+        if (error || r < chunk_size)
         {
-            retval = gta_append_element_to_array(&name, &name_size, &name_len, &c, sizeof(char));
-            if (retval != GTA_OK)
-            {
-                goto exit;
-            }
-            if (c == '\0')
+            if (errno == 0)
             {
-                in_name = false;
+                errno = EIO;
             }
+            return GTA_SYSTEM_ERROR;
         }
-        else
+    }
+    else
+    {
+        size_compressed = compressed_size;
+        errno = 0;
+        r = write_fn(userdata, &size_compressed, sizeof(uint64_t), &error);
+        if (error || r < sizeof(uint64_t))
         {
-            retval = gta_append_element_to_array(&value, &value_size, &value_len, &c, sizeof(char));
-            if (retval != GTA_OK)
+            if (errno == 0)
             {
-                goto exit;
+                errno = EIO;
             }
-            if (c == '\0')
+            return GTA_SYSTEM_ERROR;
+        }
+        errno = 0;
+        r = write_fn(userdata, compressed, compressed_size, &error);
+        if (error || r < compressed_size)
+        {
+            if (errno == 0)
             {
-                retval = gta_set_tag(*taglist, name, value);
-                if (retval != GTA_OK)
-                {
-                    goto exit;
-                }
-                name_len = 0;
-                value_len = 0;
-                in_name = true;
+                errno = EIO;
             }
+            return GTA_SYSTEM_ERROR;
         }
     }
+    return GTA_OK;
+}
 
-exit:
-    free(name);
-    free(value);
+/**
+ * \brief               Write a data chunk.
+ * \param header        The header.
+ * \param codec         The codec to compress with, or NULL.
+ * \param stride        The element size for array data, or 0 for header data; see gta_compress_chunk().
+ * \param chunk         The chunk buffer.
+ * \param chunk_size    The size of the chunk.
+ * \param write_fn      The custom output function.
+ * \param userdata      A parameter to the custom output function.
+ * \return              \a GTA_OK, \a GTA_UNSUPPORTED_DATA (if the chunk size larger than the limit), or \a GTA_SYSTEM_ERROR.
+ */
+static GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL1(1)
+gta_result_t
+gta_write_chunk(const gta_header_t *GTA_RESTRICT header, gta_codec_t *codec, size_t stride,
+        const void *GTA_RESTRICT chunk, size_t chunk_size,
+        gta_write_t write_fn, intptr_t userdata)
+{
+    uint8_t output_compression;
+    void *compressed;
+    size_t compressed_size;
+    gta_result_t retval;
+
+    if (chunk_size > gta_max_chunk_size)
+    {
+        return GTA_UNSUPPORTED_DATA;
+    }
+    retval = gta_compress_chunk(header, codec, stride, chunk, chunk_size,
+            &output_compression, &compressed, &compressed_size);
     if (retval != GTA_OK)
     {
-        gta_destroy_taglist(*taglist);
-        free(*taglist);
-        *taglist = NULL;
+        return retval;
     }
+    retval = gta_emit_chunk(chunk, chunk_size,
+            output_compression, compressed, compressed_size, write_fn, userdata);
+    gta_free_chunk(compressed);
     return retval;
 }
 
+/* A chunk that is compressed by a worker thread and then written in order. */
+typedef struct
+{
+    gta_task_t task;
+    const gta_header_t *header;
+    size_t stride;              // Element size for the pre-filter
+    const void *chunk;
+    size_t chunk_size;
+    uint8_t output_compression;
+    void *compressed;
+    size_t compressed_size;
+    gta_result_t retval;
+    int errno_value;
+} gta_chunk_job_t;
+
+static GTA_ATTR_NONNULL1(1)
+void
+gta_run_chunk_job(gta_task_t *task, gta_codec_t *codec)
+{
+    gta_chunk_job_t *job = (gta_chunk_job_t *)task;
+
+    errno = 0;
+    job->retval = gta_compress_chunk(job->header, codec, job->stride, job->chunk, job->chunk_size,
+            &job->output_compression, &job->compressed, &job->compressed_size);
+    job->errno_value = errno;
+}
+
+/**
+ * rief               Write a list of array data chunks, compressing them in parallel.
+ * \param header        The header.
+ * \param codec         The codec for the calling thread, or NULL.
+ * \param workers       The compression workers, or NULL.
+ * \param jobs          The chunks.
+ * \param jobs_count    The number of chunks.
+ * \param write_fn      The custom output function.
+ * \param userdata      A parameter to the custom output function.
+ * 
+eturn               GTA_OK,  GTA_OVERFLOW, or  GTA_SYSTEM_ERROR.
+ *
+ * The chunks are written in the given order, so that the output is the same as if
+ * gta_write_chunk() had been called for each chunk. Each chunk is written as soon as
+ * it and its predecessors are compressed. The calling thread compresses chunks
+ * while it waits. Without workers, all chunks are compressed by the calling thread.
+ */
+static GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL1(1)
 gta_result_t
-gta_read_header(gta_header_t *GTA_RESTRICT header, gta_read_t read_fn, intptr_t userdata)
+gta_write_chunks(const gta_header_t *GTA_RESTRICT header, gta_codec_t *codec, gta_workers_t *workers,
+        gta_chunk_job_t *GTA_RESTRICT jobs, size_t jobs_count,
+        gta_write_t write_fn, intptr_t userdata)
 {
-    uint8_t firstblock[6];
-    int input_error = false;
     gta_result_t retval = GTA_OK;
-    size_t r;
 
-    /* Use a temp header to avoid changing the given header unless we read everything successfully */
-    gta_header_t *temp_header = NULL;
-    retval = gta_create_header(&temp_header);
-    if (retval != GTA_OK)
+    for (size_t j = 0; j < jobs_count; j++)
     {
-        return retval;
+        jobs[j].task.run = gta_run_chunk_job;
+        jobs[j].header = header;
+        jobs[j].stride = gta_filter_stride(header);
+        gta_submit_task(workers, &jobs[j].task, codec);
     }
-
-    /* Read first block */
-    r = read_fn(userdata, firstblock, 6, &input_error);
-    if (input_error)
+    for (size_t j = 0; j < jobs_count; j++)
     {
-        retval = GTA_SYSTEM_ERROR;
-        goto exit;
+        gta_wait_task(workers, &jobs[j].task, codec);
+        if (retval == GTA_OK)
+        {
+            if (jobs[j].retval != GTA_OK)
+            {
+                errno = jobs[j].errno_value;
+                retval = jobs[j].retval;
+            }
+            else
+            {
+                retval = gta_emit_chunk(jobs[j].chunk, jobs[j].chunk_size,
+                        jobs[j].output_compression, jobs[j].compressed, jobs[j].compressed_size,
+                        write_fn, userdata);
+            }
+        }
+        gta_free_chunk(jobs[j].compressed);
+        jobs[j].compressed = NULL;
     }
-    if (r < 6)
+    return retval;
+}
+
+
+/*
+ *
+ * Initialize and Deinitialize Tag Lists
+ *
+ */
+
+
+static GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW
+void
+gta_create_taglist(gta_taglist_t *GTA_RESTRICT taglist)
+{
+    taglist->entries = 0;
+    taglist->size = 0;
+    taglist->tags = NULL;
+    taglist->arena = NULL;
+    taglist->arena_last = NULL;
+    taglist->arena_size = 0;
+    taglist->arena_garbage = 0;
+    taglist->index = NULL;
+    taglist->index_size = 0;
+    taglist->changes = 0;
+}
+
+static GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW
+void
+gta_destroy_taglist(gta_taglist_t *GTA_RESTRICT taglist)
+{
+    gta_free(taglist->tags);
+    while (taglist->arena)
     {
-        retval = GTA_UNEXPECTED_EOF;
-        goto exit;
+        gta_arena_block_t *next = taglist->arena->next;
+        gta_free(taglist->arena);
+        taglist->arena = next;
     }
-    if (strncmp((char *)firstblock, "GTA", 3) != 0)
+    gta_free(taglist->index);
+}
+
+/* The number of bytes that a tag list occupies in a GTA file: all names and
+ * values with their terminators, plus the empty name that ends the list. */
+static GTA_ATTR_NONNULL_ALL GTA_ATTR_PURE GTA_ATTR_NOTHROW
+size_t
+gta_get_taglist_encoded_size(const gta_taglist_t *GTA_RESTRICT taglist)
+{
+    return taglist->arena_size - taglist->arena_garbage + 1;
+}
+
+/* FNV-1a hash of a tag name. Also returns the length of the name. */
+static GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW
+uint32_t
+gta_tag_hash(const char *GTA_RESTRICT name, size_t *GTA_RESTRICT len)
+{
+    const unsigned char *p = (const unsigned char *)name;
+    uint32_t hash = UINT32_C(2166136261);
+    size_t i = 0;
+    for (; p[i] != '\0'; i++)
     {
-        retval = GTA_INVALID_DATA;
-        goto exit;
+        hash = (hash ^ p[i]) * UINT32_C(16777619);
     }
-    if (firstblock[3] != 1)
+    *len = i;
+    return hash;
+}
+
+/* Return the index slot of the tag with the given name, or, if there is no
+ * such tag, the empty slot where it would be entered. The index must exist. */
+static GTA_ATTR_NONNULL_ALL GTA_ATTR_PURE GTA_ATTR_NOTHROW
+size_t
+gta_find_tag_slot(const gta_taglist_t *GTA_RESTRICT taglist, const char *GTA_RESTRICT name, uint32_t hash)
+{
+    size_t mask = taglist->index_size - 1;
+    size_t slot = hash & mask;
+    for (;;)
     {
-        retval = GTA_UNSUPPORTED_DATA;
-        goto exit;
+        ssize_t e = taglist->index[slot];
+        if (e < 0 || (taglist->tags[e].hash == hash
+                    && strcmp(taglist->tags[e].name, name) == 0))
+        {
+            return slot;
+        }
+        slot = (slot + 1) & mask;
     }
-    if (firstblock[4] & 0xfc)
+}
+
+/* Enter all tags into the index. */
+static GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW
+void
+gta_fill_taglist_index(gta_taglist_t *GTA_RESTRICT taglist)
+{
+    size_t mask = taglist->index_size - 1;
+    for (size_t i = 0; i < taglist->index_size; i++)
     {
-        retval = GTA_UNSUPPORTED_DATA;
-        goto exit;
+        taglist->index[i] = -1;
     }
-    bool big_endian = (firstblock[4] & 0x01);
-#if WORDS_BIGENDIAN
-    temp_header->host_endianness = big_endian;
-#else
-    temp_header->host_endianness = !big_endian;
-#endif
-    if (firstblock[5] != GTA_NONE
-            && firstblock[5] != GTA_ZLIB
-            && firstblock[5] != GTA_ZLIB1
-            && firstblock[5] != GTA_ZLIB2
-            && firstblock[5] != GTA_ZLIB3
-            && firstblock[5] != GTA_ZLIB4
-            && firstblock[5] != GTA_ZLIB5
-            && firstblock[5] != GTA_ZLIB6
-            && firstblock[5] != GTA_ZLIB7
-            && firstblock[5] != GTA_ZLIB8
-            && firstblock[5] != GTA_ZLIB9
-            && firstblock[5] != GTA_BZIP2
-            && firstblock[5] != GTA_XZ)
+    for (ssize_t i = 0; i < taglist->entries; i++)
     {
-        retval = GTA_UNSUPPORTED_DATA;
-        goto exit;
+        size_t slot = taglist->tags[i].hash & mask;
+        while (taglist->index[slot] >= 0)
+        {
+            slot = (slot + 1) & mask;
+        }
+        taglist->index[slot] = i;
     }
-    temp_header->compression = firstblock[5];
-
-    /* Read rest of header from chunk list */
-
-    void *chunk = NULL;
-    size_t chunk_size = 0;
-    size_t chunk_index = 0;
+}
 
-    // Read component list
+/* Make sure that the tags array has room for n tags. */
+static GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW
+gta_result_t
+gta_reserve_tags(gta_taglist_t *GTA_RESTRICT taglist, size_t n)
+{
+    if (n <= taglist->size)
     {
-        void *comp_array = NULL;
-        size_t comp_array_size = 0;
-        size_t comp_array_elements = 0;
-        void *bs_array = NULL;
-        size_t bs_array_size = 0;
-        size_t bs_array_elements = 0;
-        size_t element_size = 0;
-        for (;;)
-        {
-            uint8_t type;
-            retval = gta_read_blob_from_chunk(temp_header, read_fn, userdata,
-                    &chunk, &chunk_size, &chunk_index,
-                    &type, sizeof(uint8_t));
-            if (retval != GTA_OK)
-            {
-                free(comp_array);
-                free(bs_array);
-                goto exit;
-            }
-            if (type == 0xff)
-            {
-                break;
-            }
-            uint64_t size;
-            switch (type)
-            {
-            case GTA_BLOB:
-                break;
-            case GTA_INT8:
-            case GTA_UINT8:
-                size = 1;
-                break;
-            case GTA_INT16:
-            case GTA_UINT16:
-                size = 2;
-                break;
-            case GTA_INT32:
-            case GTA_UINT32:
-            case GTA_FLOAT32:
-                size = 4;
-                break;
-            case GTA_INT64:
-            case GTA_UINT64:
-            case GTA_FLOAT64:
-            case GTA_CFLOAT32:
-                size = 8;
-                break;
-            case GTA_INT128:
-            case GTA_UINT128:
-            case GTA_FLOAT128:
-            case GTA_CFLOAT64:
-                size = 16;
-                break;
-            case GTA_CFLOAT128:
-                size = 32;
-                break;
-            default:
-                retval = GTA_INVALID_DATA;
-                free(comp_array);
-                free(bs_array);
-                goto exit;
-                break;
-            }
-            if (type == GTA_BLOB)
-            {
-                retval = gta_read_blob_from_chunk(temp_header, read_fn, userdata,
-                        &chunk, &chunk_size, &chunk_index,
-                        &size, sizeof(uint64_t));
-                if (retval != GTA_OK)
-                {
-                    free(comp_array);
-                    free(bs_array);
-                    goto exit;
-                }
-                if (gta_data_needs_endianness_swapping(temp_header))
-                {
-                    gta_swap_endianness_64(&size);
-                }
-                if (size == 0)
-                {
-                    retval = GTA_INVALID_DATA;
-                    free(comp_array);
-                    free(bs_array);
-                    goto exit;
-                }
-                uintmax_t bigsize = size;
-                retval = gta_append_element_to_array(
-                        &bs_array, &bs_array_size, &bs_array_elements,
-                        &bigsize, sizeof(uintmax_t));
-                if (retval != GTA_OK)
-                {
-                    free(comp_array);
-                    free(bs_array);
-                    goto exit;
-                }
-            }
-            if (element_size > UINTMAX_MAX - size)
-            {
-                retval = GTA_OVERFLOW;
-                free(comp_array);
-                free(bs_array);
-                goto exit;
-            }
-            element_size += size;
-            retval = gta_append_element_to_array(
-                    &comp_array, &comp_array_size, &comp_array_elements,
-                    &type, sizeof(uint8_t));
-            if (retval != GTA_OK)
-            {
-                free(comp_array);
-                free(bs_array);
-                goto exit;
-            }
-        }
-        temp_header->components = comp_array_elements;
-        temp_header->element_size = element_size;
-        if (comp_array_elements > 0)
+        return GTA_OK;
+    }
+    size_t size = (taglist->size > 0 ? taglist->size : 8);
+    while (size < n)
+    {
+        if (size > SIZE_MAX / 2)
         {
-            temp_header->component_types = realloc(comp_array, comp_array_elements * sizeof(uint8_t));
-            if (!temp_header->component_types)
-            {
-                free(comp_array);
-                retval = GTA_SYSTEM_ERROR;
-                goto exit;
-            }
+            return GTA_OVERFLOW;
         }
-        if (bs_array_elements > 0)
+        size *= 2;
+    }
+    if (size > (size_t)SSIZE_MAX || gta_size_overflow(size, sizeof(gta_tag_t)))
+    {
+        return GTA_OVERFLOW;
+    }
+    gta_tag_t *tags = gta_realloc(taglist->tags, size * sizeof(gta_tag_t));
+    if (!tags)
+    {
+        return GTA_SYSTEM_ERROR;
+    }
+    taglist->tags = tags;
+    taglist->size = size;
+    return GTA_OK;
+}
+
+/* Make sure that the index can hold n tags while staying at most half full.
+ * A resized index is filled with the current tags. */
+static GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW
+gta_result_t
+gta_reserve_taglist_index(gta_taglist_t *GTA_RESTRICT taglist, size_t n)
+{
+    if (n <= taglist->index_size / 2)
+    {
+        return GTA_OK;
+    }
+    size_t index_size = (taglist->index_size > 0 ? taglist->index_size : 16);
+    while (n > index_size / 2)
+    {
+        if (index_size > SIZE_MAX / 2)
         {
-            temp_header->component_blob_sizes = realloc(bs_array, bs_array_elements * sizeof(uintmax_t));
-            if (!temp_header->component_blob_sizes)
-            {
-                free(bs_array);
-                retval = GTA_SYSTEM_ERROR;
-                goto exit;
-            }
+            return GTA_OVERFLOW;
         }
+        index_size *= 2;
     }
+    if (gta_size_overflow(index_size, sizeof(ssize_t)))
+    {
+        return GTA_OVERFLOW;
+    }
+    ssize_t *index = gta_malloc(index_size * sizeof(ssize_t));
+    if (!index)
+    {
+        return GTA_SYSTEM_ERROR;
+    }
+    gta_free(taglist->index);
+    taglist->index = index;
+    taglist->index_size = index_size;
+    gta_fill_taglist_index(taglist);
+    return GTA_OK;
+}
 
-    // Read dimension list
+/* Make sure that the last block of the arena has room for n more bytes. If a
+ * new block is needed, the last pending bytes of the current last block, which
+ * belong to an incomplete string, are moved to the new block. Other strings are
+ * never moved. */
+static GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW
+gta_result_t
+gta_reserve_arena(gta_taglist_t *GTA_RESTRICT taglist, size_t n, size_t pending)
+{
+    gta_arena_block_t *last = taglist->arena_last;
+    if (last && n <= last->capacity - last->size)
     {
-        void *dim_array = NULL;
-        size_t dim_array_size = 0;
-        size_t dim_array_elements = 0;
-        uintmax_t data_size = temp_header->element_size;
-        for (;;)
-        {
-            uint64_t size;
-            retval = gta_read_blob_from_chunk(temp_header, read_fn, userdata,
-                    &chunk, &chunk_size, &chunk_index,
-                    &size, sizeof(uint64_t));
-            if (retval != GTA_OK)
-            {
-                free(dim_array);
-                goto exit;
-            }
-            if (gta_data_needs_endianness_swapping(temp_header))
-            {
-                gta_swap_endianness_64(&size);
-            }
-            if (size == 0)
-            {
-                break;
-            }
-            if (gta_uintmax_overflow(data_size, size))
+        return GTA_OK;
+    }
+    if (n > SIZE_MAX - pending)
+    {
+        return GTA_OVERFLOW;
+    }
+    /* Let the block size grow with the live data, so that the number of blocks
+     * stays small. */
+    size_t capacity = pending + n;
+    size_t live = taglist->arena_size - taglist->arena_garbage;
+    if (capacity < live)
+    {
+        capacity = live;
+    }
+    if (capacity < gta_bufsize_inc)
+    {
+        capacity = gta_bufsize_inc;
+    }
+    if (capacity > SIZE_MAX - sizeof(gta_arena_block_t))
+    {
+        return GTA_OVERFLOW;
+    }
+    gta_arena_block_t *block = gta_malloc(sizeof(gta_arena_block_t) + capacity);
+    if (!block)
+    {
+        return GTA_SYSTEM_ERROR;
+    }
+    block->prev = last;
+    block->next = NULL;
+    block->size = 0;
+    block->capacity = capacity;
+    block->garbage = 0;
+    if (last)
+    {
+        memcpy(block->data, last->data + last->size - pending, pending);
+        block->size = pending;
+        last->size -= pending;
+        if (last->size == 0)
+        {
+            /* The last block held nothing else; replace it */
+            block->prev = last->prev;
+            if (last->prev)
             {
-                retval = GTA_OVERFLOW;
-                free(dim_array);
-                goto exit;
+                last->prev->next = block;
             }
-            data_size *= size;
-            uintmax_t bigsize = size;
-            retval = gta_append_element_to_array(
-                    &dim_array, &dim_array_size, &dim_array_elements,
-                    &bigsize, sizeof(uintmax_t));
-            if (retval != GTA_OK)
+            else
             {
-                free(dim_array);
-                goto exit;
+                taglist->arena = block;
             }
+            gta_free(last);
         }
-        temp_header->dimensions = dim_array_elements;
-        if (dim_array_elements > 0)
+        else
         {
-            temp_header->dimension_sizes = realloc(dim_array, dim_array_elements * sizeof(uintmax_t));
-            if (!temp_header->dimension_sizes)
-            {
-                free(dim_array);
-                retval = GTA_SYSTEM_ERROR;
-                goto exit;
-            }
+            last->next = block;
         }
     }
+    else
+    {
+        taglist->arena = block;
+    }
+    taglist->arena_last = block;
+    return GTA_OK;
+}
 
-    // Read tag lists
+/* Append a string of the given length and its terminator to the last block of
+ * the arena, which must have room for it. Returns the copy of the string. */
+static GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW
+char *
+gta_append_to_arena(gta_taglist_t *GTA_RESTRICT taglist, const char *s, size_t len)
+{
+    gta_arena_block_t *last = taglist->arena_last;
+    char *p = last->data + last->size;
+    memcpy(p, s, len);
+    p[len] = '\0';
+    last->size += len + 1;
+    taglist->arena_size += len + 1;
+    return p;
+}
+
+/* Mark a string of the given size, including its terminator, as garbage. A
+ * block that holds only garbage is freed, or emptied if it is the last block. */
+static GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW
+void
+gta_remove_from_arena(gta_taglist_t *GTA_RESTRICT taglist, gta_arena_block_t *GTA_RESTRICT block, size_t size)
+{
+    block->garbage += size;
+    taglist->arena_garbage += size;
+    if (block->garbage < block->size)
     {
-        gta_taglist_t *taglist;
-        retval = gta_read_taglist_from_chunk(header, read_fn, userdata,
-                &chunk, &chunk_size, &chunk_index, &taglist);
-        if (retval != GTA_OK)
+        return;
+    }
+    taglist->arena_size -= block->size;
+    taglist->arena_garbage -= block->garbage;
+    if (block == taglist->arena_last)
+    {
+        block->size = 0;
+        block->garbage = 0;
+    }
+    else
+    {
+        if (block->prev)
         {
-            goto exit;
+            block->prev->next = block->next;
         }
-        gta_destroy_taglist(temp_header->global_taglist);
-        free(temp_header->global_taglist);
-        temp_header->global_taglist = taglist;
-        void *tl_array = NULL;
-        size_t tl_array_size = 0;
-        size_t tl_array_elements = 0;
-        for (size_t i = 0; i < temp_header->components; i++)
+        else
         {
-            taglist = NULL;
-            if ((retval = gta_read_taglist_from_chunk(header, read_fn, userdata,
-                            &chunk, &chunk_size, &chunk_index, &taglist)) != GTA_OK
-                    || (retval = gta_append_element_to_array(
-                            &tl_array, &tl_array_size, &tl_array_elements,
-                            &taglist, sizeof(gta_taglist_t *))) != GTA_OK)
+            taglist->arena = block->next;
+        }
+        block->next->prev = block->prev;
+        gta_free(block);
+    }
+}
+
+
+/*
+ *
+ * Access Tag Lists
+ *
+ */
+
+/* Word-at-a-time byte tests for the ASCII fast path of gta_check_utf8(). The
+ * tests are only exact if all bytes in the word are below 0x80, which is checked
+ * first. A false positive only sends the word to the byte-wise path. */
+static const uint64_t gta_word_ones = UINT64_C(0x0101010101010101);
+static const uint64_t gta_word_highs = UINT64_C(0x8080808080808080);
+
+static GTA_ATTR_CONST GTA_ATTR_NOTHROW
+bool
+gta_word_has_less(uint64_t w, unsigned int n)
+{
+    return ((w - gta_word_ones * n) & ~w & gta_word_highs) != 0;
+}
+
+static GTA_ATTR_CONST GTA_ATTR_NOTHROW
+bool
+gta_word_has_value(uint64_t w, unsigned int n)
+{
+    return gta_word_has_less(w ^ (gta_word_ones * n), 1);
+}
+
+/**
+ * \brief                               Check if a string is valid UTF-8 and fulfills some given requirements.
+ * \param s                             The string.
+ * \param len                           The length of the string, without the terminating null character.
+ * \param allow_control_characters      Whether the string is allowed to contain control characters.
+ * \param allow_equal_sign              Whether the string is allowed to contain the equal sign '='.
+ * \param allow_empty_string            Whether the string is allowed to be empty.
+ * \return                              True if the string is valid UTF-8 and fulfills the given requirements, false otherwise.
+ *
+ * Runs of plain ASCII are checked eight bytes at a time.
+ */
+static GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL
+bool
+gta_check_utf8(const char *s, size_t len, bool allow_control_characters, bool allow_equal_sign, bool allow_empty_string)
+{
+    const unsigned char *data = (const unsigned char *)s;
+    size_t i = 0;
+    int multibyte_case = 0;
+    int continuation_bytes = 0;
+    unsigned int multibyte_val = 0;
+    bool error = false;
+
+    if (len == 0)
+    {
+        return allow_empty_string;
+    }
+    while (i < len)
+    {
+        if (continuation_bytes == 0 && len - i >= sizeof(uint64_t))
+        {
+            uint64_t w;
+            memcpy(&w, data + i, sizeof(uint64_t));
+            if (!(w & gta_word_highs)
+                    && (allow_control_characters
+                        || (!gta_word_has_less(w, 0x20) && !gta_word_has_value(w, 0x7f)))
+                    && (allow_equal_sign || !gta_word_has_value(w, '=')))
             {
-                if (taglist)
-                {
-                    gta_destroy_taglist(taglist);
-                }
-                for (size_t j = 0; j < i; j++)
-                {
-                    gta_taglist_t *tl = ((gta_taglist_t **)tl_array)[j];
-                    gta_destroy_taglist(tl);
-                    free(tl);
-                }
-                free(tl_array);
-                goto exit;
+                i += sizeof(uint64_t);
+                continue;
             }
         }
-        if (tl_array_elements > 0)
+        unsigned char c = data[i++];
+        if (c < 0x80)
         {
-            temp_header->component_taglists = realloc(tl_array, tl_array_elements * sizeof(gta_taglist_t *));
-            if (!temp_header->component_taglists)
+            if (continuation_bytes > 0 || c == 0x00)
             {
-                free(tl_array);
-                retval = GTA_SYSTEM_ERROR;
-                goto exit;
+                error = true;
+                break;
+            }
+            if ((c < 0x20 || c == 0x7f) && !allow_control_characters)
+            {
+                error = true;
+                break;
+            }
+            if (c == '=' && !allow_equal_sign)
+            {
+                error = true;
+                break;
             }
         }
-        tl_array = NULL;
-        tl_array_size = 0;
-        tl_array_elements = 0;
-        for (size_t i = 0; i < temp_header->dimensions; i++)
+        else if (c < 0xc0)
         {
-            taglist = NULL;
-            if ((retval = gta_read_taglist_from_chunk(header, read_fn, userdata,
-                            &chunk, &chunk_size, &chunk_index, &taglist)) != GTA_OK
-                    || (retval = gta_append_element_to_array(
-                            &tl_array, &tl_array_size, &tl_array_elements,
-                            &taglist, sizeof(gta_taglist_t *))) != GTA_OK)
+            if (continuation_bytes > 0)
             {
-                if (taglist)
-                {
-                    gta_destroy_taglist(taglist);
-                }
-                for (size_t j = 0; j < i; j++)
+                multibyte_val = (multibyte_val << 6u) | (c & 0x3f);
+                continuation_bytes--;
+                if (continuation_bytes == 0)
                 {
-                    gta_taglist_t *tl = ((gta_taglist_t **)tl_array)[j];
-                    gta_destroy_taglist(tl);
-                    free(tl);
+                    if ((multibyte_case == 2 && multibyte_val < 0x80)
+                            || (multibyte_case == 3 && multibyte_val < 0x800)
+                            || (multibyte_case == 4 && multibyte_val < 0x10000)
+                            || multibyte_val > 0x10ffff)
+                    {
+                        error = true;
+                        break;
+                    }
                 }
-                free(tl_array);
-                goto exit;
             }
-        }
-        if (tl_array_elements > 0)
-        {
-            temp_header->dimension_taglists = realloc(tl_array, tl_array_elements * sizeof(gta_taglist_t *));
-            if (!temp_header->dimension_taglists)
+            else
             {
-                free(tl_array);
-                retval = GTA_SYSTEM_ERROR;
-                goto exit;
+                error = true;
+                break;
             }
         }
-    }
-
-    // Make sure that the chunk is now empty
-    if (chunk_index != chunk_size)
-    {
-        retval = GTA_INVALID_DATA;
-        goto exit;
-    }
-
-    // Read an empty chunk that marks the end of the chunk list
-    free(chunk);
-    chunk = NULL;
-    retval = gta_read_chunk(header, &chunk, &chunk_size, read_fn, userdata);
-    if (retval != GTA_OK)
-    {
-        goto exit;
-    }
-    if (chunk_size != 0)
-    {
-        retval = GTA_INVALID_DATA;
-        goto exit;
-    }
-
-exit:
-    if (retval == GTA_OK)
-    {
-        gta_destroy_taglist(header->global_taglist);
-        free(header->global_taglist);
-        free(header->component_types);
-        free(header->component_blob_sizes);
-        for (size_t i = 0; i < header->components; i++)
+        else if (c < 0xc2)
         {
-            gta_destroy_taglist(header->component_taglists[i]);
-            free(header->component_taglists[i]);
+            error = true;
+            break;
         }
-        free(header->component_taglists);
-        free(header->dimension_sizes);
-        for (size_t i = 0; i < header->dimensions; i++)
+        else if (c < 0xe0)
         {
-            gta_destroy_taglist(header->dimension_taglists[i]);
-            free(header->dimension_taglists[i]);
+            if (continuation_bytes == 0)
+            {
+                multibyte_case = 2;
+                multibyte_val = (c & 0x1f);
+                continuation_bytes = 1;
+            }
+            else
+            {
+                error = true;
+                break;
+            }
         }
-        free(header->dimension_taglists);
-        memcpy(header, temp_header, sizeof(gta_header_t));
-    }
-    else
-    {
-        gta_destroy_taglist(temp_header->global_taglist);
-        free(temp_header->global_taglist);
-        free(temp_header->component_types);
-        free(temp_header->component_blob_sizes);
-        if (temp_header->component_taglists)
+        else if (c < 0xf0)
         {
-            for (size_t i = 0; i < temp_header->components; i++)
+            if (continuation_bytes == 0)
             {
-                gta_destroy_taglist(temp_header->component_taglists[i]);
-                free(temp_header->component_taglists[i]);
+                multibyte_case = 3;
+                multibyte_val = (c & 0x0f);
+                continuation_bytes = 2;
+            }
+            else
+            {
+                error = true;
+                break;
             }
-            free(temp_header->component_taglists);
         }
-        free(temp_header->dimension_sizes);
-        if (temp_header->dimension_taglists)
+        else if (c < 0xf5)
         {
-            for (size_t i = 0; i < temp_header->dimensions; i++)
+            if (continuation_bytes == 0)
             {
-                gta_destroy_taglist(temp_header->dimension_taglists[i]);
-                free(temp_header->dimension_taglists[i]);
+                multibyte_case = 4;
+                multibyte_val = (c & 0x07);
+                continuation_bytes = 3;
+            }
+            else
+            {
+                error = true;
+                break;
             }
-            free(temp_header->dimension_taglists);
+        }
+        else // (c <= 0xff)
+        {
+            error = true;
+            break;
         }
     }
-    free(temp_header);
-    return retval;
+    if (continuation_bytes > 0)
+    {
+        error = true;
+    }
+
+    return !error;
 }
 
-gta_result_t
-gta_read_header_from_stream(gta_header_t *GTA_RESTRICT header, FILE *GTA_RESTRICT f)
+/**
+ * \brief Check if a string is a valid tag name.
+ * \param name  The string.
+ * \param len   The length of the string.
+ * \return      True if the string is a valid tag name, false otherwise.
+ */
+static GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL
+bool
+gta_check_tag_name(const char *name, size_t len)
 {
-    return gta_read_header(header, gta_read_stream, (intptr_t)f);
+    return gta_check_utf8(name, len, false, false, false);
 }
 
-gta_result_t
-gta_read_header_from_fd(gta_header_t *GTA_RESTRICT header, int fd)
+/**
+ * \brief Check if a string is a valid tag value.
+ * \param value The string.
+ * \param len   The length of the string.
+ * \return      True if the string is a valid tag value, false otherwise.
+ */
+static GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL
+bool
+gta_check_tag_value(const char *value, size_t len)
 {
-    return gta_read_header(header, gta_read_fd, fd);
+    return gta_check_utf8(value, len, false, true, true);
 }
 
-static GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL
-gta_result_t
-gta_write_blob_to_chunk(const gta_header_t *GTA_RESTRICT header, gta_write_t write_fn, intptr_t userdata,
-        void *chunk, size_t chunk_size, size_t *chunk_index,
-        const void *blob, size_t blob_size)
+uintmax_t
+gta_get_tags(const gta_taglist_t *GTA_RESTRICT taglist)
 {
-    gta_result_t retval = GTA_OK;
-    const char *cblob = blob;
-    char *cchunk = chunk;
-    for (size_t i = 0; i < blob_size; i++)
-    {
-        cchunk[(*chunk_index)++] = cblob[i];
-        if (*chunk_index == chunk_size)
-        {
-            retval = gta_write_chunk(header, chunk, *chunk_index, write_fn, userdata);
-            if (retval != GTA_OK)
-            {
-                return retval;
-            }
-            *chunk_index = 0;
-        }
-    }
-    return retval;
+    return taglist->entries;
 }
 
-static GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL
-gta_result_t
-gta_write_taglist_to_chunk(const gta_header_t *GTA_RESTRICT header, gta_write_t write_fn, intptr_t userdata,
-        void *chunk, size_t chunk_size, size_t *chunk_index, const gta_taglist_t *GTA_RESTRICT taglist)
+const char *
+gta_get_tag_name(const gta_taglist_t *GTA_RESTRICT taglist, uintmax_t i)
 {
-    gta_result_t retval = GTA_OK;
-    for (uintmax_t i = 0; i < gta_get_tags(taglist); i++)
-    {
-        const char *name = gta_get_tag_name(taglist, i);
-        retval = gta_write_blob_to_chunk(header, write_fn, userdata, chunk, chunk_size, chunk_index,
-                name, strlen(name) + 1);
-        if (retval != GTA_OK)
-        {
-            return retval;
-        }
-        const char *value = gta_get_tag_value(taglist, i);
-        retval = gta_write_blob_to_chunk(header, write_fn, userdata, chunk, chunk_size, chunk_index,
-                value, strlen(value) + 1);
-        if (retval != GTA_OK)
-        {
-            return retval;
-        }
+    return taglist->tags[i].name;
+}
+
+const char *
+gta_get_tag_value(const gta_taglist_t *GTA_RESTRICT taglist, uintmax_t i)
+{
+    return taglist->tags[i].value;
+}
+
+const char *
+gta_get_tag(const gta_taglist_t *GTA_RESTRICT taglist, const char *GTA_RESTRICT name)
+{
+    if (taglist->entries == 0)
+    {
+        return NULL;
     }
-    char taglist_end = '\0';
-    retval = gta_write_blob_to_chunk(header, write_fn, userdata, chunk, chunk_size, chunk_index,
-            &taglist_end, sizeof(char));
-    return retval;
+    size_t name_len;
+    uint32_t hash = gta_tag_hash(name, &name_len);
+    ssize_t e = taglist->index[gta_find_tag_slot(taglist, name, hash)];
+    return (e >= 0 ? taglist->tags[e].value : NULL);
 }
 
 gta_result_t
-gta_write_header(const gta_header_t *GTA_RESTRICT header, gta_write_t write_fn, intptr_t userdata)
+gta_set_tag(gta_taglist_t *GTA_RESTRICT taglist, const char *GTA_RESTRICT name, const char *GTA_RESTRICT value)
 {
-    uint8_t firstblock[6];
-    int output_error = false;
-    gta_result_t retval = GTA_OK;
-    size_t r;
-
-    /* Write first block */
-    firstblock[0] = 'G';
-    firstblock[1] = 'T';
-    firstblock[2] = 'A';
-    firstblock[3] = 1;
-    firstblock[4] = 0;
-#if WORDS_BIGENDIAN
-    firstblock[4] |= 0x01;
-#endif
-    if (header->compression != GTA_NONE)
+    /* The name and value may point into this tag list. This is safe because
+     * strings in the arena are never moved, and the old value of a tag is only
+     * removed after the new one was copied. */
+    size_t name_len;
+    size_t value_len = strlen(value);
+    uint32_t hash = gta_tag_hash(name, &name_len);
+    if (!gta_check_tag_name(name, name_len) || !gta_check_tag_value(value, value_len))
     {
-        // This is only here so that libgta versions <= 0.9.2 can read files created by this libgta version.
-        firstblock[4] |= 0x02;
+        return GTA_INVALID_DATA;
     }
-    firstblock[5] = header->compression;
-    errno = 0;
-    r = write_fn(userdata, firstblock, 6, &output_error);
-    if (output_error || r < 6)
+    gta_result_t retval;
+
+    if (taglist->entries > 0)
     {
-        if (errno == 0)
+        ssize_t e = taglist->index[gta_find_tag_slot(taglist, name, hash)];
+        if (e >= 0)
         {
-            errno = EIO;
+            if (value_len > SIZE_MAX - 1)
+            {
+                return GTA_OVERFLOW;
+            }
+            if ((retval = gta_reserve_arena(taglist, value_len + 1, 0)) != GTA_OK)
+            {
+                return retval;
+            }
+            gta_tag_t *tag = taglist->tags + e;
+            char *old_value = tag->value;
+            gta_arena_block_t *old_value_block = tag->value_block;
+            tag->value = gta_append_to_arena(taglist, value, value_len);
+            tag->value_block = taglist->arena_last;
+            gta_remove_from_arena(taglist, old_value_block, strlen(old_value) + 1);
+            taglist->changes++;
+            return GTA_OK;
         }
-        return GTA_SYSTEM_ERROR;
     }
 
-    /* Write rest of header in chunklist */
-
-    // Compute required space for header
-    size_t required_size = 6;
-    required_size += header->components * sizeof(uint8_t);
-    required_size += 1 * sizeof(uint8_t);
-    for (size_t i = 0; i < header->components; i++)
+    if (taglist->entries == SSIZE_MAX
+            || value_len > SIZE_MAX - 2 || name_len > SIZE_MAX - 2 - value_len)
     {
-        required_size += header->component_taglists[i]->encoded_size;
-        if (header->component_types[i] == GTA_BLOB)
-        {
-            required_size += sizeof(uint64_t);
-        }
+        return GTA_OVERFLOW;
     }
-    required_size += header->dimensions * sizeof(uint64_t);
-    required_size += 1 * sizeof(uint64_t);
-    for (size_t i = 0; i < header->dimensions; i++)
+    if ((retval = gta_reserve_tags(taglist, taglist->entries + 1)) != GTA_OK
+            || (retval = gta_reserve_taglist_index(taglist, taglist->entries + 1)) != GTA_OK
+            || (retval = gta_reserve_arena(taglist, name_len + 1 + value_len + 1, 0)) != GTA_OK)
     {
-        required_size += header->dimension_taglists[i]->encoded_size;
+        return retval;
     }
-    required_size += header->global_taglist->encoded_size;
-    // Allocate a chunk
-    void *chunk = NULL;
-    size_t chunk_size = 0;
-    size_t chunk_index = 0;
-    chunk_size = (required_size < gta_max_chunk_size ? required_size : gta_max_chunk_size);
-    chunk = malloc(chunk_size);
-    if (!chunk)
+    gta_tag_t *tag = taglist->tags + taglist->entries;
+    tag->name = gta_append_to_arena(taglist, name, name_len);
+    tag->value = gta_append_to_arena(taglist, value, value_len);
+    tag->name_block = taglist->arena_last;
+    tag->value_block = taglist->arena_last;
+    tag->hash = hash;
+    taglist->index[gta_find_tag_slot(taglist, tag->name, hash)] = taglist->entries;
+    taglist->entries++;
+    taglist->changes++;
+    return GTA_OK;
+}
+
+gta_result_t
+gta_unset_tag(gta_taglist_t *GTA_RESTRICT taglist, const char *GTA_RESTRICT name)
+{
+    if (taglist->entries == 0)
     {
-        retval = GTA_SYSTEM_ERROR;
-        goto exit;
+        return GTA_OK;
     }
+    size_t name_len;
+    uint32_t hash = gta_tag_hash(name, &name_len);
+    ssize_t e = taglist->index[gta_find_tag_slot(taglist, name, hash)];
+    if (e < 0)
+    {
+        return GTA_OK;
+    }
+    gta_tag_t tag = taglist->tags[e];
+    memmove(taglist->tags + e, taglist->tags + e + 1, (taglist->entries - e - 1) * sizeof(gta_tag_t));
+    taglist->entries--;
+    gta_fill_taglist_index(taglist);
+    /* The name may point to the removed tag, so its length was computed first. */
+    gta_remove_from_arena(taglist, tag.name_block, name_len + 1);
+    gta_remove_from_arena(taglist, tag.value_block, strlen(tag.value) + 1);
+    taglist->changes++;
+    return GTA_OK;
+}
 
-    // Write component list
-    size_t blob_size_index = 0;
-    for (size_t i = 0; i < header->components; i++)
+void
+gta_unset_all_tags(gta_taglist_t *GTA_RESTRICT taglist)
+{
+    uintmax_t changes = taglist->changes;
+    gta_destroy_taglist(taglist);
+    gta_create_taglist(taglist);
+    taglist->changes = changes + 1;
+}
+
+gta_result_t
+gta_clone_taglist(gta_taglist_t *GTA_RESTRICT dst_taglist,
+        const gta_taglist_t *GTA_RESTRICT src_taglist)
+{
+    /* The copy stores all strings in a single block, without garbage. */
+    gta_taglist_t tmp_taglist;
+    gta_create_taglist(&tmp_taglist);
+    if (src_taglist->entries > 0)
     {
-        uint8_t type = header->component_types[i];
-        retval = gta_write_blob_to_chunk(header, write_fn, userdata, chunk, chunk_size, &chunk_index,
-                &type, sizeof(uint8_t));
+        size_t size = src_taglist->arena_size - src_taglist->arena_garbage;
+        gta_result_t retval = gta_reserve_arena(&tmp_taglist, size, 0);
         if (retval != GTA_OK)
         {
-            goto exit;
+            return retval;
         }
-        if (type == GTA_BLOB)
+        tmp_taglist.tags = gta_malloc(src_taglist->entries * sizeof(gta_tag_t));
+        tmp_taglist.index = gta_malloc(src_taglist->index_size * sizeof(ssize_t));
+        if (!tmp_taglist.tags || !tmp_taglist.index)
         {
-            uint64_t blob_size = header->component_blob_sizes[blob_size_index];
-            retval = gta_write_blob_to_chunk(header, write_fn, userdata, chunk, chunk_size, &chunk_index,
-                    &blob_size, sizeof(uint64_t));
-            if (retval != GTA_OK)
-            {
-                goto exit;
-            }
-            blob_size_index++;
+            gta_destroy_taglist(&tmp_taglist);
+            return GTA_SYSTEM_ERROR;
+        }
+        for (ssize_t i = 0; i < src_taglist->entries; i++)
+        {
+            const gta_tag_t *src_tag = src_taglist->tags + i;
+            gta_tag_t *tag = tmp_taglist.tags + i;
+            tag->name = gta_append_to_arena(&tmp_taglist, src_tag->name, strlen(src_tag->name));
+            tag->value = gta_append_to_arena(&tmp_taglist, src_tag->value, strlen(src_tag->value));
+            tag->name_block = tmp_taglist.arena_last;
+            tag->value_block = tmp_taglist.arena_last;
+            tag->hash = src_tag->hash;
         }
+        memcpy(tmp_taglist.index, src_taglist->index, src_taglist->index_size * sizeof(ssize_t));
+        tmp_taglist.entries = src_taglist->entries;
+        tmp_taglist.size = src_taglist->entries;
+        tmp_taglist.index_size = src_taglist->index_size;
     }
-    uint8_t componentlist_end = 0xff;
-    retval = gta_write_blob_to_chunk(header, write_fn, userdata, chunk, chunk_size, &chunk_index,
-            &componentlist_end, sizeof(uint8_t));
-    if (retval != GTA_OK)
+    tmp_taglist.changes = dst_taglist->changes + 1;
+    gta_destroy_taglist(dst_taglist);
+    memcpy(dst_taglist, &tmp_taglist, sizeof(gta_taglist_t));
+    return GTA_OK;
+}
+
+/*
+ *
+ * Initialization and Deinitialization of Headers
+ *
+ */
+
+
+/* The total number of changes of all tag lists of a header. Since the counts only
+ * grow, a different total means that at least one tag list was modified. */
+static GTA_ATTR_NONNULL_ALL GTA_ATTR_PURE GTA_ATTR_NOTHROW
+uintmax_t
+gta_get_taglist_changes(const gta_header_t *GTA_RESTRICT header)
+{
+    uintmax_t changes = header->global_taglist->changes;
+    for (size_t i = 0; i < header->components; i++)
     {
-        goto exit;
+        changes += header->component_taglists[i]->changes;
     }
-
-    // Write dimension list
     for (size_t i = 0; i < header->dimensions; i++)
     {
-        uint64_t dimension_size = header->dimension_sizes[i];
-        retval = gta_write_blob_to_chunk(header, write_fn, userdata, chunk, chunk_size, &chunk_index,
-                &dimension_size, sizeof(uint64_t));
-        if (retval != GTA_OK)
-        {
-            goto exit;
-        }
+        changes += header->dimension_taglists[i]->changes;
     }
-    uint64_t dimensionlist_end = 0;
-    retval = gta_write_blob_to_chunk(header, write_fn, userdata, chunk, chunk_size, &chunk_index,
-            &dimensionlist_end, sizeof(uint64_t));
+    return changes;
+}
+
+/* Drop the encoded header; must be called whenever the header is modified. */
+static GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW
+void
+gta_invalidate_encoded_header(gta_header_t *GTA_RESTRICT header)
+{
+    gta_free(header->encoded);
+    header->encoded = NULL;
+    header->encoded_size = 0;
+}
+
+
+gta_result_t
+gta_create_header(gta_header_t *GTA_RESTRICT *GTA_RESTRICT header)
+{
+    *header = gta_malloc(sizeof(gta_header_t));
+    if (!*header)
+    {
+        return GTA_SYSTEM_ERROR;
+    }
+    gta_header_t *GTA_RESTRICT hdr = *header;
+    hdr->host_endianness = true;
+    hdr->compression = GTA_NONE;
+    hdr->filter = GTA_FILTER_NONE;
+    hdr->global_taglist = gta_malloc(sizeof(gta_taglist_t));
+    if (!hdr->global_taglist)
+    {
+        gta_free(hdr);
+        return GTA_SYSTEM_ERROR;
+    }
+    gta_create_taglist(hdr->global_taglist);
+    hdr->components = 0;
+    hdr->component_types = NULL;
+    hdr->component_blob_sizes = NULL;
+    hdr->component_taglists = NULL;
+    hdr->element_size = 0;
+    hdr->component_offsets = NULL;
+    hdr->swap_runs = NULL;
+    hdr->swap_runs_count = 0;
+    hdr->dimensions = 0;
+    hdr->dimension_sizes = NULL;
+    hdr->dimension_taglists = NULL;
+    hdr->elements = 0;
+    hdr->data_size = 0;
+    hdr->compression_threads = 0;
+    hdr->decompression_threads = 0;
+    hdr->encoded = NULL;
+    hdr->encoded_size = 0;
+    hdr->encoded_changes = 0;
+    return GTA_OK;
+}
+
+gta_result_t
+gta_clone_header(gta_header_t *GTA_RESTRICT dst_header,
+        const gta_header_t *GTA_RESTRICT src_header)
+{
+    gta_result_t retval;
+    gta_header_t *temp_header;
+
+    retval = gta_create_header(&temp_header);
     if (retval != GTA_OK)
     {
-        goto exit;
+        return retval;
     }
 
-    // Write tag lists
-    retval = gta_write_taglist_to_chunk(header, write_fn, userdata, chunk, chunk_size, &chunk_index,
-            header->global_taglist);
+    temp_header->host_endianness = src_header->host_endianness;
+    temp_header->compression = src_header->compression;
+    temp_header->filter = src_header->filter;
+    temp_header->compression_threads = src_header->compression_threads;
+    temp_header->decompression_threads = src_header->decompression_threads;
+    retval = gta_clone_taglist(temp_header->global_taglist, src_header->global_taglist);
     if (retval != GTA_OK)
     {
         goto exit;
     }
-    for (size_t i = 0; i < header->components; i++)
+    gta_type_t *types = gta_malloc(src_header->components * sizeof(gta_type_t));
+    if (!types)
     {
-        retval = gta_write_taglist_to_chunk(header, write_fn, userdata, chunk, chunk_size, &chunk_index,
-                header->component_taglists[i]);
-        if (retval != GTA_OK)
-        {
-            goto exit;
-        }
+        retval = GTA_SYSTEM_ERROR;
+        goto exit;
     }
-    for (size_t i = 0; i < header->dimensions; i++)
+    for (uintmax_t i = 0; i < src_header->components; i++)
     {
-        retval = gta_write_taglist_to_chunk(header, write_fn, userdata, chunk, chunk_size, &chunk_index,
-                header->dimension_taglists[i]);
+        types[i] = src_header->component_types[i];
+    }
+    retval = gta_set_components(temp_header, src_header->components,
+            types, src_header->component_blob_sizes);
+    gta_free(types);
+    if (retval != GTA_OK)
+    {
+        goto exit;
+    }
+    for (uintmax_t i = 0; i < src_header->components; i++)
+    {
+        retval = gta_clone_taglist(temp_header->component_taglists[i], src_header->component_taglists[i]);
         if (retval != GTA_OK)
         {
             goto exit;
         }
     }
-
-    // Flush the chunk
-    if (chunk_index > 0)
+    retval = gta_set_dimensions(temp_header, src_header->dimensions, src_header->dimension_sizes);
+    if (retval != GTA_OK)
+    {
+        goto exit;
+    }
+    for (uintmax_t i = 0; i < src_header->dimensions; i++)
     {
-        retval = gta_write_chunk(header, chunk, chunk_index, write_fn, userdata);
+        retval = gta_clone_taglist(temp_header->dimension_taglists[i], src_header->dimension_taglists[i]);
         if (retval != GTA_OK)
         {
             goto exit;
         }
     }
-
-    // An empty chunk marks the end
-    retval = gta_write_chunk(header, NULL, 0, write_fn, userdata);
-    if (retval != GTA_OK)
+    // Copy a valid encoding, since the clone is often written next. Failure is harmless.
+    gta_encoded_header_lock();
+    if (src_header->encoded && src_header->encoded_changes == gta_get_taglist_changes(src_header))
     {
-        goto exit;
+        temp_header->encoded = gta_malloc(src_header->encoded_size);
+        if (temp_header->encoded)
+        {
+            memcpy(temp_header->encoded, src_header->encoded, src_header->encoded_size);
+            temp_header->encoded_size = src_header->encoded_size;
+            temp_header->encoded_changes = gta_get_taglist_changes(temp_header);
+        }
     }
+    gta_encoded_header_unlock();
 
 exit:
-    free(chunk);
-    return retval;
-}
-
-gta_result_t
-gta_write_header_to_stream(const gta_header_t *GTA_RESTRICT header, FILE *GTA_RESTRICT f)
-{
-    return gta_write_header(header, gta_write_stream, (intptr_t)f);
-}
+    if (retval == GTA_OK)
+    {
+        gta_destroy_taglist(dst_header->global_taglist);
+        gta_free(dst_header->global_taglist);
+        gta_free(dst_header->component_types);
+        gta_free(dst_header->component_blob_sizes);
+        gta_free(dst_header->component_offsets);
+        gta_free(dst_header->swap_runs);
+        for (uintmax_t i = 0; i < dst_header->components; i++)
+        {
+            gta_destroy_taglist(dst_header->component_taglists[i]);
+            gta_free(dst_header->component_taglists[i]);
+        }
+        gta_free(dst_header->component_taglists);
+        gta_free(dst_header->dimension_sizes);
+        for (uintmax_t i = 0; i < dst_header->dimensions; i++)
+        {
+            gta_destroy_taglist(dst_header->dimension_taglists[i]);
+            gta_free(dst_header->dimension_taglists[i]);
+        }
+        gta_free(dst_header->dimension_taglists);
+        gta_free(dst_header->encoded);
+        memcpy(dst_header, temp_header, sizeof(gta_header_t));
+    }
+    else
+    {
+        if (temp_header->global_taglist)
+        {
+            gta_destroy_taglist(temp_header->global_taglist);
+            gta_free(temp_header->global_taglist);
+        }
+        gta_free(temp_header->component_types);
+        gta_free(temp_header->component_blob_sizes);
+        gta_free(temp_header->component_offsets);
+        gta_free(temp_header->swap_runs);
+        if (temp_header->component_taglists)
+        {
+            for (uintmax_t i = 0; i < temp_header->components; i++)
+            {
+                gta_destroy_taglist(temp_header->component_taglists[i]);
+                gta_free(temp_header->component_taglists[i]);
+            }
+        }
+        gta_free(temp_header->component_taglists);
+        gta_free(temp_header->dimension_sizes);
+        if (temp_header->dimension_taglists)
+        {
+            for (uintmax_t i = 0; i < temp_header->dimensions; i++)
+            {
+                gta_destroy_taglist(temp_header->dimension_taglists[i]);
+                gta_free(temp_header->dimension_taglists[i]);
+            }
+            gta_free(temp_header->dimension_taglists);
+        }
+    }
+    gta_free(temp_header);
+    return retval;
+}
 
-gta_result_t
-gta_write_header_to_fd(const gta_header_t *GTA_RESTRICT header, int fd)
+void
+gta_destroy_header(gta_header_t *GTA_RESTRICT header)
 {
-    return gta_write_header(header, gta_write_fd, fd);
+    gta_destroy_taglist(header->global_taglist);
+    gta_free(header->global_taglist);
+    gta_free(header->component_types);
+    gta_free(header->component_blob_sizes);
+    gta_free(header->component_offsets);
+    gta_free(header->swap_runs);
+    for (uintmax_t i = 0; i < header->components; i++)
+    {
+        gta_destroy_taglist(header->component_taglists[i]);
+        gta_free(header->component_taglists[i]);
+    }
+    gta_free(header->component_taglists);
+    gta_free(header->dimension_sizes);
+    for (uintmax_t i = 0; i < header->dimensions; i++)
+    {
+        gta_destroy_taglist(header->dimension_taglists[i]);
+        gta_free(header->dimension_taglists[i]);
+    }
+    gta_free(header->dimension_taglists);
+    gta_free(header->encoded);
+    gta_free(header);
 }
 
 
 /*
  *
- * Access Headers
+ * Read and Write Headers
  *
  */
 
 
-const gta_taglist_t *
-gta_get_global_taglist_const(const gta_header_t *GTA_RESTRICT header)
+static GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW
+gta_result_t
+gta_append_element_to_array(
+        void **array, size_t *array_size, size_t *array_elements,
+        const void *element, size_t element_size)
 {
-    return header->global_taglist;
+    if (*array_elements == *array_size)
+    {
+        /* Grow geometrically so that long arrays are not copied over and over.
+         * On failure, the array is left as it is; the caller frees it. */
+        void *tmp_ptr;
+        size_t inc = (*array_size > gta_bufsize_inc ? *array_size : gta_bufsize_inc);
+        if (*array_size > SIZE_MAX - inc
+                || gta_size_overflow(*array_size + inc, element_size))
+        {
+            return GTA_OVERFLOW;
+        }
+        tmp_ptr = gta_realloc(*array, (*array_size + inc) * element_size);
+        if (!tmp_ptr)
+        {
+            return GTA_SYSTEM_ERROR;
+        }
+        *array = tmp_ptr;
+        *array_size += inc;
+    }
+    void *dst = (char *)(*array) + *array_elements * element_size;
+    memcpy(dst, element, element_size);
+    (*array_elements)++;
+    return GTA_OK;
 }
 
-gta_taglist_t *
-gta_get_global_taglist(gta_header_t *GTA_RESTRICT header)
+/* Read a header chunk. An uncompressed chunk in a memory buffer is not copied; the
+ * chunk then points into the buffer, and must be freed with gta_free_header_chunk(). */
+static GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL
+gta_result_t
+gta_read_header_chunk(const gta_header_t *GTA_RESTRICT header, gta_read_t read_fn, intptr_t userdata,
+        void **chunk, size_t *chunk_size)
 {
-    return header->global_taglist;
-}
+    gta_memory_input_t *m = (gta_memory_input_t *)userdata;
+    uintmax_t offset;
+    uint8_t compression;
+    size_t raw_size;
+    gta_result_t retval;
 
-uintmax_t
-gta_get_element_size(const gta_header_t *GTA_RESTRICT header)
-{
-    return header->element_size;
+    *chunk = NULL;
+    if (read_fn == gta_read_memory)
+    {
+        offset = m->offset;
+        retval = gta_read_chunk_head(header, chunk_size, &compression, &raw_size, read_fn, userdata);
+        if (retval == GTA_OK && *chunk_size > 0 && compression == GTA_NONE)
+        {
+            const void *src = gta_peek_memory(read_fn, userdata, raw_size);
+            if (!src)
+            {
+                *chunk_size = 0;
+                return GTA_UNEXPECTED_EOF;
+            }
+            *chunk = (void *)src;
+            return GTA_OK;
+        }
+        // Read the chunk again the usual way
+        m->offset = offset;
+    }
+    return gta_read_chunk(header, NULL, 0, chunk, chunk_size, read_fn, userdata);
 }
 
-uintmax_t
-gta_get_components(const gta_header_t *GTA_RESTRICT header)
+static GTA_ATTR_NOTHROW
+void
+gta_free_header_chunk(void *chunk, gta_read_t read_fn, intptr_t userdata)
 {
-    return header->components;
+    if (!gta_is_peeked_memory(chunk, read_fn, userdata))
+    {
+        gta_free_chunk(chunk);
+    }
 }
 
-gta_type_t
-gta_get_component_type(const gta_header_t *GTA_RESTRICT header, uintmax_t i)
+/* Make the next header chunk current if the current one is used up. */
+static GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL
+gta_result_t
+gta_next_header_chunk(const gta_header_t *GTA_RESTRICT header, gta_read_t read_fn, intptr_t userdata,
+        void **chunk, size_t *chunk_size, size_t *chunk_index)
 {
-    return header->component_types[i];
+    if (*chunk_index < *chunk_size)
+    {
+        return GTA_OK;
+    }
+    gta_free_header_chunk(*chunk, read_fn, userdata);
+    *chunk = NULL;
+    gta_result_t retval = gta_read_header_chunk(header, read_fn, userdata, chunk, chunk_size);
+    if (retval != GTA_OK)
+    {
+        return retval;
+    }
+    if (*chunk_size == 0)
+    {
+        return GTA_INVALID_DATA;
+    }
+    *chunk_index = 0;
+    return GTA_OK;
 }
 
-uintmax_t
-gta_get_component_size(const gta_header_t *GTA_RESTRICT header, uintmax_t i)
+static GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL
+gta_result_t
+gta_read_blob_from_chunk(const gta_header_t *GTA_RESTRICT header, gta_read_t read_fn, intptr_t userdata,
+        void **chunk, size_t *chunk_size, size_t *chunk_index,
+        void *blob, size_t blob_size)
 {
-    gta_type_t type = header->component_types[i];
-    uintmax_t size = 0;
-    switch (type)
+    char *cblob = blob;
+    while (blob_size > 0)
     {
-    case GTA_INT8:
-    case GTA_UINT8:
-        size = 1;
-        break;
-    case GTA_INT16:
-    case GTA_UINT16:
-        size = 2;
-        break;
-    case GTA_INT32:
-    case GTA_UINT32:
-    case GTA_FLOAT32:
-        size = 4;
-        break;
-    case GTA_INT64:
-    case GTA_UINT64:
-    case GTA_FLOAT64:
-    case GTA_CFLOAT32:
-        size = 8;
-        break;
-    case GTA_INT128:
-    case GTA_UINT128:
-    case GTA_FLOAT128:
-    case GTA_CFLOAT64:
-        size = 16;
-        break;
-    case GTA_CFLOAT128:
-        size = 32;
-        break;
-    case GTA_BLOB:
+        gta_result_t retval = gta_next_header_chunk(header, read_fn, userdata, chunk, chunk_size, chunk_index);
+        if (retval != GTA_OK)
         {
-            size_t blob_size_index = 0;
-            for (size_t j = 0; j < i; j++)
-            {
-                if (header->component_types[j] == GTA_BLOB)
-                {
-                    blob_size_index++;
-                }
-            }
-            size = header->component_blob_sizes[blob_size_index];
+            return retval;
         }
-        break;
+        size_t n = *chunk_size - *chunk_index;
+        if (n > blob_size)
+        {
+            n = blob_size;
+        }
+        memcpy(cblob, (const char *)(*chunk) + *chunk_index, n);
+        *chunk_index += n;
+        cblob += n;
+        blob_size -= n;
     }
-    return size;
-}
-
-const gta_taglist_t *
-gta_get_component_taglist_const(const gta_header_t *GTA_RESTRICT header, uintmax_t i)
-{
-    return header->component_taglists[i];
+    return GTA_OK;
 }
 
-gta_taglist_t *
-gta_get_component_taglist(gta_header_t *GTA_RESTRICT header, uintmax_t i)
+/*
+ * Append a null-terminated string from the header chunks to the arena of a tag
+ * list. The terminator is located with memchr(), so that a string that lies
+ * within one chunk is copied at once; only strings that span chunk boundaries
+ * are copied piecewise. The string always ends up in the last block.
+ */
+static GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL
+gta_result_t
+gta_read_string_from_chunk(const gta_header_t *GTA_RESTRICT header, gta_read_t read_fn, intptr_t userdata,
+        void **chunk, size_t *chunk_size, size_t *chunk_index,
+        gta_taglist_t *GTA_RESTRICT taglist, char **string, size_t *string_len)
 {
-    return header->component_taglists[i];
+    size_t len = 0;
+    for (;;)
+    {
+        gta_result_t retval = gta_next_header_chunk(header, read_fn, userdata, chunk, chunk_size, chunk_index);
+        if (retval != GTA_OK)
+        {
+            return retval;
+        }
+        const char *p = (const char *)(*chunk) + *chunk_index;
+        size_t n = *chunk_size - *chunk_index;
+        const char *nul = memchr(p, '\0', n);
+        size_t span = (nul ? (size_t)(nul - p) + 1 : n);
+        retval = gta_reserve_arena(taglist, span, len);
+        if (retval != GTA_OK)
+        {
+            return retval;
+        }
+        gta_arena_block_t *last = taglist->arena_last;
+        memcpy(last->data + last->size, p, span);
+        last->size += span;
+        taglist->arena_size += span;
+        len += span;
+        *chunk_index += span;
+        if (nul)
+        {
+            break;
+        }
+    }
+    *string = taglist->arena_last->data + taglist->arena_last->size - len;
+    *string_len = len - 1;
+    return GTA_OK;
 }
 
+/*
+ * Build the index of a tag list whose tags were appended without maintaining
+ * it. If a name occurs more than once, the result is the same as if the tags
+ * had been set one after the other with gta_set_tag(): the first entry keeps
+ * its position and receives the last value.
+ */
+static GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL
 gta_result_t
-gta_set_components(gta_header_t *GTA_RESTRICT header, uintmax_t n,
-        const gta_type_t *GTA_RESTRICT types, const uintmax_t *GTA_RESTRICT sizes)
+gta_index_taglist(gta_taglist_t *GTA_RESTRICT taglist)
 {
-    if (n > UINT64_MAX || n > SIZE_MAX
-            || gta_size_overflow(n, sizeof(uint8_t))
-            || gta_size_overflow(n, sizeof(gta_taglist_t *)))
+    ssize_t entries = taglist->entries;
+    taglist->entries = 0;
+    gta_result_t retval = gta_reserve_taglist_index(taglist, entries);
+    if (retval != GTA_OK)
     {
-        return GTA_OVERFLOW;
+        taglist->entries = entries;
+        return retval;
     }
-
-    uintmax_t element_size = 0;
-    uintmax_t data_size = 0;
-    size_t blobs = 0;
-
-    for (size_t i = 0; i < n; i++)
+    for (ssize_t i = 0; i < entries; i++)
     {
-        uintmax_t size = 0;
-        switch (types[i])
+        gta_tag_t tag = taglist->tags[i];
+        size_t slot = gta_find_tag_slot(taglist, tag.name, tag.hash);
+        ssize_t e = taglist->index[slot];
+        if (e >= 0)
         {
-        case GTA_BLOB:
-            size = sizes[blobs++];
-            if (size < 1 || size > UINT64_MAX)
-            {
-                return GTA_OVERFLOW;
-            }
-            break;
-        case GTA_INT8:
-        case GTA_UINT8:
-            size = 1;
-            break;
-        case GTA_INT16:
-        case GTA_UINT16:
-            size = 2;
-            break;
-        case GTA_INT32:
-        case GTA_UINT32:
-        case GTA_FLOAT32:
-            size = 4;
-            break;
-        case GTA_INT64:
-        case GTA_UINT64:
-        case GTA_FLOAT64:
-        case GTA_CFLOAT32:
-            size = 8;
-            break;
-        case GTA_INT128:
-        case GTA_UINT128:
-        case GTA_FLOAT128:
-        case GTA_CFLOAT64:
-            size = 16;
-            break;
-        case GTA_CFLOAT128:
-            size = 32;
-            break;
-        default:
-            return GTA_UNSUPPORTED_DATA;
-            break;
+            gta_tag_t *first = taglist->tags + e;
+            gta_remove_from_arena(taglist, tag.name_block, strlen(tag.name) + 1);
+            gta_remove_from_arena(taglist, first->value_block, strlen(first->value) + 1);
+            first->value = tag.value;
+            first->value_block = tag.value_block;
         }
-        if (element_size > UINTMAX_MAX - size)
+        else
         {
-            return GTA_OVERFLOW;
+            taglist->tags[taglist->entries] = tag;
+            taglist->index[slot] = taglist->entries;
+            taglist->entries++;
         }
-        element_size += size;
     }
-    data_size = element_size;
+    return GTA_OK;
+}
+
+/*
+ * Read a tag list from the header chunks. Names and values are appended to
+ * the arena straight from the chunk data, and the index is built once at the
+ * end by gta_index_taglist().
+ */
+static GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL
+gta_result_t
+gta_read_taglist_from_chunk(const gta_header_t *GTA_RESTRICT header, gta_read_t read_fn, intptr_t userdata,
+        void **chunk, size_t *chunk_size, size_t *chunk_index,
+        gta_taglist_t **taglist)
+{
+    gta_result_t retval = GTA_OK;
+
+    *taglist = gta_malloc(sizeof(gta_taglist_t));
+    if (!*taglist)
+    {
+        return GTA_SYSTEM_ERROR;
+    }
+    gta_create_taglist(*taglist);
+    gta_taglist_t *tl = *taglist;
+    for (;;)
+    {
+        gta_tag_t tag;
+        size_t name_len, value_len;
+        retval = gta_read_string_from_chunk(header, read_fn, userdata,
+                chunk, chunk_size, chunk_index, tl, &tag.name, &name_len);
+        if (retval != GTA_OK)
+        {
+            goto exit;
+        }
+        tag.name_block = tl->arena_last;
+        if (name_len == 0)
+        {
+            /* Drop the terminator of the list from the arena */
+            tl->arena_last->size--;
+            tl->arena_size--;
+            break;
+        }
+        retval = gta_read_string_from_chunk(header, read_fn, userdata,
+                chunk, chunk_size, chunk_index, tl, &tag.value, &value_len);
+        if (retval != GTA_OK)
+        {
+            goto exit;
+        }
+        tag.value_block = tl->arena_last;
+        if (!gta_check_tag_name(tag.name, name_len)
+                || !gta_check_tag_value(tag.value, value_len))
+        {
+            retval = GTA_INVALID_DATA;
+            goto exit;
+        }
+        if (tl->entries == SSIZE_MAX)
+        {
+            retval = GTA_OVERFLOW;
+            goto exit;
+        }
+        retval = gta_reserve_tags(tl, tl->entries + 1);
+        if (retval != GTA_OK)
+        {
+            goto exit;
+        }
+        tag.hash = gta_tag_hash(tag.name, &name_len);
+        tl->tags[tl->entries++] = tag;
+    }
+    retval = gta_index_taglist(tl);
+
+exit:
+    if (retval != GTA_OK)
+    {
+        gta_destroy_taglist(*taglist);
+        gta_free(*taglist);
+        *taglist = NULL;
+    }
+    return retval;
+}
+
+gta_result_t
+gta_read_header(gta_header_t *GTA_RESTRICT header, gta_read_t read_fn, intptr_t userdata)
+{
+    uint8_t firstblock[6];
+    int input_error = false;
+    void *chunk = NULL;
+    gta_result_t retval = GTA_OK;
+    size_t r;
+
+    /* Use a temp header to avoid changing the given header unless we read everything successfully */
+    gta_header_t *temp_header = NULL;
+    retval = gta_create_header(&temp_header);
+    if (retval != GTA_OK)
+    {
+        return retval;
+    }
+
+    /* Read first block */
+    r = read_fn(userdata, firstblock, 6, &input_error);
+    if (input_error)
+    {
+        retval = GTA_SYSTEM_ERROR;
+        goto exit;
+    }
+    if (r < 6)
+    {
+        retval = GTA_UNEXPECTED_EOF;
+        goto exit;
+    }
+    if (strncmp((char *)firstblock, "GTA", 3) != 0)
+    {
+        retval = GTA_INVALID_DATA;
+        goto exit;
+    }
+    if (firstblock[3] != 1)
+    {
+        retval = GTA_UNSUPPORTED_DATA;
+        goto exit;
+    }
+    if (firstblock[4] & 0xfc)
+    {
+        retval = GTA_UNSUPPORTED_DATA;
+        goto exit;
+    }
+    bool big_endian = (firstblock[4] & 0x01);
+#if WORDS_BIGENDIAN
+    temp_header->host_endianness = big_endian;
+#else
+    temp_header->host_endianness = !big_endian;
+#endif
+    if (!gta_compression_is_supported(gta_chunk_method(firstblock[5])))
+    {
+        retval = GTA_UNSUPPORTED_DATA;
+        goto exit;
+    }
+    if (gta_chunk_method(firstblock[5]) == GTA_NONE && gta_chunk_filter(firstblock[5]) != GTA_FILTER_NONE)
+    {
+        retval = GTA_INVALID_DATA;
+        goto exit;
+    }
+    temp_header->compression = gta_chunk_method(firstblock[5]);
+    temp_header->filter = gta_chunk_filter(firstblock[5]);
+
+    /* Read rest of header from chunk list */
+
+    size_t chunk_size = 0;
+    size_t chunk_index = 0;
+
+    // Read component list
+    {
+        void *comp_array = NULL;
+        size_t comp_array_size = 0;
+        size_t comp_array_elements = 0;
+        void *bs_array = NULL;
+        size_t bs_array_size = 0;
+        size_t bs_array_elements = 0;
+        size_t element_size = 0;
+        for (;;)
+        {
+            uint8_t type;
+            retval = gta_read_blob_from_chunk(temp_header, read_fn, userdata,
+                    &chunk, &chunk_size, &chunk_index,
+                    &type, sizeof(uint8_t));
+            if (retval != GTA_OK)
+            {
+                gta_free(comp_array);
+                gta_free(bs_array);
+                goto exit;
+            }
+            if (type == 0xff)
+            {
+                break;
+            }
+            uint64_t size;
+            switch (type)
+            {
+            case GTA_BLOB:
+                break;
+            case GTA_INT8:
+            case GTA_UINT8:
+                size = 1;
+                break;
+            case GTA_INT16:
+            case GTA_UINT16:
+                size = 2;
+                break;
+            case GTA_INT32:
+            case GTA_UINT32:
+            case GTA_FLOAT32:
+                size = 4;
+                break;
+            case GTA_INT64:
+            case GTA_UINT64:
+            case GTA_FLOAT64:
+            case GTA_CFLOAT32:
+                size = 8;
+                break;
+            case GTA_INT128:
+            case GTA_UINT128:
+            case GTA_FLOAT128:
+            case GTA_CFLOAT64:
+                size = 16;
+                break;
+            case GTA_CFLOAT128:
+                size = 32;
+                break;
+            default:
+                retval = GTA_INVALID_DATA;
+                gta_free(comp_array);
+                gta_free(bs_array);
+                goto exit;
+                break;
+            }
+            if (type == GTA_BLOB)
+            {
+                retval = gta_read_blob_from_chunk(temp_header, read_fn, userdata,
+                        &chunk, &chunk_size, &chunk_index,
+                        &size, sizeof(uint64_t));
+                if (retval != GTA_OK)
+                {
+                    gta_free(comp_array);
+                    gta_free(bs_array);
+                    goto exit;
+                }
+                if (gta_data_needs_endianness_swapping(temp_header))
+                {
+                    gta_swap_endianness_64(&size);
+                }
+                if (size == 0)
+                {
+                    retval = GTA_INVALID_DATA;
+                    gta_free(comp_array);
+                    gta_free(bs_array);
+                    goto exit;
+                }
+                uintmax_t bigsize = size;
+                retval = gta_append_element_to_array(
+                        &bs_array, &bs_array_size, &bs_array_elements,
+                        &bigsize, sizeof(uintmax_t));
+                if (retval != GTA_OK)
+                {
+                    gta_free(comp_array);
+                    gta_free(bs_array);
+                    goto exit;
+                }
+            }
+            if (element_size > UINTMAX_MAX - size)
+            {
+                retval = GTA_OVERFLOW;
+                gta_free(comp_array);
+                gta_free(bs_array);
+                goto exit;
+            }
+            element_size += size;
+            retval = gta_append_element_to_array(
+                    &comp_array, &comp_array_size, &comp_array_elements,
+                    &type, sizeof(uint8_t));
+            if (retval != GTA_OK)
+            {
+                gta_free(comp_array);
+                gta_free(bs_array);
+                goto exit;
+            }
+        }
+        temp_header->components = comp_array_elements;
+        temp_header->element_size = element_size;
+        if (comp_array_elements > 0)
+        {
+            temp_header->component_types = gta_realloc(comp_array, comp_array_elements * sizeof(uint8_t));
+            if (!temp_header->component_types)
+            {
+                gta_free(comp_array);
+                retval = GTA_SYSTEM_ERROR;
+                goto exit;
+            }
+        }
+        if (bs_array_elements > 0)
+        {
+            temp_header->component_blob_sizes = gta_realloc(bs_array, bs_array_elements * sizeof(uintmax_t));
+            if (!temp_header->component_blob_sizes)
+            {
+                gta_free(bs_array);
+                retval = GTA_SYSTEM_ERROR;
+                goto exit;
+            }
+        }
+        retval = gta_create_element_layout(temp_header->components, temp_header->component_types,
+                temp_header->component_blob_sizes, &(temp_header->component_offsets),
+                &(temp_header->swap_runs), &(temp_header->swap_runs_count));
+        if (retval != GTA_OK)
+        {
+            goto exit;
+        }
+    }
+
+    // Read dimension list
+    {
+        void *dim_array = NULL;
+        size_t dim_array_size = 0;
+        size_t dim_array_elements = 0;
+        uintmax_t data_size = temp_header->element_size;
+        uintmax_t elements = 1;
+        for (;;)
+        {
+            uint64_t size;
+            retval = gta_read_blob_from_chunk(temp_header, read_fn, userdata,
+                    &chunk, &chunk_size, &chunk_index,
+                    &size, sizeof(uint64_t));
+            if (retval != GTA_OK)
+            {
+                gta_free(dim_array);
+                goto exit;
+            }
+            if (gta_data_needs_endianness_swapping(temp_header))
+            {
+                gta_swap_endianness_64(&size);
+            }
+            if (size == 0)
+            {
+                break;
+            }
+            if (gta_uintmax_overflow(data_size, size))
+            {
+                retval = GTA_OVERFLOW;
+                gta_free(dim_array);
+                goto exit;
+            }
+            data_size *= size;
+            elements *= size;
+            uintmax_t bigsize = size;
+            retval = gta_append_element_to_array(
+                    &dim_array, &dim_array_size, &dim_array_elements,
+                    &bigsize, sizeof(uintmax_t));
+            if (retval != GTA_OK)
+            {
+                gta_free(dim_array);
+                goto exit;
+            }
+        }
+        temp_header->dimensions = dim_array_elements;
+        temp_header->elements = (dim_array_elements > 0 ? elements : 0);
+        temp_header->data_size = (dim_array_elements > 0 ? data_size : 0);
+        if (dim_array_elements > 0)
+        {
+            temp_header->dimension_sizes = gta_realloc(dim_array, dim_array_elements * sizeof(uintmax_t));
+            if (!temp_header->dimension_sizes)
+            {
+                gta_free(dim_array);
+                retval = GTA_SYSTEM_ERROR;
+                goto exit;
+            }
+        }
+    }
+
+    // Read tag lists
+    {
+        gta_taglist_t *taglist;
+        retval = gta_read_taglist_from_chunk(header, read_fn, userdata,
+                &chunk, &chunk_size, &chunk_index, &taglist);
+        if (retval != GTA_OK)
+        {
+            goto exit;
+        }
+        gta_destroy_taglist(temp_header->global_taglist);
+        gta_free(temp_header->global_taglist);
+        temp_header->global_taglist = taglist;
+        void *tl_array = NULL;
+        size_t tl_array_size = 0;
+        size_t tl_array_elements = 0;
+        for (size_t i = 0; i < temp_header->components; i++)
+        {
+            taglist = NULL;
+            if ((retval = gta_read_taglist_from_chunk(header, read_fn, userdata,
+                            &chunk, &chunk_size, &chunk_index, &taglist)) != GTA_OK
+                    || (retval = gta_append_element_to_array(
+                            &tl_array, &tl_array_size, &tl_array_elements,
+                            &taglist, sizeof(gta_taglist_t *))) != GTA_OK)
+            {
+                if (taglist)
+                {
+                    gta_destroy_taglist(taglist);
+                    gta_free(taglist);
+                }
+                for (size_t j = 0; j < i; j++)
+                {
+                    gta_taglist_t *tl = ((gta_taglist_t **)tl_array)[j];
+                    gta_destroy_taglist(tl);
+                    gta_free(tl);
+                }
+                gta_free(tl_array);
+                goto exit;
+            }
+        }
+        if (tl_array_elements > 0)
+        {
+            temp_header->component_taglists = gta_realloc(tl_array, tl_array_elements * sizeof(gta_taglist_t *));
+            if (!temp_header->component_taglists)
+            {
+                gta_free(tl_array);
+                retval = GTA_SYSTEM_ERROR;
+                goto exit;
+            }
+        }
+        tl_array = NULL;
+        tl_array_size = 0;
+        tl_array_elements = 0;
+        for (size_t i = 0; i < temp_header->dimensions; i++)
+        {
+            taglist = NULL;
+            if ((retval = gta_read_taglist_from_chunk(header, read_fn, userdata,
+                            &chunk, &chunk_size, &chunk_index, &taglist)) != GTA_OK
+                    || (retval = gta_append_element_to_array(
+                            &tl_array, &tl_array_size, &tl_array_elements,
+                            &taglist, sizeof(gta_taglist_t *))) != GTA_OK)
+            {
+                if (taglist)
+                {
+                    gta_destroy_taglist(taglist);
+                    gta_free(taglist);
+                }
+                for (size_t j = 0; j < i; j++)
+                {
+                    gta_taglist_t *tl = ((gta_taglist_t **)tl_array)[j];
+                    gta_destroy_taglist(tl);
+                    gta_free(tl);
+                }
+                gta_free(tl_array);
+                goto exit;
+            }
+        }
+        if (tl_array_elements > 0)
+        {
+            temp_header->dimension_taglists = gta_realloc(tl_array, tl_array_elements * sizeof(gta_taglist_t *));
+            if (!temp_header->dimension_taglists)
+            {
+                gta_free(tl_array);
+                retval = GTA_SYSTEM_ERROR;
+                goto exit;
+            }
+        }
+    }
+
+    // Make sure that the chunk is now empty
+    if (chunk_index != chunk_size)
+    {
+        retval = GTA_INVALID_DATA;
+        goto exit;
+    }
+
+    // Read an empty chunk that marks the end of the chunk list
+    gta_free_header_chunk(chunk, read_fn, userdata);
+    chunk = NULL;
+    retval = gta_read_chunk(header, NULL, 0, &chunk, &chunk_size, read_fn, userdata);
+    if (retval != GTA_OK)
+    {
+        goto exit;
+    }
+    if (chunk_size != 0)
+    {
+        retval = GTA_INVALID_DATA;
+        goto exit;
+    }
+
+exit:
+    if (retval == GTA_OK)
+    {
+        gta_destroy_taglist(header->global_taglist);
+        gta_free(header->global_taglist);
+        gta_free(header->component_types);
+        gta_free(header->component_blob_sizes);
+        gta_free(header->component_offsets);
+        gta_free(header->swap_runs);
+        for (size_t i = 0; i < header->components; i++)
+        {
+            gta_destroy_taglist(header->component_taglists[i]);
+            gta_free(header->component_taglists[i]);
+        }
+        gta_free(header->component_taglists);
+        gta_free(header->dimension_sizes);
+        for (size_t i = 0; i < header->dimensions; i++)
+        {
+            gta_destroy_taglist(header->dimension_taglists[i]);
+            gta_free(header->dimension_taglists[i]);
+        }
+        gta_free(header->dimension_taglists);
+        gta_free(header->encoded);
+        temp_header->compression_threads = header->compression_threads;
+        temp_header->decompression_threads = header->decompression_threads;
+        memcpy(header, temp_header, sizeof(gta_header_t));
+    }
+    else
+    {
+        gta_destroy_taglist(temp_header->global_taglist);
+        gta_free(temp_header->global_taglist);
+        gta_free(temp_header->component_types);
+        gta_free(temp_header->component_blob_sizes);
+        gta_free(temp_header->component_offsets);
+        gta_free(temp_header->swap_runs);
+        if (temp_header->component_taglists)
+        {
+            for (size_t i = 0; i < temp_header->components; i++)
+            {
+                gta_destroy_taglist(temp_header->component_taglists[i]);
+                gta_free(temp_header->component_taglists[i]);
+            }
+            gta_free(temp_header->component_taglists);
+        }
+        gta_free(temp_header->dimension_sizes);
+        if (temp_header->dimension_taglists)
+        {
+            for (size_t i = 0; i < temp_header->dimensions; i++)
+            {
+                gta_destroy_taglist(temp_header->dimension_taglists[i]);
+                gta_free(temp_header->dimension_taglists[i]);
+            }
+            gta_free(temp_header->dimension_taglists);
+        }
+    }
+    gta_free_header_chunk(chunk, read_fn, userdata);
+    gta_free(temp_header);
+    return retval;
+}
+
+gta_result_t
+gta_read_header_from_stream(gta_header_t *GTA_RESTRICT header, FILE *GTA_RESTRICT f)
+{
+    return gta_read_header(header, gta_read_stream, (intptr_t)f);
+}
+
+gta_result_t
+gta_read_header_from_fd(gta_header_t *GTA_RESTRICT header, int fd)
+{
+    return gta_read_header(header, gta_read_fd, fd);
+}
+
+gta_result_t
+gta_read_header_from_memory(gta_header_t *GTA_RESTRICT header,
+        const void *GTA_RESTRICT buffer, size_t size, size_t *GTA_RESTRICT offset)
+{
+    gta_memory_input_t m = { buffer, size, *offset };
+    gta_result_t retval = gta_read_header(header, gta_read_memory, (intptr_t)&m);
+    if (retval == GTA_OK)
+    {
+        *offset = (size_t)m.offset;
+    }
+    return retval;
+}
+
+static GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL
+gta_result_t
+gta_write_blob_to_chunk(const gta_header_t *GTA_RESTRICT header, gta_write_t write_fn, intptr_t userdata,
+        void *chunk, size_t chunk_size, size_t *chunk_index,
+        const void *blob, size_t blob_size)
+{
+    const char *cblob = blob;
+    while (blob_size > 0)
+    {
+        size_t n = chunk_size - *chunk_index;
+        if (n > blob_size)
+        {
+            n = blob_size;
+        }
+        memcpy((char *)chunk + *chunk_index, cblob, n);
+        *chunk_index += n;
+        cblob += n;
+        blob_size -= n;
+        if (*chunk_index == chunk_size)
+        {
+            gta_result_t retval = gta_write_chunk(header, NULL, 0, chunk, *chunk_index, write_fn, userdata);
+            if (retval != GTA_OK)
+            {
+                return retval;
+            }
+            *chunk_index = 0;
+        }
+    }
+    return GTA_OK;
+}
+
+static GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL
+gta_result_t
+gta_write_taglist_to_chunk(const gta_header_t *GTA_RESTRICT header, gta_write_t write_fn, intptr_t userdata,
+        void *chunk, size_t chunk_size, size_t *chunk_index, const gta_taglist_t *GTA_RESTRICT taglist)
+{
+    gta_result_t retval = GTA_OK;
+    if (taglist->arena_garbage == 0)
+    {
+        /* The blocks of the arena hold exactly the encoded tags */
+        for (const gta_arena_block_t *block = taglist->arena; block; block = block->next)
+        {
+            if (block->size > 0)
+            {
+                retval = gta_write_blob_to_chunk(header, write_fn, userdata, chunk, chunk_size, chunk_index,
+                        block->data, block->size);
+                if (retval != GTA_OK)
+                {
+                    return retval;
+                }
+            }
+        }
+    }
+    else
+    {
+        for (uintmax_t i = 0; i < gta_get_tags(taglist); i++)
+        {
+            const char *name = gta_get_tag_name(taglist, i);
+            retval = gta_write_blob_to_chunk(header, write_fn, userdata, chunk, chunk_size, chunk_index,
+                    name, strlen(name) + 1);
+            if (retval != GTA_OK)
+            {
+                return retval;
+            }
+            const char *value = gta_get_tag_value(taglist, i);
+            retval = gta_write_blob_to_chunk(header, write_fn, userdata, chunk, chunk_size, chunk_index,
+                    value, strlen(value) + 1);
+            if (retval != GTA_OK)
+            {
+                return retval;
+            }
+        }
+    }
+    char taglist_end = '\0';
+    retval = gta_write_blob_to_chunk(header, write_fn, userdata, chunk, chunk_size, chunk_index,
+            &taglist_end, sizeof(char));
+    return retval;
+}
+
+/* Encode a header. The header has already been checked by gta_write_header(). */
+static GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL
+gta_result_t
+gta_encode_header(const gta_header_t *GTA_RESTRICT header, gta_write_t write_fn, intptr_t userdata)
+{
+    uint8_t firstblock[6];
+    int output_error = false;
+    gta_result_t retval = GTA_OK;
+    size_t r;
+
+    /* Write first block */
+    firstblock[0] = 'G';
+    firstblock[1] = 'T';
+    firstblock[2] = 'A';
+    firstblock[3] = 1;
+    firstblock[4] = 0;
+#if WORDS_BIGENDIAN
+    firstblock[4] |= 0x01;
+#endif
+    if (header->compression != GTA_NONE)
+    {
+        // This is only here so that libgta versions <= 0.9.2 can read files created by this libgta version.
+        firstblock[4] |= 0x02;
+    }
+    firstblock[5] = gta_chunk_compression(header->compression,
+            header->compression == GTA_NONE ? GTA_FILTER_NONE : header->filter);
+    errno = 0;
+    r = write_fn(userdata, firstblock, 6, &output_error);
+    if (output_error || r < 6)
+    {
+        if (errno == 0)
+        {
+            errno = EIO;
+        }
+        return GTA_SYSTEM_ERROR;
+    }
+
+    /* Write rest of header in chunklist */
+
+    // Compute required space for header
+    size_t required_size = 6;
+    required_size += header->components * sizeof(uint8_t);
+    required_size += 1 * sizeof(uint8_t);
+    for (size_t i = 0; i < header->components; i++)
+    {
+        required_size += gta_get_taglist_encoded_size(header->component_taglists[i]);
+        if (header->component_types[i] == GTA_BLOB)
+        {
+            required_size += sizeof(uint64_t);
+        }
+    }
+    required_size += header->dimensions * sizeof(uint64_t);
+    required_size += 1 * sizeof(uint64_t);
+    for (size_t i = 0; i < header->dimensions; i++)
+    {
+        required_size += gta_get_taglist_encoded_size(header->dimension_taglists[i]);
+    }
+    required_size += gta_get_taglist_encoded_size(header->global_taglist);
+    // Allocate a chunk
+    void *chunk = NULL;
+    size_t chunk_size = 0;
+    size_t chunk_index = 0;
+    chunk_size = (required_size < gta_max_chunk_size ? required_size : gta_max_chunk_size);
+    chunk = gta_alloc_chunk(chunk_size);
+    if (!chunk)
+    {
+        retval = GTA_SYSTEM_ERROR;
+        goto exit;
+    }
+
+    // Write component list
+    size_t blob_size_index = 0;
+    for (size_t i = 0; i < header->components; i++)
+    {
+        uint8_t type = header->component_types[i];
+        retval = gta_write_blob_to_chunk(header, write_fn, userdata, chunk, chunk_size, &chunk_index,
+                &type, sizeof(uint8_t));
+        if (retval != GTA_OK)
+        {
+            goto exit;
+        }
+        if (type == GTA_BLOB)
+        {
+            uint64_t blob_size = header->component_blob_sizes[blob_size_index];
+            retval = gta_write_blob_to_chunk(header, write_fn, userdata, chunk, chunk_size, &chunk_index,
+                    &blob_size, sizeof(uint64_t));
+            if (retval != GTA_OK)
+            {
+                goto exit;
+            }
+            blob_size_index++;
+        }
+    }
+    uint8_t componentlist_end = 0xff;
+    retval = gta_write_blob_to_chunk(header, write_fn, userdata, chunk, chunk_size, &chunk_index,
+            &componentlist_end, sizeof(uint8_t));
+    if (retval != GTA_OK)
+    {
+        goto exit;
+    }
+
+    // Write dimension list
+    for (size_t i = 0; i < header->dimensions; i++)
+    {
+        uint64_t dimension_size = header->dimension_sizes[i];
+        retval = gta_write_blob_to_chunk(header, write_fn, userdata, chunk, chunk_size, &chunk_index,
+                &dimension_size, sizeof(uint64_t));
+        if (retval != GTA_OK)
+        {
+            goto exit;
+        }
+    }
+    uint64_t dimensionlist_end = 0;
+    retval = gta_write_blob_to_chunk(header, write_fn, userdata, chunk, chunk_size, &chunk_index,
+            &dimensionlist_end, sizeof(uint64_t));
+    if (retval != GTA_OK)
+    {
+        goto exit;
+    }
+
+    // Write tag lists
+    retval = gta_write_taglist_to_chunk(header, write_fn, userdata, chunk, chunk_size, &chunk_index,
+            header->global_taglist);
+    if (retval != GTA_OK)
+    {
+        goto exit;
+    }
+    for (size_t i = 0; i < header->components; i++)
+    {
+        retval = gta_write_taglist_to_chunk(header, write_fn, userdata, chunk, chunk_size, &chunk_index,
+                header->component_taglists[i]);
+        if (retval != GTA_OK)
+        {
+            goto exit;
+        }
+    }
+    for (size_t i = 0; i < header->dimensions; i++)
+    {
+        retval = gta_write_taglist_to_chunk(header, write_fn, userdata, chunk, chunk_size, &chunk_index,
+                header->dimension_taglists[i]);
+        if (retval != GTA_OK)
+        {
+            goto exit;
+        }
+    }
+
+    // Flush the chunk
+    if (chunk_index > 0)
+    {
+        retval = gta_write_chunk(header, NULL, 0, chunk, chunk_index, write_fn, userdata);
+        if (retval != GTA_OK)
+        {
+            goto exit;
+        }
+    }
+
+    // An empty chunk marks the end
+    retval = gta_write_chunk(header, NULL, 0, NULL, 0, write_fn, userdata);
+    if (retval != GTA_OK)
+    {
+        goto exit;
+    }
+
+exit:
+    gta_free_chunk(chunk);
+    return retval;
+}
+
+gta_result_t
+gta_write_header(const gta_header_t *GTA_RESTRICT header, gta_write_t write_fn, intptr_t userdata)
+{
+    int output_error = false;
+    gta_result_t retval = GTA_OK;
+    size_t r;
+
+    if (!gta_compression_is_supported(header->compression) || header->filter > GTA_FILTER_DELTA)
+    {
+        return GTA_UNSUPPORTED_DATA;
+    }
+
+    /* Encode the header into its cache, unless the cached encoding is still valid.
+     * Only the cache is modified, and concurrent writers of the same header are
+     * serialized by the lock. Once valid, the encoding stays unchanged until the
+     * header is modified, which must not happen while it is written, so it can
+     * be written without holding the lock. */
+    gta_header_t *GTA_RESTRICT cache = (gta_header_t *)header;
+    gta_encoded_header_lock();
+    uintmax_t changes = gta_get_taglist_changes(header);
+    if (!cache->encoded || cache->encoded_changes != changes)
+    {
+        gta_memory_output_t m = { NULL, 0, 0 };
+        retval = gta_encode_header(header, gta_write_memory, (intptr_t)&m);
+        gta_free(cache->encoded);
+        cache->encoded = (retval == GTA_OK ? m.buffer : NULL);
+        cache->encoded_size = (retval == GTA_OK ? m.size : 0);
+        cache->encoded_changes = changes;
+        if (retval != GTA_OK)
+        {
+            gta_free(m.buffer);
+        }
+    }
+    const void *encoded = cache->encoded;
+    size_t encoded_size = cache->encoded_size;
+    gta_encoded_header_unlock();
+    if (retval != GTA_OK)
+    {
+        return retval;
+    }
+
+    errno = 0;
+    r = write_fn(userdata, encoded, encoded_size, &output_error);
+    if (output_error || r < encoded_size)
+    {
+        if (errno == 0)
+        {
+            errno = EIO;
+        }
+        return GTA_SYSTEM_ERROR;
+    }
+    return GTA_OK;
+}
+
+gta_result_t
+gta_write_header_to_stream(const gta_header_t *GTA_RESTRICT header, FILE *GTA_RESTRICT f)
+{
+    return gta_write_header(header, gta_write_stream, (intptr_t)f);
+}
+
+gta_result_t
+gta_write_header_to_fd(const gta_header_t *GTA_RESTRICT header, int fd)
+{
+    return gta_write_header(header, gta_write_fd, fd);
+}
+
+gta_result_t
+gta_write_header_to_memory(const gta_header_t *GTA_RESTRICT header,
+        void *GTA_RESTRICT *GTA_RESTRICT buffer, size_t *GTA_RESTRICT size, size_t *GTA_RESTRICT capacity)
+{
+    gta_memory_output_t m = { *buffer, *size, *capacity };
+    gta_result_t retval = gta_write_header(header, gta_write_memory, (intptr_t)&m);
+    *buffer = m.buffer;
+    *capacity = m.capacity;
+    if (retval == GTA_OK)
+    {
+        *size = m.size;
+    }
+    return retval;
+}
+
+
+/*
+ *
+ * Access Headers
+ *
+ */
+
+
+const gta_taglist_t *
+gta_get_global_taglist_const(const gta_header_t *GTA_RESTRICT header)
+{
+    return header->global_taglist;
+}
+
+gta_taglist_t *
+gta_get_global_taglist(gta_header_t *GTA_RESTRICT header)
+{
+    return header->global_taglist;
+}
+
+uintmax_t
+gta_get_element_size(const gta_header_t *GTA_RESTRICT header)
+{
+    return header->element_size;
+}
+
+uintmax_t
+gta_get_components(const gta_header_t *GTA_RESTRICT header)
+{
+    return header->components;
+}
+
+gta_type_t
+gta_get_component_type(const gta_header_t *GTA_RESTRICT header, uintmax_t i)
+{
+    return header->component_types[i];
+}
+
+uintmax_t
+gta_get_component_size(const gta_header_t *GTA_RESTRICT header, uintmax_t i)
+{
+    return header->component_offsets[i + 1] - header->component_offsets[i];
+}
+
+const gta_taglist_t *
+gta_get_component_taglist_const(const gta_header_t *GTA_RESTRICT header, uintmax_t i)
+{
+    return header->component_taglists[i];
+}
+
+gta_taglist_t *
+gta_get_component_taglist(gta_header_t *GTA_RESTRICT header, uintmax_t i)
+{
+    return header->component_taglists[i];
+}
+
+gta_result_t
+gta_set_components(gta_header_t *GTA_RESTRICT header, uintmax_t n,
+        const gta_type_t *GTA_RESTRICT types, const uintmax_t *GTA_RESTRICT sizes)
+{
+    if (n > UINT64_MAX || n > SIZE_MAX
+            || gta_size_overflow(n, sizeof(uint8_t))
+            || gta_size_overflow(n, sizeof(gta_taglist_t *)))
+    {
+        return GTA_OVERFLOW;
+    }
+
+    uintmax_t element_size = 0;
+    uintmax_t data_size = 0;
+    size_t blobs = 0;
+
+    for (size_t i = 0; i < n; i++)
+    {
+        uintmax_t size = 0;
+        switch (types[i])
+        {
+        case GTA_BLOB:
+            size = sizes[blobs++];
+            if (size < 1 || size > UINT64_MAX)
+            {
+                return GTA_OVERFLOW;
+            }
+            break;
+        case GTA_INT8:
+        case GTA_UINT8:
+            size = 1;
+            break;
+        case GTA_INT16:
+        case GTA_UINT16:
+            size = 2;
+            break;
+        case GTA_INT32:
+        case GTA_UINT32:
+        case GTA_FLOAT32:
+            size = 4;
+            break;
+        case GTA_INT64:
+        case GTA_UINT64:
+        case GTA_FLOAT64:
+        case GTA_CFLOAT32:
+            size = 8;
+            break;
+        case GTA_INT128:
+        case GTA_UINT128:
+        case GTA_FLOAT128:
+        case GTA_CFLOAT64:
+            size = 16;
+            break;
+        case GTA_CFLOAT128:
+            size = 32;
+            break;
+        default:
+            return GTA_UNSUPPORTED_DATA;
+            break;
+        }
+        if (element_size > UINTMAX_MAX - size)
+        {
+            return GTA_OVERFLOW;
+        }
+        element_size += size;
+    }
+    data_size = element_size;
+    for (size_t i = 0; i < header->dimensions; i++)
+    {
+        if (gta_uintmax_overflow(data_size, header->dimension_sizes[i]))
+        {
+            return GTA_OVERFLOW;
+        }
+        data_size *= header->dimension_sizes[i];
+    }
+
+    uint8_t *my_types = NULL;
+    uintmax_t *my_blob_sizes = NULL;
+    gta_taglist_t **my_taglists = NULL;
+    uintmax_t *my_offsets = NULL;
+    gta_swap_run_t *my_swap_runs = NULL;
+    size_t my_swap_runs_count = 0;
+    if (n > 0)
+    {
+        my_types = gta_malloc(n * sizeof(uint8_t));
+        if (blobs > 0)
+        {
+            my_blob_sizes = gta_malloc(blobs * sizeof(uintmax_t));
+        }
+        my_taglists = gta_malloc(n * sizeof(gta_taglist_t *));
+        if (!my_types || (blobs > 0 && !my_blob_sizes) || !my_taglists)
+        {
+            gta_free(my_types);
+            gta_free(my_blob_sizes);
+            gta_free(my_taglists);
+            return GTA_SYSTEM_ERROR;
+        }
+        for (size_t i = 0; i < n; i++)
+        {
+            my_types[i] = types[i];
+        }
+        if (blobs > 0)
+        {
+            memcpy(my_blob_sizes, sizes, blobs * sizeof(uintmax_t));
+        }
+        if (gta_create_element_layout(n, my_types, my_blob_sizes,
+                    &my_offsets, &my_swap_runs, &my_swap_runs_count) != GTA_OK)
+        {
+            gta_free(my_types);
+            gta_free(my_blob_sizes);
+            gta_free(my_taglists);
+            return GTA_SYSTEM_ERROR;
+        }
+        for (size_t i = 0; i < n; i++)
+        {
+            my_taglists[i] = gta_malloc(sizeof(gta_taglist_t));
+            if (!my_taglists[i])
+            {
+                for (size_t j = 0; j < i; j++)
+                {
+                    gta_destroy_taglist(my_taglists[j]);
+                    gta_free(my_taglists[j]);
+                }
+                gta_free(my_types);
+                gta_free(my_blob_sizes);
+                gta_free(my_offsets);
+                gta_free(my_swap_runs);
+                gta_free(my_taglists);
+                return GTA_SYSTEM_ERROR;
+            }
+            gta_create_taglist(my_taglists[i]);
+        }
+    }
+
+    for (size_t i = 0; i < header->components; i++)
+    {
+        gta_destroy_taglist(header->component_taglists[i]);
+        gta_free(header->component_taglists[i]);
+    }
+    gta_free(header->component_types);
+    gta_free(header->component_blob_sizes);
+    gta_free(header->component_offsets);
+    gta_free(header->swap_runs);
+    gta_free(header->component_taglists);
+
+    header->components = n;
+    header->component_types = my_types;
+    header->component_blob_sizes = my_blob_sizes;
+    header->component_taglists = my_taglists;
+    header->element_size = element_size;
+    header->component_offsets = my_offsets;
+    header->swap_runs = my_swap_runs;
+    header->swap_runs_count = my_swap_runs_count;
+    header->data_size = element_size * header->elements;
+    gta_invalidate_encoded_header(header);
+
+    return GTA_OK;
+}
+
+uintmax_t
+gta_get_dimensions(const gta_header_t *GTA_RESTRICT header)
+{
+    return header->dimensions;
+}
+
+uintmax_t
+gta_get_dimension_size(const gta_header_t *GTA_RESTRICT header, uintmax_t i)
+{
+    return header->dimension_sizes[i];
+}
+
+const gta_taglist_t *
+gta_get_dimension_taglist_const(const gta_header_t *GTA_RESTRICT header, uintmax_t i)
+{
+    return header->dimension_taglists[i];
+}
+
+gta_taglist_t *
+gta_get_dimension_taglist(gta_header_t *GTA_RESTRICT header, uintmax_t i)
+{
+    return header->dimension_taglists[i];
+}
+
+gta_result_t
+gta_set_dimensions(gta_header_t *GTA_RESTRICT header, uintmax_t n, const uintmax_t *GTA_RESTRICT sizes)
+{
+    uintmax_t data_size = header->element_size;
+    uintmax_t elements = 1;
+
+    if (n > UINT64_MAX || n > SIZE_MAX
+            || gta_size_overflow(n, sizeof(gta_taglist_t *))
+            || gta_size_overflow(n, sizeof(uintmax_t)))
+    {
+        return GTA_OVERFLOW;
+    }
+    for (size_t i = 0; i < n; i++)
+    {
+        if (sizes[i] < 1)
+        {
+            return GTA_INVALID_DATA;
+        }
+        if (sizes[i] > UINT64_MAX)
+        {
+            return GTA_OVERFLOW;
+        }
+        if (gta_uintmax_overflow(data_size, sizes[i]))
+        {
+            return GTA_OVERFLOW;
+        }
+        data_size *= sizes[i];
+        elements *= sizes[i];
+    }
+
+    uintmax_t *my_sizes = NULL;
+    gta_taglist_t **my_taglists = NULL;
+    if (n > 0)
+    {
+        my_sizes = gta_malloc(n * sizeof(uintmax_t));
+        my_taglists = gta_malloc(n * sizeof(gta_taglist_t *));
+        if (!my_sizes || !my_taglists)
+        {
+            gta_free(my_sizes);
+            gta_free(my_taglists);
+            return GTA_SYSTEM_ERROR;
+        }
+        memcpy(my_sizes, sizes, n * sizeof(uintmax_t));
+        for (size_t i = 0; i < n; i++)
+        {
+            my_taglists[i] = gta_malloc(sizeof(gta_taglist_t));
+            if (!my_taglists[i])
+            {
+                for (size_t j = 0; j < i; j++)
+                {
+                    gta_destroy_taglist(my_taglists[j]);
+                    gta_free(my_taglists[j]);
+                }
+                gta_free(my_sizes);
+                gta_free(my_taglists);
+                return GTA_SYSTEM_ERROR;
+            }
+            gta_create_taglist(my_taglists[i]);
+        }
+    }
+
     for (size_t i = 0; i < header->dimensions; i++)
     {
-        if (gta_uintmax_overflow(data_size, header->dimension_sizes[i]))
+        gta_destroy_taglist(header->dimension_taglists[i]);
+        gta_free(header->dimension_taglists[i]);
+    }
+    gta_free(header->dimension_sizes);
+    gta_free(header->dimension_taglists);
+
+    header->dimensions = n;
+    header->dimension_sizes = my_sizes;
+    header->dimension_taglists = my_taglists;
+    header->elements = (n > 0 ? elements : 0);
+    header->data_size = (n > 0 ? data_size : 0);
+    gta_invalidate_encoded_header(header);
+
+    return GTA_OK;
+}
+
+uintmax_t
+gta_get_elements(const gta_header_t *GTA_RESTRICT header)
+{
+    return header->elements;
+}
+
+uintmax_t
+gta_get_data_size(const gta_header_t *GTA_RESTRICT header)
+{
+    return header->data_size;
+}
+
+gta_compression_t
+gta_get_compression(const gta_header_t *GTA_RESTRICT header)
+{
+    return header->compression;
+}
+
+void
+gta_set_compression(gta_header_t *GTA_RESTRICT header, gta_compression_t compression)
+{
+    if (compression != header->compression)
+    {
+        header->compression = compression;
+        gta_invalidate_encoded_header(header);
+    }
+}
+
+gta_filter_t
+gta_get_filter(const gta_header_t *GTA_RESTRICT header)
+{
+    return header->filter;
+}
+
+void
+gta_set_filter(gta_header_t *GTA_RESTRICT header, gta_filter_t filter)
+{
+    if (filter != header->filter)
+    {
+        header->filter = filter;
+        gta_invalidate_encoded_header(header);
+    }
+}
+
+unsigned int
+gta_get_compression_threads(const gta_header_t *GTA_RESTRICT header)
+{
+    return header->compression_threads;
+}
+
+void
+gta_set_compression_threads(gta_header_t *GTA_RESTRICT header, unsigned int threads)
+{
+    header->compression_threads = threads;
+}
+
+unsigned int
+gta_get_decompression_threads(const gta_header_t *GTA_RESTRICT header)
+{
+    return header->decompression_threads;
+}
+
+void
+gta_set_decompression_threads(gta_header_t *GTA_RESTRICT header, unsigned int threads)
+{
+    header->decompression_threads = threads;
+}
+
+
+/*
+ *
+ * In-Memory Data Access
+ *
+ */
+
+
+void
+gta_linear_index_to_indices(const gta_header_t *GTA_RESTRICT header, uintmax_t index, uintmax_t *indices)
+{
+    uintmax_t multiplied_dim_sizes = gta_get_elements(header);
+    for (uintmax_t i = 0; i < gta_get_dimensions(header); i++)
+    {
+        uintmax_t j = gta_get_dimensions(header) - 1 - i;
+        multiplied_dim_sizes /= gta_get_dimension_size(header, j);
+        indices[j] = index / multiplied_dim_sizes;
+        index -= indices[j] * multiplied_dim_sizes;
+    }
+}
+
+uintmax_t
+gta_indices_to_linear_index(const gta_header_t *GTA_RESTRICT header, const uintmax_t *indices)
+{
+    uintmax_t dim_product = 1;
+    uintmax_t index = indices[0];
+    for (uintmax_t i = 1; i < gta_get_dimensions(header); i++)
+    {
+        dim_product *= gta_get_dimension_size(header, i - 1);
+        index += indices[i] * dim_product;
+    }
+    return index;
+}
+
+const void *
+gta_get_element_const(const gta_header_t *GTA_RESTRICT header, const void *GTA_RESTRICT data, const uintmax_t *GTA_RESTRICT indices)
+{
+    // We know that size_t does not overflow because all the data is in a buffer
+    size_t index = gta_indices_to_linear_index(header, indices);
+    const char *ptr = data;
+    return ptr + index * gta_get_element_size(header);
+}
+
+void *
+gta_get_element(const gta_header_t *GTA_RESTRICT header, void *GTA_RESTRICT data, const uintmax_t *GTA_RESTRICT indices)
+{
+    return (void *)gta_get_element_const(header, data, indices);
+}
+
+const void *
+gta_get_element_linear_const(const gta_header_t *GTA_RESTRICT header, const void *GTA_RESTRICT data, uintmax_t index)
+{
+    return ((const char *)data) + index * gta_get_element_size(header);
+}
+
+void *
+gta_get_element_linear(const gta_header_t *GTA_RESTRICT header, void *GTA_RESTRICT data, uintmax_t index)
+{
+    return (void *)gta_get_element_linear_const(header, data, index);
+}
+
+const void *
+gta_get_component_const(const gta_header_t *GTA_RESTRICT header, const void *GTA_RESTRICT element, uintmax_t i)
+{
+    // We know that size_t does not overflow because all the data is in a buffer
+    return ((const char *)element) + header->component_offsets[i];
+}
+
+void *
+gta_get_component(const gta_header_t *GTA_RESTRICT header, void *GTA_RESTRICT element, uintmax_t i)
+{
+    return (void *)gta_get_component_const(header, element, i);
+}
+
+
+/*
+ *
+ * Read and Write Complete Arrays
+ *
+ */
+
+
+gta_result_t
+gta_read_data(const gta_header_t *GTA_RESTRICT header, void *GTA_RESTRICT data, gta_read_t read_fn, intptr_t userdata)
+{
+    // We know that the data size fits into size_t, because the caller already allocated a buffer for all the data.
+    if (gta_get_compression(header) != GTA_NONE)
+    {
+        char *data_ptr = data;
+        size_t remaining_size = gta_get_data_size(header);
+        void *chunk;
+        size_t chunk_size;
+        gta_readahead_t *readahead = NULL;
+        gta_codec_t codec;
+        gta_result_t retval;
+
+        gta_init_codec(&codec);
+        if (header->decompression_threads > 1)
+        {
+            readahead = gta_create_readahead(header->decompression_threads);
+            if (!readahead)
+            {
+                return GTA_SYSTEM_ERROR;
+            }
+        }
+        for (;;)
+        {
+            if (readahead)
+            {
+                retval = gta_read_chunk_readahead(header, readahead, &chunk, &chunk_size, read_fn, userdata);
+            }
+            else
+            {
+                retval = gta_read_chunk(header, &codec, gta_filter_stride(header),
+                        &chunk, &chunk_size, read_fn, userdata);
+            }
+            if (retval != GTA_OK)
+            {
+                break;
+            }
+            if (chunk_size == 0)
+            {
+                if (remaining_size != 0)
+                {
+                    retval = GTA_INVALID_DATA;
+                }
+                break;
+            }
+            if (chunk_size > remaining_size)
+            {
+                gta_free_chunk(chunk);
+                retval = GTA_INVALID_DATA;
+                break;
+            }
+            memcpy(data_ptr, chunk, chunk_size);
+            gta_free_chunk(chunk);
+            remaining_size -= chunk_size;
+            data_ptr += chunk_size;
+        }
+        if (readahead)
+        {
+            gta_destroy_readahead(readahead);
+        }
+        gta_free_codec(&codec);
+        if (retval != GTA_OK)
+        {
+            return retval;
+        }
+    }
+    else
+    {
+        int input_error = false;
+        size_t r = read_fn(userdata, data, gta_get_data_size(header), &input_error);
+        if (input_error)
+        {
+            return GTA_SYSTEM_ERROR;
+        }
+        if (r < gta_get_data_size(header))
+        {
+            return GTA_UNEXPECTED_EOF;
+        }
+    }
+    if (gta_data_needs_endianness_swapping(header))
+    {
+        gta_swap_elements_endianness(header, data, gta_get_elements(header));
+    }
+    return GTA_OK;
+}
+
+gta_result_t
+gta_read_data_from_stream(const gta_header_t *GTA_RESTRICT header, void *GTA_RESTRICT data, FILE *GTA_RESTRICT f)
+{
+    return gta_read_data(header, data, gta_read_stream, (intptr_t)f);
+}
+
+gta_result_t
+gta_read_data_from_fd(const gta_header_t *GTA_RESTRICT header, void *GTA_RESTRICT data, int fd)
+{
+    return gta_read_data(header, data, gta_read_fd, fd);
+}
+
+gta_result_t
+gta_read_data_from_memory(const gta_header_t *GTA_RESTRICT header, void *GTA_RESTRICT data,
+        const void *GTA_RESTRICT buffer, size_t size, size_t *GTA_RESTRICT offset)
+{
+    gta_memory_input_t m = { buffer, size, *offset };
+    gta_result_t retval = gta_read_data(header, data, gta_read_memory, (intptr_t)&m);
+    if (retval == GTA_OK)
+    {
+        *offset = (size_t)m.offset;
+    }
+    return retval;
+}
+
+gta_result_t
+gta_get_data_from_memory(const gta_header_t *GTA_RESTRICT header, const void *GTA_RESTRICT *GTA_RESTRICT data,
+        const void *GTA_RESTRICT buffer, size_t size, size_t *GTA_RESTRICT offset)
+{
+    if (gta_get_compression(header) != GTA_NONE || gta_data_needs_endianness_swapping(header))
+    {
+        return GTA_UNSUPPORTED_DATA;
+    }
+    if (gta_get_data_size(header) > SIZE_MAX)
+    {
+        return GTA_OVERFLOW;
+    }
+    size_t data_size = gta_get_data_size(header);
+    if (*offset > size || data_size > size - *offset)
+    {
+        return GTA_UNEXPECTED_EOF;
+    }
+    *data = (const char *)buffer + *offset;
+    *offset += data_size;
+    return GTA_OK;
+}
+
+gta_result_t
+gta_skip_data(const gta_header_t *GTA_RESTRICT header, gta_read_t read_fn, gta_seek_t seek_fn, intptr_t userdata)
+{
+    gta_result_t retval;
+
+    if (gta_get_compression(header) != GTA_NONE)
+    {
+        uintmax_t s = gta_get_data_size(header);
+        size_t chunk_size;
+        uintmax_t encoded_size;
+        while (s > 0)
+        {
+            retval = gta_skip_chunk(header, &chunk_size, &encoded_size, read_fn, seek_fn, userdata);
+            if (retval != GTA_OK)
+            {
+                return retval;
+            }
+            if (chunk_size > s)
+            {
+                return GTA_INVALID_DATA;
+            }
+            s -= chunk_size;
+            if (chunk_size == 0 && s > 0)
+            {
+                return GTA_INVALID_DATA;
+            }
+        }
+        retval = gta_skip_chunk(header, &chunk_size, &encoded_size, read_fn, seek_fn, userdata);
+        if (retval != GTA_OK)
+        {
+            return retval;
+        }
+        if (chunk_size != 0)
+        {
+            return GTA_INVALID_DATA;
+        }
+    }
+    else
+    {
+        if (seek_fn)
+        {
+            if (gta_get_data_size(header) > (uintmax_t)(INTMAX_MAX))
+            {
+                return GTA_OVERFLOW;
+            }
+            int error = false;
+            seek_fn(userdata, gta_get_data_size(header), SEEK_CUR, &error);
+            if (error)
+            {
+                return GTA_SYSTEM_ERROR;
+            }
+        }
+        else
+        {
+            retval = gta_readskip(read_fn, userdata, gta_get_data_size(header));
+            if (retval != GTA_OK)
+            {
+                return retval;
+            }
+        }
+    }
+    return GTA_OK;
+}
+
+gta_result_t
+gta_skip_data_from_stream(const gta_header_t *GTA_RESTRICT header, FILE *GTA_RESTRICT f)
+{
+    return gta_skip_data(header, gta_read_stream,
+            (ftello(f) == -1 ? NULL : gta_seek_stream), (intptr_t)f);
+}
+
+gta_result_t
+gta_skip_data_from_fd(const gta_header_t *GTA_RESTRICT header, int fd)
+{
+    return gta_skip_data(header, gta_read_fd,
+            (lseek(fd, 0, SEEK_CUR) == -1 ? NULL : gta_seek_fd), fd);
+}
+
+gta_result_t
+gta_skip_data_from_memory(const gta_header_t *GTA_RESTRICT header,
+        const void *GTA_RESTRICT buffer, size_t size, size_t *GTA_RESTRICT offset)
+{
+    gta_memory_input_t m = { buffer, size, *offset };
+    gta_result_t retval = gta_skip_data(header, gta_read_memory, gta_seek_memory, (intptr_t)&m);
+    if (retval == GTA_OK && m.offset > size)
+    {
+        // Seeking does not check for the end of the buffer
+        retval = GTA_UNEXPECTED_EOF;
+    }
+    if (retval == GTA_OK)
+    {
+        *offset = (size_t)m.offset;
+    }
+    return retval;
+}
+
+gta_result_t
+gta_write_data(const gta_header_t *GTA_RESTRICT header, const void *GTA_RESTRICT data, gta_write_t write_fn, intptr_t userdata)
+{
+    // We know that the data size fits into size_t, because the caller already allocated a buffer for all the data.
+    if (gta_get_compression(header) != GTA_NONE)
+    {
+        const char *chunk_ptr = data;
+        size_t remaining_size = gta_get_data_size(header);
+        size_t chunk_size;
+        gta_codec_t codec;
+        gta_result_t retval = GTA_OK;
+
+        gta_init_codec(&codec);
+        if (header->compression_threads > 1)
+        {
+            // Compress up to compression_threads chunks at a time, and write them in order.
+            // The calling thread is one of the compression threads.
+            unsigned int threads = header->compression_threads;
+            if (gta_size_overflow(threads, sizeof(gta_chunk_job_t)))
+            {
+                return GTA_OVERFLOW;
+            }
+            gta_chunk_job_t *jobs = gta_malloc(threads * sizeof(gta_chunk_job_t));
+            if (!jobs)
+            {
+                return GTA_SYSTEM_ERROR;
+            }
+            gta_workers_t *workers = gta_create_workers(threads - 1);
+            while (retval == GTA_OK && remaining_size > 0)
+            {
+                size_t jobs_count = 0;
+                while (jobs_count < threads && remaining_size > 0)
+                {
+                    chunk_size = gta_max_chunk_size;
+                    if (chunk_size > remaining_size)
+                    {
+                        chunk_size = remaining_size;
+                    }
+                    jobs[jobs_count].chunk = chunk_ptr;
+                    jobs[jobs_count].chunk_size = chunk_size;
+                    jobs[jobs_count].compressed = NULL;
+                    jobs_count++;
+                    chunk_ptr += chunk_size;
+                    remaining_size -= chunk_size;
+                }
+                retval = gta_write_chunks(header, &codec, workers, jobs, jobs_count, write_fn, userdata);
+            }
+            gta_destroy_workers(workers);
+            gta_free(jobs);
+            if (retval == GTA_OK)
+            {
+                retval = gta_write_chunk(header, NULL, 0, NULL, 0, write_fn, userdata);
+            }
+        }
+        else
+        {
+            for (;;)
+            {
+                chunk_size = gta_max_chunk_size;
+                if (chunk_size > remaining_size)
+                {
+                    chunk_size = remaining_size;
+                }
+                retval = gta_write_chunk(header, &codec, gta_filter_stride(header),
+                        chunk_ptr, chunk_size, write_fn, userdata);
+                if (retval != GTA_OK || chunk_size == 0)
+                {
+                    break;
+                }
+                chunk_ptr += chunk_size;
+                remaining_size -= chunk_size;
+            }
+        }
+        gta_free_codec(&codec);
+        return retval;
+    }
+    else
+    {
+        int output_error = false;
+        errno = 0;
+        size_t r = write_fn(userdata, data, gta_get_data_size(header), &output_error);
+        if (output_error || r < gta_get_data_size(header))
+        {
+            if (errno == 0)
+            {
+                errno = EIO;
+            }
+            return GTA_SYSTEM_ERROR;
+        }
+        return GTA_OK;
+    }
+}
+
+gta_result_t
+gta_write_data_to_stream(const gta_header_t *GTA_RESTRICT header, const void *GTA_RESTRICT data, FILE *GTA_RESTRICT f)
+{
+    return gta_write_data(header, data, gta_write_stream, (intptr_t)f);
+}
+
+gta_result_t
+gta_write_data_to_fd(const gta_header_t *GTA_RESTRICT header, const void *GTA_RESTRICT data, int fd)
+{
+    return gta_write_data(header, data, gta_write_fd, fd);
+}
+
+gta_result_t
+gta_write_data_to_memory(const gta_header_t *GTA_RESTRICT header, const void *GTA_RESTRICT data,
+        void *GTA_RESTRICT *GTA_RESTRICT buffer, size_t *GTA_RESTRICT size, size_t *GTA_RESTRICT capacity)
+{
+    gta_memory_output_t m = { *buffer, *size, *capacity };
+    gta_result_t retval = gta_write_data(header, data, gta_write_memory, (intptr_t)&m);
+    *buffer = m.buffer;
+    *capacity = m.capacity;
+    if (retval == GTA_OK)
+    {
+        *size = m.size;
+    }
+    return retval;
+}
+
+gta_result_t
+gta_copy_data(const gta_header_t *GTA_RESTRICT read_header, gta_read_t read_fn, intptr_t read_userdata,
+        const gta_header_t *GTA_RESTRICT write_header, gta_write_t write_fn, intptr_t write_userdata)
+{
+    if (gta_get_dimensions(read_header) != gta_get_dimensions(write_header)
+            || gta_get_components(read_header) != gta_get_components(write_header))
+    {
+        return GTA_INVALID_DATA;
+    }
+    for (uintmax_t i = 0; i < gta_get_dimensions(read_header); i++)
+    {
+        if (gta_get_dimension_size(read_header, i) != gta_get_dimension_size(write_header, i))
+        {
+            return GTA_INVALID_DATA;
+        }
+    }
+    for (uintmax_t i = 0; i < gta_get_components(read_header); i++)
+    {
+        if (gta_get_component_type(read_header, i) != gta_get_component_type(write_header, i))
+        {
+            return GTA_INVALID_DATA;
+        }
+        if (gta_get_component_type(read_header, i) == GTA_BLOB
+                && gta_get_component_size(read_header, i) != gta_get_component_size(write_header, i))
+        {
+            return GTA_INVALID_DATA;
+        }
+    }
+
+    uintmax_t size = gta_get_data_size(read_header);
+    gta_result_t retval = GTA_OK;
+
+    if (gta_get_compression(read_header) != GTA_NONE
+            && gta_get_compression(write_header) == gta_get_compression(read_header)
+            && gta_get_filter(write_header) == gta_get_filter(read_header)
+            && !gta_data_needs_endianness_swapping(read_header))
+    {
+        // Pass the chunks through without decompressing and recompressing them.
+        uint8_t compression;
+        void *raw;
+        size_t raw_size;
+        size_t chunk_size;
+        do
+        {
+            retval = gta_read_raw_chunk(read_header, &chunk_size, &compression,
+                    &raw, &raw_size, read_fn, read_userdata);
+            if (retval != GTA_OK)
+            {
+                return retval;
+            }
+            if (chunk_size > size)
+            {
+                gta_free_chunk(raw);
+                return GTA_INVALID_DATA;
+            }
+            retval = gta_emit_chunk(raw, chunk_size, compression, raw, raw_size,
+                    write_fn, write_userdata);
+            gta_free_chunk(raw);
+            if (retval != GTA_OK)
+            {
+                return retval;
+            }
+            size -= chunk_size;
+        }
+        while (chunk_size > 0);
+        if (size > 0)
+        {
+            return GTA_UNEXPECTED_EOF;
+        }
+    }
+    else if (gta_get_compression(read_header) != GTA_NONE)
+    {
+        // The same codec decompresses and recompresses all chunks.
+        gta_codec_t codec;
+        void *chunk = NULL;
+        size_t chunk_size = 0;
+        gta_init_codec(&codec);
+        do
+        {
+            retval = gta_read_chunk(read_header, &codec, gta_filter_stride(read_header),
+                    &chunk, &chunk_size, read_fn, read_userdata);
+            if (retval != GTA_OK)
+            {
+                break;
+            }
+            if (chunk_size > size)
+            {
+                gta_free_chunk(chunk);
+                retval = GTA_INVALID_DATA;
+                break;
+            }
+            if (gta_get_compression(write_header) != GTA_NONE)
+            {
+                retval = gta_write_chunk(write_header, &codec, gta_filter_stride(write_header),
+                        chunk, chunk_size, write_fn, write_userdata);
+            }
+            else
+            {
+                int error = false;
+                errno = 0;
+                size_t r = write_fn(write_userdata, chunk, chunk_size, &error);
+                if (error || r < chunk_size)
+                {
+                    if (errno == 0)
+                    {
+                        errno = EIO;
+                    }
+                    retval = GTA_SYSTEM_ERROR;
+                }
+            }
+            gta_free_chunk(chunk);
+            if (retval != GTA_OK)
+            {
+                break;
+            }
+            size -= chunk_size;
+        }
+        while (chunk_size > 0);
+        gta_free_codec(&codec);
+        if (retval != GTA_OK)
+        {
+            return retval;
+        }
+        if (size > 0)
+        {
+            return GTA_UNEXPECTED_EOF;
+        }
+    }
+    else
+    {
+        gta_codec_t codec;
+        void *buffer = gta_alloc_chunk(size < gta_max_chunk_size ? size : gta_max_chunk_size);
+
+        if (!buffer)
+        {
+            return GTA_SYSTEM_ERROR;
+        }
+        gta_init_codec(&codec);
+        while (size > 0)
+        {
+            int error = false;
+            size_t x = (size > gta_max_chunk_size ? gta_max_chunk_size : size);
+            size_t r = read_fn(read_userdata, buffer, x, &error);
+            if (error)
+            {
+                retval = GTA_SYSTEM_ERROR;
+                break;
+            }
+            if (r < x)
+            {
+                retval = GTA_UNEXPECTED_EOF;
+                break;
+            }
+            if (gta_get_compression(write_header) != GTA_NONE)
+            {
+                // Each piece that was read is exactly one output chunk, as in gta_write_data().
+                retval = gta_write_chunk(write_header, &codec, gta_filter_stride(write_header),
+                        buffer, x, write_fn, write_userdata);
+            }
+            else
+            {
+                errno = 0;
+                r = write_fn(write_userdata, buffer, x, &error);
+                if (error || r < x)
+                {
+                    if (errno == 0)
+                    {
+                        errno = EIO;
+                    }
+                    retval = GTA_SYSTEM_ERROR;
+                }
+            }
+            if (retval != GTA_OK)
+            {
+                break;
+            }
+            size -= x;
+        }
+        if (retval == GTA_OK && gta_get_compression(write_header) != GTA_NONE)
+        {
+            // An empty chunk marks the end
+            retval = gta_write_chunk(write_header, NULL, 0, NULL, 0, write_fn, write_userdata);
+        }
+        gta_free_codec(&codec);
+        gta_free_chunk(buffer);
+        if (retval != GTA_OK)
+        {
+            return retval;
+        }
+    }
+    return GTA_OK;
+}
+
+gta_result_t
+gta_copy_data_stream(
+        const gta_header_t *GTA_RESTRICT read_header, FILE *GTA_RESTRICT read_f,
+        const gta_header_t *GTA_RESTRICT write_header, FILE *GTA_RESTRICT write_f)
+{
+    return gta_copy_data(
+            read_header, gta_read_stream, (intptr_t)read_f,
+            write_header, gta_write_stream, (intptr_t)write_f);
+}
+
+gta_result_t
+gta_copy_data_fd(
+        const gta_header_t *GTA_RESTRICT read_header, int read_fd,
+        const gta_header_t *GTA_RESTRICT write_header, int write_fd)
+{
+    return gta_copy_data(
+            read_header, gta_read_fd, read_fd,
+            write_header, gta_write_fd, write_fd);
+}
+
+
+/*
+ *
+ * Read and Write Array Elements
+ *
+ */
+
+gta_result_t
+gta_create_io_state(gta_io_state_t *GTA_RESTRICT *GTA_RESTRICT io_state)
+{
+    *io_state = gta_malloc(sizeof(gta_io_state_t));
+    if (!*io_state)
+    {
+        return GTA_SYSTEM_ERROR;
+    }
+    (*io_state)->io_type = 0;
+    (*io_state)->failure = false;
+    (*io_state)->counter = 0;
+    (*io_state)->chunk = NULL;
+    (*io_state)->chunk_size = 0;
+    (*io_state)->chunk_capacity = 0;
+    (*io_state)->chunk_index = 0;
+    (*io_state)->already_read = 0;
+    (*io_state)->compression_threads = 0;
+    (*io_state)->pending_chunks = NULL;
+    (*io_state)->pending_chunks_count = 0;
+    (*io_state)->workers = NULL;
+    (*io_state)->decompression_threads = 0;
+    (*io_state)->readahead = NULL;
+    gta_init_codec(&((*io_state)->codec));
+    return GTA_OK;
+}
+
+static GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW
+void
+gta_free_pending_chunks(gta_io_state_t *GTA_RESTRICT io_state)
+{
+    for (size_t i = 0; i < io_state->pending_chunks_count; i++)
+    {
+        gta_free_chunk(io_state->pending_chunks[i]);
+    }
+    gta_free(io_state->pending_chunks);
+    io_state->pending_chunks = NULL;
+    io_state->pending_chunks_count = 0;
+}
+
+static GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW
+void
+gta_free_io_state_chunk(gta_io_state_t *GTA_RESTRICT io_state)
+{
+    gta_free_chunk(io_state->chunk);
+    io_state->chunk = NULL;
+    io_state->chunk_capacity = 0;
+}
+
+/**
+ * \brief               Make sure that the chunk buffer of an input/output state is large enough.
+ * \param io_state      The input/output state.
+ * \param size          The required size.
+ * \return              \a GTA_OK or \a GTA_SYSTEM_ERROR.
+ *
+ * The buffer is only reallocated if it is too small; its contents are not preserved in this case.
+ */
+static GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW
+gta_result_t
+gta_reserve_io_state_chunk(gta_io_state_t *GTA_RESTRICT io_state, size_t size)
+{
+    if (io_state->chunk_capacity < size)
+    {
+        gta_free_io_state_chunk(io_state);
+        io_state->chunk = gta_alloc_chunk(size);
+        if (!io_state->chunk)
+        {
+            return GTA_SYSTEM_ERROR;
+        }
+        io_state->chunk_capacity = size;
+    }
+    return GTA_OK;
+}
+
+void
+gta_destroy_io_state(gta_io_state_t *GTA_RESTRICT io_state)
+{
+    gta_free_chunk(io_state->chunk);
+    gta_free_pending_chunks(io_state);
+    gta_destroy_workers(io_state->workers);
+    if (io_state->readahead)
+    {
+        gta_destroy_readahead(io_state->readahead);
+    }
+    gta_free_codec(&io_state->codec);
+    gta_free(io_state);
+}
+
+unsigned int
+gta_get_io_state_compression_threads(const gta_io_state_t *GTA_RESTRICT io_state)
+{
+    return io_state->compression_threads;
+}
+
+void
+gta_set_io_state_compression_threads(gta_io_state_t *GTA_RESTRICT io_state, unsigned int threads)
+{
+    io_state->compression_threads = threads;
+}
+
+unsigned int
+gta_get_io_state_decompression_threads(const gta_io_state_t *GTA_RESTRICT io_state)
+{
+    return io_state->decompression_threads;
+}
+
+void
+gta_set_io_state_decompression_threads(gta_io_state_t *GTA_RESTRICT io_state, unsigned int threads)
+{
+    io_state->decompression_threads = threads;
+}
+
+gta_result_t
+gta_clone_io_state(gta_io_state_t *GTA_RESTRICT dst_io_state,
+        const gta_io_state_t *GTA_RESTRICT src_io_state)
+{
+    void *chunk = NULL;
+    void **pending_chunks = NULL;
+    gta_readahead_t *readahead = NULL;
+
+    if (src_io_state->chunk)
+    {
+        chunk = gta_alloc_chunk(src_io_state->chunk_capacity);
+        if (!chunk)
+        {
+            return GTA_SYSTEM_ERROR;
+        }
+        memcpy(chunk, src_io_state->chunk, src_io_state->chunk_size);
+    }
+    if (src_io_state->pending_chunks_count > 0)
+    {
+        pending_chunks = gta_malloc(src_io_state->pending_chunks_count * sizeof(void *));
+        if (!pending_chunks)
+        {
+            gta_free_chunk(chunk);
+            return GTA_SYSTEM_ERROR;
+        }
+        for (size_t i = 0; i < src_io_state->pending_chunks_count; i++)
+        {
+            pending_chunks[i] = gta_alloc_chunk(gta_max_chunk_size);
+            if (!pending_chunks[i])
+            {
+                for (size_t j = 0; j < i; j++)
+                {
+                    gta_free_chunk(pending_chunks[j]);
+                }
+                gta_free(pending_chunks);
+                gta_free_chunk(chunk);
+                return GTA_SYSTEM_ERROR;
+            }
+            memcpy(pending_chunks[i], src_io_state->pending_chunks[i], gta_max_chunk_size);
+        }
+    }
+    if (src_io_state->readahead)
+    {
+        readahead = gta_clone_readahead(src_io_state->readahead);
+        if (!readahead)
+        {
+            for (size_t i = 0; i < src_io_state->pending_chunks_count; i++)
+            {
+                gta_free_chunk(pending_chunks[i]);
+            }
+            gta_free(pending_chunks);
+            gta_free_chunk(chunk);
+            return GTA_SYSTEM_ERROR;
+        }
+    }
+    gta_free_chunk(dst_io_state->chunk);
+    gta_free_pending_chunks(dst_io_state);
+    if (dst_io_state->readahead)
+    {
+        gta_destroy_readahead(dst_io_state->readahead);
+    }
+    dst_io_state->io_type = src_io_state->io_type;
+    dst_io_state->failure = src_io_state->failure;
+    dst_io_state->counter = src_io_state->counter;
+    dst_io_state->chunk = chunk;
+    dst_io_state->chunk_size = src_io_state->chunk_size;
+    dst_io_state->chunk_capacity = src_io_state->chunk_capacity;
+    dst_io_state->chunk_index = src_io_state->chunk_index;
+    dst_io_state->already_read = src_io_state->already_read;
+    dst_io_state->compression_threads = src_io_state->compression_threads;
+    dst_io_state->pending_chunks = pending_chunks;
+    dst_io_state->pending_chunks_count = src_io_state->pending_chunks_count;
+    dst_io_state->decompression_threads = src_io_state->decompression_threads;
+    dst_io_state->readahead = readahead;
+    // Codecs and compression workers carry no state between chunks, so the clone keeps its own.
+    return GTA_OK;
+}
+
+/**
+ * \brief               Read the next chunk for element-based input.
+ * \param header        The header.
+ * \param io_state      The input state.
+ * \param dst           A buffer that receives the chunk directly if the chunk fits into it, or NULL.
+ * \param dst_size      The size of \a dst.
+ * \param direct_size   The size of the chunk if it was read into \a dst, or 0.
+ * \param read_fn       The custom input function.
+ * \param userdata      A parameter to the custom input function.
+ * \return              \a GTA_OK, \a GTA_INVALID_DATA, \a GTA_UNSUPPORTED_DATA, \a GTA_UNEXPECTED_EOF, or \a GTA_SYSTEM_ERROR.
+ *
+ * Uses the read-ahead queue if parallel decompression is enabled. Once the queue
+ * exists, it must be used until the last chunk was read, because it already
+ * consumed input.
+ * Otherwise, a chunk that fits into \a dst is decompressed directly into it, and other
+ * chunks are decompressed into the chunk buffer of the input state, which is reused.
+ */
+static GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL3(1, 2, 5)
+gta_result_t
+gta_read_elements_chunk(const gta_header_t *GTA_RESTRICT header, gta_io_state_t *GTA_RESTRICT io_state,
+        void *GTA_RESTRICT dst, size_t dst_size, size_t *GTA_RESTRICT direct_size,
+        gta_read_t read_fn, intptr_t userdata)
+{
+    unsigned int threads = (io_state->decompression_threads > 0
+            ? io_state->decompression_threads : header->decompression_threads);
+    gta_result_t retval;
+
+    *direct_size = 0;
+    if (!io_state->readahead && threads > 1)
+    {
+        io_state->readahead = gta_create_readahead(threads);
+        if (!io_state->readahead)
+        {
+            return GTA_SYSTEM_ERROR;
+        }
+    }
+    if (io_state->readahead)
+    {
+        gta_free_io_state_chunk(io_state);
+        retval = gta_read_chunk_readahead(header, io_state->readahead,
+                &(io_state->chunk), &(io_state->chunk_size), read_fn, userdata);
+        io_state->chunk_capacity = io_state->chunk_size;
+        return retval;
+    }
+
+    size_t chunk_size;
+    uint8_t compression;
+    size_t raw_size;
+    void *target;
+    void *raw;
+    const void *src;
+    int error = false;
+    size_t r;
+
+    io_state->chunk_size = 0;
+    retval = gta_read_chunk_head(header, &chunk_size, &compression, &raw_size, read_fn, userdata);
+    if (retval != GTA_OK || chunk_size == 0)
+    {
+        return retval;
+    }
+    if (dst && chunk_size <= dst_size)
+    {
+        target = dst;
+    }
+    else
+    {
+        retval = gta_reserve_io_state_chunk(io_state, chunk_size);
+        if (retval != GTA_OK)
+        {
+            return retval;
+        }
+        target = io_state->chunk;
+    }
+    if (compression != GTA_NONE && (src = gta_peek_memory(read_fn, userdata, raw_size)))
+    {
+        // Decompress directly from the input buffer
+        retval = gta_uncompress_chunk(&io_state->codec, target, chunk_size, src, raw_size,
+                compression, gta_filter_stride(header));
+        goto exit;
+    }
+    if (compression == GTA_NONE)
+    {
+        raw = target;
+    }
+    else if (target == dst)
+    {
+        // the chunk buffer is unused while the chunk goes directly to the destination
+        retval = gta_reserve_io_state_chunk(io_state, raw_size);
+        if (retval != GTA_OK)
+        {
+            return retval;
+        }
+        raw = io_state->chunk;
+    }
+    else
+    {
+        raw = gta_alloc_chunk(raw_size);
+        if (!raw)
+        {
+            return GTA_SYSTEM_ERROR;
+        }
+    }
+    r = read_fn(userdata, raw, raw_size, &error);
+    if (error)
+    {
+        retval = GTA_SYSTEM_ERROR;
+    }
+    else if (r < raw_size)
+    {
+        retval = GTA_UNEXPECTED_EOF;
+    }
+    else if (compression != GTA_NONE)
+    {
+        retval = gta_uncompress_chunk(&io_state->codec, target, chunk_size, raw, raw_size,
+                compression, gta_filter_stride(header));
+    }
+    if (raw != target && raw != io_state->chunk)
+    {
+        gta_free_chunk(raw);
+    }
+exit:
+    if (retval == GTA_OK)
+    {
+        if (target == dst)
+        {
+            *direct_size = chunk_size;
+        }
+        else
+        {
+            io_state->chunk_size = chunk_size;
+        }
+    }
+    return retval;
+}
+
+/**
+ * \brief               Read array elements, either completely or only selected components.
+ * \param header        The header.
+ * \param io_state      The input state.
+ * \param n             The number of elements to read.
+ * \param buf           The buffer for the elements, or NULL if \a gathers is used.
+ * \param gathers       The gather plan for selected components, or NULL if \a buf is used.
+ * \param gathers_count The number of entries in the gather plan.
+ * \param read_fn       The custom input function.
+ * \param userdata      A parameter to the custom input function.
+ * \return              \a GTA_OK, \a GTA_INVALID_DATA, \a GTA_OVERFLOW, \a GTA_UNEXPECTED_EOF, or \a GTA_SYSTEM_ERROR.
+ *
+ * With a gather plan, the selected components are copied out of the chunk buffer
+ * while it is consumed, so that the complete elements are never stored.
+ */
+static GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL3(1, 2, 7)
+gta_result_t
+gta_read_elements_gather(const gta_header_t *GTA_RESTRICT header, gta_io_state_t *GTA_RESTRICT io_state,
+        uintmax_t n, void *GTA_RESTRICT buf, const gta_gather_t *GTA_RESTRICT gathers, size_t gathers_count,
+        gta_read_t read_fn, intptr_t userdata)
+{
+    gta_result_t retval = GTA_OK;
+
+    if (io_state->io_type == 0)
+    {
+        io_state->io_type = 1;
+    }
+    if (io_state->io_type != 1)
+    {
+        retval = GTA_INVALID_DATA;
+        goto exit;
+    }
+    if (io_state->failure)
+    {
+        retval = GTA_INVALID_DATA;
+        goto exit;
+    }
+    if (n > gta_get_elements(header) || io_state->counter > gta_get_elements(header) - n)
+    {
+        retval = GTA_INVALID_DATA;
+        goto exit;
+    }
+    uintmax_t s = gta_get_element_size(header);
+    if (s == 0)
+    {
+        retval = GTA_INVALID_DATA;
+        goto exit;
+    }
+    if (s > SIZE_MAX || n > SIZE_MAX || gta_size_overflow(n, s))
+    {
+        retval = GTA_OVERFLOW;
+        goto exit;
+    }
+    size_t size = n * s;
+    size_t i = 0;
+    while (i < size)
+    {
+        if (io_state->chunk_index == io_state->chunk_size)
+        {
+            io_state->chunk_index = 0;
+            if (gta_get_compression(header) != GTA_NONE)
+            {
+                size_t direct_size;
+                retval = gta_read_elements_chunk(header, io_state, gathers ? NULL : (char *)buf + i, size - i,
+                        &direct_size, read_fn, userdata);
+                if (retval != GTA_OK)
+                {
+                    goto exit;
+                }
+                if (direct_size > 0)
+                {
+                    i += direct_size;
+                    continue;
+                }
+            }
+            else
+            {
+                size_t chunk_size = gta_max_chunk_size;
+                if (gta_get_data_size(header) < chunk_size)
+                {
+                    chunk_size = gta_get_data_size(header);
+                }
+                if (!gathers && size - i >= chunk_size)
+                {
+                    // read the rest of the request directly, bypassing the chunk buffer
+                    int error = false;
+                    size_t r = read_fn(userdata, (char *)buf + i, size - i, &error);
+                    if (error)
+                    {
+                        retval = GTA_SYSTEM_ERROR;
+                        goto exit;
+                    }
+                    if (r < size - i)
+                    {
+                        retval = GTA_UNEXPECTED_EOF;
+                        goto exit;
+                    }
+                    io_state->chunk_size = 0;
+                    io_state->already_read += size - i;
+                    i = size;
+                    continue;
+                }
+                retval = gta_reserve_io_state_chunk(io_state, chunk_size);
+                if (retval != GTA_OK)
+                {
+                    goto exit;
+                }
+                uintmax_t read_size = gta_get_data_size(header) - io_state->already_read;
+                if (read_size > chunk_size)
+                {
+                    read_size = chunk_size;
+                }
+                int error = false;
+                size_t r = read_fn(userdata, io_state->chunk, read_size, &error);
+                if (error)
+                {
+                    retval = GTA_SYSTEM_ERROR;
+                    goto exit;
+                }
+                if (r < read_size)
+                {
+                    retval = GTA_UNEXPECTED_EOF;
+                    goto exit;
+                }
+                io_state->chunk_size = read_size;
+                io_state->already_read += read_size;
+            }
+        }
+        size_t l = size - i;
+        if (l > io_state->chunk_size - io_state->chunk_index)
+        {
+            l = io_state->chunk_size - io_state->chunk_index;
+        }
+        if (gathers)
+        {
+            gta_gather_bytes(header, gathers, gathers_count, (char *)(io_state->chunk) + io_state->chunk_index, i, l);
+        }
+        else
+        {
+            memcpy((char *)buf + i, (char *)(io_state->chunk) + io_state->chunk_index, l);
+        }
+        i += l;
+        io_state->chunk_index += l;
+    }
+    io_state->counter += n;
+    if (io_state->counter == gta_get_elements(header))
+    {
+        if (gta_get_compression(header) != GTA_NONE)
         {
-            return GTA_OVERFLOW;
+            if (io_state->chunk_index != io_state->chunk_size)
+            {
+                retval = GTA_INVALID_DATA;
+                goto exit;
+            }
+            // read the last, empty chunk
+            size_t direct_size;
+            retval = gta_read_elements_chunk(header, io_state, NULL, 0, &direct_size, read_fn, userdata);
+            if (retval != GTA_OK)
+            {
+                goto exit;
+            }
+            if (io_state->chunk_size != 0)
+            {
+                retval = GTA_INVALID_DATA;
+                goto exit;
+            }
+            if (io_state->readahead)
+            {
+                gta_destroy_readahead(io_state->readahead);
+                io_state->readahead = NULL;
+            }
         }
-        data_size *= header->dimension_sizes[i];
+        // free the chunk; it will not be needed anymore
+        gta_free_io_state_chunk(io_state);
     }
-
-    uint8_t *my_types = NULL;
-    uintmax_t *my_blob_sizes = NULL;
-    gta_taglist_t **my_taglists = NULL;
-    if (n > 0)
+    if (gta_data_needs_endianness_swapping(header))
     {
-        my_types = malloc(n * sizeof(uint8_t));
-        if (blobs > 0)
-        {
-            my_blob_sizes = malloc(blobs * sizeof(uintmax_t));
-        }
-        my_taglists = malloc(n * sizeof(gta_taglist_t *));
-        if (!my_types || (blobs > 0 && !my_blob_sizes) || !my_taglists)
-        {
-            free(my_types);
-            free(my_blob_sizes);
-            free(my_taglists);
-            return GTA_SYSTEM_ERROR;
-        }
-        for (size_t i = 0; i < n; i++)
+        if (gathers)
         {
-            my_types[i] = types[i];
+            gta_swap_gathered_endianness(gathers, gathers_count, n);
         }
-        if (blobs > 0)
+        else
         {
-            memcpy(my_blob_sizes, sizes, blobs * sizeof(uintmax_t));
+            gta_swap_elements_endianness(header, buf, n);
         }
-        for (size_t i = 0; i < n; i++)
+    }
+exit:
+    if (retval != GTA_OK)
+    {
+        io_state->failure = true;
+        gta_free_io_state_chunk(io_state);
+        if (io_state->readahead)
         {
-            my_taglists[i] = malloc(sizeof(gta_taglist_t));
-            if (!my_taglists[i])
-            {
-                for (size_t j = 0; j < i; j++)
-                {
-                    gta_destroy_taglist(my_taglists[j]);
-                    free(my_taglists[j]);
-                }
-                free(my_types);
-                free(my_blob_sizes);
-                free(my_taglists);
-                return GTA_SYSTEM_ERROR;
-            }
-            gta_create_taglist(my_taglists[i]);
+            gta_destroy_readahead(io_state->readahead);
+            io_state->readahead = NULL;
         }
     }
+    return retval;
+}
 
-    for (size_t i = 0; i < header->components; i++)
+gta_result_t
+gta_read_elements(const gta_header_t *GTA_RESTRICT header, gta_io_state_t *GTA_RESTRICT io_state,
+        uintmax_t n, void *GTA_RESTRICT buf, gta_read_t read_fn, intptr_t userdata)
+{
+    return gta_read_elements_gather(header, io_state, n, buf, NULL, 0, read_fn, userdata);
+}
+
+gta_result_t
+gta_read_elements_from_stream(const gta_header_t *GTA_RESTRICT header, gta_io_state_t *GTA_RESTRICT io_state,
+        uintmax_t n, void *GTA_RESTRICT buf, FILE *GTA_RESTRICT f)
+{
+    return gta_read_elements(header, io_state, n, buf, gta_read_stream, (intptr_t)f);
+}
+
+gta_result_t
+gta_read_elements_from_fd(const gta_header_t *GTA_RESTRICT header, gta_io_state_t *GTA_RESTRICT io_state,
+        uintmax_t n, void *GTA_RESTRICT buf, int fd)
+{
+    return gta_read_elements(header, io_state, n, buf, gta_read_fd, fd);
+}
+
+gta_result_t
+gta_read_elements_from_memory(const gta_header_t *GTA_RESTRICT header, gta_io_state_t *GTA_RESTRICT io_state,
+        uintmax_t n, void *GTA_RESTRICT buf, const void *GTA_RESTRICT buffer, size_t size, size_t *GTA_RESTRICT offset)
+{
+    gta_memory_input_t m = { buffer, size, *offset };
+    gta_result_t retval = gta_read_elements(header, io_state, n, buf, gta_read_memory, (intptr_t)&m);
+    if (retval == GTA_OK)
     {
-        gta_destroy_taglist(header->component_taglists[i]);
-        free(header->component_taglists[i]);
+        *offset = (size_t)m.offset;
     }
-    free(header->component_types);
-    free(header->component_blob_sizes);
-    free(header->component_taglists);
+    return retval;
+}
 
-    header->components = n;
-    header->component_types = my_types;
-    header->component_blob_sizes = my_blob_sizes;
-    header->component_taglists = my_taglists;
-    header->element_size = element_size;
+gta_result_t
+gta_read_element_components(const gta_header_t *GTA_RESTRICT header, gta_io_state_t *GTA_RESTRICT io_state,
+        uintmax_t n, size_t count, const uintmax_t *GTA_RESTRICT components,
+        void *const *GTA_RESTRICT buffers, const size_t *GTA_RESTRICT strides,
+        gta_read_t read_fn, intptr_t userdata)
+{
+    gta_gather_t *gathers;
+    gta_result_t retval = gta_create_gather(header, count, components, buffers, strides, &gathers);
+    if (retval != GTA_OK)
+    {
+        return retval;
+    }
+    retval = gta_read_elements_gather(header, io_state, n, NULL, gathers, count, read_fn, userdata);
+    gta_free(gathers);
+    return retval;
+}
 
-    return GTA_OK;
+gta_result_t
+gta_read_element_components_from_stream(const gta_header_t *GTA_RESTRICT header, gta_io_state_t *GTA_RESTRICT io_state,
+        uintmax_t n, size_t count, const uintmax_t *GTA_RESTRICT components,
+        void *const *GTA_RESTRICT buffers, const size_t *GTA_RESTRICT strides, FILE *GTA_RESTRICT f)
+{
+    return gta_read_element_components(header, io_state, n, count, components, buffers, strides,
+            gta_read_stream, (intptr_t)f);
 }
 
-uintmax_t
-gta_get_dimensions(const gta_header_t *GTA_RESTRICT header)
+gta_result_t
+gta_read_element_components_from_fd(const gta_header_t *GTA_RESTRICT header, gta_io_state_t *GTA_RESTRICT io_state,
+        uintmax_t n, size_t count, const uintmax_t *GTA_RESTRICT components,
+        void *const *GTA_RESTRICT buffers, const size_t *GTA_RESTRICT strides, int fd)
 {
-    return header->dimensions;
+    return gta_read_element_components(header, io_state, n, count, components, buffers, strides,
+            gta_read_fd, fd);
 }
 
-uintmax_t
-gta_get_dimension_size(const gta_header_t *GTA_RESTRICT header, uintmax_t i)
+gta_result_t
+gta_read_element_components_from_memory(const gta_header_t *GTA_RESTRICT header, gta_io_state_t *GTA_RESTRICT io_state,
+        uintmax_t n, size_t count, const uintmax_t *GTA_RESTRICT components,
+        void *const *GTA_RESTRICT buffers, const size_t *GTA_RESTRICT strides,
+        const void *GTA_RESTRICT buffer, size_t size, size_t *GTA_RESTRICT offset)
 {
-    return header->dimension_sizes[i];
+    gta_memory_input_t m = { buffer, size, *offset };
+    gta_result_t retval = gta_read_element_components(header, io_state, n, count, components, buffers, strides,
+            gta_read_memory, (intptr_t)&m);
+    if (retval == GTA_OK)
+    {
+        *offset = (size_t)m.offset;
+    }
+    return retval;
 }
 
-const gta_taglist_t *
-gta_get_dimension_taglist_const(const gta_header_t *GTA_RESTRICT header, uintmax_t i)
+/**
+ * \brief               Get the compression workers of an output state.
+ * \param io_state      The output state.
+ * \param threads       The maximum number of compression threads.
+ * \return              The workers, or NULL for serial compression.
+ *
+ * The workers are started on first use and kept until all elements are written, so that
+ * the threads are not created again for each batch of chunks. The calling thread is one of
+ * the compression threads.
+ */
+static GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW
+gta_workers_t *
+gta_io_state_workers(gta_io_state_t *GTA_RESTRICT io_state, unsigned int threads)
 {
-    return header->dimension_taglists[i];
+    if (threads <= 1)
+    {
+        return NULL;
+    }
+    if (!io_state->workers)
+    {
+        io_state->workers = gta_create_workers(threads - 1);
+    }
+    return io_state->workers;
 }
 
-gta_taglist_t *
-gta_get_dimension_taglist(gta_header_t *GTA_RESTRICT header, uintmax_t i)
+/**
+ * \brief               Write the pending chunks of an output state.
+ * \param header        The header.
+ * \param io_state      The output state.
+ * \param threads       The maximum number of compression threads.
+ * \param last_chunk    An optional last chunk to write after the pending chunks.
+ * \param last_size     The size of the last chunk (0 if there is none).
+ * \param write_fn      The custom output function.
+ * \param userdata      A parameter to the custom output function.
+ * \return              \a GTA_OK, \a GTA_OVERFLOW, or \a GTA_SYSTEM_ERROR.
+ *
+ * All pending chunks are full, i.e. they have the maximum chunk size.
+ * They are freed by this function, even if an error occurs.
+ */
+static GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL1(1)
+gta_result_t
+gta_write_pending_chunks(const gta_header_t *GTA_RESTRICT header, gta_io_state_t *GTA_RESTRICT io_state,
+        unsigned int threads, const void *GTA_RESTRICT last_chunk, size_t last_size,
+        gta_write_t write_fn, intptr_t userdata)
 {
-    return header->dimension_taglists[i];
+    size_t jobs_count = io_state->pending_chunks_count + (last_size > 0 ? 1 : 0);
+    gta_chunk_job_t *jobs;
+    gta_result_t retval;
+
+    if (jobs_count == 0)
+    {
+        return GTA_OK;
+    }
+    jobs = gta_malloc(jobs_count * sizeof(gta_chunk_job_t));
+    if (!jobs)
+    {
+        gta_free_pending_chunks(io_state);
+        return GTA_SYSTEM_ERROR;
+    }
+    for (size_t j = 0; j < io_state->pending_chunks_count; j++)
+    {
+        jobs[j].chunk = io_state->pending_chunks[j];
+        jobs[j].chunk_size = gta_max_chunk_size;
+        jobs[j].compressed = NULL;
+    }
+    if (last_size > 0)
+    {
+        jobs[jobs_count - 1].chunk = last_chunk;
+        jobs[jobs_count - 1].chunk_size = last_size;
+        jobs[jobs_count - 1].compressed = NULL;
+    }
+    retval = gta_write_chunks(header, &io_state->codec, gta_io_state_workers(io_state, threads),
+            jobs, jobs_count, write_fn, userdata);
+    gta_free(jobs);
+    gta_free_pending_chunks(io_state);
+    return retval;
 }
 
+/**
+ * \brief               Write whole chunks directly from the caller's buffer.
+ * \param header        The header.
+ * \param io_state      The output state.
+ * \param threads       The maximum number of compression threads.
+ * \param buf           The remaining data of the current request, starting at a chunk boundary.
+ * \param size          The size of \a buf.
+ * \param remaining     The number of data bytes that remain to be written for the whole array.
+ * \param written       The number of bytes of \a buf that were written.
+ * \param write_fn      The custom output function.
+ * \param userdata      A parameter to the custom output function.
+ * \return              \a GTA_OK, \a GTA_OVERFLOW, or \a GTA_SYSTEM_ERROR.
+ *
+ * Each chunk that is completely contained in \a buf is compressed from there, without
+ * copying it into a chunk buffer first. The chunk boundaries are the same as if the data
+ * was written through the chunk buffer. Pending chunks are written first. With parallel
+ * compression, batches of \a threads chunks are compressed at the same time.
+ */
+static GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL3(1, 2, 7)
 gta_result_t
-gta_set_dimensions(gta_header_t *GTA_RESTRICT header, uintmax_t n, const uintmax_t *GTA_RESTRICT sizes)
+gta_write_elements_direct(const gta_header_t *GTA_RESTRICT header, gta_io_state_t *GTA_RESTRICT io_state,
+        unsigned int threads, const char *GTA_RESTRICT buf, size_t size, uintmax_t remaining,
+        size_t *GTA_RESTRICT written, gta_write_t write_fn, intptr_t userdata)
 {
-    uintmax_t data_size = header->element_size;
+    size_t batch = (threads > 1 ? threads : 1);
+    gta_chunk_job_t *jobs = NULL;
+    gta_result_t retval = GTA_OK;
 
-    if (n > UINT64_MAX || n > SIZE_MAX
-            || gta_size_overflow(n, sizeof(gta_taglist_t *))
-            || gta_size_overflow(n, sizeof(uintmax_t)))
+    *written = 0;
+    if (size < (remaining < gta_max_chunk_size ? remaining : gta_max_chunk_size))
+    {
+        return GTA_OK;
+    }
+    if (batch < io_state->pending_chunks_count + 1)
+    {
+        batch = io_state->pending_chunks_count + 1;
+    }
+    if (gta_size_overflow(batch, sizeof(gta_chunk_job_t)))
     {
         return GTA_OVERFLOW;
     }
-    for (size_t i = 0; i < n; i++)
+    jobs = gta_malloc(batch * sizeof(gta_chunk_job_t));
+    if (!jobs)
     {
-        if (sizes[i] < 1)
+        return GTA_SYSTEM_ERROR;
+    }
+    for (;;)
+    {
+        size_t jobs_count = 0;
+        for (size_t j = 0; j < io_state->pending_chunks_count; j++)
         {
-            return GTA_INVALID_DATA;
+            jobs[jobs_count].chunk = io_state->pending_chunks[j];
+            jobs[jobs_count].chunk_size = gta_max_chunk_size;
+            jobs[jobs_count].compressed = NULL;
+            jobs_count++;
         }
-        if (sizes[i] > UINT64_MAX)
+        size_t direct_chunks = 0;
+        while (jobs_count < batch)
         {
-            return GTA_OVERFLOW;
+            uintmax_t chunk_size = remaining - *written;
+            if (chunk_size > gta_max_chunk_size)
+            {
+                chunk_size = gta_max_chunk_size;
+            }
+            if (chunk_size == 0 || size - *written < chunk_size)
+            {
+                break;
+            }
+            jobs[jobs_count].chunk = buf + *written;
+            jobs[jobs_count].chunk_size = chunk_size;
+            jobs[jobs_count].compressed = NULL;
+            jobs_count++;
+            direct_chunks++;
+            *written += chunk_size;
+        }
+        if (direct_chunks == 0)
+        {
+            break;
+        }
+        retval = gta_write_chunks(header, &io_state->codec, gta_io_state_workers(io_state, threads),
+                jobs, jobs_count, write_fn, userdata);
+        gta_free_pending_chunks(io_state);
+        if (retval != GTA_OK)
+        {
+            break;
+        }
+    }
+    gta_free(jobs);
+    return retval;
+}
+
+gta_result_t
+gta_write_elements(const gta_header_t *GTA_RESTRICT header, gta_io_state_t *GTA_RESTRICT io_state,
+        uintmax_t n, const void *GTA_RESTRICT buf, gta_write_t write_fn, intptr_t userdata)
+{
+    gta_result_t retval = GTA_OK;
+
+    if (io_state->io_type == 0)
+    {
+        io_state->io_type = 2;
+    }
+    if (io_state->io_type != 2)
+    {
+        retval = GTA_INVALID_DATA;
+        goto exit;
+    }
+    if (io_state->failure)
+    {
+        retval = GTA_INVALID_DATA;
+        goto exit;
+    }
+    if (n > gta_get_elements(header) || io_state->counter > gta_get_elements(header) - n)
+    {
+        retval = GTA_INVALID_DATA;
+        goto exit;
+    }
+    uintmax_t s = gta_get_element_size(header);
+    if (s > SIZE_MAX || n > SIZE_MAX || gta_size_overflow(n, s))
+    {
+        retval = GTA_OVERFLOW;
+        goto exit;
+    }
+    unsigned int threads = (io_state->compression_threads > 0
+            ? io_state->compression_threads : header->compression_threads);
+    size_t size = n * s;
+    size_t i = 0;
+    while (i < size)
+    {
+        if (io_state->chunk_index == io_state->chunk_size)
+        {
+            if (gta_get_compression(header) != GTA_NONE)
+            {
+                if (io_state->chunk_index > 0 && threads > 1)
+                {
+                    // Keep the full chunk until enough chunks for parallel compression are available.
+                    void **pending_chunks = gta_realloc(io_state->pending_chunks,
+                            (io_state->pending_chunks_count + 1) * sizeof(void *));
+                    if (!pending_chunks)
+                    {
+                        retval = GTA_SYSTEM_ERROR;
+                        goto exit;
+                    }
+                    io_state->pending_chunks = pending_chunks;
+                    io_state->pending_chunks[io_state->pending_chunks_count++] = io_state->chunk;
+                    io_state->chunk = NULL;
+                    io_state->chunk_capacity = 0;
+                    if (io_state->pending_chunks_count >= threads)
+                    {
+                        retval = gta_write_pending_chunks(header, io_state, threads, NULL, 0, write_fn, userdata);
+                        if (retval != GTA_OK)
+                        {
+                            goto exit;
+                        }
+                    }
+                }
+                else if (io_state->chunk_index > 0)
+                {
+                    retval = gta_write_chunk(header, &io_state->codec, gta_filter_stride(header),
+                            io_state->chunk, io_state->chunk_index, write_fn, userdata);
+                    if (retval != GTA_OK)
+                    {
+                        goto exit;
+                    }
+                }
+                io_state->chunk_index = 0;
+                io_state->chunk_size = 0;
+                uintmax_t remaining_data = gta_get_data_size(header)
+                    - io_state->counter * gta_get_element_size(header) - i;
+                size_t direct_size;
+                retval = gta_write_elements_direct(header, io_state, threads, (const char *)buf + i, size - i,
+                        remaining_data, &direct_size, write_fn, userdata);
+                if (retval != GTA_OK)
+                {
+                    goto exit;
+                }
+                if (direct_size > 0)
+                {
+                    i += direct_size;
+                    continue;
+                }
+                size_t chunk_size = (remaining_data < gta_max_chunk_size) ? remaining_data : gta_max_chunk_size;
+                retval = gta_reserve_io_state_chunk(io_state, chunk_size);
+                if (retval != GTA_OK)
+                {
+                    goto exit;
+                }
+                io_state->chunk_size = chunk_size;
+            }
+            else
+            {
+                if (io_state->chunk_index > 0)
+                {
+                    int error = false;
+                    errno = 0;
+                    size_t r = write_fn(userdata, io_state->chunk, io_state->chunk_size, &error);
+                    if (error || r < io_state->chunk_size)
+                    {
+                        if (errno == 0)
+                        {
+                            errno = EIO;
+                        }
+                        retval = GTA_SYSTEM_ERROR;
+                        goto exit;
+                    }
+                }
+                io_state->chunk_index = 0;
+                io_state->chunk_size = 0;
+                size_t chunk_size = gta_max_chunk_size;
+                if (gta_get_data_size(header) < chunk_size)
+                {
+                    chunk_size = gta_get_data_size(header);
+                }
+                if (size - i >= chunk_size)
+                {
+                    // write the rest of the request directly, bypassing the chunk buffer
+                    int error = false;
+                    errno = 0;
+                    size_t r = write_fn(userdata, (const char *)buf + i, size - i, &error);
+                    if (error || r < size - i)
+                    {
+                        if (errno == 0)
+                        {
+                            errno = EIO;
+                        }
+                        retval = GTA_SYSTEM_ERROR;
+                        goto exit;
+                    }
+                    i = size;
+                    continue;
+                }
+                retval = gta_reserve_io_state_chunk(io_state, chunk_size);
+                if (retval != GTA_OK)
+                {
+                    goto exit;
+                }
+                io_state->chunk_size = chunk_size;
+            }
         }
-        if (gta_uintmax_overflow(data_size, sizes[i]))
+        size_t l = size - i;
+        if (l > io_state->chunk_size - io_state->chunk_index)
         {
-            return GTA_OVERFLOW;
+            l = io_state->chunk_size - io_state->chunk_index;
         }
-        data_size *= sizes[i];
+        memcpy((char *)(io_state->chunk) + io_state->chunk_index, (char *)buf + i, l);
+        i += l;
+        io_state->chunk_index += l;
     }
-
-    uintmax_t *my_sizes = NULL;
-    gta_taglist_t **my_taglists = NULL;
-    if (n > 0)
+    io_state->counter += n;
+    if (io_state->counter == gta_get_elements(header))
     {
-        my_sizes = malloc(n * sizeof(uintmax_t));
-        my_taglists = malloc(n * sizeof(gta_taglist_t *));
-        if (!my_sizes || !my_taglists)
+        if (gta_get_compression(header) != GTA_NONE)
         {
-            free(my_sizes);
-            free(my_taglists);
-            return GTA_SYSTEM_ERROR;
+            // flush chunks and write empty chunk
+            if (io_state->pending_chunks_count > 0)
+            {
+                retval = gta_write_pending_chunks(header, io_state, threads,
+                        io_state->chunk, io_state->chunk_index, write_fn, userdata);
+                if (retval != GTA_OK)
+                {
+                    goto exit;
+                }
+            }
+            else if (io_state->chunk_index > 0)
+            {
+                retval = gta_write_chunk(header, &io_state->codec, gta_filter_stride(header),
+                        io_state->chunk, io_state->chunk_index, write_fn, userdata);
+                if (retval != GTA_OK)
+                {
+                    goto exit;
+                }
+            }
+            gta_free_io_state_chunk(io_state);
+            gta_destroy_workers(io_state->workers);
+            io_state->workers = NULL;
+            retval = gta_write_chunk(header, NULL, 0, NULL, 0, write_fn, userdata);
+            if (retval != GTA_OK)
+            {
+                goto exit;
+            }
         }
-        memcpy(my_sizes, sizes, n * sizeof(uintmax_t));
-        for (size_t i = 0; i < n; i++)
+        else
         {
-            my_taglists[i] = malloc(sizeof(gta_taglist_t));
-            if (!my_taglists[i])
+            // flush
+            if (io_state->chunk_index > 0)
             {
-                for (size_t j = 0; j < i; j++)
+                int error = false;
+                errno = 0;
+                size_t r = write_fn(userdata, io_state->chunk, io_state->chunk_index, &error);
+                if (error || r < io_state->chunk_index)
                 {
-                    gta_destroy_taglist(my_taglists[j]);
-                    free(my_taglists[j]);
+                    if (errno == 0)
+                    {
+                        errno = EIO;
+                    }
+                    retval = GTA_SYSTEM_ERROR;
+                    goto exit;
                 }
-                free(my_sizes);
-                free(my_taglists);
-                return GTA_SYSTEM_ERROR;
             }
-            gta_create_taglist(my_taglists[i]);
+            // free the chunk; it will not be needed anymore
+            gta_free_io_state_chunk(io_state);
         }
     }
-
-    for (size_t i = 0; i < header->dimensions; i++)
-    {
-        gta_destroy_taglist(header->dimension_taglists[i]);
-        free(header->dimension_taglists[i]);
-    }
-    free(header->dimension_sizes);
-    free(header->dimension_taglists);
-
-    header->dimensions = n;
-    header->dimension_sizes = my_sizes;
-    header->dimension_taglists = my_taglists;
-
-    return GTA_OK;
-}
-
-uintmax_t
-gta_get_elements(const gta_header_t *GTA_RESTRICT header)
-{
-    if (header->dimensions == 0)
-    {
-        return 0;
-    }
-    else
+exit:
+    if (retval != GTA_OK)
     {
-        uintmax_t elements = header->dimension_sizes[0];
-        for (uintmax_t i = 1; i < header->dimensions; i++)
-        {
-            elements *= header->dimension_sizes[i];
-        }
-        return elements;
+        io_state->failure = true;
+        gta_free_io_state_chunk(io_state);
+        gta_free_pending_chunks(io_state);
     }
+    return retval;
 }
 
-uintmax_t
-gta_get_data_size(const gta_header_t *GTA_RESTRICT header)
+gta_result_t
+gta_write_elements_to_stream(const gta_header_t *GTA_RESTRICT header, gta_io_state_t *GTA_RESTRICT io_state,
+        uintmax_t n, const void *GTA_RESTRICT buf, FILE *GTA_RESTRICT f)
 {
-    return gta_get_element_size(header) * gta_get_elements(header);
+    return gta_write_elements(header, io_state, n, buf, gta_write_stream, (intptr_t)f);
 }
 
-gta_compression_t
-gta_get_compression(const gta_header_t *GTA_RESTRICT header)
+gta_result_t
+gta_write_elements_to_fd(const gta_header_t *GTA_RESTRICT header, gta_io_state_t *GTA_RESTRICT io_state,
+        uintmax_t n, const void *GTA_RESTRICT buf, int fd)
 {
-    return header->compression;
+    return gta_write_elements(header, io_state, n, buf, gta_write_fd, fd);
 }
 
-void
-gta_set_compression(gta_header_t *GTA_RESTRICT header, gta_compression_t compression)
+gta_result_t
+gta_write_elements_to_memory(const gta_header_t *GTA_RESTRICT header, gta_io_state_t *GTA_RESTRICT io_state,
+        uintmax_t n, const void *GTA_RESTRICT buf,
+        void *GTA_RESTRICT *GTA_RESTRICT buffer, size_t *GTA_RESTRICT size, size_t *GTA_RESTRICT capacity)
 {
-    header->compression = compression;
+    gta_memory_output_t m = { *buffer, *size, *capacity };
+    gta_result_t retval = gta_write_elements(header, io_state, n, buf, gta_write_memory, (intptr_t)&m);
+    *buffer = m.buffer;
+    *capacity = m.capacity;
+    if (retval == GTA_OK)
+    {
+        *size = m.size;
+    }
+    return retval;
 }
 
 
 /*
  *
- * In-Memory Data Access
+ * Read and Write Array Blocks
  *
  */
 
 
-void
-gta_linear_index_to_indices(const gta_header_t *GTA_RESTRICT header, uintmax_t index, uintmax_t *indices)
+/**
+ * \brief               Get the offset of an array element.
+ * \param header        The header.
+ * \param indices       The indices for each dimension of the array.
+ * \return              The offset of the element, relative to the start of the data.
+ */
+static GTA_ATTR_NONNULL_ALL GTA_ATTR_PURE GTA_ATTR_NOTHROW
+intmax_t
+gta_get_element_offset(const gta_header_t *GTA_RESTRICT header, const uintmax_t *GTA_RESTRICT indices)
 {
-    uintmax_t multiplied_dim_sizes = gta_get_elements(header);
+    uintmax_t index = 0;
+    uintmax_t dim_product = 1;
     for (uintmax_t i = 0; i < gta_get_dimensions(header); i++)
     {
-        uintmax_t j = gta_get_dimensions(header) - 1 - i;
-        multiplied_dim_sizes /= gta_get_dimension_size(header, j);
-        indices[j] = index / multiplied_dim_sizes;
-        index -= indices[j] * multiplied_dim_sizes;
+        if (i > 0)
+        {
+            dim_product *= gta_get_dimension_size(header, i - 1);
+        }
+        index += indices[i] * dim_product;
     }
+    return index * gta_get_element_size(header);
 }
 
+/**
+ * \brief                       Get the runs of contiguous data that a block consists of.
+ * \param header                The header.
+ * \param lower_coordinates     Coordinates of the lower corner element of the block.
+ * \param higher_coordinates    Coordinates of the higher corner element of the block.
+ * \param run_size              The size of one run, in bytes.
+ * \return                      The first dimension that is not part of a run.
+ *
+ * The leading dimensions that the block covers completely are contiguous in the data,
+ * and so is the following dimension. These are merged into a single run, so that a
+ * block that consists of complete rows or planes is transferred with few large I/O
+ * operations instead of one operation per row.
+ */
+static GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW
 uintmax_t
-gta_indices_to_linear_index(const gta_header_t *GTA_RESTRICT header, const uintmax_t *indices)
+gta_get_block_run(const gta_header_t *GTA_RESTRICT header,
+        const uintmax_t *GTA_RESTRICT lower_coordinates, const uintmax_t *GTA_RESTRICT higher_coordinates,
+        uintmax_t *GTA_RESTRICT run_size)
 {
-    uintmax_t dim_product = 1;
-    uintmax_t index = indices[0];
-    for (uintmax_t i = 1; i < gta_get_dimensions(header); i++)
+    uintmax_t run_elements = 1;
+    uintmax_t d = 0;
+    while (d < gta_get_dimensions(header))
     {
-        dim_product *= gta_get_dimension_size(header, i - 1);
-        index += indices[i] * dim_product;
+        run_elements *= higher_coordinates[d] - lower_coordinates[d] + 1;
+        bool complete = (lower_coordinates[d] == 0
+                && higher_coordinates[d] == gta_get_dimension_size(header, d) - 1);
+        d++;
+        if (!complete)
+        {
+            break;
+        }
     }
-    return index;
+    *run_size = run_elements * gta_get_element_size(header);
+    return d;
 }
 
-const void *
-gta_get_element_const(const gta_header_t *GTA_RESTRICT header, const void *GTA_RESTRICT data, const uintmax_t *GTA_RESTRICT indices)
+/**
+ * \brief                       Advance to the next run of a block.
+ * \param header                The header.
+ * \param run_dimension         The first dimension that is not part of a run.
+ * \param lower_coordinates     Coordinates of the lower corner element of the block.
+ * \param higher_coordinates    Coordinates of the higher corner element of the block.
+ * \param coords                The coordinates of the first element of the current run.
+ * \return                      Whether there is a next run.
+ */
+static GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW
+bool
+gta_next_block_run(const gta_header_t *GTA_RESTRICT header, uintmax_t run_dimension,
+        const uintmax_t *GTA_RESTRICT lower_coordinates, const uintmax_t *GTA_RESTRICT higher_coordinates,
+        uintmax_t *GTA_RESTRICT coords)
 {
-    // We know that size_t does not overflow because all the data is in a buffer
-    size_t index = gta_indices_to_linear_index(header, indices);
-    const char *ptr = data;
-    return ptr + index * gta_get_element_size(header);
+    for (uintmax_t d = run_dimension; d < gta_get_dimensions(header); d++)
+    {
+        if (coords[d] < higher_coordinates[d])
+        {
+            coords[d]++;
+            return true;
+        }
+        coords[d] = lower_coordinates[d];
+    }
+    return false;
 }
 
-void *
-gta_get_element(const gta_header_t *GTA_RESTRICT header, void *GTA_RESTRICT data, const uintmax_t *GTA_RESTRICT indices)
+/* Swap the endianness of all elements in a block buffer. */
+static GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW
+void
+gta_swap_block_endianness(const gta_header_t *GTA_RESTRICT header,
+        const uintmax_t *GTA_RESTRICT lower_coordinates, const uintmax_t *GTA_RESTRICT higher_coordinates,
+        void *GTA_RESTRICT block)
 {
-    return (void *)gta_get_element_const(header, data, indices);
+    uintmax_t elements = 1;
+    for (uintmax_t d = 0; d < gta_get_dimensions(header); d++)
+    {
+        elements *= higher_coordinates[d] - lower_coordinates[d] + 1;
+    }
+    gta_swap_elements_endianness(header, block, elements);
 }
 
-const void *
-gta_get_element_linear_const(const gta_header_t *GTA_RESTRICT header, const void *GTA_RESTRICT data, uintmax_t index)
+/* Check whether the offsets of a block of the given array can be computed without overflow. */
+static GTA_ATTR_NONNULL_ALL GTA_ATTR_PURE GTA_ATTR_NOTHROW
+gta_result_t
+gta_check_block_offsets(const gta_header_t *GTA_RESTRICT header, intmax_t data_offset,
+        const uintmax_t *GTA_RESTRICT higher_coordinates)
 {
-    return ((const char *)data) + index * gta_get_element_size(header);
+    if (data_offset > INTMAX_MAX - gta_get_element_offset(header, higher_coordinates)
+            || gta_get_element_size(header) > (uintmax_t)(INTMAX_MAX)
+            || data_offset + gta_get_element_offset(header, higher_coordinates) > INTMAX_MAX - (intmax_t)gta_get_element_size(header))
+    {
+        return GTA_OVERFLOW;
+    }
+    return GTA_OK;
 }
 
-void *
-gta_get_element_linear(const gta_header_t *GTA_RESTRICT header, void *GTA_RESTRICT data, uintmax_t index)
+/* Check whether a block of the given array can be accessed directly. */
+static GTA_ATTR_NONNULL_ALL GTA_ATTR_PURE GTA_ATTR_NOTHROW
+gta_result_t
+gta_check_block(const gta_header_t *GTA_RESTRICT header, intmax_t data_offset,
+        const uintmax_t *GTA_RESTRICT higher_coordinates)
 {
-    return (void *)gta_get_element_linear_const(header, data, index);
+    if (gta_get_compression(header) != GTA_NONE || gta_get_dimensions(header) == 0)
+    {
+        return GTA_UNSUPPORTED_DATA;
+    }
+    return gta_check_block_offsets(header, data_offset, higher_coordinates);
 }
 
-const void *
-gta_get_component_const(const gta_header_t *GTA_RESTRICT header, const void *GTA_RESTRICT element, uintmax_t i)
+gta_result_t
+gta_read_block(const gta_header_t *GTA_RESTRICT header, intmax_t data_offset,
+        const uintmax_t *GTA_RESTRICT lower_coordinates, const uintmax_t *GTA_RESTRICT higher_coordinates,
+        void *GTA_RESTRICT block, gta_read_t read_fn, gta_seek_t seek_fn, intptr_t userdata)
 {
-    // We know that size_t does not overflow because all the data is in a buffer
-    const char *c = element;
-    size_t blob_size_index = 0;
-    for (uintmax_t j = 0; j < i; j++)
+    gta_result_t retval = gta_check_block(header, data_offset, higher_coordinates);
+    if (retval != GTA_OK)
     {
-        switch (header->component_types[j])
-        {
-        case GTA_BLOB:
-            c += header->component_blob_sizes[blob_size_index++];
-            break;
-        case GTA_INT8:
-        case GTA_UINT8:
-            c += 1;
-            break;
-        case GTA_INT16:
-        case GTA_UINT16:
-            c += 2;
-            break;
-        case GTA_INT32:
-        case GTA_UINT32:
-        case GTA_FLOAT32:
-            c += 4;
+        return retval;
+    }
+
+    uintmax_t *coords = gta_malloc(gta_get_dimensions(header) * sizeof(uintmax_t));
+    if (!coords)
+    {
+        return GTA_SYSTEM_ERROR;
+    }
+
+    memcpy(coords, lower_coordinates, gta_get_dimensions(header) * sizeof(uintmax_t));
+    uintmax_t run_size;
+    uintmax_t run_dimension = gta_get_block_run(header, lower_coordinates, higher_coordinates, &run_size);
+    char *block_ptr = block;
+
+    for (;;)
+    {
+        intmax_t o = gta_get_element_offset(header, coords);
+        // Read data
+        int error = false;
+        seek_fn(userdata, data_offset + o, SEEK_SET, &error);
+        if (error)
+        {
+            retval = GTA_SYSTEM_ERROR;
             break;
-        case GTA_INT64:
-        case GTA_UINT64:
-        case GTA_FLOAT64:
-        case GTA_CFLOAT32:
-            c += 8;
+        }
+        size_t r = read_fn(userdata, block_ptr, run_size, &error);
+        if (error)
+        {
+            retval = GTA_SYSTEM_ERROR;
             break;
-        case GTA_INT128:
-        case GTA_UINT128:
-        case GTA_FLOAT128:
-        case GTA_CFLOAT64:
-            c += 16;
+        }
+        if (r < run_size)
+        {
+            retval = GTA_UNEXPECTED_EOF;
             break;
-        case GTA_CFLOAT128:
-            c += 32;
+        }
+        block_ptr += run_size;
+        if (!gta_next_block_run(header, run_dimension, lower_coordinates, higher_coordinates, coords))
+        {
             break;
         }
     }
-    return c;
+    // Fix endianness
+    if (retval == GTA_OK && gta_data_needs_endianness_swapping(header))
+    {
+        gta_swap_block_endianness(header, lower_coordinates, higher_coordinates, block);
+    }
+    gta_free(coords);
+    return retval;
 }
 
-void *
-gta_get_component(const gta_header_t *GTA_RESTRICT header, void *GTA_RESTRICT element, uintmax_t i)
+gta_result_t
+gta_read_block_from_stream(const gta_header_t *GTA_RESTRICT header, intmax_t data_offset,
+        const uintmax_t *GTA_RESTRICT lower_coordinates, const uintmax_t *GTA_RESTRICT higher_coordinates,
+        void *GTA_RESTRICT block, FILE *GTA_RESTRICT f)
 {
-    return (void *)gta_get_component_const(header, element, i);
+    return gta_read_block(header, data_offset, lower_coordinates, higher_coordinates, block,
+            gta_read_stream, gta_seek_stream, (intptr_t)f);
 }
 
+/* The maximum gap between two runs of data that is read over (and discarded)
+ * so that both runs can be read with a single operation. */
+static const size_t gta_block_gap_max = 64 * 1024;
 
-/*
- *
- * Read and Write Complete Arrays
- *
- */
+#if HAVE_PREADV
 
+/* The maximum number of bytes read with a single system call. */
+static const size_t gta_block_batch_max = 256 * 1024 * 1024;
+/* The maximum number of I/O vectors for a single system call. */
+#if defined IOV_MAX && IOV_MAX < 1024
+static const int gta_block_iov_max = IOV_MAX;
+#else
+static const int gta_block_iov_max = 1024;
+#endif
 
+/* Read the given I/O vectors completely from the given offset. */
+static GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW
 gta_result_t
-gta_read_data(const gta_header_t *GTA_RESTRICT header, void *GTA_RESTRICT data, gta_read_t read_fn, intptr_t userdata)
+gta_preadv_all(int fd, struct iovec *GTA_RESTRICT iov, int iovcnt, intmax_t offset)
 {
-    // We know that the data size fits into size_t, because the caller already allocated a buffer for all the data.
-    if (gta_get_compression(header) != GTA_NONE)
+    while (iovcnt > 0)
     {
-        char *data_ptr = data;
-        size_t remaining_size = gta_get_data_size(header);
-        void *chunk;
-        size_t chunk_size;
-        gta_result_t retval;
-
-        for (;;)
+        if (offset > OFF_MAX)
         {
-            retval = gta_read_chunk(header, &chunk, &chunk_size, read_fn, userdata);
-            if (retval != GTA_OK)
-            {
-                return retval;
-            }
-            if (chunk_size == 0)
-            {
-                if (remaining_size == 0)
-                {
-                    break;
-                }
-                else
-                {
-                    return GTA_INVALID_DATA;
-                }
-            }
-            if (chunk_size > remaining_size)
-            {
-                free(chunk);
-                return GTA_INVALID_DATA;
-            }
-            memcpy(data_ptr, chunk, chunk_size);
-            free(chunk);
-            remaining_size -= chunk_size;
-            data_ptr += chunk_size;
+            errno = EOVERFLOW;
+            return GTA_SYSTEM_ERROR;
         }
-    }
-    else
-    {
-        int input_error = false;
-        size_t r = read_fn(userdata, data, gta_get_data_size(header), &input_error);
-        if (input_error)
+        ssize_t r = preadv(fd, iov, iovcnt, offset);
+        if (r < 0)
         {
+            if (errno == EINTR)
+            {
+                continue;
+            }
             return GTA_SYSTEM_ERROR;
         }
-        if (r < gta_get_data_size(header))
+        if (r == 0)
         {
             return GTA_UNEXPECTED_EOF;
         }
-    }
-    if (gta_data_needs_endianness_swapping(header))
-    {
-        for (uintmax_t i = 0; i < gta_get_elements(header); i++)
+        offset += r;
+        while (iovcnt > 0 && (size_t)r >= iov->iov_len)
+        {
+            r -= iov->iov_len;
+            iov++;
+            iovcnt--;
+        }
+        if (iovcnt > 0)
         {
-            void *e = gta_get_element_linear(header, data, i);
-            gta_swap_element_endianness(header, e);
+            iov->iov_base = (char *)iov->iov_base + r;
+            iov->iov_len -= r;
         }
     }
     return GTA_OK;
 }
 
+/*
+ * Read a block from a file descriptor with positional, vectored I/O. Runs that are
+ * close to each other are read with a single system call; the gaps between them go
+ * to a scratch buffer.
+ */
+static GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW
 gta_result_t
-gta_read_data_from_stream(const gta_header_t *GTA_RESTRICT header, void *GTA_RESTRICT data, FILE *GTA_RESTRICT f)
+gta_read_block_fd(const gta_header_t *GTA_RESTRICT header, intmax_t data_offset,
+        const uintmax_t *GTA_RESTRICT lower_coordinates, const uintmax_t *GTA_RESTRICT higher_coordinates,
+        void *GTA_RESTRICT block, int fd)
 {
-    return gta_read_data(header, data, gta_read_stream, (intptr_t)f);
-}
+    gta_result_t retval = gta_check_block(header, data_offset, higher_coordinates);
+    if (retval != GTA_OK)
+    {
+        return retval;
+    }
 
-gta_result_t
-gta_read_data_from_fd(const gta_header_t *GTA_RESTRICT header, void *GTA_RESTRICT data, int fd)
-{
-    return gta_read_data(header, data, gta_read_fd, fd);
-}
+    uintmax_t *coords = gta_malloc(gta_get_dimensions(header) * sizeof(uintmax_t));
+    struct iovec *iov = gta_malloc(gta_block_iov_max * sizeof(struct iovec));
+    void *gap = NULL;
+    if (!coords || !iov)
+    {
+        retval = GTA_SYSTEM_ERROR;
+        goto exit;
+    }
 
-gta_result_t
-gta_skip_data(const gta_header_t *GTA_RESTRICT header, gta_read_t read_fn, gta_seek_t seek_fn, intptr_t userdata)
-{
-    gta_result_t retval;
+    memcpy(coords, lower_coordinates, gta_get_dimensions(header) * sizeof(uintmax_t));
+    uintmax_t run_size;
+    uintmax_t run_dimension = gta_get_block_run(header, lower_coordinates, higher_coordinates, &run_size);
+    char *block_ptr = block;
+    int iovcnt = 0;
+    intmax_t batch_offset = 0;  // File offset of the first byte of the current batch
+    intmax_t batch_end = 0;     // File offset after the last byte of the current batch
+    uintmax_t batch_size = 0;
 
-    if (gta_get_compression(header) != GTA_NONE)
+    for (;;)
     {
-        uintmax_t s = gta_get_data_size(header);
-        size_t chunk_size;
-        while (s > 0)
+        intmax_t o = data_offset + gta_get_element_offset(header, coords);
+        uintmax_t remaining = run_size;
+        while (remaining > 0)
         {
-            retval = gta_skip_chunk(header, &chunk_size, read_fn, seek_fn, userdata);
-            if (retval != GTA_OK)
+            uintmax_t l = (remaining < gta_block_batch_max ? remaining : gta_block_batch_max);
+            if (iovcnt > 0
+                    && ((uintmax_t)(o - batch_end) > gta_block_gap_max
+                        || iovcnt > gta_block_iov_max - 2
+                        || batch_size + (o - batch_end) + l > gta_block_batch_max))
             {
-                return retval;
+                retval = gta_preadv_all(fd, iov, iovcnt, batch_offset);
+                if (retval != GTA_OK)
+                {
+                    goto exit;
+                }
+                iovcnt = 0;
             }
-            if (chunk_size > s)
+            if (iovcnt == 0)
             {
-                return GTA_INVALID_DATA;
+                batch_offset = o;
+                batch_size = 0;
             }
-            s -= chunk_size;
-            if (chunk_size == 0 && s > 0)
+            else if (o > batch_end)
             {
-                return GTA_INVALID_DATA;
+                if (!gap)
+                {
+                    gap = gta_malloc(gta_block_gap_max);
+                    if (!gap)
+                    {
+                        retval = GTA_SYSTEM_ERROR;
+                        goto exit;
+                    }
+                }
+                iov[iovcnt].iov_base = gap;
+                iov[iovcnt].iov_len = o - batch_end;
+                iovcnt++;
+                batch_size += o - batch_end;
             }
+            iov[iovcnt].iov_base = block_ptr;
+            iov[iovcnt].iov_len = l;
+            iovcnt++;
+            batch_size += l;
+            block_ptr += l;
+            o += l;
+            batch_end = o;
+            remaining -= l;
         }
-        retval = gta_skip_chunk(header, &chunk_size, read_fn, seek_fn, userdata);
-        if (retval != GTA_OK)
-        {
-            return retval;
-        }
-        if (chunk_size != 0)
+        if (!gta_next_block_run(header, run_dimension, lower_coordinates, higher_coordinates, coords))
         {
-            return GTA_INVALID_DATA;
+            break;
         }
     }
-    else
+    if (iovcnt > 0)
     {
-        if (seek_fn)
-        {
-            if (gta_get_data_size(header) > (uintmax_t)(INTMAX_MAX))
-            {
-                return GTA_OVERFLOW;
-            }
-            int error = false;
-            seek_fn(userdata, gta_get_data_size(header), SEEK_CUR, &error);
-            if (error)
-            {
-                return GTA_SYSTEM_ERROR;
-            }
-        }
-        else
+        retval = gta_preadv_all(fd, iov, iovcnt, batch_offset);
+        if (retval != GTA_OK)
         {
-            retval = gta_readskip(read_fn, userdata, gta_get_data_size(header));
-            if (retval != GTA_OK)
-            {
-                return retval;
-            }
+            goto exit;
         }
     }
-    return GTA_OK;
-}
+    // Fix endianness
+    if (gta_data_needs_endianness_swapping(header))
+    {
+        gta_swap_block_endianness(header, lower_coordinates, higher_coordinates, block);
+    }
 
-gta_result_t
-gta_skip_data_from_stream(const gta_header_t *GTA_RESTRICT header, FILE *GTA_RESTRICT f)
-{
-    return gta_skip_data(header, gta_read_stream,
-            (ftello(f) == -1 ? NULL : gta_seek_stream), (intptr_t)f);
+exit:
+    gta_free(gap);
+    gta_free(iov);
+    gta_free(coords);
+    return retval;
 }
 
+#endif
+
 gta_result_t
-gta_skip_data_from_fd(const gta_header_t *GTA_RESTRICT header, int fd)
+gta_read_block_from_fd(const gta_header_t *GTA_RESTRICT header, intmax_t data_offset,
+        const uintmax_t *GTA_RESTRICT lower_coordinates, const uintmax_t *GTA_RESTRICT higher_coordinates,
+        void *GTA_RESTRICT block, int fd)
 {
-    return gta_skip_data(header, gta_read_fd,
-            (lseek(fd, 0, SEEK_CUR) == -1 ? NULL : gta_seek_fd), fd);
+#if HAVE_PREADV
+    return gta_read_block_fd(header, data_offset, lower_coordinates, higher_coordinates, block, fd);
+#else
+    return gta_read_block(header, data_offset, lower_coordinates, higher_coordinates, block,
+            gta_read_fd, gta_seek_fd, fd);
+#endif
 }
 
 gta_result_t
-gta_write_data(const gta_header_t *GTA_RESTRICT header, const void *GTA_RESTRICT data, gta_write_t write_fn, intptr_t userdata)
+gta_read_block_components(const gta_header_t *GTA_RESTRICT header, intmax_t data_offset,
+        const uintmax_t *GTA_RESTRICT lower_coordinates, const uintmax_t *GTA_RESTRICT higher_coordinates,
+        size_t count, const uintmax_t *GTA_RESTRICT components,
+        void *const *GTA_RESTRICT buffers, const size_t *GTA_RESTRICT strides,
+        gta_read_t read_fn, gta_seek_t seek_fn, intptr_t userdata)
 {
-    // We know that the data size fits into size_t, because the caller already allocated a buffer for all the data.
-    if (gta_get_compression(header) != GTA_NONE)
+    gta_result_t retval = gta_check_block(header, data_offset, higher_coordinates);
+    if (retval != GTA_OK)
     {
-        const char *chunk_ptr = data;
-        size_t remaining_size = gta_get_data_size(header);
-        size_t chunk_size;
-        gta_result_t retval;
+        return retval;
+    }
 
-        for (;;)
-        {
-            chunk_size = gta_max_chunk_size;
-            if (chunk_size > remaining_size)
-            {
-                chunk_size = remaining_size;
-            }
-            retval = gta_write_chunk(header, chunk_ptr, chunk_size, write_fn, userdata);
-            if (retval != GTA_OK)
-            {
-                return retval;
-            }
-            if (chunk_size == 0)
-            {
-                break;
-            }
-            chunk_ptr += chunk_size;
-            remaining_size -= chunk_size;
-        }
+    gta_gather_t *gathers;
+    retval = gta_create_gather(header, count, components, buffers, strides, &gathers);
+    if (retval != GTA_OK)
+    {
+        return retval;
+    }
+    uintmax_t element_size = gta_get_element_size(header);
+    if (element_size == 0)
+    {
+        // Elements without components have no data
+        gta_free(gathers);
         return GTA_OK;
     }
-    else
+    uintmax_t *coords = gta_malloc(gta_get_dimensions(header) * sizeof(uintmax_t));
+    void *piece = NULL;
+    if (!coords)
     {
-        int output_error = false;
-        errno = 0;
-        size_t r = write_fn(userdata, data, gta_get_data_size(header), &output_error);
-        if (output_error || r < gta_get_data_size(header))
+        retval = GTA_SYSTEM_ERROR;
+        goto exit;
+    }
+
+    memcpy(coords, lower_coordinates, gta_get_dimensions(header) * sizeof(uintmax_t));
+    uintmax_t run_size;
+    uintmax_t run_dimension = gta_get_block_run(header, lower_coordinates, higher_coordinates, &run_size);
+    // Each run is read in pieces through a temporary buffer, from which the components are gathered
+    uintmax_t piece_size = gta_max_chunk_size - gta_max_chunk_size % element_size;
+    if (piece_size == 0)
+    {
+        piece_size = element_size;
+    }
+    if (piece_size > run_size)
+    {
+        piece_size = run_size;
+    }
+    piece = gta_alloc_chunk(piece_size);
+    if (!piece)
+    {
+        retval = GTA_SYSTEM_ERROR;
+        goto exit;
+    }
+    uintmax_t pos = 0;          // Position in the data of all block elements
+
+    for (;;)
+    {
+        intmax_t o = gta_get_element_offset(header, coords);
+        int error = false;
+        seek_fn(userdata, data_offset + o, SEEK_SET, &error);
+        if (error)
+        {
+            retval = GTA_SYSTEM_ERROR;
+            goto exit;
+        }
+        uintmax_t remaining = run_size;
+        while (remaining > 0)
         {
-            if (errno == 0)
+            size_t l = (remaining < piece_size ? remaining : piece_size);
+            size_t r = read_fn(userdata, piece, l, &error);
+            if (error)
             {
-                errno = EIO;
+                retval = GTA_SYSTEM_ERROR;
+                goto exit;
             }
-            return GTA_SYSTEM_ERROR;
+            if (r < l)
+            {
+                retval = GTA_UNEXPECTED_EOF;
+                goto exit;
+            }
+            gta_gather_bytes(header, gathers, count, piece, pos, l);
+            pos += l;
+            remaining -= l;
+        }
+        if (!gta_next_block_run(header, run_dimension, lower_coordinates, higher_coordinates, coords))
+        {
+            break;
         }
-        return GTA_OK;
     }
+    // Fix endianness
+    if (gta_data_needs_endianness_swapping(header))
+    {
+        gta_swap_gathered_endianness(gathers, count, pos / element_size);
+    }
+
+exit:
+    gta_free_chunk(piece);
+    gta_free(coords);
+    gta_free(gathers);
+    return retval;
 }
 
 gta_result_t
-gta_write_data_to_stream(const gta_header_t *GTA_RESTRICT header, const void *GTA_RESTRICT data, FILE *GTA_RESTRICT f)
+gta_read_block_components_from_stream(const gta_header_t *GTA_RESTRICT header, intmax_t data_offset,
+        const uintmax_t *GTA_RESTRICT lower_coordinates, const uintmax_t *GTA_RESTRICT higher_coordinates,
+        size_t count, const uintmax_t *GTA_RESTRICT components,
+        void *const *GTA_RESTRICT buffers, const size_t *GTA_RESTRICT strides, FILE *GTA_RESTRICT f)
 {
-    return gta_write_data(header, data, gta_write_stream, (intptr_t)f);
+    return gta_read_block_components(header, data_offset, lower_coordinates, higher_coordinates,
+            count, components, buffers, strides, gta_read_stream, gta_seek_stream, (intptr_t)f);
 }
 
 gta_result_t
-gta_write_data_to_fd(const gta_header_t *GTA_RESTRICT header, const void *GTA_RESTRICT data, int fd)
+gta_read_block_components_from_fd(const gta_header_t *GTA_RESTRICT header, intmax_t data_offset,
+        const uintmax_t *GTA_RESTRICT lower_coordinates, const uintmax_t *GTA_RESTRICT higher_coordinates,
+        size_t count, const uintmax_t *GTA_RESTRICT components,
+        void *const *GTA_RESTRICT buffers, const size_t *GTA_RESTRICT strides, int fd)
 {
-    return gta_write_data(header, data, gta_write_fd, fd);
+    return gta_read_block_components(header, data_offset, lower_coordinates, higher_coordinates,
+            count, components, buffers, strides, gta_read_fd, gta_seek_fd, fd);
 }
 
-gta_result_t
-gta_copy_data(const gta_header_t *GTA_RESTRICT read_header, gta_read_t read_fn, intptr_t read_userdata,
-        const gta_header_t *GTA_RESTRICT write_header, gta_write_t write_fn, intptr_t write_userdata)
+#if HAVE_PWRITE
+
+/* Write a buffer completely to the given offset. */
+static GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW
+size_t
+gta_pwrite_all(int fd, const void *GTA_RESTRICT buffer, size_t size, intmax_t offset, int *GTA_RESTRICT error)
 {
-    if (gta_get_dimensions(read_header) != gta_get_dimensions(write_header)
-            || gta_get_components(read_header) != gta_get_components(write_header))
-    {
-        return GTA_INVALID_DATA;
-    }
-    for (uintmax_t i = 0; i < gta_get_dimensions(read_header); i++)
+    const char *ptr = buffer;
+    size_t bytes_written = 0;
+    while (bytes_written < size)
     {
-        if (gta_get_dimension_size(read_header, i) != gta_get_dimension_size(write_header, i))
+        if (offset > OFF_MAX)
         {
-            return GTA_INVALID_DATA;
+            errno = EOVERFLOW;
+            *error = true;
+            break;
         }
-    }
-    for (uintmax_t i = 0; i < gta_get_components(read_header); i++)
-    {
-        if (gta_get_component_type(read_header, i) != gta_get_component_type(write_header, i))
+        size_t remaining_size = size - bytes_written;
+        ssize_t r = pwrite(fd, ptr, (remaining_size <= SSIZE_MAX ? remaining_size : SSIZE_MAX), offset);
+        if (r < 0)
         {
-            return GTA_INVALID_DATA;
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            *error = true;
+            break;
         }
-        if (gta_get_component_type(read_header, i) == GTA_BLOB
-                && gta_get_component_size(read_header, i) != gta_get_component_size(write_header, i))
+        if (r == 0)
         {
-            return GTA_INVALID_DATA;
+            break;
         }
+        bytes_written += r;
+        ptr += r;
+        offset += r;
+    }
+    return bytes_written;
+}
+
+#endif
+
+/*
+ * Write a block with either write_fn and seek_fn, or, if fd is not -1, with positional
+ * writes to the file descriptor.
+ */
+static GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL3(1, 3, 4) GTA_ATTR_NOTHROW
+gta_result_t
+gta_write_block_runs(const gta_header_t *GTA_RESTRICT header, intmax_t data_offset,
+        const uintmax_t *GTA_RESTRICT lower_coordinates, const uintmax_t *GTA_RESTRICT higher_coordinates,
+        const void *GTA_RESTRICT block, gta_write_t write_fn, gta_seek_t seek_fn, intptr_t userdata, int fd)
+{
+    gta_result_t retval = gta_check_block(header, data_offset, higher_coordinates);
+    if (retval != GTA_OK)
+    {
+        return retval;
     }
 
-    uintmax_t size = gta_get_data_size(read_header);
-    gta_result_t retval = GTA_OK;
+    uintmax_t *coords = gta_malloc(gta_get_dimensions(header) * sizeof(uintmax_t));
+    if (!coords)
+    {
+        return GTA_SYSTEM_ERROR;
+    }
 
-    if (gta_get_compression(read_header) != GTA_NONE)
+    memcpy(coords, lower_coordinates, gta_get_dimensions(header) * sizeof(uintmax_t));
+    uintmax_t run_size;
+    uintmax_t run_dimension = gta_get_block_run(header, lower_coordinates, higher_coordinates, &run_size);
+    // If the endianness needs to be fixed, each run is written in pieces through a temporary buffer.
+    // Elements without components have no data to fix.
+    uintmax_t piece_size = run_size;
+    void *temp_block = NULL;
+    if (gta_get_element_size(header) > 0 && gta_data_needs_endianness_swapping(header))
     {
-        void *chunk = NULL;
-        size_t chunk_size = 0;
-        do
+        uintmax_t max_piece_size = gta_max_chunk_size - gta_max_chunk_size % gta_get_element_size(header);
+        if (max_piece_size == 0)
         {
-            retval = gta_read_chunk(read_header, &chunk, &chunk_size, read_fn, read_userdata);
-            if (retval != GTA_OK)
-            {
-                free(chunk);
-                return retval;
-            }
-            if (chunk_size > size)
-            {
-                free(chunk);
-                return GTA_INVALID_DATA;
-            }
-            if (gta_get_compression(write_header) != GTA_NONE)
-            {
-                retval = gta_write_chunk(write_header, chunk, chunk_size, write_fn, write_userdata);
-            }
-            else
-            {
-                int error = false;
-                errno = 0;
-                size_t r = write_fn(write_userdata, chunk, chunk_size, &error);
-                if (error || r < chunk_size)
-                {
-                    if (errno == 0)
-                    {
-                        errno = EIO;
-                    }
-                    retval = GTA_SYSTEM_ERROR;
-                }
-            }
-            free(chunk);
-            if (retval != GTA_OK)
-            {
-                return retval;
-            }
-            size -= chunk_size;
+            max_piece_size = gta_get_element_size(header);
         }
-        while (chunk_size > 0);
-        if (size > 0)
+        if (piece_size > max_piece_size)
         {
-            return GTA_UNEXPECTED_EOF;
+            piece_size = max_piece_size;
         }
-    }
-    else
-    {
-        void *chunk = NULL;
-        size_t chunk_size = 0;
-        size_t chunk_index = 0;
-        void *buffer = malloc(size < gta_max_chunk_size ? size : gta_max_chunk_size);
-
-        if (!buffer)
+        temp_block = gta_alloc_chunk(piece_size);
+        if (!temp_block)
         {
+            gta_free(coords);
             return GTA_SYSTEM_ERROR;
         }
-        if (gta_get_compression(write_header) != GTA_NONE)
+    }
+    const char *block_ptr = block;
+
+    for (;;)
+    {
+        intmax_t o = data_offset + gta_get_element_offset(header, coords);
+        int error = false;
+        if (fd == -1)
         {
-            chunk_size = (size < gta_max_chunk_size ? size : gta_max_chunk_size);
-            chunk = malloc(chunk_size);
-            if (!chunk)
+            seek_fn(userdata, o, SEEK_SET, &error);
+            if (error)
             {
-                free(buffer);
-                return GTA_SYSTEM_ERROR;
+                retval = GTA_SYSTEM_ERROR;
+                break;
             }
         }
-        while (size > 0)
+        uintmax_t remaining = run_size;
+        while (remaining > 0)
         {
-            int error = false;
-            size_t x = (size > gta_max_chunk_size ? gta_max_chunk_size : size);
-            size_t r = read_fn(read_userdata, buffer, x, &error);
-            if (error)
+            size_t l = (remaining < piece_size ? remaining : piece_size);
+            const void *ptr = block_ptr;
+            // Fix endianness (we must not change endianness of an existing file)
+            if (temp_block)
             {
-                free(buffer);
-                free(chunk);
-                return GTA_SYSTEM_ERROR;
+                memcpy(temp_block, block_ptr, l);
+                gta_swap_elements_endianness(header, temp_block, l / gta_get_element_size(header));
+                ptr = temp_block;
             }
-            if (r < x)
+            // Write data
+            errno = 0;
+            size_t r;
+#if HAVE_PWRITE
+            if (fd != -1)
             {
-                free(buffer);
-                free(chunk);
-                return GTA_UNEXPECTED_EOF;
+                r = gta_pwrite_all(fd, ptr, l, o, &error);
             }
-            if (gta_get_compression(write_header) != GTA_NONE)
+            else
+#endif
             {
-                retval = gta_write_blob_to_chunk(write_header, write_fn, write_userdata,
-                        chunk, chunk_size, &chunk_index, buffer, x);
-                if (retval != GTA_OK)
-                {
-                    free(buffer);
-                    free(chunk);
-                    return retval;
-                }
+                r = write_fn(userdata, ptr, l, &error);
             }
-            else
+            if (error || r < l)
             {
-                int error = false;
-                errno = 0;
-                r = write_fn(write_userdata, buffer, x, &error);
-                if (error || r < x)
+                if (errno == 0)
                 {
-                    if (errno == 0)
-                    {
-                        errno = EIO;
-                    }
-                    free(buffer);
-                    free(chunk);
-                    return GTA_SYSTEM_ERROR;
+                    errno = EIO;
                 }
+                retval = GTA_SYSTEM_ERROR;
+                goto exit;
             }
-            size -= x;
+            block_ptr += l;
+            o += l;
+            remaining -= l;
         }
-        free(buffer);
-        if (gta_get_compression(write_header) != GTA_NONE)
+        if (!gta_next_block_run(header, run_dimension, lower_coordinates, higher_coordinates, coords))
         {
-            if (chunk_index > 0)
-            {
-                retval = gta_write_chunk(write_header, chunk, chunk_index, write_fn, write_userdata);
-                if (retval != GTA_OK)
-                {
-                    free(chunk);
-                    return retval;
-                }
-            }
-            free(chunk);
-            retval = gta_write_chunk(write_header, NULL, 0, write_fn, write_userdata);
-            if (retval != GTA_OK)
-            {
-                return retval;
-            }
+            break;
         }
     }
-    return GTA_OK;
+
+exit:
+    gta_free_chunk(temp_block);
+    gta_free(coords);
+    return retval;
 }
 
 gta_result_t
-gta_copy_data_stream(
-        const gta_header_t *GTA_RESTRICT read_header, FILE *GTA_RESTRICT read_f,
-        const gta_header_t *GTA_RESTRICT write_header, FILE *GTA_RESTRICT write_f)
+gta_write_block(const gta_header_t *GTA_RESTRICT header, intmax_t data_offset,
+        const uintmax_t *GTA_RESTRICT lower_coordinates, const uintmax_t *GTA_RESTRICT higher_coordinates,
+        const void *GTA_RESTRICT block, gta_write_t write_fn, gta_seek_t seek_fn, intptr_t userdata)
 {
-    return gta_copy_data(
-            read_header, gta_read_stream, (intptr_t)read_f,
-            write_header, gta_write_stream, (intptr_t)write_f);
+    return gta_write_block_runs(header, data_offset, lower_coordinates, higher_coordinates, block,
+            write_fn, seek_fn, userdata, -1);
 }
 
 gta_result_t
-gta_copy_data_fd(
-        const gta_header_t *GTA_RESTRICT read_header, int read_fd,
-        const gta_header_t *GTA_RESTRICT write_header, int write_fd)
+gta_write_block_to_stream(const gta_header_t *GTA_RESTRICT header, intmax_t data_offset,
+        const uintmax_t *GTA_RESTRICT lower_coordinates, const uintmax_t *GTA_RESTRICT higher_coordinates,
+        const void *GTA_RESTRICT block, FILE *GTA_RESTRICT f)
 {
-    return gta_copy_data(
-            read_header, gta_read_fd, read_fd,
-            write_header, gta_write_fd, write_fd);
+    return gta_write_block(header, data_offset, lower_coordinates, higher_coordinates, block,
+            gta_write_stream, gta_seek_stream, (intptr_t)f);
 }
 
+gta_result_t
+gta_write_block_to_fd(const gta_header_t *GTA_RESTRICT header, intmax_t data_offset,
+        const uintmax_t *GTA_RESTRICT lower_coordinates, const uintmax_t *GTA_RESTRICT higher_coordinates,
+        const void *GTA_RESTRICT block, int fd)
+{
+#if HAVE_PWRITE
+    return gta_write_block_runs(header, data_offset, lower_coordinates, higher_coordinates, block,
+            gta_write_fd, gta_seek_fd, fd, fd);
+#else
+    return gta_write_block(header, data_offset, lower_coordinates, higher_coordinates, block,
+            gta_write_fd, gta_seek_fd, fd);
+#endif
+}
 
-/*
- *
- * Read and Write Array Elements
- *
- */
+gta_result_t
+gta_pread_block_from_fd(const gta_header_t *GTA_RESTRICT header, intmax_t data_offset,
+        const uintmax_t *GTA_RESTRICT lower_coordinates, const uintmax_t *GTA_RESTRICT higher_coordinates,
+        void *GTA_RESTRICT block, int fd)
+{
+#if HAVE_PREADV
+    return gta_read_block_fd(header, data_offset, lower_coordinates, higher_coordinates, block, fd);
+#else
+    (void)header;
+    (void)data_offset;
+    (void)lower_coordinates;
+    (void)higher_coordinates;
+    (void)block;
+    (void)fd;
+    errno = ENOSYS;
+    return GTA_SYSTEM_ERROR;
+#endif
+}
 
 gta_result_t
-gta_create_io_state(gta_io_state_t *GTA_RESTRICT *GTA_RESTRICT io_state)
+gta_pwrite_block_to_fd(const gta_header_t *GTA_RESTRICT header, intmax_t data_offset,
+        const uintmax_t *GTA_RESTRICT lower_coordinates, const uintmax_t *GTA_RESTRICT higher_coordinates,
+        const void *GTA_RESTRICT block, int fd)
 {
-    *io_state = malloc(sizeof(gta_io_state_t));
-    if (!*io_state)
-    {
-        return GTA_SYSTEM_ERROR;
-    }
-    (*io_state)->io_type = 0;
-    (*io_state)->failure = false;
-    (*io_state)->counter = 0;
-    (*io_state)->chunk = NULL;
-    (*io_state)->chunk_size = 0;
-    (*io_state)->chunk_index = 0;
-    (*io_state)->already_read = 0;
-    return GTA_OK;
+#if HAVE_PWRITE
+    return gta_write_block_runs(header, data_offset, lower_coordinates, higher_coordinates, block,
+            gta_write_fd, gta_seek_fd, fd, fd);
+#else
+    (void)header;
+    (void)data_offset;
+    (void)lower_coordinates;
+    (void)higher_coordinates;
+    (void)block;
+    (void)fd;
+    errno = ENOSYS;
+    return GTA_SYSTEM_ERROR;
+#endif
 }
 
-void
-gta_destroy_io_state(gta_io_state_t *GTA_RESTRICT io_state)
+/* A run of contiguous data of one block in a multi-block read. */
+typedef struct
+{
+    uintmax_t offset;   // Offset relative to the start of the data
+    uintmax_t size;     // Size in bytes
+    char *dst;          // Destination in the block buffer
+} gta_block_run_t;
+
+static int
+gta_block_run_cmp(const void *a, const void *b)
 {
-    free(io_state->chunk);
-    free(io_state);
+    const gta_block_run_t *ra = a;
+    const gta_block_run_t *rb = b;
+    return (ra->offset < rb->offset ? -1 : ra->offset > rb->offset ? +1 : 0);
 }
 
+/*
+ * Read size bytes at the given offset, either with read_fn and seek_fn, or, if fd is not -1,
+ * with positional I/O from the file descriptor.
+ */
+static GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NOTHROW
 gta_result_t
-gta_clone_io_state(gta_io_state_t *GTA_RESTRICT dst_io_state,
-        const gta_io_state_t *GTA_RESTRICT src_io_state)
+gta_read_at(intmax_t offset, void *GTA_RESTRICT buffer, size_t size,
+        gta_read_t read_fn, gta_seek_t seek_fn, intptr_t userdata, int fd)
 {
-    void *chunk = NULL;
-
-    if (src_io_state->chunk)
+#if HAVE_PREADV
+    if (fd != -1)
+    {
+        struct iovec iov;
+        iov.iov_base = buffer;
+        iov.iov_len = size;
+        return gta_preadv_all(fd, &iov, 1, offset);
+    }
+#else
+    (void)fd;
+#endif
+    int error = false;
+    seek_fn(userdata, offset, SEEK_SET, &error);
+    if (error)
     {
-        chunk = malloc(src_io_state->chunk_size);
-        if (!chunk)
-        {
-            return GTA_SYSTEM_ERROR;
-        }
-        memcpy(chunk, src_io_state->chunk, src_io_state->chunk_size);
+        return GTA_SYSTEM_ERROR;
+    }
+    size_t r = read_fn(userdata, buffer, size, &error);
+    if (error)
+    {
+        return GTA_SYSTEM_ERROR;
+    }
+    if (r < size)
+    {
+        return GTA_UNEXPECTED_EOF;
     }
-    free(dst_io_state->chunk);
-    dst_io_state->io_type = src_io_state->io_type;
-    dst_io_state->failure = src_io_state->failure;
-    dst_io_state->counter = src_io_state->counter;
-    dst_io_state->chunk = chunk;
-    dst_io_state->chunk_size = src_io_state->chunk_size;
-    dst_io_state->chunk_index = src_io_state->chunk_index;
-    dst_io_state->already_read = src_io_state->already_read;
     return GTA_OK;
 }
 
+/*
+ * Read several blocks. The runs of all blocks are sorted by their offset, and runs
+ * that overlap or are close to each other are read with a single operation into a
+ * staging buffer, from which they are copied into the block buffers.
+ */
+static GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NOTHROW
 gta_result_t
-gta_read_elements(const gta_header_t *GTA_RESTRICT header, gta_io_state_t *GTA_RESTRICT io_state,
-        uintmax_t n, void *GTA_RESTRICT buf, gta_read_t read_fn, intptr_t userdata)
+gta_read_blocks_runs(const gta_header_t *GTA_RESTRICT header, intmax_t data_offset, size_t n,
+        const uintmax_t *GTA_RESTRICT lower_coordinates, const uintmax_t *GTA_RESTRICT higher_coordinates,
+        void *const *GTA_RESTRICT blocks, gta_read_t read_fn, gta_seek_t seek_fn, intptr_t userdata, int fd)
 {
     gta_result_t retval = GTA_OK;
+    uintmax_t dimensions = gta_get_dimensions(header);
+    uintmax_t *coords = NULL;
+    gta_block_run_t *runs = NULL;
+    size_t runs_count = 0;
+    void *staging = NULL;
+    size_t staging_size = 0;
 
-    if (io_state->io_type == 0)
+    if (n == 0)
     {
-        io_state->io_type = 1;
+        return GTA_OK;
     }
-    if (io_state->io_type != 1)
+    if (gta_get_compression(header) != GTA_NONE || dimensions == 0)
     {
-        retval = GTA_INVALID_DATA;
-        goto exit;
+        return GTA_UNSUPPORTED_DATA;
     }
-    if (io_state->failure)
+    if (dimensions > SIZE_MAX / sizeof(uintmax_t) / n)
     {
-        retval = GTA_INVALID_DATA;
-        goto exit;
+        return GTA_OVERFLOW;
     }
-    if (n > gta_get_elements(header) || io_state->counter > gta_get_elements(header) - n)
+
+    // Count the runs
+    for (size_t i = 0; i < n; i++)
     {
-        retval = GTA_INVALID_DATA;
-        goto exit;
+        const uintmax_t *lc = lower_coordinates + i * dimensions;
+        const uintmax_t *hc = higher_coordinates + i * dimensions;
+        retval = gta_check_block(header, data_offset, hc);
+        if (retval != GTA_OK)
+        {
+            return retval;
+        }
+        uintmax_t run_size;
+        uintmax_t run_dimension = gta_get_block_run(header, lc, hc, &run_size);
+        uintmax_t block_runs = 1;
+        for (uintmax_t d = run_dimension; d < dimensions; d++)
+        {
+            uintmax_t l = hc[d] - lc[d] + 1;
+            if (block_runs > SIZE_MAX / l)
+            {
+                return GTA_OVERFLOW;
+            }
+            block_runs *= l;
+        }
+        if (block_runs > SIZE_MAX / sizeof(gta_block_run_t) - runs_count)
+        {
+            return GTA_OVERFLOW;
+        }
+        runs_count += block_runs;
     }
-    uintmax_t s = gta_get_element_size(header);
-    if (s == 0)
+
+    // Collect and sort the runs
+    coords = gta_malloc(dimensions * sizeof(uintmax_t));
+    runs = gta_malloc(runs_count * sizeof(gta_block_run_t));
+    if (!coords || !runs)
     {
-        retval = GTA_INVALID_DATA;
+        retval = GTA_SYSTEM_ERROR;
         goto exit;
     }
-    if (s > SIZE_MAX || n > SIZE_MAX || gta_size_overflow(n, s))
+    size_t r = 0;
+    for (size_t i = 0; i < n; i++)
     {
-        retval = GTA_OVERFLOW;
-        goto exit;
+        const uintmax_t *lc = lower_coordinates + i * dimensions;
+        const uintmax_t *hc = higher_coordinates + i * dimensions;
+        uintmax_t run_size;
+        uintmax_t run_dimension = gta_get_block_run(header, lc, hc, &run_size);
+        char *block_ptr = blocks[i];
+        memcpy(coords, lc, dimensions * sizeof(uintmax_t));
+        do
+        {
+            runs[r].offset = gta_get_element_offset(header, coords);
+            runs[r].size = run_size;
+            runs[r].dst = block_ptr;
+            r++;
+            block_ptr += run_size;
+        }
+        while (gta_next_block_run(header, run_dimension, lc, hc, coords));
     }
-    size_t size = n * s;
+    qsort(runs, runs_count, sizeof(gta_block_run_t), gta_block_run_cmp);
+
+    // Read the runs, merging neighbors
     size_t i = 0;
-    while (i < size)
+    while (i < runs_count)
     {
-        if (io_state->chunk_index == io_state->chunk_size)
+        uintmax_t segment_start = runs[i].offset;
+        uintmax_t segment_end = runs[i].offset + runs[i].size;
+        size_t j = i + 1;
+        if (runs[i].size <= gta_max_chunk_size)
         {
-            if (gta_get_compression(header) != GTA_NONE)
-            {
-                free(io_state->chunk);
-                io_state->chunk = NULL;
-                gta_result_t retval = gta_read_chunk(header, &(io_state->chunk),
-                        &(io_state->chunk_size), read_fn, userdata);
-                if (retval != GTA_OK)
-                {
-                    goto exit;
-                }
-            }
-            else
+            while (j < runs_count && (runs[j].offset <= segment_end
+                        || runs[j].offset - segment_end <= gta_block_gap_max))
             {
-                size_t chunk_size = gta_max_chunk_size;
-                if (!io_state->chunk)
-                {
-                    if (gta_get_data_size(header) < chunk_size)
-                    {
-                        chunk_size = gta_get_data_size(header);
-                    }
-                    io_state->chunk = malloc(chunk_size);
-                    if (!io_state->chunk)
-                    {
-                        retval = GTA_SYSTEM_ERROR;
-                        goto exit;
-                    }
-                }
-                uintmax_t read_size = gta_get_data_size(header) - io_state->already_read;
-                if (read_size > chunk_size)
-                {
-                    read_size = chunk_size;
-                }
-                int error = false;
-                size_t r = read_fn(userdata, io_state->chunk, read_size, &error);
-                if (error)
+                uintmax_t end = runs[j].offset + runs[j].size;
+                if (end < segment_end)
                 {
-                    retval = GTA_SYSTEM_ERROR;
-                    goto exit;
+                    end = segment_end;
                 }
-                if (r < read_size)
+                if (end - segment_start > gta_max_chunk_size)
                 {
-                    retval = GTA_UNEXPECTED_EOF;
-                    goto exit;
+                    break;
                 }
-                io_state->chunk_size = read_size;
-                io_state->already_read += read_size;
+                segment_end = end;
+                j++;
             }
-            io_state->chunk_index = 0;
         }
-        size_t l = size - i;
-        if (l > io_state->chunk_size - io_state->chunk_index)
+        if (j == i + 1)
         {
-            l = io_state->chunk_size - io_state->chunk_index;
+            // A single run: read it directly into the block
+            retval = gta_read_at(data_offset + runs[i].offset, runs[i].dst, runs[i].size,
+                    read_fn, seek_fn, userdata, fd);
+            if (retval != GTA_OK)
+            {
+                goto exit;
+            }
         }
-        memcpy((char *)buf + i, (char *)(io_state->chunk) + io_state->chunk_index, l);
-        i += l;
-        io_state->chunk_index += l;
-    }
-    io_state->counter += n;
-    if (io_state->counter == gta_get_elements(header))
-    {
-        if (gta_get_compression(header) != GTA_NONE)
+        else
         {
-            if (io_state->chunk_index != io_state->chunk_size)
+            size_t segment_size = segment_end - segment_start;
+            if (segment_size > staging_size)
             {
-                retval = GTA_INVALID_DATA;
-                goto exit;
+                gta_free_chunk(staging);
+                staging = gta_alloc_chunk(segment_size);
+                if (!staging)
+                {
+                    retval = GTA_SYSTEM_ERROR;
+                    goto exit;
+                }
+                staging_size = segment_size;
             }
-            // read the last, empty chunk
-            free(io_state->chunk);
-            io_state->chunk = NULL;
-            retval = gta_read_chunk(header, &(io_state->chunk),
-                    &(io_state->chunk_size), read_fn, userdata);
+            retval = gta_read_at(data_offset + segment_start, staging, segment_size,
+                    read_fn, seek_fn, userdata, fd);
             if (retval != GTA_OK)
             {
                 goto exit;
             }
-            if (io_state->chunk_size != 0)
+            for (size_t k = i; k < j; k++)
             {
-                retval = GTA_INVALID_DATA;
-                goto exit;
+                memcpy(runs[k].dst, (char *)staging + (runs[k].offset - segment_start), runs[k].size);
             }
         }
-        else
-        {
-            // free the chunk; it will not be needed anymore
-            free(io_state->chunk);
-            io_state->chunk = NULL;
-        }
+        i = j;
     }
+
+    // Fix endianness
     if (gta_data_needs_endianness_swapping(header))
     {
-        for (uintmax_t i = 0; i < n; i++)
+        for (size_t k = 0; k < n; k++)
         {
-            gta_swap_element_endianness(header, (char *)buf + i * s);
+            gta_swap_block_endianness(header,
+                    lower_coordinates + k * dimensions, higher_coordinates + k * dimensions, blocks[k]);
         }
     }
+
 exit:
-    if (retval != GTA_OK)
-    {
-        io_state->failure = true;
-        free(io_state->chunk);
-        io_state->chunk = NULL;
-    }
+    gta_free_chunk(staging);
+    gta_free(runs);
+    gta_free(coords);
     return retval;
 }
 
 gta_result_t
-gta_read_elements_from_stream(const gta_header_t *GTA_RESTRICT header, gta_io_state_t *GTA_RESTRICT io_state,
-        uintmax_t n, void *GTA_RESTRICT buf, FILE *GTA_RESTRICT f)
+gta_read_blocks(const gta_header_t *GTA_RESTRICT header, intmax_t data_offset, size_t n,
+        const uintmax_t *GTA_RESTRICT lower_coordinates, const uintmax_t *GTA_RESTRICT higher_coordinates,
+        void *const *GTA_RESTRICT blocks, gta_read_t read_fn, gta_seek_t seek_fn, intptr_t userdata)
 {
-    return gta_read_elements(header, io_state, n, buf, gta_read_stream, (intptr_t)f);
+    return gta_read_blocks_runs(header, data_offset, n, lower_coordinates, higher_coordinates, blocks,
+            read_fn, seek_fn, userdata, -1);
 }
 
 gta_result_t
-gta_read_elements_from_fd(const gta_header_t *GTA_RESTRICT header, gta_io_state_t *GTA_RESTRICT io_state,
-        uintmax_t n, void *GTA_RESTRICT buf, int fd)
+gta_read_blocks_from_stream(const gta_header_t *GTA_RESTRICT header, intmax_t data_offset, size_t n,
+        const uintmax_t *GTA_RESTRICT lower_coordinates, const uintmax_t *GTA_RESTRICT higher_coordinates,
+        void *const *GTA_RESTRICT blocks, FILE *GTA_RESTRICT f)
 {
-    return gta_read_elements(header, io_state, n, buf, gta_read_fd, fd);
+    return gta_read_blocks(header, data_offset, n, lower_coordinates, higher_coordinates, blocks,
+            gta_read_stream, gta_seek_stream, (intptr_t)f);
 }
 
 gta_result_t
-gta_write_elements(const gta_header_t *GTA_RESTRICT header, gta_io_state_t *GTA_RESTRICT io_state,
-        uintmax_t n, const void *GTA_RESTRICT buf, gta_write_t write_fn, intptr_t userdata)
+gta_read_blocks_from_fd(const gta_header_t *GTA_RESTRICT header, intmax_t data_offset, size_t n,
+        const uintmax_t *GTA_RESTRICT lower_coordinates, const uintmax_t *GTA_RESTRICT higher_coordinates,
+        void *const *GTA_RESTRICT blocks, int fd)
+{
+#if HAVE_PREADV
+    return gta_read_blocks_runs(header, data_offset, n, lower_coordinates, higher_coordinates, blocks,
+            gta_read_fd, gta_seek_fd, fd, fd);
+#else
+    return gta_read_blocks(header, data_offset, n, lower_coordinates, higher_coordinates, blocks,
+            gta_read_fd, gta_seek_fd, fd);
+#endif
+}
+
+
+/*
+ *
+ * Random Access to Compressed Data
+ *
+ */
+
+
+gta_result_t
+gta_create_chunk_index(const gta_header_t *GTA_RESTRICT header, gta_chunk_index_t *GTA_RESTRICT *GTA_RESTRICT index,
+        gta_read_t read_fn, gta_seek_t seek_fn, intptr_t userdata)
 {
+    gta_chunk_index_t *idx;
     gta_result_t retval = GTA_OK;
 
-    if (io_state->io_type == 0)
-    {
-        io_state->io_type = 2;
-    }
-    if (io_state->io_type != 2)
-    {
-        retval = GTA_INVALID_DATA;
-        goto exit;
-    }
-    if (io_state->failure)
-    {
-        retval = GTA_INVALID_DATA;
-        goto exit;
-    }
-    if (n > gta_get_elements(header) || io_state->counter > gta_get_elements(header) - n)
+    idx = gta_malloc(sizeof(gta_chunk_index_t));
+    if (!idx)
     {
-        retval = GTA_INVALID_DATA;
-        goto exit;
+        return GTA_SYSTEM_ERROR;
     }
-    uintmax_t s = gta_get_element_size(header);
-    if (s > SIZE_MAX || n > SIZE_MAX || gta_size_overflow(n, s))
+    idx->data_size = gta_get_data_size(header);
+    idx->chunks = 0;
+    idx->size = 0;
+    idx->data_offsets = NULL;
+    idx->file_offsets = NULL;
+    if (gta_get_compression(header) == GTA_NONE)
     {
-        retval = GTA_OVERFLOW;
-        goto exit;
+        retval = gta_skip_data(header, read_fn, seek_fn, userdata);
     }
-    size_t size = n * s;
-    size_t i = 0;
-    while (i < size)
+    else
     {
-        if (io_state->chunk_index == io_state->chunk_size)
+        uintmax_t data_offset = 0;
+        uintmax_t file_offset = 0;
+        size_t chunk_size;
+        uintmax_t encoded_size;
+        for (;;)
         {
-            if (gta_get_compression(header) != GTA_NONE)
-            {
-                if (io_state->counter > 0)
-                {
-                    retval = gta_write_chunk(header, io_state->chunk,
-                            io_state->chunk_index, write_fn, userdata);
-                    if (retval != GTA_OK)
-                    {
-                        goto exit;
-                    }
-                }
-                free(io_state->chunk);
-                uintmax_t remaining_data = gta_get_data_size(header)
-                    - io_state->counter * gta_get_element_size(header) - i;
-                io_state->chunk_size = (remaining_data < gta_max_chunk_size) ? remaining_data : gta_max_chunk_size;
-                io_state->chunk = malloc(io_state->chunk_size);
-                if (!io_state->chunk)
-                {
-                    retval = GTA_SYSTEM_ERROR;
-                    goto exit;
-                }
-            }
-            else
+            retval = gta_skip_chunk(header, &chunk_size, &encoded_size, read_fn, seek_fn, userdata);
+            if (retval != GTA_OK)
             {
-                if (!io_state->chunk)
-                {
-                    size_t chunk_size = gta_max_chunk_size;
-                    if (gta_get_data_size(header) < chunk_size)
-                    {
-                        chunk_size = gta_get_data_size(header);
-                    }
-                    io_state->chunk = malloc(chunk_size);
-                    if (!io_state->chunk)
-                    {
-                        retval = GTA_SYSTEM_ERROR;
-                        goto exit;
-                    }
-                    io_state->chunk_size = chunk_size;
-                }
-                if (io_state->chunk_index > 0)
-                {
-                    int error = false;
-                    errno = 0;
-                    size_t r = write_fn(userdata, io_state->chunk, io_state->chunk_size, &error);
-                    if (error || r < io_state->chunk_size)
-                    {
-                        if (errno == 0)
-                        {
-                            errno = EIO;
-                        }
-                        retval = GTA_SYSTEM_ERROR;
-                        goto exit;
-                    }
-                }
+                break;
             }
-            io_state->chunk_index = 0;
-        }
-        size_t l = size - i;
-        if (l > io_state->chunk_size - io_state->chunk_index)
-        {
-            l = io_state->chunk_size - io_state->chunk_index;
-        }
-        memcpy((char *)(io_state->chunk) + io_state->chunk_index, (char *)buf + i, l);
-        i += l;
-        io_state->chunk_index += l;
-    }
-    io_state->counter += n;
-    if (io_state->counter == gta_get_elements(header))
-    {
-        if (gta_get_compression(header) != GTA_NONE)
-        {
-            // flush chunk and write empty chunk
-            if (io_state->chunk_index > 0)
+            if (chunk_size == 0)
             {
-                retval = gta_write_chunk(header, io_state->chunk, io_state->chunk_index, write_fn, userdata);
-                if (retval != GTA_OK)
+                if (data_offset != idx->data_size)
                 {
-                    goto exit;
+                    retval = GTA_INVALID_DATA;
                 }
+                break;
             }
-            free(io_state->chunk);
-            io_state->chunk = NULL;
-            retval = gta_write_chunk(header, NULL, 0, write_fn, userdata);
-            if (retval != GTA_OK)
+            if (chunk_size > idx->data_size - data_offset)
             {
-                goto exit;
+                retval = GTA_INVALID_DATA;
+                break;
             }
-        }
-        else
-        {
-            // flush
-            if (io_state->chunk_index > 0)
+            if (idx->chunks == idx->size)
             {
-                int error = false;
-                errno = 0;
-                size_t r = write_fn(userdata, io_state->chunk, io_state->chunk_index, &error);
-                if (error || r < io_state->chunk_index)
+                if (idx->size > SIZE_MAX / sizeof(uintmax_t) - gta_bufsize_inc)
+                {
+                    retval = GTA_OVERFLOW;
+                    break;
+                }
+                size_t size = idx->size + gta_bufsize_inc;
+                uintmax_t *data_offsets = gta_realloc(idx->data_offsets, size * sizeof(uintmax_t));
+                if (!data_offsets)
                 {
-                    if (errno == 0)
-                    {
-                        errno = EIO;
-                    }
                     retval = GTA_SYSTEM_ERROR;
-                    goto exit;
+                    break;
+                }
+                idx->data_offsets = data_offsets;
+                uintmax_t *file_offsets = gta_realloc(idx->file_offsets, size * sizeof(uintmax_t));
+                if (!file_offsets)
+                {
+                    retval = GTA_SYSTEM_ERROR;
+                    break;
                 }
+                idx->file_offsets = file_offsets;
+                idx->size = size;
             }
-            // free the chunk; it will not be needed anymore
-            free(io_state->chunk);
-            io_state->chunk = NULL;
+            idx->data_offsets[idx->chunks] = data_offset;
+            idx->file_offsets[idx->chunks] = file_offset;
+            idx->chunks++;
+            data_offset += chunk_size;
+            file_offset += encoded_size;
         }
     }
-exit:
     if (retval != GTA_OK)
     {
-        io_state->failure = true;
-        free(io_state->chunk);
-        io_state->chunk = NULL;
+        gta_destroy_chunk_index(idx);
+        return retval;
     }
-    return retval;
+    *index = idx;
+    return GTA_OK;
 }
 
 gta_result_t
-gta_write_elements_to_stream(const gta_header_t *GTA_RESTRICT header, gta_io_state_t *GTA_RESTRICT io_state,
-        uintmax_t n, const void *GTA_RESTRICT buf, FILE *GTA_RESTRICT f)
+gta_create_chunk_index_from_stream(const gta_header_t *GTA_RESTRICT header,
+        gta_chunk_index_t *GTA_RESTRICT *GTA_RESTRICT index, FILE *GTA_RESTRICT f)
 {
-    return gta_write_elements(header, io_state, n, buf, gta_write_stream, (intptr_t)f);
+    return gta_create_chunk_index(header, index, gta_read_stream,
+            (ftello(f) == -1 ? NULL : gta_seek_stream), (intptr_t)f);
 }
 
 gta_result_t
-gta_write_elements_to_fd(const gta_header_t *GTA_RESTRICT header, gta_io_state_t *GTA_RESTRICT io_state,
-        uintmax_t n, const void *GTA_RESTRICT buf, int fd)
+gta_create_chunk_index_from_fd(const gta_header_t *GTA_RESTRICT header,
+        gta_chunk_index_t *GTA_RESTRICT *GTA_RESTRICT index, int fd)
 {
-    return gta_write_elements(header, io_state, n, buf, gta_write_fd, fd);
+    return gta_create_chunk_index(header, index, gta_read_fd,
+            (lseek(fd, 0, SEEK_CUR) == -1 ? NULL : gta_seek_fd), fd);
 }
 
+void
+gta_destroy_chunk_index(gta_chunk_index_t *GTA_RESTRICT index)
+{
+    gta_free(index->data_offsets);
+    gta_free(index->file_offsets);
+    gta_free(index);
+}
 
-/*
- *
- * Read and Write Array Blocks
- *
- */
-
-
-/**
- * \brief               Get the offset of an array element.
- * \param header        The header.
- * \param indices       The indices for each dimension of the array.
- * \return              The offset of the element, relative to the start of the data.
- */
-static GTA_ATTR_NONNULL_ALL GTA_ATTR_PURE GTA_ATTR_NOTHROW
-intmax_t
-gta_get_element_offset(const gta_header_t *GTA_RESTRICT header, const uintmax_t *GTA_RESTRICT indices)
+uintmax_t
+gta_get_chunk_index_chunks(const gta_chunk_index_t *GTA_RESTRICT index)
 {
-    uintmax_t index = 0;
-    uintmax_t dim_product = 1;
-    for (uintmax_t i = 0; i < gta_get_dimensions(header); i++)
-    {
-        if (i > 0)
-        {
-            dim_product *= gta_get_dimension_size(header, i - 1);
-        }
-        index += indices[i] * dim_product;
-    }
-    return index * gta_get_element_size(header);
+    return index->chunks;
 }
 
 gta_result_t
-gta_read_block(const gta_header_t *GTA_RESTRICT header, intmax_t data_offset,
+gta_read_block_with_index(const gta_header_t *GTA_RESTRICT header, const gta_chunk_index_t *GTA_RESTRICT index,
+        intmax_t data_offset,
         const uintmax_t *GTA_RESTRICT lower_coordinates, const uintmax_t *GTA_RESTRICT higher_coordinates,
         void *GTA_RESTRICT block, gta_read_t read_fn, gta_seek_t seek_fn, intptr_t userdata)
 {
-    if (gta_get_compression(header) != GTA_NONE || gta_get_dimensions(header) == 0)
+    if (gta_get_compression(header) == GTA_NONE)
+    {
+        return gta_read_block(header, data_offset, lower_coordinates, higher_coordinates,
+                block, read_fn, seek_fn, userdata);
+    }
+    if (gta_get_dimensions(header) == 0)
     {
         return GTA_UNSUPPORTED_DATA;
     }
-    if (data_offset > INTMAX_MAX - gta_get_element_offset(header, higher_coordinates)
-            || gta_get_element_size(header) > (uintmax_t)(INTMAX_MAX)
-            || data_offset + gta_get_element_offset(header, higher_coordinates) > INTMAX_MAX - (intmax_t)gta_get_element_size(header))
+    if (index->data_size != gta_get_data_size(header) || index->chunks == 0)
     {
-        return GTA_OVERFLOW;
+        return GTA_INVALID_DATA;
+    }
+    for (uintmax_t i = 0; i < gta_get_dimensions(header); i++)
+    {
+        if (lower_coordinates[i] > higher_coordinates[i]
+                || higher_coordinates[i] >= gta_get_dimension_size(header, i))
+        {
+            return GTA_INVALID_DATA;
+        }
+    }
+    gta_result_t retval = gta_check_block_offsets(header, data_offset, higher_coordinates);
+    if (retval != GTA_OK)
+    {
+        return retval;
     }
 
-    uintmax_t *coords = malloc(gta_get_dimensions(header) * sizeof(uintmax_t));
+    uintmax_t *coords = gta_malloc(gta_get_dimensions(header) * sizeof(uintmax_t));
     if (!coords)
     {
         return GTA_SYSTEM_ERROR;
     }
 
     memcpy(coords, lower_coordinates, gta_get_dimensions(header) * sizeof(uintmax_t));
-    uintmax_t dim0_len = higher_coordinates[0] - lower_coordinates[0] + 1;
-    uintmax_t dim0_datalen = dim0_len * gta_get_element_size(header);
+    uintmax_t run_size;
+    uintmax_t run_dimension = gta_get_block_run(header, lower_coordinates, higher_coordinates, &run_size);
     char *block_ptr = block;
-    gta_result_t retval = GTA_OK;
+    void *chunk = NULL;         // The current chunk
+    size_t chunk_size = 0;
+    size_t c = 0;               // Index of the current chunk
+    gta_codec_t codec;
+    retval = GTA_OK;
 
+    gta_init_codec(&codec);
     for (;;)
     {
-        intmax_t o = gta_get_element_offset(header, coords);
-        // Read data
-        int error = false;
-        seek_fn(userdata, data_offset + o, SEEK_SET, &error);
-        if (error)
-        {
-            retval = GTA_SYSTEM_ERROR;
-            break;
-        }
-        size_t r = read_fn(userdata, block_ptr, dim0_datalen, &error);
-        if (error)
-        {
-            retval = GTA_SYSTEM_ERROR;
-            break;
-        }
-        if (r < dim0_datalen)
+        // Copy the data from the chunks that contain it. Since the offsets increase,
+        // each chunk is read and decompressed at most once.
+        uintmax_t o = gta_get_element_offset(header, coords);
+        uintmax_t remaining = run_size;
+        char *ptr = block_ptr;
+        while (remaining > 0)
         {
-            retval = GTA_UNEXPECTED_EOF;
-            break;
-        }
-        // Fix endianness
-        if (gta_data_needs_endianness_swapping(header))
-        {
-            for (uintmax_t i = 0; i < dim0_len; i++)
-            {
-                void *e = block_ptr + i * gta_get_element_size(header);
-                gta_swap_element_endianness(header, e);
-            }
-        }
-        // Increase block index and coordinates
-        block_ptr += dim0_datalen;
-        uintmax_t d;
-        for (d = 1; d < gta_get_dimensions(header); d++)
-        {
-            if (coords[d] < higher_coordinates[d])
+            if (!chunk || o < index->data_offsets[c] || o - index->data_offsets[c] >= chunk_size)
             {
-                coords[d]++;
-                break;
+                // Find the chunk that contains the offset
+                size_t lo = 0;
+                size_t hi = index->chunks;
+                while (hi - lo > 1)
+                {
+                    size_t mid = lo + (hi - lo) / 2;
+                    if (index->data_offsets[mid] <= o)
+                    {
+                        lo = mid;
+                    }
+                    else
+                    {
+                        hi = mid;
+                    }
+                }
+                c = lo;
+                if (index->file_offsets[c] > (uintmax_t)(INTMAX_MAX - data_offset))
+                {
+                    retval = GTA_OVERFLOW;
+                    goto exit;
+                }
+                gta_free_chunk(chunk);
+                chunk = NULL;
+                int error = false;
+                seek_fn(userdata, data_offset + index->file_offsets[c], SEEK_SET, &error);
+                if (error)
+                {
+                    retval = GTA_SYSTEM_ERROR;
+                    goto exit;
+                }
+                retval = gta_read_chunk(header, &codec, gta_filter_stride(header),
+                        &chunk, &chunk_size, read_fn, userdata);
+                if (retval != GTA_OK)
+                {
+                    goto exit;
+                }
+                uintmax_t expected_size = (c + 1 < index->chunks ? index->data_offsets[c + 1] : index->data_size)
+                    - index->data_offsets[c];
+                if (chunk_size != expected_size || o - index->data_offsets[c] >= chunk_size)
+                {
+                    retval = GTA_INVALID_DATA;
+                    goto exit;
+                }
             }
-            else
+            size_t i = o - index->data_offsets[c];
+            size_t l = chunk_size - i;
+            if (l > remaining)
             {
-                coords[d] = lower_coordinates[d];
+                l = remaining;
             }
+            memcpy(ptr, (char *)chunk + i, l);
+            ptr += l;
+            o += l;
+            remaining -= l;
         }
-        if (d == gta_get_dimensions(header))
+        block_ptr += run_size;
+        if (!gta_next_block_run(header, run_dimension, lower_coordinates, higher_coordinates, coords))
         {
             break;
         }
     }
-    free(coords);
+    // Fix endianness
+    if (gta_data_needs_endianness_swapping(header))
+    {
+        gta_swap_block_endianness(header, lower_coordinates, higher_coordinates, block);
+    }
+exit:
+    gta_free_codec(&codec);
+    gta_free_chunk(chunk);
+    gta_free(coords);
     return retval;
 }
 
 gta_result_t
-gta_read_block_from_stream(const gta_header_t *GTA_RESTRICT header, intmax_t data_offset,
+gta_read_block_with_index_from_stream(const gta_header_t *GTA_RESTRICT header,
+        const gta_chunk_index_t *GTA_RESTRICT index, intmax_t data_offset,
         const uintmax_t *GTA_RESTRICT lower_coordinates, const uintmax_t *GTA_RESTRICT higher_coordinates,
         void *GTA_RESTRICT block, FILE *GTA_RESTRICT f)
 {
-    return gta_read_block(header, data_offset, lower_coordinates, higher_coordinates, block,
+    return gta_read_block_with_index(header, index, data_offset, lower_coordinates, higher_coordinates, block,
             gta_read_stream, gta_seek_stream, (intptr_t)f);
 }
 
 gta_result_t
-gta_read_block_from_fd(const gta_header_t *GTA_RESTRICT header, intmax_t data_offset,
+gta_read_block_with_index_from_fd(const gta_header_t *GTA_RESTRICT header,
+        const gta_chunk_index_t *GTA_RESTRICT index, intmax_t data_offset,
         const uintmax_t *GTA_RESTRICT lower_coordinates, const uintmax_t *GTA_RESTRICT higher_coordinates,
         void *GTA_RESTRICT block, int fd)
 {
-    return gta_read_block(header, data_offset, lower_coordinates, higher_coordinates, block,
+    return gta_read_block_with_index(header, index, data_offset, lower_coordinates, higher_coordinates, block,
             gta_read_fd, gta_seek_fd, fd);
 }
 
+
+/*
+ *
+ * Memory-Mapped Data Access
+ *
+ */
+
+
 gta_result_t
-gta_write_block(const gta_header_t *GTA_RESTRICT header, intmax_t data_offset,
-        const uintmax_t *GTA_RESTRICT lower_coordinates, const uintmax_t *GTA_RESTRICT higher_coordinates,
-        const void *GTA_RESTRICT block, gta_write_t write_fn, gta_seek_t seek_fn, intptr_t userdata)
+gta_map_data_from_fd(const gta_header_t *GTA_RESTRICT header, intmax_t data_offset,
+        gta_mapping_t *GTA_RESTRICT *GTA_RESTRICT mapping, int fd)
 {
-    if (gta_get_compression(header) != GTA_NONE || gta_get_dimensions(header) == 0)
+    gta_mapping_t *m;
+    gta_result_t retval = GTA_OK;
+
+    if (gta_get_compression(header) != GTA_NONE || gta_data_needs_endianness_swapping(header))
     {
         return GTA_UNSUPPORTED_DATA;
     }
-    if (data_offset > INTMAX_MAX - gta_get_element_offset(header, higher_coordinates)
-            || gta_get_element_size(header) > (uintmax_t)(INTMAX_MAX)
-            || data_offset + gta_get_element_offset(header, higher_coordinates) > INTMAX_MAX - (intmax_t)gta_get_element_size(header))
+    if (data_offset < 0 || gta_get_data_size(header) > SIZE_MAX
+            || gta_get_data_size(header) > (uintmax_t)(INTMAX_MAX - data_offset))
     {
         return GTA_OVERFLOW;
     }
-
-    uintmax_t *coords = malloc(gta_get_dimensions(header) * sizeof(uintmax_t));
-    if (!coords)
+    size_t data_size = gta_get_data_size(header);
+    m = gta_malloc(sizeof(gta_mapping_t));
+    if (!m)
     {
         return GTA_SYSTEM_ERROR;
     }
-
-    memcpy(coords, lower_coordinates, gta_get_dimensions(header) * sizeof(uintmax_t));
-    uintmax_t dim0_len = higher_coordinates[0] - lower_coordinates[0] + 1;
-    uintmax_t dim0_datalen = dim0_len * gta_get_element_size(header);
-    void *temp_block = NULL;
-    if (gta_data_needs_endianness_swapping(header))
+    m->start = NULL;
+    m->length = 0;
+    m->data = NULL;
+    m->mapped = false;
+    if (data_size == 0)
     {
-        temp_block = malloc(dim0_datalen);
-        if (!temp_block)
-        {
-            free(coords);
-            return GTA_OVERFLOW;
-        }
+        goto exit;
     }
-    const char *block_ptr = block;
-    gta_result_t retval = GTA_OK;
 
-    for (;;)
+#if HAVE_MMAP
+    struct stat st;
+    if (fstat(fd, &st) != 0)
     {
-        intmax_t o = gta_get_element_offset(header, coords);
-        // Fix endianness (we must not change endianness of an existing file)
-        if (gta_data_needs_endianness_swapping(header))
+        retval = GTA_SYSTEM_ERROR;
+        goto exit;
+    }
+    if (S_ISREG(st.st_mode))
+    {
+        if ((uintmax_t)st.st_size < (uintmax_t)data_offset + data_size)
         {
-            memcpy(temp_block, block_ptr, dim0_datalen);
-            for (uintmax_t i = 0; i < dim0_len; i++)
-            {
-                void *e = (char *)temp_block + i * gta_get_element_size(header);
-                gta_swap_element_endianness(header, e);
-            }
+            retval = GTA_UNEXPECTED_EOF;
+            goto exit;
         }
-        // Write data
-        int error = false;
-        seek_fn(userdata, data_offset + o, SEEK_SET, &error);
-        if (error)
+        // The offset of the mapping must be a multiple of the page size
+        long page_size = sysconf(_SC_PAGESIZE);
+        size_t skip = (page_size > 0 ? data_offset % page_size : 0);
+        if (data_size > SIZE_MAX - skip || data_offset - (intmax_t)skip > OFF_MAX)
         {
-            retval = GTA_SYSTEM_ERROR;
-            break;
+            retval = GTA_OVERFLOW;
+            goto exit;
         }
-        errno = 0;
-        size_t r = write_fn(userdata,
-                gta_data_needs_endianness_swapping(header) ? temp_block : block_ptr,
-                dim0_datalen, &error);
-        if (error || r < dim0_datalen)
+        void *start = mmap(NULL, data_size + skip, PROT_READ, MAP_PRIVATE, fd, data_offset - skip);
+        if (start == MAP_FAILED)
         {
-            if (errno == 0)
-            {
-                errno = EIO;
-            }
             retval = GTA_SYSTEM_ERROR;
-            break;
-        }
-        // Increase block index and coordinates
-        block_ptr += dim0_datalen;
-        uintmax_t d;
-        for (d = 1; d < gta_get_dimensions(header); d++)
-        {
-            if (coords[d] < higher_coordinates[d])
-            {
-                coords[d]++;
-                break;
-            }
-            else
-            {
-                coords[d] = lower_coordinates[d];
-            }
-        }
-        if (d == gta_get_dimensions(header))
-        {
-            break;
+            goto exit;
         }
+        m->start = start;
+        m->length = data_size + skip;
+        m->data = (char *)start + skip;
+        m->mapped = true;
+        goto exit;
     }
-    free(temp_block);
-    free(coords);
-    return retval;
+#endif
+
+    // Fall back to reading the data into a buffer
+    m->start = gta_malloc(data_size);
+    if (!m->start)
+    {
+        retval = GTA_SYSTEM_ERROR;
+        goto exit;
+    }
+    m->length = data_size;
+    m->data = m->start;
+    retval = gta_read_at(data_offset, m->start, data_size, gta_read_fd, gta_seek_fd, fd, fd);
+
+exit:
+    if (retval != GTA_OK)
+    {
+        gta_unmap_data(m);
+        return retval;
+    }
+    *mapping = m;
+    return GTA_OK;
 }
 
 gta_result_t
-gta_write_block_to_stream(const gta_header_t *GTA_RESTRICT header, intmax_t data_offset,
-        const uintmax_t *GTA_RESTRICT lower_coordinates, const uintmax_t *GTA_RESTRICT higher_coordinates,
-        const void *GTA_RESTRICT block, FILE *GTA_RESTRICT f)
+gta_map_data_from_stream(const gta_header_t *GTA_RESTRICT header, intmax_t data_offset,
+        gta_mapping_t *GTA_RESTRICT *GTA_RESTRICT mapping, FILE *GTA_RESTRICT f)
 {
-    return gta_write_block(header, data_offset, lower_coordinates, higher_coordinates, block,
-            gta_write_stream, gta_seek_stream, (intptr_t)f);
+    return gta_map_data_from_fd(header, data_offset, mapping, fileno(f));
 }
 
-gta_result_t
-gta_write_block_to_fd(const gta_header_t *GTA_RESTRICT header, intmax_t data_offset,
-        const uintmax_t *GTA_RESTRICT lower_coordinates, const uintmax_t *GTA_RESTRICT higher_coordinates,
-        const void *GTA_RESTRICT block, int fd)
+const void *
+gta_get_mapped_data(const gta_mapping_t *GTA_RESTRICT mapping)
 {
-    return gta_write_block(header, data_offset, lower_coordinates, higher_coordinates, block,
-            gta_write_fd, gta_seek_fd, fd);
+    return mapping->data;
+}
+
+void
+gta_unmap_data(gta_mapping_t *GTA_RESTRICT mapping)
+{
+#if HAVE_MMAP
+    if (mapping->mapped)
+    {
+        munmap(mapping->start, mapping->length);
+    }
+    else
+#endif
+    {
+        gta_free(mapping->start);
+    }
+    gta_free(mapping);
 }
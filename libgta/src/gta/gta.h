@@ -56,8 +56,22 @@
  * - stream-based (for streamable tasks),
  * - or block-based (for random access to the array data).
  *
+ * Headers, complete data, and element streams can also be read from and written to memory
+ * buffers instead of files; see gta_read_header_from_memory() and gta_write_header_to_memory().
+ *
  * The library provides interfaces for C and C++. See the <a href="files.html">Files</a> section.
  *
+ * \section threads Thread Safety
+ *
+ * The only global state of the library are the allocator and the buffer pool settings (see
+ * gta_set_allocator() and gta_set_buffer_pool_size()); the buffer pool itself is thread-safe.
+ * Different objects (headers, tag lists, I/O states) can be used by different threads at the same time. An object that is not modified can be shared between
+ * threads: all functions that take a const gta_header_t or const gta_taglist_t only read from it.\n
+ * Functions that read or write through a stream or file descriptor use its file position, so a stream
+ * or file descriptor must not be used by several threads at the same time. The exceptions are
+ * gta_pread_block_from_fd() and gta_pwrite_block_to_fd(), which use positional I/O and allow
+ * concurrent block access through a single file descriptor.
+ *
  * \section examples Examples
  *
  * Examples written in C:
@@ -298,6 +312,12 @@ typedef enum
  * \a GTA_BZIP2 compression is moderately fast and achieves a good compression ratio.
  * \a GTA_XZ compression is slow for compression, moderately fast for decompression,
  * and achieves good or very good compression rates.
+ * \a GTA_ZSTD compression is very fast at low levels and achieves a better compression
+ * ratio than \a GTA_ZLIB; higher levels trade speed for ratio.
+ * \a GTA_LZ4 compression is the fastest method and achieves a low compression ratio.\n
+ * \a GTA_ZSTD and \a GTA_LZ4 are only available if libgta was built with libzstd and liblz4.
+ * Otherwise, and in libgta versions that do not know these methods, reading and writing
+ * arrays that use them fails with \a GTA_UNSUPPORTED_DATA.
  */
 typedef enum
 {
@@ -313,9 +333,53 @@ typedef enum
     GTA_ZLIB8 = 11,     /**< \brief ZLIB compression with level 8 */
     GTA_ZLIB9 = 12,     /**< \brief ZLIB compression with level 9 */
     GTA_BZIP2 = 2,      /**< \brief BZIP2 compression (moderate speed, good compression rates) */
-    GTA_XZ    = 3       /**< \brief XZ compression (low/moderate speed, good/very good compression rates) */
+    GTA_XZ    = 3,      /**< \brief XZ compression (low/moderate speed, good/very good compression rates) */
+    GTA_ZSTD  = 13,     /**< \brief ZSTD compression with default level (very fast, good compression rates) */
+    GTA_ZSTD1  = 14,    /**< \brief ZSTD compression with level 1 */
+    GTA_ZSTD2  = 15,    /**< \brief ZSTD compression with level 2 */
+    GTA_ZSTD3  = 16,    /**< \brief ZSTD compression with level 3 */
+    GTA_ZSTD4  = 17,    /**< \brief ZSTD compression with level 4 */
+    GTA_ZSTD5  = 18,    /**< \brief ZSTD compression with level 5 */
+    GTA_ZSTD6  = 19,    /**< \brief ZSTD compression with level 6 */
+    GTA_ZSTD7  = 20,    /**< \brief ZSTD compression with level 7 */
+    GTA_ZSTD8  = 21,    /**< \brief ZSTD compression with level 8 */
+    GTA_ZSTD9  = 22,    /**< \brief ZSTD compression with level 9 */
+    GTA_ZSTD10 = 23,    /**< \brief ZSTD compression with level 10 */
+    GTA_ZSTD11 = 24,    /**< \brief ZSTD compression with level 11 */
+    GTA_ZSTD12 = 25,    /**< \brief ZSTD compression with level 12 */
+    GTA_ZSTD13 = 26,    /**< \brief ZSTD compression with level 13 */
+    GTA_ZSTD14 = 27,    /**< \brief ZSTD compression with level 14 */
+    GTA_ZSTD15 = 28,    /**< \brief ZSTD compression with level 15 */
+    GTA_ZSTD16 = 29,    /**< \brief ZSTD compression with level 16 */
+    GTA_ZSTD17 = 30,    /**< \brief ZSTD compression with level 17 */
+    GTA_ZSTD18 = 31,    /**< \brief ZSTD compression with level 18 */
+    GTA_ZSTD19 = 32,    /**< \brief ZSTD compression with level 19 */
+    GTA_LZ4   = 33      /**< \brief LZ4 compression (fastest, low compression rates) */
 } gta_compression_t;
 
+/**
+ * \brief       GTA pre-filters
+ *
+ * Reversible transformations of the array data that are applied to each chunk before
+ * compression and reverted after decompression. They rearrange the bytes of the array
+ * elements so that the compression methods find more redundancy, which often improves
+ * the compression ratio of numerical data considerably.\n
+ * \a GTA_FILTER_SHUFFLE groups the bytes of all elements of a chunk by their position
+ * within the element, so that e.g. the high bytes of all values are stored together.\n
+ * \a GTA_FILTER_BITSHUFFLE does the same for the individual bits of the elements.\n
+ * \a GTA_FILTER_DELTA replaces each element by its bytewise difference to the preceding
+ * element along dimension 0, which helps for smoothly varying data.\n
+ * Filters are only used for compressed data. Libgta versions that do not know filters
+ * fail to read filtered arrays with \a GTA_UNSUPPORTED_DATA.
+ */
+typedef enum
+{
+    GTA_FILTER_NONE       = 0,  /**< \brief No filter */
+    GTA_FILTER_SHUFFLE    = 1,  /**< \brief Byte shuffle by element size */
+    GTA_FILTER_BITSHUFFLE = 2,  /**< \brief Bit shuffle by element size */
+    GTA_FILTER_DELTA      = 3   /**< \brief Bytewise difference of consecutive elements */
+} gta_filter_t;
+
 /**
  * \brief       Custom input function
  *
@@ -360,6 +424,20 @@ typedef void (*gta_seek_t)(intptr_t userdata, intmax_t offset, int whence, int *
  */
 typedef struct gta_internal_io_state_struct gta_io_state_t;
 
+/**
+ * \brief       Index of the chunks of compressed data
+ *
+ * See gta_create_chunk_index() and gta_read_block_with_index().
+ */
+typedef struct gta_internal_chunk_index_struct gta_chunk_index_t;
+
+/**
+ * \brief       Array data that is mapped into memory
+ *
+ * See gta_map_data_from_fd().
+ */
+typedef struct gta_internal_mapping_struct gta_mapping_t;
+
 
 /**
  *
@@ -386,6 +464,59 @@ GTA_ATTR_NOTHROW;
 
 /*@}*/
 
+
+/**
+ *
+ * \name Memory Management
+ *
+ * All memory that libgta allocates is obtained from an allocator that can be replaced, for example
+ * by a memory pool of the application.\n
+ * Additionally, libgta can keep the buffers that hold data chunks in a pool instead of freeing
+ * them, and reuse them for the following chunks. A chunk buffer has a size of 16 MiB, so this avoids
+ * much allocator work and memory fragmentation in long-running programs that read or write many
+ * arrays. The pool is disabled by default.\n
+ * These settings are global. They must not be changed while other threads use libgta.
+ */
+
+/*@{*/
+
+/**
+ * \brief                       Set the allocator.
+ * \param malloc_fn             Replacement for malloc(), or NULL.
+ * \param realloc_fn            Replacement for realloc(), or NULL.
+ * \param free_fn               Replacement for free(), or NULL.
+ *
+ * If any of the functions is NULL, the standard functions are used.
+ * This function must be called while no libgta objects exist, because objects that were allocated with
+ * one allocator cannot be freed with another. It empties and disables the buffer pool.
+ */
+extern GTA_EXPORT void
+gta_set_allocator(void *(*malloc_fn)(size_t), void *(*realloc_fn)(void *, size_t), void (*free_fn)(void *))
+GTA_ATTR_NOTHROW;
+
+/**
+ * \brief                       Set the size of the buffer pool.
+ * \param buffers               The maximum number of unused chunk buffers that are kept.
+ * \return                      \a GTA_OK, \a GTA_OVERFLOW, or \a GTA_SYSTEM_ERROR.
+ *
+ * A value of 0 disables the pool. Reducing the size frees the buffers that do not fit anymore.
+ * A reasonable size is the number of chunks that are processed at the same time, e.g. the number of
+ * compression threads plus two.
+ */
+extern GTA_EXPORT gta_result_t
+gta_set_buffer_pool_size(size_t buffers)
+GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NOTHROW;
+
+/**
+ * \brief                       Get the size of the buffer pool.
+ * \return                      The maximum number of unused chunk buffers that are kept.
+ */
+extern GTA_EXPORT size_t
+gta_get_buffer_pool_size(void)
+GTA_ATTR_NOTHROW;
+
+/*@}*/
+
 /**
  *
  * \name Create and destroy GTA Headers
@@ -401,7 +532,8 @@ GTA_ATTR_NOTHROW;
  *
  * Creates a new GTA header and initializes it.
  * The GTA will initially be empty (zero element components, zero dimensions)
- * and contain no tags. The compression method will be \a GTA_NONE.
+ * and contain no tags. The compression method will be \a GTA_NONE,
+ * and the pre-filter will be \a GTA_FILTER_NONE.
  */
 extern GTA_EXPORT gta_result_t
 gta_create_header(gta_header_t *GTA_RESTRICT *GTA_RESTRICT header)
@@ -480,13 +612,35 @@ extern GTA_EXPORT gta_result_t
 gta_read_header_from_fd(gta_header_t *GTA_RESTRICT header, int fd)
 GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW;
 
+/**
+ * \brief              Read a GTA header from a memory buffer.
+ * \param header       The header.
+ * \param buffer       The buffer.
+ * \param size         The size of the buffer.
+ * \param offset       The offset of the header in the buffer.
+ * \return             \a GTA_OK, \a GTA_OVERFLOW, \a GTA_INVALID_DATA, \a GTA_UNEXPECTED_EOF, or \a GTA_SYSTEM_ERROR.
+ *
+ * Reads a GTA header from a memory buffer, without copying the buffer first.\n
+ * On success, \a offset is set to the offset of the first data byte after the GTA header.
+ * On failure, it is unchanged.
+ */
+extern GTA_EXPORT gta_result_t
+gta_read_header_from_memory(gta_header_t *GTA_RESTRICT header,
+        const void *GTA_RESTRICT buffer, size_t size, size_t *GTA_RESTRICT offset)
+GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW;
+
 
 /**
  * \brief               Write a GTA header.
  * \param header        The header.
  * \param write_fn      The custom output function.
  * \param userdata      A parameter to the custom output function.
- * \return              \a GTA_OK or \a GTA_SYSTEM_ERROR.
+ * \return              \a GTA_OK, \a GTA_UNSUPPORTED_DATA (if the compression method is not available
+ *                      or the pre-filter is unknown), or \a GTA_SYSTEM_ERROR.
+ *
+ * The encoded header is kept with the header until the header or one of its tag lists is modified,
+ * so writing the same header again, e.g. for a stream of similar arrays, costs a single call
+ * of the output function.
  */
 extern GTA_EXPORT gta_result_t
 gta_write_header(const gta_header_t *GTA_RESTRICT header, gta_write_t write_fn, intptr_t userdata)
@@ -496,7 +650,7 @@ GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL;
  * \brief               Write a GTA header to a stream.
  * \param header        The header.
  * \param f             The stream.
- * \return              \a GTA_OK or \a GTA_SYSTEM_ERROR.
+ * \return              \a GTA_OK, \a GTA_UNSUPPORTED_DATA, or \a GTA_SYSTEM_ERROR.
  */
 extern GTA_EXPORT gta_result_t
 gta_write_header_to_stream(const gta_header_t *GTA_RESTRICT header, FILE *GTA_RESTRICT f)
@@ -506,12 +660,31 @@ GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW;
  * \brief               Write a GTA header to a file descriptor.
  * \param header        The header.
  * \param fd            The file descriptor.
- * \return              \a GTA_OK or \a GTA_SYSTEM_ERROR.
+ * \return              \a GTA_OK, \a GTA_UNSUPPORTED_DATA, or \a GTA_SYSTEM_ERROR.
  */
 extern GTA_EXPORT gta_result_t
 gta_write_header_to_fd(const gta_header_t *GTA_RESTRICT header, int fd)
 GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW;
 
+/**
+ * \brief               Write a GTA header to a memory buffer.
+ * \param header        The header.
+ * \param buffer        The buffer, or NULL.
+ * \param size          The number of bytes already in the buffer.
+ * \param capacity      The allocated size of the buffer.
+ * \return              \a GTA_OK, \a GTA_UNSUPPORTED_DATA, or \a GTA_SYSTEM_ERROR.
+ *
+ * Appends the header to the buffer, and adds its size to \a size.
+ * The buffer is enlarged as needed, geometrically, so that appending many pieces is cheap.
+ * It must have been allocated with the allocator of libgta (see gta_set_allocator()), which
+ * is malloc() by default, and must be freed the same way. A NULL buffer has capacity 0.\n
+ * On failure, \a size is unchanged, but the buffer may have been enlarged.
+ */
+extern GTA_EXPORT gta_result_t
+gta_write_header_to_memory(const gta_header_t *GTA_RESTRICT header,
+        void *GTA_RESTRICT *GTA_RESTRICT buffer, size_t *GTA_RESTRICT size, size_t *GTA_RESTRICT capacity)
+GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW;
+
 /*@}*/
 
 
@@ -682,6 +855,97 @@ extern GTA_EXPORT void
 gta_set_compression(gta_header_t *GTA_RESTRICT header, gta_compression_t compression)
 GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW;
 
+/**
+ * \brief               Get the pre-filter.
+ * \param header        The header.
+ * \return              The pre-filter.
+ *
+ * Gets the pre-filter that is applied to the data before compression.\n
+ * See \a gta_filter_t for more information on pre-filters.\n
+ * For uncompressed arrays that were read from a file, this is always \a GTA_FILTER_NONE.
+ */
+extern GTA_EXPORT gta_filter_t
+gta_get_filter(const gta_header_t *GTA_RESTRICT header)
+GTA_ATTR_NONNULL_ALL GTA_ATTR_PURE GTA_ATTR_NOTHROW;
+
+/**
+ * \brief               Set the pre-filter.
+ * \param header        The header.
+ * \param filter        The pre-filter.
+ *
+ * Sets the pre-filter that is applied to the data before compression.\n
+ * See \a gta_filter_t for more information on pre-filters.\n
+ * The filter is ignored if the compression is \a GTA_NONE.
+ */
+extern GTA_EXPORT void
+gta_set_filter(gta_header_t *GTA_RESTRICT header, gta_filter_t filter)
+GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW;
+
+/**
+ * \brief               Get the number of compression threads.
+ * \param header        The header.
+ * \return              The number of compression threads.
+ *
+ * See gta_set_compression_threads().
+ */
+extern GTA_EXPORT unsigned int
+gta_get_compression_threads(const gta_header_t *GTA_RESTRICT header)
+GTA_ATTR_NONNULL_ALL GTA_ATTR_PURE GTA_ATTR_NOTHROW;
+
+/**
+ * \brief               Set the number of compression threads.
+ * \param header        The header.
+ * \param threads       The number of compression threads.
+ *
+ * Sets the number of data chunks that gta_write_data() and gta_write_elements()
+ * compress in parallel. The default is 0, which means that chunks are compressed
+ * one after the other by the calling thread, as is the value 1.\n
+ * The calling thread compresses chunks together with \a threads - 1 worker threads.
+ * The workers are started once for each gta_write_data() call, or on the first
+ * parallel write of an input/output state, and they are kept until all data is written.\n
+ * The chunks are always written in order, so the output does not depend on this
+ * setting. Parallel compression needs memory for up to \a threads chunks of
+ * 16 MiB each, in addition to the memory used by the compression methods.\n
+ * This setting is not stored in the GTA. It has no effect if the data is not
+ * compressed or if the library was built without thread support.
+ */
+extern GTA_EXPORT void
+gta_set_compression_threads(gta_header_t *GTA_RESTRICT header, unsigned int threads)
+GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW;
+
+/**
+ * \brief               Get the number of decompression threads.
+ * \param header        The header.
+ * \return              The number of decompression threads.
+ *
+ * See gta_set_decompression_threads().
+ */
+extern GTA_EXPORT unsigned int
+gta_get_decompression_threads(const gta_header_t *GTA_RESTRICT header)
+GTA_ATTR_NONNULL_ALL GTA_ATTR_PURE GTA_ATTR_NOTHROW;
+
+/**
+ * \brief               Set the number of decompression threads.
+ * \param header        The header.
+ * \param threads       The number of decompression threads.
+ *
+ * Sets the number of data chunks that gta_read_data() and gta_read_elements()
+ * read ahead and decompress in parallel. The default is 0, which means that
+ * each chunk is read and decompressed only when it is needed, as is the value 1.\n
+ * The decompression threads are started once for each gta_read_data() call, or on
+ * the first chunk that an input/output state reads, and they are kept until the last
+ * chunk was read.\n
+ * Read-ahead never reads beyond the end of the data, so input streams that contain
+ * several GTAs can still be read. It needs memory for up to 2 * \a threads chunks
+ * of 16 MiB each.\n
+ * This setting is not stored in the GTA. It has no effect if the data is not
+ * compressed; decompression is serial if the library was built without thread
+ * support.
+ */
+extern GTA_EXPORT void
+gta_set_decompression_threads(gta_header_t *GTA_RESTRICT header, unsigned int threads)
+GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW;
+
 /*@}*/
 
 
@@ -752,6 +1016,9 @@ GTA_ATTR_NONNULL_ALL GTA_ATTR_PURE GTA_ATTR_NOTHROW;
  * \param taglist       The tag list.
  * \param i             The tag index.
  * \return              The name of the tag.
+ *
+ * The returned string remains valid until this tag is removed, or the tag list is
+ * cleared, replaced, or destroyed.
  */
 extern GTA_EXPORT const char *
 gta_get_tag_name(const gta_taglist_t *GTA_RESTRICT taglist, uintmax_t i)
@@ -762,6 +1029,9 @@ GTA_ATTR_NONNULL_ALL GTA_ATTR_PURE GTA_ATTR_NOTHROW;
  * \param taglist       The tag list.
  * \param i             The tag index.
  * \return              The value of the tag.
+ *
+ * The returned string remains valid until this tag is changed or removed, or the
+ * tag list is cleared, replaced, or destroyed.
  */
 extern GTA_EXPORT const char *
 gta_get_tag_value(const gta_taglist_t *GTA_RESTRICT taglist, uintmax_t i)
@@ -772,6 +1042,9 @@ GTA_ATTR_NONNULL_ALL GTA_ATTR_PURE GTA_ATTR_NOTHROW;
  * \param taglist       The tag list.
  * \param name          The tag name.
  * \return              The tag value, or NULL if the tag name is not found.
+ *
+ * The returned string remains valid until this tag is changed or removed, or the
+ * tag list is cleared, replaced, or destroyed.
  */
 extern GTA_EXPORT const char *
 gta_get_tag(const gta_taglist_t *GTA_RESTRICT taglist, const char *GTA_RESTRICT name)
@@ -879,6 +1152,45 @@ extern GTA_EXPORT gta_result_t
 gta_read_data_from_fd(const gta_header_t *GTA_RESTRICT header, void *GTA_RESTRICT data, int fd)
 GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW;
 
+/**
+ * \brief               Read the complete data from a memory buffer.
+ * \param header        The header.
+ * \param data          The data buffer.
+ * \param buffer        The input buffer.
+ * \param size          The size of the input buffer.
+ * \param offset        The offset of the data in the input buffer.
+ * \return              \a GTA_OK, \a GTA_UNSUPPORTED_DATA, \a GTA_UNEXPECTED_EOF, or \a GTA_SYSTEM_ERROR.
+ *
+ * Reads the complete data into the given buffer. The buffer must be large enough.
+ * Compressed chunks are decompressed directly from the input buffer.\n
+ * On success, \a offset is advanced past the data. On failure, it is unchanged.
+ */
+extern GTA_EXPORT gta_result_t
+gta_read_data_from_memory(const gta_header_t *GTA_RESTRICT header, void *GTA_RESTRICT data,
+        const void *GTA_RESTRICT buffer, size_t size, size_t *GTA_RESTRICT offset)
+GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW;
+
+/**
+ * \brief               Get the complete data in a memory buffer, without copying it.
+ * \param header        The header.
+ * \param data          Returns a pointer to the data inside \a buffer.
+ * \param buffer        The input buffer.
+ * \param size          The size of the input buffer.
+ * \param offset        The offset of the data in the input buffer.
+ * \return              \a GTA_OK, \a GTA_UNSUPPORTED_DATA (if the data is compressed or not in host endianness),
+ *                      \a GTA_OVERFLOW, or \a GTA_UNEXPECTED_EOF.
+ *
+ * The data of an uncompressed array in host endianness is stored in the buffer exactly as
+ * gta_get_element() and the other in-memory access functions expect it, so it can be used in place,
+ * as long as the buffer exists. Note that the pointer may not be suitably aligned for the component types.\n
+ * On success, \a offset is advanced past the data. On failure, it is unchanged; use
+ * gta_read_data_from_memory() instead.
+ */
+extern GTA_EXPORT gta_result_t
+gta_get_data_from_memory(const gta_header_t *GTA_RESTRICT header, const void *GTA_RESTRICT *GTA_RESTRICT data,
+        const void *GTA_RESTRICT buffer, size_t size, size_t *GTA_RESTRICT offset)
+GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW;
+
 /**
  * \brief               Skip the complete data.
  * \param header        The header.
@@ -917,6 +1229,22 @@ extern GTA_EXPORT gta_result_t
 gta_skip_data_from_fd(const gta_header_t *GTA_RESTRICT header, int fd)
 GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW;
 
+/**
+ * \brief               Skip the complete data in a memory buffer.
+ * \param header        The header.
+ * \param buffer        The buffer.
+ * \param size          The size of the buffer.
+ * \param offset        The offset of the data in the buffer.
+ * \return              \a GTA_OK, \a GTA_UNSUPPORTED_DATA, \a GTA_UNEXPECTED_EOF, or \a GTA_SYSTEM_ERROR.
+ *
+ * Advances \a offset past the complete data, so that the next GTA header can be read.
+ * On failure, \a offset is unchanged.
+ */
+extern GTA_EXPORT gta_result_t
+gta_skip_data_from_memory(const gta_header_t *GTA_RESTRICT header,
+        const void *GTA_RESTRICT buffer, size_t size, size_t *GTA_RESTRICT offset)
+GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW;
+
 /**
  * \brief               Write the complete data.
  * \param header        The header.
@@ -957,6 +1285,23 @@ extern GTA_EXPORT gta_result_t
 gta_write_data_to_fd(const gta_header_t *GTA_RESTRICT header, const void *GTA_RESTRICT data, int fd)
 GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL1(1) GTA_ATTR_NOTHROW;
 
+/**
+ * \brief               Write the complete data to a memory buffer.
+ * \param header        The header.
+ * \param data          The data buffer.
+ * \param buffer        The output buffer, or NULL.
+ * \param size          The number of bytes already in the output buffer.
+ * \param capacity      The allocated size of the output buffer.
+ * \return              \a GTA_OK or \a GTA_SYSTEM_ERROR.
+ *
+ * Appends the complete data to the output buffer. See gta_write_header_to_memory()
+ * for the handling of the output buffer.
+ */
+extern GTA_EXPORT gta_result_t
+gta_write_data_to_memory(const gta_header_t *GTA_RESTRICT header, const void *GTA_RESTRICT data,
+        void *GTA_RESTRICT *GTA_RESTRICT buffer, size_t *GTA_RESTRICT size, size_t *GTA_RESTRICT capacity)
+GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL1(1) GTA_ATTR_NONNULL3(3, 4, 5) GTA_ATTR_NOTHROW;
+
 /**
  * \brief               Copy the complete data.
  * \param read_header   The input header.
@@ -971,6 +1316,8 @@ GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL1(1) GTA_ATTR_NOTHROW;
  * The data encoding is altered as necessary (endianness correction, compression).
  * Note that the data encoding may change even if \a read_header and \a write_header
  * point to the same header!
+ * If both headers use the same compression and the input has host endianness,
+ * the chunks are copied verbatim, without decompressing and recompressing them.
  */
 extern GTA_EXPORT gta_result_t
 gta_copy_data(
@@ -990,6 +1337,8 @@ GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL;
  * The data encoding is altered as necessary (endianness correction, compression).
  * Note that the data encoding may change even if \a read_header and \a write_header
  * point to the same header!
+ * If both headers use the same compression and the input has host endianness,
+ * the chunks are copied verbatim, without decompressing and recompressing them.
  */
 extern GTA_EXPORT gta_result_t
 gta_copy_data_stream(
@@ -1009,6 +1358,8 @@ GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW;
  * The data encoding is altered as necessary (endianness correction, compression).
  * Note that the data encoding may change even if \a read_header and \a write_header
  * point to the same header!
+ * If both headers use the same compression and the input has host endianness,
+ * the chunks are copied verbatim, without decompressing and recompressing them.
  */
 extern GTA_EXPORT gta_result_t
 gta_copy_data_fd(
@@ -1167,6 +1518,56 @@ extern GTA_EXPORT void
 gta_destroy_io_state(gta_io_state_t *GTA_RESTRICT io_state)
 GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW;
 
+/**
+ * \brief               Get the number of compression threads of an input/output state.
+ * \param io_state      The input/output state.
+ * \return              The number of compression threads.
+ *
+ * See gta_set_io_state_compression_threads().
+ */
+extern GTA_EXPORT unsigned int
+gta_get_io_state_compression_threads(const gta_io_state_t *GTA_RESTRICT io_state)
+GTA_ATTR_NONNULL_ALL GTA_ATTR_PURE GTA_ATTR_NOTHROW;
+
+/**
+ * \brief               Set the number of compression threads of an input/output state.
+ * \param io_state      The input/output state.
+ * \param threads       The number of compression threads.
+ *
+ * Overrides the header setting (see gta_set_compression_threads()) for
+ * gta_write_elements() calls that use this state. The default is 0, which means
+ * that the header setting is used. The number of worker threads is determined by
+ * the first write that compresses chunks in parallel.
+ */
+extern GTA_EXPORT void
+gta_set_io_state_compression_threads(gta_io_state_t *GTA_RESTRICT io_state, unsigned int threads)
+GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW;
+
+/**
+ * \brief               Get the number of decompression threads of an input/output state.
+ * \param io_state      The input/output state.
+ * \return              The number of decompression threads.
+ *
+ * See gta_set_io_state_decompression_threads().
+ */
+extern GTA_EXPORT unsigned int
+gta_get_io_state_decompression_threads(const gta_io_state_t *GTA_RESTRICT io_state)
+GTA_ATTR_NONNULL_ALL GTA_ATTR_PURE GTA_ATTR_NOTHROW;
+
+/**
+ * \brief               Set the number of decompression threads of an input/output state.
+ * \param io_state      The input/output state.
+ * \param threads       The number of decompression threads.
+ *
+ * Overrides the header setting (see gta_set_decompression_threads()) for
+ * gta_read_elements() calls that use this state. The default is 0, which means
+ * that the header setting is used. The setting is evaluated when the first chunk
+ * is read.
+ */
+extern GTA_EXPORT void
+gta_set_io_state_decompression_threads(gta_io_state_t *GTA_RESTRICT io_state, unsigned int threads)
+GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW;
+
 /**
  * \brief               Read array elements.
  * \param header        The header.
@@ -1216,6 +1617,124 @@ gta_read_elements_from_fd(const gta_header_t *GTA_RESTRICT header, gta_io_state_
         uintmax_t n, void *GTA_RESTRICT buf, int fd)
 GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL;
 
+/**
+ * \brief               Read array elements from a memory buffer.
+ * \param header        The header.
+ * \param io_state      The input/output state.
+ * \param n             The number of elements to read.
+ * \param buf           The buffer for the elements.
+ * \param buffer        The input buffer.
+ * \param size          The size of the input buffer.
+ * \param offset        The current offset in the input buffer.
+ * \return              \a GTA_OK, \a GTA_INVALID_DATA, \a GTA_OVERFLOW, \a GTA_UNEXPECTED_EOF, or \a GTA_SYSTEM_ERROR.
+ *
+ * Reads the given number of elements into the given buffer, which must be large enough.
+ * Compressed chunks are decompressed directly from the input buffer.
+ * On success, \a offset is advanced past the input that was consumed.
+ */
+extern GTA_EXPORT gta_result_t
+gta_read_elements_from_memory(const gta_header_t *GTA_RESTRICT header, gta_io_state_t *GTA_RESTRICT io_state,
+        uintmax_t n, void *GTA_RESTRICT buf, const void *GTA_RESTRICT buffer, size_t size, size_t *GTA_RESTRICT offset)
+GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL;
+
+/**
+ * \brief               Read selected components of array elements.
+ * \param header        The header.
+ * \param io_state      The input/output state.
+ * \param n             The number of elements to read.
+ * \param count         The number of selected components.
+ * \param components    The indices of the selected components.
+ * \param buffers       The output buffers, one for each selected component.
+ * \param strides       The distance in bytes between consecutive elements in each output buffer, or NULL.
+ * \param read_fn       The custom input function.
+ * \param userdata      A parameter to the custom input function.
+ * \return              \a GTA_OK, \a GTA_INVALID_DATA, \a GTA_OVERFLOW, \a GTA_UNEXPECTED_EOF, or \a GTA_SYSTEM_ERROR.
+ *
+ * Reads the given number of elements like gta_read_elements(), but stores only the
+ * selected components: the value of component \a components[k] of element j is
+ * stored at \a buffers[k] + j * \a strides[k], in host endianness.
+ * The complete elements are never stored; the components are copied out of the
+ * data chunks directly.\n
+ * If \a strides is NULL, the values of each component are tightly packed, so that
+ * each buffer must hold \a n values of its component. To get an interleaved buffer that
+ * contains only the selected components, let \a buffers[k] point to the position of the
+ * component in the first element and set all strides to the size of such an element.\n
+ * A component index may be selected more than once. Invalid component indices result in
+ * \a GTA_INVALID_DATA, without consuming input. If no components are selected (\a count is 0,
+ * and \a components and \a buffers may be NULL), the elements are skipped.\n
+ * This function can be mixed with gta_read_elements() calls on the same input/output state.
+ */
+extern GTA_EXPORT gta_result_t
+gta_read_element_components(const gta_header_t *GTA_RESTRICT header, gta_io_state_t *GTA_RESTRICT io_state,
+        uintmax_t n, size_t count, const uintmax_t *GTA_RESTRICT components,
+        void *const *GTA_RESTRICT buffers, const size_t *GTA_RESTRICT strides,
+        gta_read_t read_fn, intptr_t userdata)
+GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL3(1, 2, 8);
+
+/**
+ * \brief               Read selected components of array elements from a stream.
+ * \param header        The header.
+ * \param io_state      The input/output state.
+ * \param n             The number of elements to read.
+ * \param count         The number of selected components.
+ * \param components    The indices of the selected components.
+ * \param buffers       The output buffers, one for each selected component.
+ * \param strides       The distance in bytes between consecutive elements in each output buffer, or NULL.
+ * \param f             The stream.
+ * \return              \a GTA_OK, \a GTA_INVALID_DATA, \a GTA_OVERFLOW, \a GTA_UNEXPECTED_EOF, or \a GTA_SYSTEM_ERROR.
+ *
+ * See gta_read_element_components().
+ */
+extern GTA_EXPORT gta_result_t
+gta_read_element_components_from_stream(const gta_header_t *GTA_RESTRICT header, gta_io_state_t *GTA_RESTRICT io_state,
+        uintmax_t n, size_t count, const uintmax_t *GTA_RESTRICT components,
+        void *const *GTA_RESTRICT buffers, const size_t *GTA_RESTRICT strides, FILE *GTA_RESTRICT f)
+GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL3(1, 2, 8);
+
+/**
+ * \brief               Read selected components of array elements from a file descriptor.
+ * \param header        The header.
+ * \param io_state      The input/output state.
+ * \param n             The number of elements to read.
+ * \param count         The number of selected components.
+ * \param components    The indices of the selected components.
+ * \param buffers       The output buffers, one for each selected component.
+ * \param strides       The distance in bytes between consecutive elements in each output buffer, or NULL.
+ * \param fd            The file descriptor.
+ * \return              \a GTA_OK, \a GTA_INVALID_DATA, \a GTA_OVERFLOW, \a GTA_UNEXPECTED_EOF, or \a GTA_SYSTEM_ERROR.
+ *
+ * See gta_read_element_components().
+ */
+extern GTA_EXPORT gta_result_t
+gta_read_element_components_from_fd(const gta_header_t *GTA_RESTRICT header, gta_io_state_t *GTA_RESTRICT io_state,
+        uintmax_t n, size_t count, const uintmax_t *GTA_RESTRICT components,
+        void *const *GTA_RESTRICT buffers, const size_t *GTA_RESTRICT strides, int fd)
+GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL2(1, 2);
+
+/**
+ * \brief               Read selected components of array elements from a memory buffer.
+ * \param header        The header.
+ * \param io_state      The input/output state.
+ * \param n             The number of elements to read.
+ * \param count         The number of selected components.
+ * \param components    The indices of the selected components.
+ * \param buffers       The output buffers, one for each selected component.
+ * \param strides       The distance in bytes between consecutive elements in each output buffer, or NULL.
+ * \param buffer        The input buffer.
+ * \param size          The size of the input buffer.
+ * \param offset        The current offset in the input buffer.
+ * \return              \a GTA_OK, \a GTA_INVALID_DATA, \a GTA_OVERFLOW, \a GTA_UNEXPECTED_EOF, or \a GTA_SYSTEM_ERROR.
+ *
+ * See gta_read_element_components().
+ * On success, \a offset is advanced past the input that was consumed.
+ */
+extern GTA_EXPORT gta_result_t
+gta_read_element_components_from_memory(const gta_header_t *GTA_RESTRICT header, gta_io_state_t *GTA_RESTRICT io_state,
+        uintmax_t n, size_t count, const uintmax_t *GTA_RESTRICT components,
+        void *const *GTA_RESTRICT buffers, const size_t *GTA_RESTRICT strides,
+        const void *GTA_RESTRICT buffer, size_t size, size_t *GTA_RESTRICT offset)
+GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL3(1, 2, 8) GTA_ATTR_NONNULL1(10);
+
 /**
  * \brief               Write array elements.
  * \param header        The header.
@@ -1265,6 +1784,26 @@ gta_write_elements_to_fd(const gta_header_t *GTA_RESTRICT header, gta_io_state_t
         uintmax_t n, const void *GTA_RESTRICT buf, int fd)
 GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL;
 
+/**
+ * \brief               Write array elements to a memory buffer.
+ * \param header        The header.
+ * \param io_state      The input/output state.
+ * \param n             The number of elements to write.
+ * \param buf           The buffer for the elements.
+ * \param buffer        The output buffer, or NULL.
+ * \param size          The number of bytes already in the output buffer.
+ * \param capacity      The allocated size of the output buffer.
+ * \return              \a GTA_OK, \a GTA_INVALID_DATA, \a GTA_OVERFLOW, or \a GTA_SYSTEM_ERROR.
+ *
+ * Writes the given number of elements from the given buffer, appending the output to the output buffer.
+ * See gta_write_header_to_memory() for the handling of the output buffer.
+ */
+extern GTA_EXPORT gta_result_t
+gta_write_elements_to_memory(const gta_header_t *GTA_RESTRICT header, gta_io_state_t *GTA_RESTRICT io_state,
+        uintmax_t n, const void *GTA_RESTRICT buf,
+        void *GTA_RESTRICT *GTA_RESTRICT buffer, size_t *GTA_RESTRICT size, size_t *GTA_RESTRICT capacity)
+GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL;
+
 
 /*@}*/
 
@@ -1280,7 +1819,9 @@ GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL;
  * A block is given by the lowest and highest element coordinates in each dimension.
  * For example, for a 2D array from which we want a rectangle of 20x10 elements starting at
  * element (5,3), we would store the values (5,3) in \a lower_coordinates and (24, 12) in
- * \a higher_coordinates.
+ * \a higher_coordinates.\n
+ * Blocks that span complete rows or planes of the array are contiguous in the data, and are
+ * transferred with few large I/O operations.
  */
 
 /*@{*/
@@ -1336,7 +1877,9 @@ GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW;
  * \return                      \a GTA_OK, \a GTA_UNSUPPORTED_DATA (if the data is compressed), \a GTA_OVERFLOW, \a GTA_UNEXPECTED_EOF, or \a GTA_SYSTEM_ERROR.
  *
  * Reads the given array block and copies it to the given block buffer, which must be large enough.\n
- * This function modifies the file position indicator of the input.
+ * Where the system supports it, positional I/O is used, so that rows that are close to each
+ * other are read with a single system call. The file position indicator of the input is
+ * unspecified afterwards.
  */
 extern GTA_EXPORT gta_result_t
 gta_read_block_from_fd(const gta_header_t *GTA_RESTRICT header, intmax_t data_offset,
@@ -1344,6 +1887,78 @@ gta_read_block_from_fd(const gta_header_t *GTA_RESTRICT header, intmax_t data_of
         void *GTA_RESTRICT block, int fd)
 GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW;
 
+/**
+ * \brief                       Read selected components of an array block.
+ * \param header                The header.
+ * \param data_offset           Offset of the first data byte.
+ * \param lower_coordinates     Coordinates of the lower corner element of the block.
+ * \param higher_coordinates    Coordinates of the higher corner element of the block.
+ * \param count                 The number of selected components.
+ * \param components            The indices of the selected components.
+ * \param buffers               The output buffers, one for each selected component.
+ * \param strides               The distance in bytes between consecutive elements in each output buffer, or NULL.
+ * \param read_fn               The custom input function.
+ * \param seek_fn               The custom seek function.
+ * \param userdata              A parameter to the custom input function.
+ * \return                      \a GTA_OK, \a GTA_INVALID_DATA, \a GTA_UNSUPPORTED_DATA (if the data is compressed), \a GTA_OVERFLOW, \a GTA_UNEXPECTED_EOF, or \a GTA_SYSTEM_ERROR.
+ *
+ * Reads the given array block like gta_read_block(), but stores only the selected
+ * components, in the same way as gta_read_element_components(). The elements are
+ * numbered in block order.\n
+ * This function modifies the file position indicator of the input.
+ */
+extern GTA_EXPORT gta_result_t
+gta_read_block_components(const gta_header_t *GTA_RESTRICT header, intmax_t data_offset,
+        const uintmax_t *GTA_RESTRICT lower_coordinates, const uintmax_t *GTA_RESTRICT higher_coordinates,
+        size_t count, const uintmax_t *GTA_RESTRICT components,
+        void *const *GTA_RESTRICT buffers, const size_t *GTA_RESTRICT strides,
+        gta_read_t read_fn, gta_seek_t seek_fn, intptr_t userdata)
+GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL3(1, 3, 4) GTA_ATTR_NONNULL2(9, 10);
+
+/**
+ * \brief                       Read selected components of an array block from a stream.
+ * \param header                The header.
+ * \param data_offset           Offset of the first data byte.
+ * \param lower_coordinates     Coordinates of the lower corner element of the block.
+ * \param higher_coordinates    Coordinates of the higher corner element of the block.
+ * \param count                 The number of selected components.
+ * \param components            The indices of the selected components.
+ * \param buffers               The output buffers, one for each selected component.
+ * \param strides               The distance in bytes between consecutive elements in each output buffer, or NULL.
+ * \param f                     The stream.
+ * \return                      \a GTA_OK, \a GTA_INVALID_DATA, \a GTA_UNSUPPORTED_DATA (if the data is compressed), \a GTA_OVERFLOW, \a GTA_UNEXPECTED_EOF, or \a GTA_SYSTEM_ERROR.
+ *
+ * See gta_read_block_components().
+ */
+extern GTA_EXPORT gta_result_t
+gta_read_block_components_from_stream(const gta_header_t *GTA_RESTRICT header, intmax_t data_offset,
+        const uintmax_t *GTA_RESTRICT lower_coordinates, const uintmax_t *GTA_RESTRICT higher_coordinates,
+        size_t count, const uintmax_t *GTA_RESTRICT components,
+        void *const *GTA_RESTRICT buffers, const size_t *GTA_RESTRICT strides, FILE *GTA_RESTRICT f)
+GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL3(1, 3, 4) GTA_ATTR_NONNULL1(9) GTA_ATTR_NOTHROW;
+
+/**
+ * \brief                       Read selected components of an array block from a file descriptor.
+ * \param header                The header.
+ * \param data_offset           Offset of the first data byte.
+ * \param lower_coordinates     Coordinates of the lower corner element of the block.
+ * \param higher_coordinates    Coordinates of the higher corner element of the block.
+ * \param count                 The number of selected components.
+ * \param components            The indices of the selected components.
+ * \param buffers               The output buffers, one for each selected component.
+ * \param strides               The distance in bytes between consecutive elements in each output buffer, or NULL.
+ * \param fd                    The file descriptor.
+ * \return                      \a GTA_OK, \a GTA_INVALID_DATA, \a GTA_UNSUPPORTED_DATA (if the data is compressed), \a GTA_OVERFLOW, \a GTA_UNEXPECTED_EOF, or \a GTA_SYSTEM_ERROR.
+ *
+ * See gta_read_block_components().
+ */
+extern GTA_EXPORT gta_result_t
+gta_read_block_components_from_fd(const gta_header_t *GTA_RESTRICT header, intmax_t data_offset,
+        const uintmax_t *GTA_RESTRICT lower_coordinates, const uintmax_t *GTA_RESTRICT higher_coordinates,
+        size_t count, const uintmax_t *GTA_RESTRICT components,
+        void *const *GTA_RESTRICT buffers, const size_t *GTA_RESTRICT strides, int fd)
+GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL3(1, 3, 4) GTA_ATTR_NOTHROW;
+
 /**
  * \brief                       Write an array block.
  * \param header                The header.
@@ -1392,7 +2007,8 @@ GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW;
  * \param fd                    The file descriptor.
  * \return                      \a GTA_OK, \a GTA_UNSUPPORTED_DATA (if the data is compressed), \a GTA_OVERFLOW, \a GTA_SYSTEM_ERROR.
  *
- * This function modifies the file position indicator of the output.
+ * Where the system supports it, positional I/O is used. The file position indicator of the
+ * output is unspecified afterwards.
  */
 extern GTA_EXPORT gta_result_t
 gta_write_block_to_fd(const gta_header_t *GTA_RESTRICT header, intmax_t data_offset,
@@ -1400,6 +2016,330 @@ gta_write_block_to_fd(const gta_header_t *GTA_RESTRICT header, intmax_t data_off
         const void *GTA_RESTRICT block, int fd)
 GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW;
 
+/**
+ * \brief                       Read an array block from a file descriptor without using its file position.
+ * \param header                The header.
+ * \param data_offset           Offset of the first data byte.
+ * \param lower_coordinates     Coordinates of the lower corner element of the block.
+ * \param higher_coordinates    Coordinates of the higher corner element of the block.
+ * \param block                 The block buffer.
+ * \param fd                    The file descriptor.
+ * \return                      \a GTA_OK, \a GTA_UNSUPPORTED_DATA (if the data is compressed), \a GTA_OVERFLOW, \a GTA_UNEXPECTED_EOF, or \a GTA_SYSTEM_ERROR.
+ *
+ * Reads the given array block and copies it to the given block buffer, which must be large enough.\n
+ * This function uses positional I/O: it neither uses nor modifies the file position of \a fd.
+ * Several threads can therefore read blocks from the same file descriptor concurrently.\n
+ * If the system does not support positional I/O, this function fails with \a GTA_SYSTEM_ERROR
+ * and sets errno to ENOSYS.
+ */
+extern GTA_EXPORT gta_result_t
+gta_pread_block_from_fd(const gta_header_t *GTA_RESTRICT header, intmax_t data_offset,
+        const uintmax_t *GTA_RESTRICT lower_coordinates, const uintmax_t *GTA_RESTRICT higher_coordinates,
+        void *GTA_RESTRICT block, int fd)
+GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW;
+
+/**
+ * \brief                       Write an array block to a file descriptor without using its file position.
+ * \param header                The header.
+ * \param data_offset           Offset of the first data byte.
+ * \param lower_coordinates     Coordinates of the lower corner element of the block.
+ * \param higher_coordinates    Coordinates of the higher corner element of the block.
+ * \param block                 The block buffer.
+ * \param fd                    The file descriptor.
+ * \return                      \a GTA_OK, \a GTA_UNSUPPORTED_DATA (if the data is compressed), \a GTA_OVERFLOW, \a GTA_SYSTEM_ERROR.
+ *
+ * This function uses positional I/O: it neither uses nor modifies the file position of \a fd.
+ * Several threads can therefore write non-overlapping blocks to the same file descriptor
+ * concurrently.\n
+ * If the system does not support positional I/O, this function fails with \a GTA_SYSTEM_ERROR
+ * and sets errno to ENOSYS.
+ */
+extern GTA_EXPORT gta_result_t
+gta_pwrite_block_to_fd(const gta_header_t *GTA_RESTRICT header, intmax_t data_offset,
+        const uintmax_t *GTA_RESTRICT lower_coordinates, const uintmax_t *GTA_RESTRICT higher_coordinates,
+        const void *GTA_RESTRICT block, int fd)
+GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW;
+
+/**
+ * \brief                       Read several array blocks.
+ * \param header                The header.
+ * \param data_offset           Offset of the first data byte.
+ * \param n                     The number of blocks.
+ * \param lower_coordinates     Coordinates of the lower corner elements of the blocks, one after the other.
+ * \param higher_coordinates    Coordinates of the higher corner elements of the blocks, one after the other.
+ * \param blocks                The block buffers, one for each block.
+ * \param read_fn               The custom input function.
+ * \param seek_fn               The custom seek function.
+ * \param userdata              A parameter to the custom input function.
+ * \return                      \a GTA_OK, \a GTA_UNSUPPORTED_DATA (if the data is compressed), \a GTA_OVERFLOW, \a GTA_UNEXPECTED_EOF, or \a GTA_SYSTEM_ERROR.
+ *
+ * Reads the given array blocks and copies each to its block buffer, which must be large enough.
+ * The coordinates of block i start at index i * dimensions of \a lower_coordinates and
+ * \a higher_coordinates. Blocks may overlap.\n
+ * This is more efficient than reading the blocks one by one: the data of all blocks is
+ * read in the order of the file, and data that is close together is read with a single operation.\n
+ * This function modifies the file position indicator of the input.
+ */
+extern GTA_EXPORT gta_result_t
+gta_read_blocks(const gta_header_t *GTA_RESTRICT header, intmax_t data_offset, size_t n,
+        const uintmax_t *GTA_RESTRICT lower_coordinates, const uintmax_t *GTA_RESTRICT higher_coordinates,
+        void *const *GTA_RESTRICT blocks, gta_read_t read_fn, gta_seek_t seek_fn, intptr_t userdata)
+GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL;
+
+/**
+ * \brief                       Read several array blocks from a stream.
+ * \param header                The header.
+ * \param data_offset           Offset of the first data byte.
+ * \param n                     The number of blocks.
+ * \param lower_coordinates     Coordinates of the lower corner elements of the blocks, one after the other.
+ * \param higher_coordinates    Coordinates of the higher corner elements of the blocks, one after the other.
+ * \param blocks                The block buffers, one for each block.
+ * \param f                     The stream.
+ * \return                      \a GTA_OK, \a GTA_UNSUPPORTED_DATA (if the data is compressed), \a GTA_OVERFLOW, \a GTA_UNEXPECTED_EOF, or \a GTA_SYSTEM_ERROR.
+ *
+ * See gta_read_blocks().\n
+ * This function modifies the file position indicator of the input.
+ */
+extern GTA_EXPORT gta_result_t
+gta_read_blocks_from_stream(const gta_header_t *GTA_RESTRICT header, intmax_t data_offset, size_t n,
+        const uintmax_t *GTA_RESTRICT lower_coordinates, const uintmax_t *GTA_RESTRICT higher_coordinates,
+        void *const *GTA_RESTRICT blocks, FILE *GTA_RESTRICT f)
+GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW;
+
+/**
+ * \brief                       Read several array blocks from a file descriptor.
+ * \param header                The header.
+ * \param data_offset           Offset of the first data byte.
+ * \param n                     The number of blocks.
+ * \param lower_coordinates     Coordinates of the lower corner elements of the blocks, one after the other.
+ * \param higher_coordinates    Coordinates of the higher corner elements of the blocks, one after the other.
+ * \param blocks                The block buffers, one for each block.
+ * \param fd                    The file descriptor.
+ * \return                      \a GTA_OK, \a GTA_UNSUPPORTED_DATA (if the data is compressed), \a GTA_OVERFLOW, \a GTA_UNEXPECTED_EOF, or \a GTA_SYSTEM_ERROR.
+ *
+ * See gta_read_blocks().\n
+ * Where the system supports it, positional I/O is used. The file position indicator of the
+ * input is unspecified afterwards.
+ */
+extern GTA_EXPORT gta_result_t
+gta_read_blocks_from_fd(const gta_header_t *GTA_RESTRICT header, intmax_t data_offset, size_t n,
+        const uintmax_t *GTA_RESTRICT lower_coordinates, const uintmax_t *GTA_RESTRICT higher_coordinates,
+        void *const *GTA_RESTRICT blocks, int fd)
+GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW;
+
+/*@}*/
+
+
+/**
+ *
+ * \name Random Access to Compressed Data
+ *
+ * Compressed data is stored in chunks of up to 16 MiB, and the size of each chunk is only known
+ * after the previous chunk was read. A chunk index stores the position of each chunk, so that
+ * blocks of compressed arrays can be read by decompressing only the chunks that overlap the block.\n
+ * The index is created by scanning the chunk list once. This reads only the small chunk headers
+ * if the input is seekable. The index does not change afterwards, so it can be shared between
+ * threads that read from separate inputs.
+ */
+
+/*@{*/
+
+/**
+ * \brief               Create a chunk index.
+ * \param header        The header.
+ * \param index         The chunk index.
+ * \param read_fn       The custom input function.
+ * \param seek_fn       The custom seek function, or NULL for non-seekable input.
+ * \param userdata      A parameter to the custom input/seek functions.
+ * \return              \a GTA_OK, \a GTA_OVERFLOW, \a GTA_INVALID_DATA, \a GTA_UNEXPECTED_EOF, or \a GTA_SYSTEM_ERROR.
+ *
+ * Scans the data, which must start at the current input position, and creates an index of its chunks.
+ * Afterwards, the input position is after the end of the data, as with gta_skip_data().\n
+ * If the data is not compressed, the index is empty.
+ * The index must be freed with gta_destroy_chunk_index().
+ */
+extern GTA_EXPORT gta_result_t
+gta_create_chunk_index(const gta_header_t *GTA_RESTRICT header, gta_chunk_index_t *GTA_RESTRICT *GTA_RESTRICT index,
+        gta_read_t read_fn, gta_seek_t seek_fn, intptr_t userdata)
+GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL3(1, 2, 3);
+
+/**
+ * \brief               Create a chunk index from a stream.
+ * \param header        The header.
+ * \param index         The chunk index.
+ * \param f             The stream.
+ * \return              \a GTA_OK, \a GTA_OVERFLOW, \a GTA_INVALID_DATA, \a GTA_UNEXPECTED_EOF, or \a GTA_SYSTEM_ERROR.
+ *
+ * See gta_create_chunk_index().
+ */
+extern GTA_EXPORT gta_result_t
+gta_create_chunk_index_from_stream(const gta_header_t *GTA_RESTRICT header,
+        gta_chunk_index_t *GTA_RESTRICT *GTA_RESTRICT index, FILE *GTA_RESTRICT f)
+GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL;
+
+/**
+ * \brief               Create a chunk index from a file descriptor.
+ * \param header        The header.
+ * \param index         The chunk index.
+ * \param fd            The file descriptor.
+ * \return              \a GTA_OK, \a GTA_OVERFLOW, \a GTA_INVALID_DATA, \a GTA_UNEXPECTED_EOF, or \a GTA_SYSTEM_ERROR.
+ *
+ * See gta_create_chunk_index().
+ */
+extern GTA_EXPORT gta_result_t
+gta_create_chunk_index_from_fd(const gta_header_t *GTA_RESTRICT header,
+        gta_chunk_index_t *GTA_RESTRICT *GTA_RESTRICT index, int fd)
+GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL;
+
+/**
+ * \brief               Destroy a chunk index and free its resources.
+ * \param index         The chunk index.
+ */
+extern GTA_EXPORT void
+gta_destroy_chunk_index(gta_chunk_index_t *GTA_RESTRICT index)
+GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW;
+
+/**
+ * \brief               Get the number of chunks in a chunk index.
+ * \param index         The chunk index.
+ * \return              The number of chunks (0 for uncompressed data).
+ */
+extern GTA_EXPORT uintmax_t
+gta_get_chunk_index_chunks(const gta_chunk_index_t *GTA_RESTRICT index)
+GTA_ATTR_NONNULL_ALL GTA_ATTR_PURE GTA_ATTR_NOTHROW;
+
+/**
+ * \brief                       Read an array block using a chunk index.
+ * \param header                The header.
+ * \param index                 The chunk index.
+ * \param data_offset           Offset of the first data byte.
+ * \param lower_coordinates     Coordinates of the lower corner element of the block.
+ * \param higher_coordinates    Coordinates of the higher corner element of the block.
+ * \param block                 The block buffer.
+ * \param read_fn               The custom input function.
+ * \param seek_fn               The custom seek function.
+ * \param userdata              A parameter to the custom input function.
+ * \return                      \a GTA_OK, \a GTA_UNSUPPORTED_DATA, \a GTA_INVALID_DATA, \a GTA_OVERFLOW, \a GTA_UNEXPECTED_EOF, or \a GTA_SYSTEM_ERROR.
+ *
+ * Like gta_read_block(), but also works for compressed data. Only the chunks that
+ * overlap the block are read and decompressed, each at most once per call.\n
+ * For uncompressed data, this is equivalent to gta_read_block().\n
+ * This function modifies the file position indicator of the input.
+ */
+extern GTA_EXPORT gta_result_t
+gta_read_block_with_index(const gta_header_t *GTA_RESTRICT header, const gta_chunk_index_t *GTA_RESTRICT index,
+        intmax_t data_offset,
+        const uintmax_t *GTA_RESTRICT lower_coordinates, const uintmax_t *GTA_RESTRICT higher_coordinates,
+        void *GTA_RESTRICT block, gta_read_t read_fn, gta_seek_t seek_fn, intptr_t userdata)
+GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL;
+
+/**
+ * \brief                       Read an array block from a stream using a chunk index.
+ * \param header                The header.
+ * \param index                 The chunk index.
+ * \param data_offset           Offset of the first data byte.
+ * \param lower_coordinates     Coordinates of the lower corner element of the block.
+ * \param higher_coordinates    Coordinates of the higher corner element of the block.
+ * \param block                 The block buffer.
+ * \param f                     The stream.
+ * \return                      \a GTA_OK, \a GTA_UNSUPPORTED_DATA, \a GTA_INVALID_DATA, \a GTA_OVERFLOW, \a GTA_UNEXPECTED_EOF, or \a GTA_SYSTEM_ERROR.
+ *
+ * See gta_read_block_with_index().
+ */
+extern GTA_EXPORT gta_result_t
+gta_read_block_with_index_from_stream(const gta_header_t *GTA_RESTRICT header,
+        const gta_chunk_index_t *GTA_RESTRICT index, intmax_t data_offset,
+        const uintmax_t *GTA_RESTRICT lower_coordinates, const uintmax_t *GTA_RESTRICT higher_coordinates,
+        void *GTA_RESTRICT block, FILE *GTA_RESTRICT f)
+GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL;
+
+/**
+ * \brief                       Read an array block from a file descriptor using a chunk index.
+ * \param header                The header.
+ * \param index                 The chunk index.
+ * \param data_offset           Offset of the first data byte.
+ * \param lower_coordinates     Coordinates of the lower corner element of the block.
+ * \param higher_coordinates    Coordinates of the higher corner element of the block.
+ * \param block                 The block buffer.
+ * \param fd                    The file descriptor.
+ * \return                      \a GTA_OK, \a GTA_UNSUPPORTED_DATA, \a GTA_INVALID_DATA, \a GTA_OVERFLOW, \a GTA_UNEXPECTED_EOF, or \a GTA_SYSTEM_ERROR.
+ *
+ * See gta_read_block_with_index().
+ */
+extern GTA_EXPORT gta_result_t
+gta_read_block_with_index_from_fd(const gta_header_t *GTA_RESTRICT header,
+        const gta_chunk_index_t *GTA_RESTRICT index, intmax_t data_offset,
+        const uintmax_t *GTA_RESTRICT lower_coordinates, const uintmax_t *GTA_RESTRICT higher_coordinates,
+        void *GTA_RESTRICT block, int fd)
+GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL;
+
+/*@}*/
+
+
+/**
+ *
+ * \name Memory-Mapped Data Access
+ *
+ * The data of an uncompressed array that is stored in host endianness has exactly the layout
+ * that the in-memory element access functions such as gta_get_element() expect. Such data
+ * can be mapped into memory directly instead of being copied with gta_read_data(). Only the parts
+ * of the data that are actually accessed are read from the file, by the operating system.\n
+ * If the system does not support memory mapping, or the input is not a regular file, the data is
+ * read into a buffer instead. The interface is the same in both cases.
+ */
+
+/*@{*/
+
+/**
+ * \brief                       Map array data into memory.
+ * \param header                The header.
+ * \param data_offset           Offset of the first data byte.
+ * \param mapping               The mapping.
+ * \param fd                    The file descriptor.
+ * \return                      \a GTA_OK, \a GTA_UNSUPPORTED_DATA (if the data is compressed or not in host endianness), \a GTA_OVERFLOW, \a GTA_UNEXPECTED_EOF, or \a GTA_SYSTEM_ERROR.
+ *
+ * Maps the data of the array read-only into memory. Use gta_get_mapped_data() to access it, and
+ * gta_unmap_data() to release it. The file descriptor can be closed while the mapping exists.
+ */
+extern GTA_EXPORT gta_result_t
+gta_map_data_from_fd(const gta_header_t *GTA_RESTRICT header, intmax_t data_offset,
+        gta_mapping_t *GTA_RESTRICT *GTA_RESTRICT mapping, int fd)
+GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW;
+
+/**
+ * \brief                       Map array data from a stream into memory.
+ * \param header                The header.
+ * \param data_offset           Offset of the first data byte.
+ * \param mapping               The mapping.
+ * \param f                     The stream.
+ * \return                      \a GTA_OK, \a GTA_UNSUPPORTED_DATA (if the data is compressed or not in host endianness), \a GTA_OVERFLOW, \a GTA_UNEXPECTED_EOF, or \a GTA_SYSTEM_ERROR.
+ *
+ * See gta_map_data_from_fd().
+ */
+extern GTA_EXPORT gta_result_t
+gta_map_data_from_stream(const gta_header_t *GTA_RESTRICT header, intmax_t data_offset,
+        gta_mapping_t *GTA_RESTRICT *GTA_RESTRICT mapping, FILE *GTA_RESTRICT f)
+GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW;
+
+/**
+ * \brief                       Get the mapped array data.
+ * \param mapping               The mapping.
+ * \return                      The array data.
+ *
+ * The data can be used with gta_get_element_const() and the other in-memory access functions.
+ */
+extern GTA_EXPORT const void *
+gta_get_mapped_data(const gta_mapping_t *GTA_RESTRICT mapping)
+GTA_ATTR_NONNULL_ALL GTA_ATTR_PURE GTA_ATTR_NOTHROW;
+
+/**
+ * \brief                       Unmap array data.
+ * \param mapping               The mapping.
+ */
+extern GTA_EXPORT void
+gta_unmap_data(gta_mapping_t *GTA_RESTRICT mapping)
+GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW;
+
 /*@}*/
 
 
@@ -151,6 +151,10 @@ namespace gta
      * \a gta::bzip2 compression is moderately fast and achieves a good compression ratio.
      * \a gta::xz compression is slow for compression, moderately fast for decompression,
      * and achieves good or very good compression rates.
+     * \a gta::zstd compression is very fast at low levels and achieves a better compression
+     * ratio than \a gta::zlib; higher levels trade speed for ratio.
+     * \a gta::lz4 compression is the fastest method and achieves a low compression ratio.\n
+     * \a gta::zstd and \a gta::lz4 are only available if libgta was built with libzstd and liblz4.
      */
     enum compression
     {
@@ -166,7 +170,43 @@ namespace gta
         zlib8 = GTA_ZLIB8, /**< \brief ZLIB compression with level 8 */
         zlib9 = GTA_ZLIB9, /**< \brief ZLIB compression with level 9 */
         bzip2 = GTA_BZIP2, /**< \brief BZIP2 compression (moderate speed, good compression rates) */
-        xz = GTA_XZ        /**< \brief XZ compression (low/moderate speed, good/very good compression rates) */
+        xz = GTA_XZ,       /**< \brief XZ compression (low/moderate speed, good/very good compression rates) */
+        zstd = GTA_ZSTD,   /**< \brief ZSTD compression (very fast, good compression rates) */
+        zstd1  = GTA_ZSTD1,  /**< \brief ZSTD compression with level 1 */
+        zstd2  = GTA_ZSTD2,  /**< \brief ZSTD compression with level 2 */
+        zstd3  = GTA_ZSTD3,  /**< \brief ZSTD compression with level 3 */
+        zstd4  = GTA_ZSTD4,  /**< \brief ZSTD compression with level 4 */
+        zstd5  = GTA_ZSTD5,  /**< \brief ZSTD compression with level 5 */
+        zstd6  = GTA_ZSTD6,  /**< \brief ZSTD compression with level 6 */
+        zstd7  = GTA_ZSTD7,  /**< \brief ZSTD compression with level 7 */
+        zstd8  = GTA_ZSTD8,  /**< \brief ZSTD compression with level 8 */
+        zstd9  = GTA_ZSTD9,  /**< \brief ZSTD compression with level 9 */
+        zstd10 = GTA_ZSTD10, /**< \brief ZSTD compression with level 10 */
+        zstd11 = GTA_ZSTD11, /**< \brief ZSTD compression with level 11 */
+        zstd12 = GTA_ZSTD12, /**< \brief ZSTD compression with level 12 */
+        zstd13 = GTA_ZSTD13, /**< \brief ZSTD compression with level 13 */
+        zstd14 = GTA_ZSTD14, /**< \brief ZSTD compression with level 14 */
+        zstd15 = GTA_ZSTD15, /**< \brief ZSTD compression with level 15 */
+        zstd16 = GTA_ZSTD16, /**< \brief ZSTD compression with level 16 */
+        zstd17 = GTA_ZSTD17, /**< \brief ZSTD compression with level 17 */
+        zstd18 = GTA_ZSTD18, /**< \brief ZSTD compression with level 18 */
+        zstd19 = GTA_ZSTD19, /**< \brief ZSTD compression with level 19 */
+        lz4 = GTA_LZ4      /**< \brief LZ4 compression (fastest, low compression rates) */
+    };
+
+    /**
+     * \brief GTA pre-filters
+     *
+     * This is equivalent to \a gta_filter_t from the C interface.\n
+     * Pre-filters rearrange the bytes of the array elements before compression,
+     * so that the compression methods find more redundancy.
+     */
+    enum filter
+    {
+        filter_none = GTA_FILTER_NONE,                  /**< \brief No filter */
+        filter_shuffle = GTA_FILTER_SHUFFLE,            /**< \brief Byte shuffle by element size */
+        filter_bitshuffle = GTA_FILTER_BITSHUFFLE,      /**< \brief Bit shuffle by element size */
+        filter_delta = GTA_FILTER_DELTA                 /**< \brief Bytewise difference of consecutive elements */
     };
 
     /**
@@ -296,6 +336,9 @@ namespace gta
          * \brief       Get a tag name.
          * \param i     The tag index.
          * \return      The name of the tag.
+         *
+         * The returned string remains valid until this tag is removed, or the tag list is
+         * cleared, replaced, or destroyed.
          */
         const char *name(uintmax_t i) const
         {
@@ -306,6 +349,9 @@ namespace gta
          * \brief       Get a tag value.
          * \param i     The tag index.
          * \return      The value of the tag.
+         *
+         * The returned string remains valid until this tag is changed or removed, or the
+         * tag list is cleared, replaced, or destroyed.
          */
         const char *value(uintmax_t i) const
         {
@@ -316,6 +362,9 @@ namespace gta
          * \brief       Get a tag value by its name.
          * \param name  The tag name.
          * \return      The tag value, or NULL if the tag name is not found.
+         *
+         * The returned string remains valid until this tag is changed or removed, or the
+         * tag list is cleared, replaced, or destroyed.
          */
         const char *get(const char *name) const
         {
@@ -694,6 +743,148 @@ namespace gta
         }
         /** \endcond */
 
+        /**
+         * \brief               Get the number of compression threads.
+         * \return              The number of compression threads.
+         *
+         * See \a gta_set_io_state_compression_threads().
+         */
+        unsigned int compression_threads() const
+        {
+            return gta_get_io_state_compression_threads(_state);
+        }
+
+        /**
+         * \brief               Set the number of compression threads.
+         * \param threads       The number of compression threads.
+         *
+         * Overrides the header setting for element-based output with this state.\n
+         * See \a gta_set_io_state_compression_threads() for more information.
+         */
+        void set_compression_threads(unsigned int threads)
+        {
+            gta_set_io_state_compression_threads(_state, threads);
+        }
+
+        /**
+         * \brief               Get the number of decompression threads.
+         * \return              The number of decompression threads.
+         *
+         * See \a gta_set_io_state_decompression_threads().
+         */
+        unsigned int decompression_threads() const
+        {
+            return gta_get_io_state_decompression_threads(_state);
+        }
+
+        /**
+         * \brief               Set the number of decompression threads.
+         * \param threads       The number of decompression threads.
+         *
+         * Overrides the header setting for element-based input with this state.\n
+         * See \a gta_set_io_state_decompression_threads() for more information.
+         */
+        void set_decompression_threads(unsigned int threads)
+        {
+            gta_set_io_state_decompression_threads(_state, threads);
+        }
+
+        friend class header;
+    };
+
+    /**
+     * \brief   Index of the chunks of compressed data.
+     *
+     * See \a header::create_chunk_index() and \a header::read_block().
+     */
+    class chunk_index
+    {
+    private:
+
+        gta_chunk_index_t *_index;
+
+        // Not copyable
+        chunk_index(const chunk_index &);
+        chunk_index &operator=(const chunk_index &);
+
+    public:
+
+        chunk_index() : _index(NULL)
+        {
+        }
+
+        ~chunk_index()
+        {
+            if (_index)
+            {
+                gta_destroy_chunk_index(_index);
+            }
+        }
+
+        /**
+         * \brief               Get the number of chunks.
+         * \return              The number of chunks (0 for uncompressed data or an empty index).
+         */
+        uintmax_t chunks() const
+        {
+            return _index ? gta_get_chunk_index_chunks(_index) : 0;
+        }
+
+        friend class header;
+    };
+
+    /**
+     * \brief   Array data that is mapped into memory.
+     *
+     * See \a header::map_data().
+     */
+    class mapping
+    {
+    private:
+
+        gta_mapping_t *_mapping;
+
+        // Not copyable
+        mapping(const mapping &);
+        mapping &operator=(const mapping &);
+
+    public:
+
+        mapping() : _mapping(NULL)
+        {
+        }
+
+        ~mapping()
+        {
+            if (_mapping)
+            {
+                gta_unmap_data(_mapping);
+            }
+        }
+
+        /**
+         * \brief               Get the mapped data.
+         * \return              The array data, or NULL if nothing is mapped.
+         *
+         * The data can be used with \a header::element() and the other in-memory access functions.
+         */
+        const void *data() const
+        {
+            return _mapping ? gta_get_mapped_data(_mapping) : NULL;
+        }
+
+        /**
+         * \brief               Unmap the data.
+         */
+        void unmap()
+        {
+            if (_mapping)
+            {
+                gta_unmap_data(_mapping);
+                _mapping = NULL;
+            }
+        }
+
         friend class header;
     };
 
@@ -878,6 +1069,22 @@ namespace gta
             reset_taglists();
         }
 
+        /**
+         * \brief               Read a header.
+         * \param buffer        Input buffer.
+         * \param size          Size of the input buffer.
+         * \param offset        Offset of the header in the input buffer; advanced past it.
+         */
+        void read_from(const void *buffer, size_t size, size_t &offset)
+        {
+            gta_result_t r = gta_read_header_from_memory(_header, buffer, size, &offset);
+            if (r != GTA_OK)
+            {
+                throw exception("Cannot read GTA header", static_cast<gta::result>(r));
+            }
+            reset_taglists();
+        }
+
         /**
          * \brief       Write a header.
          * \param io    Custom output object.
@@ -931,6 +1138,23 @@ namespace gta
             }
         }
 
+        /**
+         * \brief               Write a header.
+         * \param buffer        Output buffer, or NULL.
+         * \param size          Number of bytes already in the output buffer.
+         * \param capacity      Allocated size of the output buffer.
+         *
+         * Appends the header to the output buffer and enlarges it as needed. See \a gta_write_header_to_memory().
+         */
+        void write_to(void *&buffer, size_t &size, size_t &capacity) const
+        {
+            gta_result_t r = gta_write_header_to_memory(_header, &buffer, &size, &capacity);
+            if (r != GTA_OK)
+            {
+                throw exception("Cannot write GTA header", static_cast<gta::result>(r));
+            }
+        }
+
         /*@}*/
 
         /**
@@ -1098,6 +1322,74 @@ namespace gta
             gta_set_compression(_header, static_cast<gta_compression_t>(compression));
         }
 
+        /**
+         * \brief               Get the pre-filter.
+         * \return              The pre-filter.
+         *
+         * See \a gta_get_filter().
+         */
+        gta::filter filter() const
+        {
+            return static_cast<gta::filter>(gta_get_filter(_header));
+        }
+
+        /**
+         * \brief               Set the pre-filter.
+         * \param filter        The pre-filter.
+         *
+         * See \a gta_set_filter().
+         */
+        void set_filter(gta::filter filter)
+        {
+            gta_set_filter(_header, static_cast<gta_filter_t>(filter));
+        }
+
+        /**
+         * \brief               Get the number of compression threads.
+         * \return              The number of compression threads.
+         *
+         * See \a gta_set_compression_threads().
+         */
+        unsigned int compression_threads() const
+        {
+            return gta_get_compression_threads(_header);
+        }
+
+        /**
+         * \brief               Set the number of compression threads.
+         * \param threads       The number of compression threads.
+         *
+         * Sets the number of data chunks that are compressed in parallel when writing data.\n
+         * See \a gta_set_compression_threads() for more information.
+         */
+        void set_compression_threads(unsigned int threads)
+        {
+            gta_set_compression_threads(_header, threads);
+        }
+
+        /**
+         * \brief               Get the number of decompression threads.
+         * \return              The number of decompression threads.
+         *
+         * See \a gta_set_decompression_threads().
+         */
+        unsigned int decompression_threads() const
+        {
+            return gta_get_decompression_threads(_header);
+        }
+
+        /**
+         * \brief               Set the number of decompression threads.
+         * \param threads       The number of decompression threads.
+         *
+         * Sets the number of data chunks that are read ahead and decompressed in parallel when reading data.\n
+         * See \a gta_set_decompression_threads() for more information.
+         */
+        void set_decompression_threads(unsigned int threads)
+        {
+            gta_set_decompression_threads(_header, threads);
+        }
+
         /*@}*/
 
         /**
@@ -1369,6 +1661,44 @@ namespace gta
             }
         }
 
+        /**
+         * \brief               Read the complete data.
+         * \param buffer        Input buffer.
+         * \param size          Size of the input buffer.
+         * \param offset        Offset of the data in the input buffer; advanced past it.
+         * \param data          Data buffer.
+         *
+         * Reads the complete data into the given buffer. The buffer must be large enough.
+         */
+        void read_data(const void *buffer, size_t size, size_t &offset, void *data) const
+        {
+            gta_result_t r = gta_read_data_from_memory(_header, data, buffer, size, &offset);
+            if (r != GTA_OK)
+            {
+                throw exception("Cannot read GTA data", static_cast<gta::result>(r));
+            }
+        }
+
+        /**
+         * \brief               Get the complete data in a memory buffer, without copying it.
+         * \param buffer        Input buffer.
+         * \param size          Size of the input buffer.
+         * \param offset        Offset of the data in the input buffer; advanced past it.
+         * \return              A pointer to the data inside \a buffer.
+         *
+         * The data must be uncompressed and in host endianness. See \a gta_get_data_from_memory().
+         */
+        const void *get_data(const void *buffer, size_t size, size_t &offset) const
+        {
+            const void *data;
+            gta_result_t r = gta_get_data_from_memory(_header, &data, buffer, size, &offset);
+            if (r != GTA_OK)
+            {
+                throw exception("Cannot read GTA data", static_cast<gta::result>(r));
+            }
+            return data;
+        }
+
         /**
          * \brief       Skip the complete data.
          * \param io    Custom input object.
@@ -1434,6 +1764,23 @@ namespace gta
             }
         }
 
+        /**
+         * \brief               Skip the complete data.
+         * \param buffer        Input buffer.
+         * \param size          Size of the input buffer.
+         * \param offset        Offset of the data in the input buffer; advanced past it.
+         *
+         * Skips the complete data, so that the next GTA header can be read.
+         */
+        void skip_data(const void *buffer, size_t size, size_t &offset) const
+        {
+            gta_result_t r = gta_skip_data_from_memory(_header, buffer, size, &offset);
+            if (r != GTA_OK)
+            {
+                throw exception("Cannot skip GTA data", static_cast<gta::result>(r));
+            }
+        }
+
         /**
          * \brief       Write the complete data.
          * \param io    Custom output object.
@@ -1491,6 +1838,24 @@ namespace gta
             }
         }
 
+        /**
+         * \brief               Write the complete data.
+         * \param buffer        Output buffer, or NULL.
+         * \param size          Number of bytes already in the output buffer.
+         * \param capacity      Allocated size of the output buffer.
+         * \param data          Data buffer.
+         *
+         * Appends the complete data to the output buffer and enlarges it as needed. See \a gta_write_header_to_memory().
+         */
+        void write_data(void *&buffer, size_t &size, size_t &capacity, const void *data) const
+        {
+            gta_result_t r = gta_write_data_to_memory(_header, data, &buffer, &size, &capacity);
+            if (r != GTA_OK)
+            {
+                throw exception("Cannot write GTA data", static_cast<gta::result>(r));
+            }
+        }
+
         /**
          * \brief               Copy the complete data.
          * \param read_io       Custom input object.
@@ -1836,97 +2201,260 @@ namespace gta
         }
 
         /**
-         * \brief               Write array elements.
+         * \brief               Read array elements.
          * \param state         The input/output state.
-         * \param io            Custom output object.
-         * \param n             The number of elements to write.
+         * \param buffer        Input buffer.
+         * \param size          Size of the input buffer.
+         * \param offset        Current offset in the input buffer; advanced past the consumed input.
+         * \param n             The number of elements to read.
          * \param buf           The buffer for the elements.
          *
-         * Writes the given number of elements from the given buffer.
+         * Reads the given number of elements into the given buffer, which must be large enough.
          */
-        void write_elements(io_state &state, custom_io &io, uintmax_t n, const void *buf) const
+        void read_elements(io_state &state, const void *buffer, size_t size, size_t &offset, uintmax_t n, void *buf) const
         {
-            gta_result_t r = gta_write_elements(_header, state._state, n, buf, write_custom_io, reinterpret_cast<intptr_t>(&io));
+            gta_result_t r = gta_read_elements_from_memory(_header, state._state, n, buf, buffer, size, &offset);
             if (r != GTA_OK)
             {
-                throw exception("Cannot write GTA data elements", static_cast<gta::result>(r));
+                throw exception("Cannot read GTA data elements", static_cast<gta::result>(r));
             }
         }
 
         /**
-         * \brief               Write array elements.
+         * \brief               Read selected components of array elements.
          * \param state         The input/output state.
-         * \param os            Output stream.
-         * \param n             The number of elements to write.
-         * \param buf           The buffer for the elements.
+         * \param io            Custom input object.
+         * \param n             The number of elements to read.
+         * \param count         The number of selected components.
+         * \param components    The indices of the selected components.
+         * \param buffers       The output buffers, one for each selected component.
+         * \param strides       The distance in bytes between consecutive elements in each output buffer, or NULL.
          *
-         * Writes the given number of elements from the given buffer.
+         * Reads the given number of elements, but stores only the selected components.
+         * See gta_read_element_components().
          */
-        void write_elements(io_state &state, std::ostream &os, uintmax_t n, const void *buf) const
+        void read_element_components(io_state &state, custom_io &io, uintmax_t n,
+                size_t count, const uintmax_t *components, void *const *buffers, const size_t *strides = NULL) const
         {
-            ostream_io io(os);
-            gta_result_t r = gta_write_elements(_header, state._state, n, buf, write_custom_io, reinterpret_cast<intptr_t>(&io));
+            gta_result_t r = gta_read_element_components(_header, state._state, n, count, components, buffers, strides,
+                    read_custom_io, reinterpret_cast<intptr_t>(&io));
             if (r != GTA_OK)
             {
-                throw exception("Cannot write GTA data elements", static_cast<gta::result>(r));
+                throw exception("Cannot read GTA data elements", static_cast<gta::result>(r));
             }
         }
 
         /**
-         * \brief               Write array elements.
+         * \brief               Read selected components of array elements.
          * \param state         The input/output state.
-         * \param f             Output stream.
-         * \param n             The number of elements to write.
-         * \param buf           The buffer for the elements.
+         * \param is            Input stream.
+         * \param n             The number of elements to read.
+         * \param count         The number of selected components.
+         * \param components    The indices of the selected components.
+         * \param buffers       The output buffers, one for each selected component.
+         * \param strides       The distance in bytes between consecutive elements in each output buffer, or NULL.
          *
-         * Writes the given number of elements from the given buffer.
+         * Reads the given number of elements, but stores only the selected components.
+         * See gta_read_element_components().
          */
-        void write_elements(io_state &state, FILE *f, uintmax_t n, const void *buf) const
+        void read_element_components(io_state &state, std::istream &is, uintmax_t n,
+                size_t count, const uintmax_t *components, void *const *buffers, const size_t *strides = NULL) const
         {
-            gta_result_t r = gta_write_elements_to_stream(_header, state._state, n, buf, f);
+            istream_io io(is);
+            gta_result_t r = gta_read_element_components(_header, state._state, n, count, components, buffers, strides,
+                    read_custom_io, reinterpret_cast<intptr_t>(&io));
             if (r != GTA_OK)
             {
-                throw exception("Cannot write GTA data elements", static_cast<gta::result>(r));
+                throw exception("Cannot read GTA data elements", static_cast<gta::result>(r));
             }
         }
 
         /**
-         * \brief               Write array elements.
+         * \brief               Read selected components of array elements.
          * \param state         The input/output state.
-         * \param fd            Output file descriptor.
-         * \param n             The number of elements to write.
-         * \param buf           The buffer for the elements.
+         * \param f             Input stream.
+         * \param n             The number of elements to read.
+         * \param count         The number of selected components.
+         * \param components    The indices of the selected components.
+         * \param buffers       The output buffers, one for each selected component.
+         * \param strides       The distance in bytes between consecutive elements in each output buffer, or NULL.
          *
-         * Writes the given number of elements from the given buffer.
+         * Reads the given number of elements, but stores only the selected components.
+         * See gta_read_element_components().
          */
-        void write_elements(io_state &state, int fd, uintmax_t n, const void *buf) const
+        void read_element_components(io_state &state, FILE *f, uintmax_t n,
+                size_t count, const uintmax_t *components, void *const *buffers, const size_t *strides = NULL) const
         {
-            gta_result_t r = gta_write_elements_to_fd(_header, state._state, n, buf, fd);
+            gta_result_t r = gta_read_element_components_from_stream(_header, state._state, n,
+                    count, components, buffers, strides, f);
             if (r != GTA_OK)
             {
-                throw exception("Cannot write GTA data elements", static_cast<gta::result>(r));
+                throw exception("Cannot read GTA data elements", static_cast<gta::result>(r));
             }
         }
 
-        /*@}*/
-
         /**
-         * \name Read and Write Array Blocks
+         * \brief               Read selected components of array elements.
+         * \param state         The input/output state.
+         * \param fd            Input file descriptor.
+         * \param n             The number of elements to read.
+         * \param count         The number of selected components.
+         * \param components    The indices of the selected components.
+         * \param buffers       The output buffers, one for each selected component.
+         * \param strides       The distance in bytes between consecutive elements in each output buffer, or NULL.
          *
-         * These functions can only be used if the data is not compressed (see \a header::compression())
-         * and the input/output is seekable.\n
-         * They are suitable for applications that do not want to store the complete array data in
-         * memory.\n
-         * A block is given by the lowest and highest element coordinates in each dimension.
-         * For example, for a 2D array from which we want a rectangle of 20x10 elements starting at
-         * element (5,3), we would store the values (5,3) in \a lower_coordinates and (24, 12) in
-         * \a higher_coordinates.
+         * Reads the given number of elements, but stores only the selected components.
+         * See gta_read_element_components().
          */
-
-        /*@{*/
-
-        /**
-         * \brief                       Read an array block.
+        void read_element_components(io_state &state, int fd, uintmax_t n,
+                size_t count, const uintmax_t *components, void *const *buffers, const size_t *strides = NULL) const
+        {
+            gta_result_t r = gta_read_element_components_from_fd(_header, state._state, n,
+                    count, components, buffers, strides, fd);
+            if (r != GTA_OK)
+            {
+                throw exception("Cannot read GTA data elements", static_cast<gta::result>(r));
+            }
+        }
+
+        /**
+         * \brief               Read selected components of array elements.
+         * \param state         The input/output state.
+         * \param buffer        Input buffer.
+         * \param size          Size of the input buffer.
+         * \param offset        Current offset in the input buffer; advanced past the consumed input.
+         * \param n             The number of elements to read.
+         * \param count         The number of selected components.
+         * \param components    The indices of the selected components.
+         * \param buffers       The output buffers, one for each selected component.
+         * \param strides       The distance in bytes between consecutive elements in each output buffer, or NULL.
+         *
+         * Reads the given number of elements, but stores only the selected components.
+         * See gta_read_element_components().
+         */
+        void read_element_components(io_state &state, const void *buffer, size_t size, size_t &offset, uintmax_t n,
+                size_t count, const uintmax_t *components, void *const *buffers, const size_t *strides = NULL) const
+        {
+            gta_result_t r = gta_read_element_components_from_memory(_header, state._state, n,
+                    count, components, buffers, strides, buffer, size, &offset);
+            if (r != GTA_OK)
+            {
+                throw exception("Cannot read GTA data elements", static_cast<gta::result>(r));
+            }
+        }
+
+        /**
+         * \brief               Write array elements.
+         * \param state         The input/output state.
+         * \param io            Custom output object.
+         * \param n             The number of elements to write.
+         * \param buf           The buffer for the elements.
+         *
+         * Writes the given number of elements from the given buffer.
+         */
+        void write_elements(io_state &state, custom_io &io, uintmax_t n, const void *buf) const
+        {
+            gta_result_t r = gta_write_elements(_header, state._state, n, buf, write_custom_io, reinterpret_cast<intptr_t>(&io));
+            if (r != GTA_OK)
+            {
+                throw exception("Cannot write GTA data elements", static_cast<gta::result>(r));
+            }
+        }
+
+        /**
+         * \brief               Write array elements.
+         * \param state         The input/output state.
+         * \param os            Output stream.
+         * \param n             The number of elements to write.
+         * \param buf           The buffer for the elements.
+         *
+         * Writes the given number of elements from the given buffer.
+         */
+        void write_elements(io_state &state, std::ostream &os, uintmax_t n, const void *buf) const
+        {
+            ostream_io io(os);
+            gta_result_t r = gta_write_elements(_header, state._state, n, buf, write_custom_io, reinterpret_cast<intptr_t>(&io));
+            if (r != GTA_OK)
+            {
+                throw exception("Cannot write GTA data elements", static_cast<gta::result>(r));
+            }
+        }
+
+        /**
+         * \brief               Write array elements.
+         * \param state         The input/output state.
+         * \param f             Output stream.
+         * \param n             The number of elements to write.
+         * \param buf           The buffer for the elements.
+         *
+         * Writes the given number of elements from the given buffer.
+         */
+        void write_elements(io_state &state, FILE *f, uintmax_t n, const void *buf) const
+        {
+            gta_result_t r = gta_write_elements_to_stream(_header, state._state, n, buf, f);
+            if (r != GTA_OK)
+            {
+                throw exception("Cannot write GTA data elements", static_cast<gta::result>(r));
+            }
+        }
+
+        /**
+         * \brief               Write array elements.
+         * \param state         The input/output state.
+         * \param fd            Output file descriptor.
+         * \param n             The number of elements to write.
+         * \param buf           The buffer for the elements.
+         *
+         * Writes the given number of elements from the given buffer.
+         */
+        void write_elements(io_state &state, int fd, uintmax_t n, const void *buf) const
+        {
+            gta_result_t r = gta_write_elements_to_fd(_header, state._state, n, buf, fd);
+            if (r != GTA_OK)
+            {
+                throw exception("Cannot write GTA data elements", static_cast<gta::result>(r));
+            }
+        }
+
+        /**
+         * \brief               Write array elements.
+         * \param state         The input/output state.
+         * \param buffer        Output buffer, or NULL.
+         * \param size          Number of bytes already in the output buffer.
+         * \param capacity      Allocated size of the output buffer.
+         * \param n             The number of elements to write.
+         * \param buf           The buffer for the elements.
+         *
+         * Appends the given number of elements from the given buffer to the output buffer.
+         */
+        void write_elements(io_state &state, void *&buffer, size_t &size, size_t &capacity, uintmax_t n, const void *buf) const
+        {
+            gta_result_t r = gta_write_elements_to_memory(_header, state._state, n, buf, &buffer, &size, &capacity);
+            if (r != GTA_OK)
+            {
+                throw exception("Cannot write GTA data elements", static_cast<gta::result>(r));
+            }
+        }
+
+        /*@}*/
+
+        /**
+         * \name Read and Write Array Blocks
+         *
+         * These functions can only be used if the data is not compressed (see \a header::compression())
+         * and the input/output is seekable.\n
+         * They are suitable for applications that do not want to store the complete array data in
+         * memory.\n
+         * A block is given by the lowest and highest element coordinates in each dimension.
+         * For example, for a 2D array from which we want a rectangle of 20x10 elements starting at
+         * element (5,3), we would store the values (5,3) in \a lower_coordinates and (24, 12) in
+         * \a higher_coordinates.
+         */
+
+        /*@{*/
+
+        /**
+         * \brief                       Read an array block.
          * \param io                    Custom input object.
          * \param data_offset           Offset of the first data byte.
          * \param lower_coordinates     Coordinates of the lower corner element of the block.
@@ -2006,7 +2534,7 @@ namespace gta
          * \param block                 Block buffer.
          *
          * Reads the given array block and copies it to the given block buffer, which must be large enough.\n
-         * This function modifies the file position indicator of the input.
+         * The file position indicator of the input is unspecified afterwards.
          */
         void read_block(int fd, uintmax_t data_offset,
                 const uintmax_t *lower_coordinates, const uintmax_t *higher_coordinates,
@@ -2020,6 +2548,113 @@ namespace gta
             }
         }
 
+        /**
+         * \brief                       Read selected components of an array block.
+         * \param io                    Custom input object.
+         * \param data_offset           Offset of the first data byte.
+         * \param lower_coordinates     Coordinates of the lower corner element of the block.
+         * \param higher_coordinates    Coordinates of the higher corner element of the block.
+         * \param count                 The number of selected components.
+         * \param components            The indices of the selected components.
+         * \param buffers               The output buffers, one for each selected component.
+         * \param strides               The distance in bytes between consecutive elements in each output buffer, or NULL.
+         *
+         * Reads the given array block, but stores only the selected components.
+         * See gta_read_block_components().
+         */
+        void read_block_components(custom_io &io, uintmax_t data_offset,
+                const uintmax_t *lower_coordinates, const uintmax_t *higher_coordinates,
+                size_t count, const uintmax_t *components, void *const *buffers, const size_t *strides = NULL) const
+        {
+            gta_result_t r = gta_read_block_components(_header, data_offset,
+                    lower_coordinates, higher_coordinates, count, components, buffers, strides,
+                    read_custom_io, seek_custom_io, reinterpret_cast<intptr_t>(&io));
+            if (r != GTA_OK)
+            {
+                throw exception("Cannot read GTA data block", static_cast<gta::result>(r));
+            }
+        }
+
+        /**
+         * \brief                       Read selected components of an array block.
+         * \param is                    Input stream.
+         * \param data_offset           Offset of the first data byte.
+         * \param lower_coordinates     Coordinates of the lower corner element of the block.
+         * \param higher_coordinates    Coordinates of the higher corner element of the block.
+         * \param count                 The number of selected components.
+         * \param components            The indices of the selected components.
+         * \param buffers               The output buffers, one for each selected component.
+         * \param strides               The distance in bytes between consecutive elements in each output buffer, or NULL.
+         *
+         * Reads the given array block, but stores only the selected components.
+         * See gta_read_block_components().
+         */
+        void read_block_components(std::istream &is, uintmax_t data_offset,
+                const uintmax_t *lower_coordinates, const uintmax_t *higher_coordinates,
+                size_t count, const uintmax_t *components, void *const *buffers, const size_t *strides = NULL) const
+        {
+            istream_io io(is);
+            gta_result_t r = gta_read_block_components(_header, data_offset,
+                    lower_coordinates, higher_coordinates, count, components, buffers, strides,
+                    read_custom_io, seek_custom_io, reinterpret_cast<intptr_t>(&io));
+            if (r != GTA_OK)
+            {
+                throw exception("Cannot read GTA data block", static_cast<gta::result>(r));
+            }
+        }
+
+        /**
+         * \brief                       Read selected components of an array block.
+         * \param f                     Input C stream.
+         * \param data_offset           Offset of the first data byte.
+         * \param lower_coordinates     Coordinates of the lower corner element of the block.
+         * \param higher_coordinates    Coordinates of the higher corner element of the block.
+         * \param count                 The number of selected components.
+         * \param components            The indices of the selected components.
+         * \param buffers               The output buffers, one for each selected component.
+         * \param strides               The distance in bytes between consecutive elements in each output buffer, or NULL.
+         *
+         * Reads the given array block, but stores only the selected components.
+         * See gta_read_block_components().
+         */
+        void read_block_components(FILE *f, uintmax_t data_offset,
+                const uintmax_t *lower_coordinates, const uintmax_t *higher_coordinates,
+                size_t count, const uintmax_t *components, void *const *buffers, const size_t *strides = NULL) const
+        {
+            gta_result_t r = gta_read_block_components_from_stream(_header, data_offset,
+                    lower_coordinates, higher_coordinates, count, components, buffers, strides, f);
+            if (r != GTA_OK)
+            {
+                throw exception("Cannot read GTA data block", static_cast<gta::result>(r));
+            }
+        }
+
+        /**
+         * \brief                       Read selected components of an array block.
+         * \param fd                    Input file descriptor.
+         * \param data_offset           Offset of the first data byte.
+         * \param lower_coordinates     Coordinates of the lower corner element of the block.
+         * \param higher_coordinates    Coordinates of the higher corner element of the block.
+         * \param count                 The number of selected components.
+         * \param components            The indices of the selected components.
+         * \param buffers               The output buffers, one for each selected component.
+         * \param strides               The distance in bytes between consecutive elements in each output buffer, or NULL.
+         *
+         * Reads the given array block, but stores only the selected components.
+         * See gta_read_block_components().
+         */
+        void read_block_components(int fd, uintmax_t data_offset,
+                const uintmax_t *lower_coordinates, const uintmax_t *higher_coordinates,
+                size_t count, const uintmax_t *components, void *const *buffers, const size_t *strides = NULL) const
+        {
+            gta_result_t r = gta_read_block_components_from_fd(_header, data_offset,
+                    lower_coordinates, higher_coordinates, count, components, buffers, strides, fd);
+            if (r != GTA_OK)
+            {
+                throw exception("Cannot read GTA data block", static_cast<gta::result>(r));
+            }
+        }
+
         /**
          * \brief                       Write an array block.
          * \param io                    Custom output object.
@@ -2097,7 +2732,7 @@ namespace gta
          * \param higher_coordinates    Coordinates of the higher corner element of the block.
          * \param block                 Block buffer.
          *
-         * This function modifies the file position indicator of the output.
+         * The file position indicator of the output is unspecified afterwards.
          */
         void write_block(int fd, uintmax_t data_offset,
                 const uintmax_t *lower_coordinates, const uintmax_t *higher_coordinates,
@@ -2111,6 +2746,401 @@ namespace gta
             }
         }
 
+        /**
+         * \brief                       Read an array block without using the file position.
+         * \param fd                    Input file descriptor.
+         * \param data_offset           Offset of the first data byte.
+         * \param lower_coordinates     Coordinates of the lower corner element of the block.
+         * \param higher_coordinates    Coordinates of the higher corner element of the block.
+         * \param block                 Block buffer.
+         *
+         * Reads the given array block and copies it to the given block buffer, which must be large enough.\n
+         * Several threads can use this function on the same file descriptor concurrently.
+         */
+        void pread_block(int fd, uintmax_t data_offset,
+                const uintmax_t *lower_coordinates, const uintmax_t *higher_coordinates,
+                void *block) const
+        {
+            gta_result_t r = gta_pread_block_from_fd(_header, data_offset,
+                    lower_coordinates, higher_coordinates, block, fd);
+            if (r != GTA_OK)
+            {
+                throw exception("Cannot read GTA data block", static_cast<gta::result>(r));
+            }
+        }
+
+        /**
+         * \brief                       Write an array block without using the file position.
+         * \param fd                    Output file descriptor.
+         * \param data_offset           Offset of the first data byte.
+         * \param lower_coordinates     Coordinates of the lower corner element of the block.
+         * \param higher_coordinates    Coordinates of the higher corner element of the block.
+         * \param block                 Block buffer.
+         *
+         * Several threads can use this function on the same file descriptor concurrently,
+         * as long as their blocks do not overlap.
+         */
+        void pwrite_block(int fd, uintmax_t data_offset,
+                const uintmax_t *lower_coordinates, const uintmax_t *higher_coordinates,
+                const void *block) const
+        {
+            gta_result_t r = gta_pwrite_block_to_fd(_header, data_offset,
+                    lower_coordinates, higher_coordinates, block, fd);
+            if (r != GTA_OK)
+            {
+                throw exception("Cannot write GTA data block", static_cast<gta::result>(r));
+            }
+        }
+
+        /**
+         * \brief                       Read several array blocks.
+         * \param io                    Custom input object.
+         * \param data_offset           Offset of the first data byte.
+         * \param n                     Number of blocks.
+         * \param lower_coordinates     Coordinates of the lower corner elements of the blocks, one after the other.
+         * \param higher_coordinates    Coordinates of the higher corner elements of the blocks, one after the other.
+         * \param blocks                Block buffers, one for each block.
+         *
+         * See gta_read_blocks().\n
+         * This function modifies the file position indicator of the input.
+         */
+        void read_blocks(custom_io &io, uintmax_t data_offset, size_t n,
+                const uintmax_t *lower_coordinates, const uintmax_t *higher_coordinates,
+                void *const *blocks) const
+        {
+            gta_result_t r = gta_read_blocks(_header, data_offset, n,
+                    lower_coordinates, higher_coordinates, blocks,
+                    read_custom_io, seek_custom_io, reinterpret_cast<intptr_t>(&io));
+            if (r != GTA_OK)
+            {
+                throw exception("Cannot read GTA data blocks", static_cast<gta::result>(r));
+            }
+        }
+
+        /**
+         * \brief                       Read several array blocks.
+         * \param is                    Input stream.
+         * \param data_offset           Offset of the first data byte.
+         * \param n                     Number of blocks.
+         * \param lower_coordinates     Coordinates of the lower corner elements of the blocks, one after the other.
+         * \param higher_coordinates    Coordinates of the higher corner elements of the blocks, one after the other.
+         * \param blocks                Block buffers, one for each block.
+         *
+         * See gta_read_blocks().\n
+         * This function modifies the file position indicator of the input.
+         */
+        void read_blocks(std::istream &is, uintmax_t data_offset, size_t n,
+                const uintmax_t *lower_coordinates, const uintmax_t *higher_coordinates,
+                void *const *blocks) const
+        {
+            istream_io io(is);
+            gta_result_t r = gta_read_blocks(_header, data_offset, n,
+                    lower_coordinates, higher_coordinates, blocks,
+                    read_custom_io, seek_custom_io, reinterpret_cast<intptr_t>(&io));
+            if (r != GTA_OK)
+            {
+                throw exception("Cannot read GTA data blocks", static_cast<gta::result>(r));
+            }
+        }
+
+        /**
+         * \brief                       Read several array blocks.
+         * \param f                     Input C stream.
+         * \param data_offset           Offset of the first data byte.
+         * \param n                     Number of blocks.
+         * \param lower_coordinates     Coordinates of the lower corner elements of the blocks, one after the other.
+         * \param higher_coordinates    Coordinates of the higher corner elements of the blocks, one after the other.
+         * \param blocks                Block buffers, one for each block.
+         *
+         * See gta_read_blocks().\n
+         * This function modifies the file position indicator of the input.
+         */
+        void read_blocks(FILE *f, uintmax_t data_offset, size_t n,
+                const uintmax_t *lower_coordinates, const uintmax_t *higher_coordinates,
+                void *const *blocks) const
+        {
+            gta_result_t r = gta_read_blocks_from_stream(_header, data_offset, n,
+                    lower_coordinates, higher_coordinates, blocks, f);
+            if (r != GTA_OK)
+            {
+                throw exception("Cannot read GTA data blocks", static_cast<gta::result>(r));
+            }
+        }
+
+        /**
+         * \brief                       Read several array blocks.
+         * \param fd                    Input file descriptor.
+         * \param data_offset           Offset of the first data byte.
+         * \param n                     Number of blocks.
+         * \param lower_coordinates     Coordinates of the lower corner elements of the blocks, one after the other.
+         * \param higher_coordinates    Coordinates of the higher corner elements of the blocks, one after the other.
+         * \param blocks                Block buffers, one for each block.
+         *
+         * See gta_read_blocks().\n
+         * The file position indicator of the input is unspecified afterwards.
+         */
+        void read_blocks(int fd, uintmax_t data_offset, size_t n,
+                const uintmax_t *lower_coordinates, const uintmax_t *higher_coordinates,
+                void *const *blocks) const
+        {
+            gta_result_t r = gta_read_blocks_from_fd(_header, data_offset, n,
+                    lower_coordinates, higher_coordinates, blocks, fd);
+            if (r != GTA_OK)
+            {
+                throw exception("Cannot read GTA data blocks", static_cast<gta::result>(r));
+            }
+        }
+
+        /*@}*/
+
+        /**
+         * \name Random Access to Compressed Data
+         *
+         * See the C interface for more information.
+         */
+
+        /*@{*/
+
+        /**
+         * \brief               Create a chunk index.
+         * \param index         The chunk index.
+         * \param io            Custom input object.
+         *
+         * Scans the data, which must start at the current input position, and stores the position
+         * of each chunk in the index. See \a gta_create_chunk_index().
+         */
+        void create_chunk_index(chunk_index &index, custom_io &io) const
+        {
+            gta_chunk_index_t *i;
+            gta_result_t r = gta_create_chunk_index(_header, &i, read_custom_io,
+                    (io.seekable() ? seek_custom_io : NULL),
+                    reinterpret_cast<intptr_t>(&io));
+            if (r != GTA_OK)
+            {
+                throw exception("Cannot create GTA chunk index", static_cast<gta::result>(r));
+            }
+            if (index._index)
+            {
+                gta_destroy_chunk_index(index._index);
+            }
+            index._index = i;
+        }
+
+        /**
+         * \brief               Create a chunk index.
+         * \param index         The chunk index.
+         * \param is            Input stream.
+         *
+         * Scans the data, which must start at the current input position, and stores the position
+         * of each chunk in the index. See \a gta_create_chunk_index().
+         */
+        void create_chunk_index(chunk_index &index, std::istream &is) const
+        {
+            istream_io io(is);
+            create_chunk_index(index, io);
+        }
+
+        /**
+         * \brief               Create a chunk index.
+         * \param index         The chunk index.
+         * \param f             Input C stream.
+         *
+         * Scans the data, which must start at the current input position, and stores the position
+         * of each chunk in the index. See \a gta_create_chunk_index().
+         */
+        void create_chunk_index(chunk_index &index, FILE *f) const
+        {
+            gta_chunk_index_t *i;
+            gta_result_t r = gta_create_chunk_index_from_stream(_header, &i, f);
+            if (r != GTA_OK)
+            {
+                throw exception("Cannot create GTA chunk index", static_cast<gta::result>(r));
+            }
+            if (index._index)
+            {
+                gta_destroy_chunk_index(index._index);
+            }
+            index._index = i;
+        }
+
+        /**
+         * \brief               Create a chunk index.
+         * \param index         The chunk index.
+         * \param fd            Input file descriptor.
+         *
+         * Scans the data, which must start at the current input position, and stores the position
+         * of each chunk in the index. See \a gta_create_chunk_index().
+         */
+        void create_chunk_index(chunk_index &index, int fd) const
+        {
+            gta_chunk_index_t *i;
+            gta_result_t r = gta_create_chunk_index_from_fd(_header, &i, fd);
+            if (r != GTA_OK)
+            {
+                throw exception("Cannot create GTA chunk index", static_cast<gta::result>(r));
+            }
+            if (index._index)
+            {
+                gta_destroy_chunk_index(index._index);
+            }
+            index._index = i;
+        }
+
+        /**
+         * \brief                       Read an array block using a chunk index.
+         * \param index                 The chunk index.
+         * \param io                    Custom input object.
+         * \param data_offset           Offset of the first data byte.
+         * \param lower_coordinates     Coordinates of the lower corner element of the block.
+         * \param higher_coordinates    Coordinates of the higher corner element of the block.
+         * \param block                 Block buffer.
+         *
+         * Like the other read_block() functions, but also works for compressed data.\n
+         * This function modifies the file position indicator of the input.
+         */
+        void read_block(const chunk_index &index, custom_io &io, uintmax_t data_offset,
+                const uintmax_t *lower_coordinates, const uintmax_t *higher_coordinates,
+                void *block) const
+        {
+            if (!index._index)
+            {
+                throw exception("Cannot read GTA data block", gta::invalid_data);
+            }
+            gta_result_t r = gta_read_block_with_index(_header, index._index, data_offset,
+                    lower_coordinates, higher_coordinates, block,
+                    read_custom_io, seek_custom_io, reinterpret_cast<intptr_t>(&io));
+            if (r != GTA_OK)
+            {
+                throw exception("Cannot read GTA data block", static_cast<gta::result>(r));
+            }
+        }
+
+        /**
+         * \brief                       Read an array block using a chunk index.
+         * \param index                 The chunk index.
+         * \param is                    Input stream.
+         * \param data_offset           Offset of the first data byte.
+         * \param lower_coordinates     Coordinates of the lower corner element of the block.
+         * \param higher_coordinates    Coordinates of the higher corner element of the block.
+         * \param block                 Block buffer.
+         *
+         * Like the other read_block() functions, but also works for compressed data.\n
+         * This function modifies the file position indicator of the input.
+         */
+        void read_block(const chunk_index &index, std::istream &is, uintmax_t data_offset,
+                const uintmax_t *lower_coordinates, const uintmax_t *higher_coordinates,
+                void *block) const
+        {
+            istream_io io(is);
+            read_block(index, io, data_offset, lower_coordinates, higher_coordinates, block);
+        }
+
+        /**
+         * \brief                       Read an array block using a chunk index.
+         * \param index                 The chunk index.
+         * \param f                     Input C stream.
+         * \param data_offset           Offset of the first data byte.
+         * \param lower_coordinates     Coordinates of the lower corner element of the block.
+         * \param higher_coordinates    Coordinates of the higher corner element of the block.
+         * \param block                 Block buffer.
+         *
+         * Like the other read_block() functions, but also works for compressed data.\n
+         * This function modifies the file position indicator of the input.
+         */
+        void read_block(const chunk_index &index, FILE *f, uintmax_t data_offset,
+                const uintmax_t *lower_coordinates, const uintmax_t *higher_coordinates,
+                void *block) const
+        {
+            if (!index._index)
+            {
+                throw exception("Cannot read GTA data block", gta::invalid_data);
+            }
+            gta_result_t r = gta_read_block_with_index_from_stream(_header, index._index, data_offset,
+                    lower_coordinates, higher_coordinates, block, f);
+            if (r != GTA_OK)
+            {
+                throw exception("Cannot read GTA data block", static_cast<gta::result>(r));
+            }
+        }
+
+        /**
+         * \brief                       Read an array block using a chunk index.
+         * \param index                 The chunk index.
+         * \param fd                    Input file descriptor.
+         * \param data_offset           Offset of the first data byte.
+         * \param lower_coordinates     Coordinates of the lower corner element of the block.
+         * \param higher_coordinates    Coordinates of the higher corner element of the block.
+         * \param block                 Block buffer.
+         *
+         * Like the other read_block() functions, but also works for compressed data.\n
+         * This function modifies the file position indicator of the input.
+         */
+        void read_block(const chunk_index &index, int fd, uintmax_t data_offset,
+                const uintmax_t *lower_coordinates, const uintmax_t *higher_coordinates,
+                void *block) const
+        {
+            if (!index._index)
+            {
+                throw exception("Cannot read GTA data block", gta::invalid_data);
+            }
+            gta_result_t r = gta_read_block_with_index_from_fd(_header, index._index, data_offset,
+                    lower_coordinates, higher_coordinates, block, fd);
+            if (r != GTA_OK)
+            {
+                throw exception("Cannot read GTA data block", static_cast<gta::result>(r));
+            }
+        }
+
+        /*@}*/
+
+        /**
+         * \name Memory-Mapped Data Access
+         *
+         * See the C interface for more information.
+         */
+
+        /*@{*/
+
+        /**
+         * \brief               Map array data into memory.
+         * \param m             The mapping.
+         * \param f             Input C stream.
+         * \param data_offset   Offset of the first data byte.
+         *
+         * The data must be uncompressed and in host endianness. See \a gta_map_data_from_fd().
+         */
+        void map_data(mapping &m, FILE *f, uintmax_t data_offset) const
+        {
+            gta_mapping_t *p;
+            gta_result_t r = gta_map_data_from_stream(_header, data_offset, &p, f);
+            if (r != GTA_OK)
+            {
+                throw exception("Cannot map GTA data", static_cast<gta::result>(r));
+            }
+            m.unmap();
+            m._mapping = p;
+        }
+
+        /**
+         * \brief               Map array data into memory.
+         * \param m             The mapping.
+         * \param fd            Input file descriptor.
+         * \param data_offset   Offset of the first data byte.
+         *
+         * The data must be uncompressed and in host endianness. See \a gta_map_data_from_fd().
+         */
+        void map_data(mapping &m, int fd, uintmax_t data_offset) const
+        {
+            gta_mapping_t *p;
+            gta_result_t r = gta_map_data_from_fd(_header, data_offset, &p, fd);
+            if (r != GTA_OK)
+            {
+                throw exception("Cannot map GTA data", static_cast<gta::result>(r));
+            }
+            m.unmap();
+            m._mapping = p;
+        }
+
         /*@}*/
     };
 
@@ -2164,6 +3194,51 @@ namespace gta
     }
 
     /*@}*/
+
+    /**
+     * \name Memory Management
+     */
+
+    /*@{*/
+
+    /**
+     * \brief               Set the allocator.
+     * \param malloc_fn     Replacement for malloc(), or NULL.
+     * \param realloc_fn    Replacement for realloc(), or NULL.
+     * \param free_fn       Replacement for free(), or NULL.
+     *
+     * See gta_set_allocator().
+     */
+    inline void set_allocator(void *(*malloc_fn)(size_t), void *(*realloc_fn)(void *, size_t), void (*free_fn)(void *))
+    {
+        gta_set_allocator(malloc_fn, realloc_fn, free_fn);
+    }
+
+    /**
+     * \brief               Set the size of the buffer pool.
+     * \param buffers       The maximum number of unused chunk buffers that are kept.
+     *
+     * See gta_set_buffer_pool_size().
+     */
+    inline void set_buffer_pool_size(size_t buffers)
+    {
+        gta_result_t r = gta_set_buffer_pool_size(buffers);
+        if (r != GTA_OK)
+        {
+            throw exception("Cannot set buffer pool size", static_cast<gta::result>(r));
+        }
+    }
+
+    /**
+     * \brief               Get the size of the buffer pool.
+     * \return              The maximum number of unused chunk buffers that are kept.
+     */
+    inline size_t get_buffer_pool_size()
+    {
+        return gta_get_buffer_pool_size();
+    }
+
+    /*@}*/
 }
 
 #ifdef _MSC_VER
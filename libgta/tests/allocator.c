@@ -0,0 +1,196 @@
+/*
+ * allocator.c
+ *
+ * This file is part of libgta, a library that implements the Generic Tagged
+ * Array (GTA) file format.
+ *
+ * Copyright (C) 2010, 2011
+ * Martin Lambers <marlam@marlam.de>
+ *
+ * Libgta is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 2.1 of the License, or (at your option)
+ * any later version.
+ *
+ * Libgta is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Libgta. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <gta/gta.h>
+
+#define check(condition) \
+    /* fprintf(stderr, "%s:%d: %s: Checking '%s'.\n", __FILE__, __LINE__, __PRETTY_FUNCTION__, #condition); */ \
+    if (!(condition)) \
+    { \
+        fprintf(stderr, "%s:%d: %s: Check '%s' failed.\n", \
+                __FILE__, __LINE__, __PRETTY_FUNCTION__, #condition); \
+        exit(1); \
+    }
+
+/* A counting allocator */
+static long allocated_blocks = 0;
+static long large_allocations = 0;
+
+static void *test_malloc(size_t size)
+{
+    void *ptr = malloc(size);
+    if (ptr)
+    {
+        allocated_blocks++;
+        if (size >= 16 * 1024 * 1024)
+        {
+            large_allocations++;
+        }
+    }
+    return ptr;
+}
+
+static void *test_realloc(void *ptr, size_t size)
+{
+    void *new_ptr = realloc(ptr, size);
+    if (new_ptr && !ptr)
+    {
+        allocated_blocks++;
+    }
+    return new_ptr;
+}
+
+static void test_free(void *ptr)
+{
+    if (ptr)
+    {
+        allocated_blocks--;
+    }
+    free(ptr);
+}
+
+static void read_array(const char *filename, const void *data)
+{
+    gta_header_t *header;
+    gta_io_state_t *io_state;
+    gta_result_t r;
+    FILE *f;
+
+    r = gta_create_header(&header);
+    check(r == GTA_OK);
+    f = fopen(filename, "r");
+    check(f);
+    r = gta_read_header_from_stream(header, f);
+    check(r == GTA_OK);
+    void *read_data = malloc(gta_get_data_size(header));
+    check(read_data);
+    r = gta_read_data_from_stream(header, read_data, f);
+    check(r == GTA_OK);
+    check(memcmp(read_data, data, gta_get_data_size(header)) == 0);
+    memset(read_data, 0, gta_get_data_size(header));
+    r = gta_read_header_from_stream(header, f);
+    check(r == GTA_OK);
+    r = gta_create_io_state(&io_state);
+    check(r == GTA_OK);
+    uintmax_t n = 1000003;
+    for (uintmax_t i = 0; i < gta_get_elements(header); i += n)
+    {
+        if (n > gta_get_elements(header) - i)
+        {
+            n = gta_get_elements(header) - i;
+        }
+        r = gta_read_elements_from_stream(header, io_state, n, (char *)read_data + i, f);
+        check(r == GTA_OK);
+    }
+    gta_destroy_io_state(io_state);
+    check(memcmp(read_data, data, gta_get_data_size(header)) == 0);
+    check(fclose(f) == 0);
+    free(read_data);
+    gta_destroy_header(header);
+}
+
+int main(void)
+{
+    gta_header_t *header;
+    gta_io_state_t *io_state;
+    gta_result_t r;
+    FILE *f;
+
+    gta_set_allocator(test_malloc, test_realloc, test_free);
+    check(gta_get_buffer_pool_size() == 0);
+
+    /* An array of three chunks; the first is compressible, the others are not */
+    r = gta_create_header(&header);
+    check(r == GTA_OK);
+    gta_type_t types[] = { GTA_UINT8 };
+    r = gta_set_components(header, 1, types, NULL);
+    check(r == GTA_OK);
+    uintmax_t dims[] = { 40 * 1024 * 1024 };
+    r = gta_set_dimensions(header, 1, dims);
+    check(r == GTA_OK);
+    gta_set_compression(header, GTA_ZLIB1);
+    uint8_t *data = malloc(dims[0]);
+    check(data);
+    uint32_t x = 1;
+    for (uintmax_t i = 0; i < dims[0]; i++)
+    {
+        x = x * 1664525 + 1013904223;
+        data[i] = (i < 16 * 1024 * 1024 ? i / 1000 : x >> 24);
+    }
+
+    /* Write the array twice, once completely and once element-wise */
+    f = fopen("test-allocator.tmp", "w");
+    check(f);
+    r = gta_write_header_to_stream(header, f);
+    check(r == GTA_OK);
+    r = gta_write_data_to_stream(header, data, f);
+    check(r == GTA_OK);
+    r = gta_write_header_to_stream(header, f);
+    check(r == GTA_OK);
+    r = gta_create_io_state(&io_state);
+    check(r == GTA_OK);
+    uintmax_t n = 999983;
+    for (uintmax_t i = 0; i < dims[0]; i += n)
+    {
+        if (n > dims[0] - i)
+        {
+            n = dims[0] - i;
+        }
+        r = gta_write_elements_to_stream(header, io_state, n, data + i, f);
+        check(r == GTA_OK);
+    }
+    gta_destroy_io_state(io_state);
+    check(fclose(f) == 0);
+    gta_destroy_header(header);
+
+    /* All memory comes from our allocator and is freed again */
+    check(large_allocations > 0);
+    check(allocated_blocks == 0);
+    read_array("test-allocator.tmp", data);
+    check(allocated_blocks == 0);
+
+    /* With the pool, the chunk buffers are reused */
+    r = gta_set_buffer_pool_size(4);
+    check(r == GTA_OK);
+    check(gta_get_buffer_pool_size() == 4);
+    read_array("test-allocator.tmp", data);
+    check(allocated_blocks > 0);
+    large_allocations = 0;
+    read_array("test-allocator.tmp", data);
+    check(large_allocations == 0);
+    r = gta_set_buffer_pool_size(1);
+    check(r == GTA_OK);
+    r = gta_set_buffer_pool_size(0);
+    check(r == GTA_OK);
+    check(allocated_blocks == 0);
+
+    gta_set_allocator(NULL, NULL, NULL);
+    free(data);
+    remove("test-allocator.tmp");
+    return 0;
+}
@@ -206,6 +206,40 @@ int main(void)
     free(data);
     free(data2);
 
+    /* Redefine the components of an existing array with many components */
+    gta_type_t many_types[300];
+    uintmax_t many_sizes[100];
+    for (int i = 0; i < 300; i++)
+    {
+        many_types[i] = (i % 3 == 0 ? GTA_BLOB : i % 3 == 1 ? GTA_UINT8 : GTA_FLOAT64);
+    }
+    for (int i = 0; i < 100; i++)
+    {
+        many_sizes[i] = i + 1;
+    }
+    r = gta_set_components(header, 300, many_types, many_sizes);
+    check(r == GTA_OK);
+    check(gta_get_elements(header) == 10 * 20 * 30);
+    uintmax_t offset = 0;
+    char element[6000];
+    for (int i = 0; i < 300; i++)
+    {
+        uintmax_t size = (i % 3 == 0 ? (uintmax_t)(i / 3 + 1) : i % 3 == 1 ? 1 : 8);
+        check(gta_get_component_size(header, i) == size);
+        check((char *)gta_get_component(header, element, i) == element + offset);
+        offset += size;
+    }
+    check(gta_get_element_size(header) == offset);
+    check(gta_get_data_size(header) == offset * 10 * 20 * 30);
+    r = gta_set_dimensions(header, 2, dims);
+    check(r == GTA_OK);
+    check(gta_get_elements(header) == 10 * 20);
+    check(gta_get_data_size(header) == offset * 10 * 20);
+    r = gta_set_dimensions(header, 0, NULL);
+    check(r == GTA_OK);
+    check(gta_get_elements(header) == 0);
+    check(gta_get_data_size(header) == 0);
+
     gta_destroy_header(header);
 
     return 0;
@@ -22,8 +22,14 @@
  */
 
 #include <stdio.h>
+#include <stdbool.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 #include <gta/gta.h>
 
@@ -36,6 +42,281 @@
         exit(1); \
     }
 
+static void check_block(const gta_header_t *header, const uint32_t *data,
+        const uintmax_t *lc, const uintmax_t *hc, const uint32_t *block)
+{
+    uintmax_t index = 0;
+    for (uintmax_t z = lc[2]; z <= hc[2]; z++)
+    {
+        for (uintmax_t y = lc[1]; y <= hc[1]; y++)
+        {
+            for (uintmax_t x = lc[0]; x <= hc[0]; x++)
+            {
+                uintmax_t indices[3] = { x, y, z };
+                const uint32_t *element = gta_get_element_const(header, data, indices);
+                check(block[index] == *element);
+                index++;
+            }
+        }
+    }
+}
+
+/* Test blocks that consist of complete rows and planes, and blocks with small and large
+ * gaps between their rows, with both stream and file descriptor I/O. */
+static void test_runs(void)
+{
+    gta_header_t *header;
+    gta_result_t r;
+
+    r = gta_create_header(&header);
+    check(r == GTA_OK);
+    gta_type_t types[] = { GTA_UINT32 };
+    r = gta_set_components(header, 1, types, NULL);
+    check(r == GTA_OK);
+    uintmax_t dims[] = { 1000, 100, 10 };
+    r = gta_set_dimensions(header, 3, dims);
+    check(r == GTA_OK);
+    uint32_t *data = malloc(gta_get_data_size(header));
+    check(data);
+    for (uintmax_t i = 0; i < gta_get_elements(header); i++)
+    {
+        data[i] = i;
+    }
+    int fd = open("test-blocks-runs.tmp", O_CREAT | O_TRUNC | O_RDWR, S_IRUSR | S_IWUSR);
+    check(fd != -1);
+    r = gta_write_header_to_fd(header, fd);
+    check(r == GTA_OK);
+    off_t data_offset = lseek(fd, 0, SEEK_CUR);
+    r = gta_write_data_to_fd(header, data, fd);
+    check(r == GTA_OK);
+
+    uintmax_t lc[][3] = {
+        { 0, 0, 0 }, { 0, 0, 3 }, { 0, 5, 3 }, { 10, 5, 3 }, { 0, 0, 0 }, { 999, 99, 9 }, { 0, 99, 0 } };
+    uintmax_t hc[][3] = {
+        { 999, 99, 9 }, { 999, 99, 5 }, { 999, 17, 4 }, { 20, 7, 3 }, { 9, 1, 9 }, { 999, 99, 9 }, { 999, 99, 9 } };
+    uint32_t *block = malloc(gta_get_data_size(header));
+    check(block);
+    for (size_t i = 0; i < sizeof(lc) / sizeof(lc[0]); i++)
+    {
+        memset(block, 0, gta_get_data_size(header));
+        r = gta_read_block_from_fd(header, data_offset, lc[i], hc[i], block, fd);
+        check(r == GTA_OK);
+        check_block(header, data, lc[i], hc[i], block);
+        FILE *f = fdopen(dup(fd), "r");
+        check(f);
+        memset(block, 0, gta_get_data_size(header));
+        r = gta_read_block_from_stream(header, data_offset, lc[i], hc[i], block, f);
+        check(r == GTA_OK);
+        check_block(header, data, lc[i], hc[i], block);
+        fclose(f);
+    }
+
+    /* Read all blocks at once, plus some single elements, in reverse order */
+    {
+        size_t n = sizeof(lc) / sizeof(lc[0]);
+        uintmax_t blc[sizeof(lc) / sizeof(lc[0]) + 3][3];
+        uintmax_t bhc[sizeof(lc) / sizeof(lc[0]) + 3][3];
+        void *blocks[sizeof(lc) / sizeof(lc[0]) + 3];
+        for (size_t i = 0; i < n; i++)
+        {
+            memcpy(blc[n + 2 - i], lc[i], sizeof(lc[i]));
+            memcpy(bhc[n + 2 - i], hc[i], sizeof(hc[i]));
+        }
+        uintmax_t points[3][3] = { { 7, 99, 9 }, { 3, 0, 0 }, { 4, 0, 0 } };
+        for (size_t i = 0; i < 3; i++)
+        {
+            memcpy(blc[i], points[i], sizeof(points[i]));
+            memcpy(bhc[i], points[i], sizeof(points[i]));
+        }
+        for (size_t i = 0; i < n + 3; i++)
+        {
+            blocks[i] = malloc(gta_get_data_size(header));
+            check(blocks[i]);
+        }
+        for (int k = 0; k < 2; k++)
+        {
+            for (size_t i = 0; i < n + 3; i++)
+            {
+                memset(blocks[i], 0, gta_get_data_size(header));
+            }
+            if (k == 0)
+            {
+                r = gta_read_blocks_from_fd(header, data_offset, n + 3, blc[0], bhc[0], blocks, fd);
+            }
+            else
+            {
+                FILE *f = fdopen(dup(fd), "r");
+                check(f);
+                r = gta_read_blocks_from_stream(header, data_offset, n + 3, blc[0], bhc[0], blocks, f);
+                fclose(f);
+            }
+            check(r == GTA_OK);
+            for (size_t i = 0; i < n + 3; i++)
+            {
+                check_block(header, data, blc[i], bhc[i], blocks[i]);
+            }
+        }
+        for (size_t i = 0; i < n + 3; i++)
+        {
+            free(blocks[i]);
+        }
+    }
+
+    /* Write a block with a large gap, and one with complete planes */
+    uintmax_t wlc[][3] = { { 10, 5, 2 }, { 0, 0, 7 } };
+    uintmax_t whc[][3] = { { 12, 6, 8 }, { 999, 99, 8 } };
+    for (size_t i = 0; i < 2; i++)
+    {
+        uintmax_t n = (whc[i][0] - wlc[i][0] + 1) * (whc[i][1] - wlc[i][1] + 1) * (whc[i][2] - wlc[i][2] + 1);
+        for (uintmax_t j = 0; j < n; j++)
+        {
+            block[j] = 0xffffffff - j;
+        }
+        r = gta_write_block_to_fd(header, data_offset, wlc[i], whc[i], block, fd);
+        check(r == GTA_OK);
+        uintmax_t j = 0;
+        for (uintmax_t z = wlc[i][2]; z <= whc[i][2]; z++)
+        {
+            for (uintmax_t y = wlc[i][1]; y <= whc[i][1]; y++)
+            {
+                for (uintmax_t x = wlc[i][0]; x <= whc[i][0]; x++)
+                {
+                    uintmax_t indices[3] = { x, y, z };
+                    *(uint32_t *)gta_get_element(header, data, indices) = 0xffffffff - j;
+                    j++;
+                }
+            }
+        }
+    }
+    check(lseek(fd, data_offset, SEEK_SET) == data_offset);
+    memset(block, 0, gta_get_data_size(header));
+    r = gta_read_data_from_fd(header, block, fd);
+    check(r == GTA_OK);
+    check(memcmp(block, data, gta_get_data_size(header)) == 0);
+
+    /* Positional I/O does not use or modify the file position (if the system supports it) */
+    errno = 0;
+    r = gta_pread_block_from_fd(header, data_offset, lc[0], hc[0], block, fd);
+    bool positional = !(r == GTA_SYSTEM_ERROR && errno == ENOSYS);
+    if (positional)
+    {
+        check(lseek(fd, 17, SEEK_SET) == 17);
+        for (size_t i = 0; i < sizeof(lc) / sizeof(lc[0]); i++)
+        {
+            memset(block, 0, gta_get_data_size(header));
+            r = gta_pread_block_from_fd(header, data_offset, lc[i], hc[i], block, fd);
+            check(r == GTA_OK);
+            check_block(header, data, lc[i], hc[i], block);
+            check(lseek(fd, 0, SEEK_CUR) == 17);
+        }
+        for (uintmax_t j = 0; j < 11 * 3; j++)
+        {
+            block[j] = j;
+        }
+        r = gta_pwrite_block_to_fd(header, data_offset, lc[3], hc[3], block, fd);
+        check(r == GTA_OK);
+        check(lseek(fd, 0, SEEK_CUR) == 17);
+        for (uintmax_t y = lc[3][1]; y <= hc[3][1]; y++)
+        {
+            for (uintmax_t x = lc[3][0]; x <= hc[3][0]; x++)
+            {
+                uintmax_t indices[3] = { x, y, lc[3][2] };
+                *(uint32_t *)gta_get_element(header, data, indices) = (y - lc[3][1]) * 11 + x - lc[3][0];
+            }
+        }
+        memset(block, 0, gta_get_data_size(header));
+        r = gta_pread_block_from_fd(header, data_offset, lc[2], hc[2], block, fd);
+        check(r == GTA_OK);
+        check_block(header, data, lc[2], hc[2], block);
+    }
+
+    /* Reading beyond the end of the data fails */
+    check(ftruncate(fd, data_offset + gta_get_data_size(header) - 1) == 0);
+    r = gta_read_block_from_fd(header, data_offset, lc[5], hc[5], block, fd);
+    check(r == GTA_UNEXPECTED_EOF);
+    if (positional)
+    {
+        r = gta_pread_block_from_fd(header, data_offset, lc[5], hc[5], block, fd);
+        check(r == GTA_UNEXPECTED_EOF);
+    }
+
+    close(fd);
+    free(block);
+    free(data);
+    gta_destroy_header(header);
+    remove("test-blocks-runs.tmp");
+}
+
+/* Elements without components have no data, but blocks of them can still be read and written. */
+static void test_no_components(void)
+{
+    gta_header_t *header;
+    gta_result_t r;
+
+    r = gta_create_header(&header);
+    check(r == GTA_OK);
+    r = gta_set_components(header, 0, NULL, NULL);
+    check(r == GTA_OK);
+    uintmax_t dims[] = { 2, 2 };
+    r = gta_set_dimensions(header, 2, dims);
+    check(r == GTA_OK);
+    check(gta_get_element_size(header) == 0);
+    int fd = open("test-blocks-empty.tmp", O_CREAT | O_TRUNC | O_RDWR, S_IRUSR | S_IWUSR);
+    check(fd != -1);
+    r = gta_write_header_to_fd(header, fd);
+    check(r == GTA_OK);
+    off_t data_offset = lseek(fd, 0, SEEK_CUR);
+
+    uintmax_t lc[] = { 0, 0 };
+    uintmax_t hc[] = { 1, 1 };
+    r = gta_read_block_components_from_fd(header, data_offset, lc, hc, 0, NULL, NULL, NULL, fd);
+    check(r == GTA_OK);
+    FILE *f = fdopen(dup(fd), "r");
+    check(f);
+    r = gta_read_block_components_from_stream(header, data_offset, lc, hc, 0, NULL, NULL, NULL, f);
+    check(r == GTA_OK);
+    fclose(f);
+
+    /* Writing works for both endiannesses; there is nothing to swap */
+    char *env_srcdir = getenv("srcdir");
+    check(env_srcdir);
+    const char *names[] = { "/little-endian.gta", "/big-endian.gta" };
+    char dummy = 0;
+    for (int i = 0; i < 2; i++)
+    {
+        char *filename = malloc(strlen(env_srcdir) + strlen(names[i]) + 1);
+        check(filename);
+        strcpy(filename, env_srcdir);
+        strcat(filename, names[i]);
+        gta_header_t *foreign_header;
+        r = gta_create_header(&foreign_header);
+        check(r == GTA_OK);
+        f = fopen(filename, "r");
+        check(f);
+        r = gta_read_header_from_stream(foreign_header, f);
+        check(r == GTA_OK);
+        fclose(f);
+        free(filename);
+        r = gta_set_components(foreign_header, 0, NULL, NULL);
+        check(r == GTA_OK);
+        r = gta_set_dimensions(foreign_header, 2, dims);
+        check(r == GTA_OK);
+        gta_set_compression(foreign_header, GTA_NONE);
+        r = gta_write_block_to_fd(foreign_header, data_offset, lc, hc, &dummy, fd);
+        check(r == GTA_OK);
+        f = fdopen(dup(fd), "r+");
+        check(f);
+        r = gta_write_block_to_stream(foreign_header, data_offset, lc, hc, &dummy, f);
+        check(r == GTA_OK);
+        fclose(f);
+        gta_destroy_header(foreign_header);
+    }
+
+    close(fd);
+    gta_destroy_header(header);
+    remove("test-blocks-empty.tmp");
+}
+
 int main(void)
 {
     gta_header_t *header;
@@ -153,5 +434,8 @@ int main(void)
     free(block);
     gta_destroy_header(header);
     remove("test-blocks.tmp");
+
+    test_runs();
+    test_no_components();
     return 0;
 }
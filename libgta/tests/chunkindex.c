@@ -0,0 +1,171 @@
+/*
+ * chunkindex.c
+ *
+ * This file is part of libgta, a library that implements the Generic Tagged
+ * Array (GTA) file format.
+ *
+ * Copyright (C) 2010, 2011
+ * Martin Lambers <marlam@marlam.de>
+ *
+ * Libgta is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 2.1 of the License, or (at your option)
+ * any later version.
+ *
+ * Libgta is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Libgta. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <gta/gta.h>
+
+#define check(condition) \
+    /* fprintf(stderr, "%s:%d: %s: Checking '%s'.\n", __FILE__, __LINE__, __PRETTY_FUNCTION__, #condition); */ \
+    if (!(condition)) \
+    { \
+        fprintf(stderr, "%s:%d: %s: Check '%s' failed.\n", \
+                __FILE__, __LINE__, __PRETTY_FUNCTION__, #condition); \
+        exit(1); \
+    }
+static void check_block(const gta_header_t *header, const uint32_t *data,
+        const uintmax_t *lc, const uintmax_t *hc, const uint32_t *block)
+{
+    uintmax_t index = 0;
+    for (uintmax_t z = lc[2]; z <= hc[2]; z++)
+    {
+        for (uintmax_t y = lc[1]; y <= hc[1]; y++)
+        {
+            for (uintmax_t x = lc[0]; x <= hc[0]; x++)
+            {
+                uintmax_t indices[3] = { x, y, z };
+                const uint32_t *element = gta_get_element_const(header, data, indices);
+                check(block[index] == *element);
+                index++;
+            }
+        }
+    }
+}
+
+int main(void)
+{
+    gta_header_t *header;
+    gta_chunk_index_t *index;
+    gta_result_t r;
+    FILE *f;
+
+    r = gta_create_header(&header);
+    check(r == GTA_OK);
+
+    /* Define an array that needs three chunks; the chunk boundaries are at z=64 and z=128 */
+    gta_type_t types[] = { GTA_UINT32 };
+    r = gta_set_components(header, 1, types, NULL);
+    check(r == GTA_OK);
+    uintmax_t dims[] = { 256, 256, 160 };
+    r = gta_set_dimensions(header, 3, dims);
+    check(r == GTA_OK);
+
+    /* Create the array data */
+    uint32_t *data = malloc(gta_get_data_size(header));
+    check(data);
+    uint32_t x = 1;
+    for (uintmax_t i = 0; i < gta_get_elements(header); i++)
+    {
+        x = x * 1664525 + 1013904223;
+        data[i] = (i % 7 == 0 ? x : i);
+    }
+
+    /* Write the array twice: uncompressed and compressed */
+    f = fopen("test-chunkindex.tmp", "w");
+    check(f);
+    r = gta_write_header_to_stream(header, f);
+    check(r == GTA_OK);
+    r = gta_write_data_to_stream(header, data, f);
+    check(r == GTA_OK);
+    gta_set_compression(header, GTA_ZLIB1);
+    r = gta_write_header_to_stream(header, f);
+    check(r == GTA_OK);
+    r = gta_write_data_to_stream(header, data, f);
+    check(r == GTA_OK);
+    fclose(f);
+
+    uintmax_t lc[][3] = { { 0, 0, 0 }, { 10, 20, 60 }, { 255, 255, 159 }, { 0, 100, 0 } };
+    uintmax_t hc[][3] = { { 3, 2, 1 }, { 99, 29, 70 }, { 255, 255, 159 }, { 255, 100, 159 } };
+    uint32_t *block = malloc(256 * 160 * sizeof(uint32_t));
+    check(block);
+
+    f = fopen("test-chunkindex.tmp", "r");
+    check(f);
+    int fd = fileno(f);
+
+    /* Uncompressed: the index is empty, and block reading works as usual */
+    r = gta_read_header_from_fd(header, fd);
+    check(r == GTA_OK);
+    off_t data_offset = lseek(fd, 0, SEEK_CUR);
+    r = gta_create_chunk_index_from_fd(header, &index, fd);
+    check(r == GTA_OK);
+    check(gta_get_chunk_index_chunks(index) == 0);
+    check(lseek(fd, 0, SEEK_CUR) == data_offset + (off_t)gta_get_data_size(header));
+    for (int i = 0; i < 4; i++)
+    {
+        r = gta_read_block_with_index_from_fd(header, index, data_offset, lc[i], hc[i], block, fd);
+        check(r == GTA_OK);
+        check_block(header, data, lc[i], hc[i], block);
+    }
+    gta_destroy_chunk_index(index);
+
+    /* Compressed */
+    check(lseek(fd, data_offset + gta_get_data_size(header), SEEK_SET) != -1);
+    r = gta_read_header_from_fd(header, fd);
+    check(r == GTA_OK);
+    check(gta_get_compression(header) == GTA_ZLIB1);
+    data_offset = lseek(fd, 0, SEEK_CUR);
+    r = gta_create_chunk_index_from_fd(header, &index, fd);
+    check(r == GTA_OK);
+    check(gta_get_chunk_index_chunks(index) == 3);
+    check(read(fd, block, 1) == 0);
+    r = gta_read_block_from_fd(header, data_offset, lc[0], hc[0], block, fd);
+    check(r == GTA_UNSUPPORTED_DATA);
+    for (int i = 0; i < 4; i++)
+    {
+        r = gta_read_block_with_index_from_fd(header, index, data_offset, lc[i], hc[i], block, fd);
+        check(r == GTA_OK);
+        check_block(header, data, lc[i], hc[i], block);
+    }
+    /* Invalid blocks are rejected before the chunks are accessed */
+    uintmax_t bad_lc[3] = { 0, 0, 10 };
+    uintmax_t bad_hc[3] = { 0, 0, 9 };
+    r = gta_read_block_with_index_from_fd(header, index, data_offset, bad_lc, bad_hc, block, fd);
+    check(r == GTA_INVALID_DATA);
+    bad_hc[2] = 160;
+    r = gta_read_block_with_index_from_fd(header, index, data_offset, lc[0], bad_hc, block, fd);
+    check(r == GTA_INVALID_DATA);
+    r = gta_read_block_with_index_from_fd(header, index, INTMAX_MAX, lc[0], hc[0], block, fd);
+    check(r == GTA_OVERFLOW);
+    fclose(f);
+
+    /* An index does not fit to a different array */
+    uintmax_t dims2[] = { 256, 256, 159 };
+    r = gta_set_dimensions(header, 3, dims2);
+    check(r == GTA_OK);
+    f = fopen("test-chunkindex.tmp", "r");
+    check(f);
+    r = gta_read_block_with_index_from_stream(header, index, data_offset, lc[0], hc[0], block, f);
+    check(r == GTA_INVALID_DATA);
+    fclose(f);
+    gta_destroy_chunk_index(index);
+
+    free(data);
+    free(block);
+    gta_destroy_header(header);
+    remove("test-chunkindex.tmp");
+    return 0;
+}
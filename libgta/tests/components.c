@@ -0,0 +1,353 @@
+/*
+ * components.c
+ *
+ * This file is part of libgta, a library that implements the Generic Tagged
+ * Array (GTA) file format.
+ *
+ * Copyright (C) 2010, 2011
+ * Martin Lambers <marlam@marlam.de>
+ *
+ * Libgta is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 2.1 of the License, or (at your option)
+ * any later version.
+ *
+ * Libgta is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Libgta. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <gta/gta.h>
+
+#define check(condition) \
+    /* fprintf(stderr, "%s:%d: %s: Checking '%s'.\n", __FILE__, __LINE__, __PRETTY_FUNCTION__, #condition); */ \
+    if (!(condition)) \
+    { \
+        fprintf(stderr, "%s:%d: %s: Check '%s' failed.\n", \
+                __FILE__, __LINE__, __PRETTY_FUNCTION__, #condition); \
+        exit(1); \
+    }
+
+/* Check planar component buffers against the complete elements */
+static void check_planar(const gta_header_t *header, const void *data, uintmax_t first, uintmax_t n,
+        size_t count, const uintmax_t *components, void *const *buffers)
+{
+    for (size_t k = 0; k < count; k++)
+    {
+        uintmax_t size = gta_get_component_size(header, components[k]);
+        for (uintmax_t i = 0; i < n; i++)
+        {
+            const void *element = gta_get_element_linear_const(header, data, first + i);
+            const void *component = gta_get_component_const(header, element, components[k]);
+            check(memcmp((const char *)buffers[k] + i * size, component, size) == 0);
+        }
+    }
+}
+
+/* Read the selected components of all elements in batches of varying size */
+static void read_planar(const gta_header_t *header, const void *data, FILE *f,
+        size_t count, const uintmax_t *components)
+{
+    const uintmax_t batches[] = { 1, 999, 4000, 17 };
+    gta_io_state_t *io_state;
+    void *buffers[8];
+    gta_result_t r;
+
+    for (size_t k = 0; k < count; k++)
+    {
+        buffers[k] = malloc(gta_get_elements(header) * gta_get_component_size(header, components[k]));
+        check(buffers[k]);
+    }
+    r = gta_create_io_state(&io_state);
+    check(r == GTA_OK);
+    uintmax_t first = 0;
+    for (size_t b = 0; first < gta_get_elements(header); b++)
+    {
+        uintmax_t n = batches[b % (sizeof(batches) / sizeof(batches[0]))];
+        if (n > gta_get_elements(header) - first)
+        {
+            n = gta_get_elements(header) - first;
+        }
+        if (b == 2)
+        {
+            // complete elements and selected components can be mixed
+            void *elements = malloc(n * gta_get_element_size(header));
+            check(elements);
+            r = gta_read_elements_from_stream(header, io_state, n, elements, f);
+            check(r == GTA_OK);
+            check(memcmp(elements, gta_get_element_linear_const(header, data, first),
+                        n * gta_get_element_size(header)) == 0);
+            free(elements);
+        }
+        else
+        {
+            r = gta_read_element_components_from_stream(header, io_state, n, count, components, buffers, NULL, f);
+            check(r == GTA_OK);
+            check_planar(header, data, first, n, count, components, buffers);
+        }
+        first += n;
+    }
+    gta_destroy_io_state(io_state);
+    for (size_t k = 0; k < count; k++)
+    {
+        free(buffers[k]);
+    }
+}
+
+/* Read the selected components of all elements into one interleaved buffer */
+static void read_interleaved(const gta_header_t *header, const void *data, FILE *f,
+        size_t count, const uintmax_t *components)
+{
+    gta_io_state_t *io_state;
+    void *buffers[8];
+    size_t strides[8];
+    size_t offsets[8];
+    size_t tuple_size = 0;
+    gta_result_t r;
+
+    for (size_t k = 0; k < count; k++)
+    {
+        offsets[k] = tuple_size;
+        tuple_size += gta_get_component_size(header, components[k]);
+    }
+    char *tuples = malloc(gta_get_elements(header) * tuple_size);
+    check(tuples);
+    for (size_t k = 0; k < count; k++)
+    {
+        buffers[k] = tuples + offsets[k];
+        strides[k] = tuple_size;
+    }
+    r = gta_create_io_state(&io_state);
+    check(r == GTA_OK);
+    r = gta_read_element_components_from_stream(header, io_state, gta_get_elements(header),
+            count, components, buffers, strides, f);
+    check(r == GTA_OK);
+    gta_destroy_io_state(io_state);
+    for (uintmax_t i = 0; i < gta_get_elements(header); i++)
+    {
+        const void *element = gta_get_element_linear_const(header, data, i);
+        for (size_t k = 0; k < count; k++)
+        {
+            check(memcmp(tuples + i * tuple_size + offsets[k], gta_get_component_const(header, element, components[k]),
+                        gta_get_component_size(header, components[k])) == 0);
+        }
+    }
+    free(tuples);
+}
+
+/* Read the selected components of a block, with both the stream and the file descriptor functions */
+static void read_block(const gta_header_t *header, const void *data, FILE *f, intmax_t data_offset,
+        const uintmax_t *lower, const uintmax_t *higher, size_t count, const uintmax_t *components)
+{
+    void *buffers[8];
+    gta_result_t r;
+
+    uintmax_t w = higher[0] - lower[0] + 1;
+    uintmax_t h = higher[1] - lower[1] + 1;
+    for (size_t k = 0; k < count; k++)
+    {
+        buffers[k] = malloc(w * h * gta_get_component_size(header, components[k]));
+        check(buffers[k]);
+    }
+    for (int variant = 0; variant < 2; variant++)
+    {
+        if (variant == 0)
+        {
+            r = gta_read_block_components_from_stream(header, data_offset, lower, higher,
+                    count, components, buffers, NULL, f);
+        }
+        else
+        {
+            check(fflush(f) == 0);
+            r = gta_read_block_components_from_fd(header, data_offset, lower, higher,
+                    count, components, buffers, NULL, fileno(f));
+        }
+        check(r == GTA_OK);
+        for (size_t k = 0; k < count; k++)
+        {
+            uintmax_t size = gta_get_component_size(header, components[k]);
+            for (uintmax_t y = 0; y < h; y++)
+            {
+                for (uintmax_t x = 0; x < w; x++)
+                {
+                    uintmax_t indices[] = { lower[0] + x, lower[1] + y };
+                    const void *element = gta_get_element_const(header, data, indices);
+                    check(memcmp((const char *)buffers[k] + (y * w + x) * size,
+                                gta_get_component_const(header, element, components[k]), size) == 0);
+                }
+            }
+        }
+    }
+    for (size_t k = 0; k < count; k++)
+    {
+        free(buffers[k]);
+    }
+}
+
+static void test_components(gta_compression_t compression)
+{
+    gta_header_t *header;
+    gta_header_t *header2;
+    gta_result_t r;
+
+    r = gta_create_header(&header);
+    check(r == GTA_OK);
+    gta_type_t types[] = { GTA_UINT8, GTA_INT16, GTA_BLOB, GTA_FLOAT64, GTA_CFLOAT32 };
+    uintmax_t blob_sizes[] = { 3 };
+    r = gta_set_components(header, 5, types, blob_sizes);
+    check(r == GTA_OK);
+    // more than 16 MiB of data, so that elements are split across chunks
+    uintmax_t dims[] = { 1000, 800 };
+    r = gta_set_dimensions(header, 2, dims);
+    check(r == GTA_OK);
+    gta_set_compression(header, compression);
+
+    char *data = malloc(gta_get_data_size(header));
+    check(data);
+    for (uintmax_t i = 0; i < gta_get_data_size(header); i++)
+    {
+        data[i] = (char)(i * 7 + i / 13);
+    }
+
+    FILE *f = tmpfile();
+    check(f);
+    r = gta_write_header_to_stream(header, f);
+    check(r == GTA_OK);
+    intmax_t data_offset = ftello(f);
+    r = gta_write_data_to_stream(header, data, f);
+    check(r == GTA_OK);
+
+    const uintmax_t planar[] = { 3, 0, 1 };
+    const uintmax_t interleaved[] = { 4, 2, 4 };
+    r = gta_create_header(&header2);
+    check(r == GTA_OK);
+    for (int variant = 0; variant < 3; variant++)
+    {
+        rewind(f);
+        r = gta_read_header_from_stream(header2, f);
+        check(r == GTA_OK);
+        if (variant == 0)
+        {
+            read_planar(header2, data, f, 3, planar);
+        }
+        else if (variant == 1)
+        {
+            read_interleaved(header2, data, f, 3, interleaved);
+        }
+        else
+        {
+            // without selected components, the elements are skipped
+            gta_io_state_t *io_state;
+            r = gta_create_io_state(&io_state);
+            check(r == GTA_OK);
+            r = gta_read_element_components_from_stream(header2, io_state, gta_get_elements(header2) - 1,
+                    0, NULL, NULL, NULL, f);
+            check(r == GTA_OK);
+            void *element = malloc(gta_get_element_size(header2));
+            check(element);
+            r = gta_read_elements_from_stream(header2, io_state, 1, element, f);
+            check(r == GTA_OK);
+            check(memcmp(element, gta_get_element_linear_const(header2, data, gta_get_elements(header2) - 1),
+                        gta_get_element_size(header2)) == 0);
+            free(element);
+            gta_destroy_io_state(io_state);
+        }
+    }
+
+    /* Invalid component indices are rejected */
+    gta_io_state_t *io_state;
+    r = gta_create_io_state(&io_state);
+    check(r == GTA_OK);
+    const uintmax_t invalid[] = { 5 };
+    void *buffers[] = { data };
+    r = gta_read_element_components_from_stream(header2, io_state, 1, 1, invalid, buffers, NULL, f);
+    check(r == GTA_INVALID_DATA);
+    gta_destroy_io_state(io_state);
+
+    /* Blocks */
+    const uintmax_t lower[] = { 10, 3 };
+    const uintmax_t higher[] = { 510, 20 };
+    if (compression == GTA_NONE)
+    {
+        read_block(header2, data, f, data_offset, lower, higher, 3, planar);
+    }
+    else
+    {
+        r = gta_read_block_components_from_stream(header2, data_offset, lower, higher,
+                3, planar, buffers, NULL, f);
+        check(r == GTA_UNSUPPORTED_DATA);
+    }
+
+    check(fclose(f) == 0);
+    free(data);
+    gta_destroy_header(header2);
+    gta_destroy_header(header);
+}
+
+/* Compare selected components from a file with possibly foreign endianness to its complete elements */
+static void test_endianness(const char *filename)
+{
+    gta_header_t *header;
+    gta_result_t r;
+
+    FILE *f = fopen(filename, "r");
+    check(f);
+    r = gta_create_header(&header);
+    check(r == GTA_OK);
+    r = gta_read_header_from_stream(header, f);
+    check(r == GTA_OK);
+    intmax_t data_offset = ftello(f);
+    void *data = malloc(gta_get_data_size(header));
+    check(data);
+    r = gta_read_data_from_stream(header, data, f);
+    check(r == GTA_OK);
+
+    uintmax_t components[32];
+    size_t count = gta_get_components(header);
+    check(count <= 32);
+    for (size_t k = 0; k < count; k++)
+    {
+        components[k] = count - 1 - k;
+    }
+    for (size_t k = 0; k < count; k += 8)
+    {
+        size_t c = (count - k < 8 ? count - k : 8);
+        check(fseeko(f, data_offset, SEEK_SET) == 0);
+        read_planar(header, data, f, c, components + k);
+        check(fseeko(f, data_offset, SEEK_SET) == 0);
+        read_interleaved(header, data, f, c, components + k);
+    }
+
+    check(fclose(f) == 0);
+    free(data);
+    gta_destroy_header(header);
+}
+
+int main(void)
+{
+    test_components(GTA_NONE);
+    test_components(GTA_ZLIB);
+
+    char *env_srcdir = getenv("srcdir");
+    check(env_srcdir);
+    const char *names[] = { "/little-endian.gta", "/big-endian.gta" };
+    for (int i = 0; i < 2; i++)
+    {
+        char *filename = malloc(strlen(env_srcdir) + strlen(names[i]) + 1);
+        check(filename);
+        strcpy(filename, env_srcdir);
+        strcat(filename, names[i]);
+        test_endianness(filename);
+        free(filename);
+    }
+
+    return 0;
+}
@@ -36,6 +36,163 @@
         exit(1); \
     }
 
+/* Write an array with the given compression and filter, read it back with the given
+ * number of elements per read (0 for gta_read_data), and return the file size */
+static long filter_roundtrip(gta_header_t *header, const void *data,
+        gta_compression_t compression, gta_filter_t filter, uintmax_t batch)
+{
+    gta_io_state_t *io_state;
+    gta_result_t r;
+    FILE *f;
+    long size;
+
+    gta_set_compression(header, compression);
+    gta_set_filter(header, filter);
+    uintmax_t data_size = gta_get_data_size(header);
+    uintmax_t element_size = gta_get_element_size(header);
+    uintmax_t elements = gta_get_elements(header);
+    uint8_t *data2 = malloc(data_size);
+    check(data2);
+
+    f = fopen("test-compression-filter.tmp", "w");
+    check(f);
+    r = gta_write_header_to_stream(header, f);
+    check(r == GTA_OK);
+    if (batch == 0)
+    {
+        r = gta_write_data_to_stream(header, data, f);
+        check(r == GTA_OK);
+    }
+    else
+    {
+        r = gta_create_io_state(&io_state);
+        check(r == GTA_OK);
+        for (uintmax_t done = 0; done < elements; done += batch)
+        {
+            uintmax_t n = (batch < elements - done ? batch : elements - done);
+            r = gta_write_elements_to_stream(header, io_state, n,
+                    (const uint8_t *)data + done * element_size, f);
+            check(r == GTA_OK);
+        }
+        gta_destroy_io_state(io_state);
+    }
+    size = ftell(f);
+    check(fclose(f) == 0);
+
+    f = fopen("test-compression-filter.tmp", "r");
+    check(f);
+    r = gta_read_header_from_stream(header, f);
+    check(r == GTA_OK);
+    check(gta_get_compression(header) == compression);
+    check(gta_get_filter(header) == (compression == GTA_NONE ? GTA_FILTER_NONE : filter));
+    memset(data2, 0, data_size);
+    if (batch == 0)
+    {
+        r = gta_read_data_from_stream(header, data2, f);
+        check(r == GTA_OK);
+    }
+    else
+    {
+        r = gta_create_io_state(&io_state);
+        check(r == GTA_OK);
+        for (uintmax_t done = 0; done < elements; done += batch)
+        {
+            uintmax_t n = (batch < elements - done ? batch : elements - done);
+            r = gta_read_elements_from_stream(header, io_state, n, data2 + done * element_size, f);
+            check(r == GTA_OK);
+        }
+        gta_destroy_io_state(io_state);
+    }
+    check(fgetc(f) == EOF);
+    check(fclose(f) == 0);
+    check(memcmp(data, data2, data_size) == 0);
+    free(data2);
+    remove("test-compression-filter.tmp");
+    return size;
+}
+
+/* Check that all pre-filters restore the data exactly, for element sizes with and
+ * without vectorized kernels, and for chunks that do not end on element boundaries */
+static void test_filters(void)
+{
+    const gta_filter_t filters[] = { GTA_FILTER_SHUFFLE, GTA_FILTER_BITSHUFFLE, GTA_FILTER_DELTA };
+    const gta_type_t types[][3] = {
+        { GTA_UINT8 }, { GTA_INT16 }, { GTA_FLOAT32 }, { GTA_FLOAT64 },
+        { GTA_FLOAT32, GTA_FLOAT32, GTA_FLOAT32 }, { GTA_INT16, GTA_UINT8 }
+    };
+    const uintmax_t components[] = { 1, 1, 1, 1, 3, 2 };
+    gta_header_t *header;
+    gta_result_t r;
+
+    r = gta_create_header(&header);
+    check(r == GTA_OK);
+    for (size_t t = 0; t < sizeof(components) / sizeof(components[0]); t++)
+    {
+        // An odd number of elements, so that the kernels leave remainders
+        uintmax_t dims[] = { 1001, 37 };
+        r = gta_set_components(header, components[t], types[t], NULL);
+        check(r == GTA_OK);
+        r = gta_set_dimensions(header, 2, dims);
+        check(r == GTA_OK);
+        uintmax_t data_size = gta_get_data_size(header);
+        uint8_t *data = malloc(data_size);
+        check(data);
+        for (uintmax_t i = 0; i < data_size; i++)
+        {
+            data[i] = (i % 7 == 0 ? (uint8_t)(i * 2654435761u >> 24) : (uint8_t)(i / 13));
+        }
+        for (size_t i = 0; i < sizeof(filters) / sizeof(filters[0]); i++)
+        {
+            filter_roundtrip(header, data, GTA_ZLIB1, filters[i], 0);
+            filter_roundtrip(header, data, GTA_ZLIB1, filters[i], 999);
+        }
+        filter_roundtrip(header, data, GTA_NONE, GTA_FILTER_SHUFFLE, 0);
+        free(data);
+    }
+
+    /* Smooth float data compresses better when the bytes are shuffled */
+    gta_type_t float_type[] = { GTA_FLOAT32 };
+    uintmax_t float_dims[] = { 100000 };
+    r = gta_set_components(header, 1, float_type, NULL);
+    check(r == GTA_OK);
+    r = gta_set_dimensions(header, 1, float_dims);
+    check(r == GTA_OK);
+    float *float_data = malloc(gta_get_data_size(header));
+    check(float_data);
+    for (uintmax_t i = 0; i < float_dims[0]; i++)
+    {
+        float_data[i] = 1000.0f + (float)i * 0.01f;
+    }
+    long unfiltered_size = filter_roundtrip(header, float_data, GTA_ZLIB, GTA_FILTER_NONE, 0);
+    long shuffled_size = filter_roundtrip(header, float_data, GTA_ZLIB, GTA_FILTER_SHUFFLE, 0);
+    check(shuffled_size < unfiltered_size);
+    free(float_data);
+
+    /* Several chunks whose boundaries split elements, with parallel compression */
+    gta_type_t multi_types[] = { GTA_FLOAT32, GTA_FLOAT32, GTA_FLOAT32 };
+    uintmax_t multi_dims[] = { 1500000 };
+    r = gta_set_components(header, 3, multi_types, NULL);
+    check(r == GTA_OK);
+    r = gta_set_dimensions(header, 1, multi_dims);
+    check(r == GTA_OK);
+    gta_set_compression_threads(header, 2);
+    gta_set_decompression_threads(header, 2);
+    uint8_t *multi_data = malloc(gta_get_data_size(header));
+    check(multi_data);
+    for (uintmax_t i = 0; i < gta_get_data_size(header); i++)
+    {
+        multi_data[i] = i / 100;
+    }
+    for (size_t i = 0; i < sizeof(filters) / sizeof(filters[0]); i++)
+    {
+        filter_roundtrip(header, multi_data, GTA_ZLIB1, filters[i], 0);
+    }
+    filter_roundtrip(header, multi_data, GTA_ZLIB1, GTA_FILTER_DELTA, 1000003);
+    free(multi_data);
+
+    gta_destroy_header(header);
+}
+
 int main(void)
 {
     gta_header_t *header;
@@ -329,10 +486,147 @@ int main(void)
 
     fclose(f);
     remove("test-compression.tmp");
+
+    /* Copy compressed data. With unchanged compression, the chunks are passed
+     * through, so the copy must be identical to the original. */
+    gta_set_compression(header, GTA_XZ);
+    f = fopen("test-compression.tmp", "w");
+    check(f);
+    r = gta_write_header_to_stream(header, f);
+    check(r == GTA_OK);
+    r = gta_write_data_to_stream(header, data, f);
+    check(r == GTA_OK);
+    fclose(f);
+    f = fopen("test-compression.tmp", "r");
+    check(f);
+    FILE *f2 = fopen("test-compression-copy.tmp", "w");
+    check(f2);
+    r = gta_read_header_from_stream(header, f);
+    check(r == GTA_OK);
+    r = gta_write_header_to_stream(header, f2);
+    check(r == GTA_OK);
+    r = gta_copy_data_stream(header, f, header, f2);
+    check(r == GTA_OK);
+    long copy_size = ftell(f2);
+    check(copy_size == ftell(f));
+    fclose(f2);
+    uint8_t *orig_bytes = malloc(copy_size);
+    uint8_t *copy_bytes = malloc(copy_size);
+    check(orig_bytes && copy_bytes);
+    rewind(f);
+    check(fread(orig_bytes, 1, copy_size, f) == (size_t)copy_size);
+    fclose(f);
+    f = fopen("test-compression-copy.tmp", "r");
+    check(f);
+    check(fread(copy_bytes, 1, copy_size, f) == (size_t)copy_size);
+    check(fgetc(f) == EOF);
+    fclose(f);
+    check(memcmp(orig_bytes, copy_bytes, copy_size) == 0);
+    free(orig_bytes);
+    free(copy_bytes);
+    // Changed compression
+    f = fopen("test-compression-copy.tmp", "r");
+    check(f);
+    f2 = fopen("test-compression.tmp", "w");
+    check(f2);
+    r = gta_read_header_from_stream(header, f);
+    check(r == GTA_OK);
+    gta_header_t *header2;
+    r = gta_create_header(&header2);
+    check(r == GTA_OK);
+    r = gta_clone_header(header2, header);
+    check(r == GTA_OK);
+    gta_set_compression(header2, GTA_BZIP2);
+    r = gta_write_header_to_stream(header2, f2);
+    check(r == GTA_OK);
+    r = gta_copy_data_stream(header, f, header2, f2);
+    check(r == GTA_OK);
+    fclose(f);
+    fclose(f2);
+    f = fopen("test-compression.tmp", "r");
+    check(f);
+    r = gta_read_header_from_stream(header, f);
+    check(r == GTA_OK);
+    check(gta_get_compression(header) == GTA_BZIP2);
+    memset(data2, 0, data_size);
+    r = gta_read_data_from_stream(header, data2, f);
+    check(r == GTA_OK);
+    check(memcmp(data, data2, data_size) == 0);
+    fclose(f);
+    gta_destroy_header(header2);
+    remove("test-compression.tmp");
+    remove("test-compression-copy.tmp");
+
+    /* Optional compression methods: they either work, or fail cleanly if
+     * libgta was built without them */
+    const gta_compression_t optional_methods[] = { GTA_ZSTD, GTA_ZSTD1, GTA_ZSTD19, GTA_LZ4 };
+    for (size_t i = 0; i < sizeof(optional_methods) / sizeof(optional_methods[0]); i++)
+    {
+        gta_set_compression(header, optional_methods[i]);
+        f = fopen("test-compression.tmp", "w");
+        check(f);
+        r = gta_write_header_to_stream(header, f);
+        fclose(f);
+        if (r == GTA_UNSUPPORTED_DATA)
+        {
+            continue;
+        }
+        check(r == GTA_OK);
+        f = fopen("test-compression.tmp", "w");
+        check(f);
+        r = gta_write_header_to_stream(header, f);
+        check(r == GTA_OK);
+        r = gta_write_data_to_stream(header, data, f);
+        check(r == GTA_OK);
+        fclose(f);
+        f = fopen("test-compression.tmp", "r");
+        check(f);
+        r = gta_read_header_from_stream(header, f);
+        check(r == GTA_OK);
+        check(gta_get_compression(header) == optional_methods[i]);
+        memset(data2, 0, data_size);
+        r = gta_read_data_from_stream(header, data2, f);
+        check(r == GTA_OK);
+        check(memcmp(data, data2, data_size) == 0);
+        check(fgetc(f) == EOF);
+        fclose(f);
+    }
+    remove("test-compression.tmp");
+
+    /* An unknown compression method is reported as unsupported */
+    gta_set_compression(header, GTA_ZLIB);
+    f = fopen("test-compression.tmp", "w+");
+    check(f);
+    r = gta_write_header_to_stream(header, f);
+    check(r == GTA_OK);
+    check(fseek(f, 5, SEEK_SET) == 0);
+    check(fputc(60, f) == 60);
+    rewind(f);
+    r = gta_read_header_from_stream(header, f);
+    check(r == GTA_UNSUPPORTED_DATA);
+    fclose(f);
+    remove("test-compression.tmp");
+
+    /* Uncompressed data is never filtered */
+    gta_set_compression(header, GTA_NONE);
+    f = fopen("test-compression.tmp", "w+");
+    check(f);
+    r = gta_write_header_to_stream(header, f);
+    check(r == GTA_OK);
+    check(fseek(f, 5, SEEK_SET) == 0);
+    check(fputc(GTA_NONE | (GTA_FILTER_SHUFFLE << 6), f) == (GTA_NONE | (GTA_FILTER_SHUFFLE << 6)));
+    rewind(f);
+    r = gta_read_header_from_stream(header, f);
+    check(r == GTA_INVALID_DATA);
+    fclose(f);
+    remove("test-compression.tmp");
+
     free(data);
     free(data2);
 
     gta_destroy_header(header);
 
+    test_filters();
+
     return 0;
 }
@@ -36,6 +36,119 @@
         exit(1); \
     }
 
+static void *read_file(const char *filename, size_t *size)
+{
+    FILE *f = fopen(filename, "r");
+    check(f);
+    check(fseek(f, 0, SEEK_END) == 0);
+    long s = ftell(f);
+    check(s > 0);
+    check(fseek(f, 0, SEEK_SET) == 0);
+    void *buf = malloc(s);
+    check(buf);
+    check(fread(buf, 1, s, f) == (size_t)s);
+    check(fclose(f) == 0);
+    *size = s;
+    return buf;
+}
+
+/* Write and read elements in batches that cover whole chunks, partial chunks, and both */
+static void test_batches(gta_compression_t compression, unsigned int threads)
+{
+    const uintmax_t chunk_elements = 4 * 1024 * 1024;   // 16 MiB of uint32 values
+    const uintmax_t batches[] = { 1, chunk_elements - 1, chunk_elements, 2 * chunk_elements + 5, 3 };
+    gta_header_t *header;
+    gta_io_state_t *io_state;
+    gta_result_t r;
+    FILE *f;
+
+    r = gta_create_header(&header);
+    check(r == GTA_OK);
+    gta_type_t types[] = { GTA_UINT32 };
+    r = gta_set_components(header, 1, types, NULL);
+    check(r == GTA_OK);
+    uintmax_t dims[] = { 5 * chunk_elements + 777 };
+    r = gta_set_dimensions(header, 1, dims);
+    check(r == GTA_OK);
+    gta_set_compression(header, compression);
+    uintmax_t elements = gta_get_elements(header);
+    uint32_t *data = malloc(gta_get_data_size(header));
+    check(data);
+    for (uintmax_t i = 0; i < elements; i++)
+    {
+        data[i] = i / 5;
+    }
+
+    f = fopen("test-elements-reference.tmp", "w");
+    check(f);
+    r = gta_write_header_to_stream(header, f);
+    check(r == GTA_OK);
+    r = gta_write_data_to_stream(header, data, f);
+    check(r == GTA_OK);
+    check(fclose(f) == 0);
+
+    r = gta_create_io_state(&io_state);
+    check(r == GTA_OK);
+    gta_set_io_state_compression_threads(io_state, threads);
+    f = fopen("test-elements-batches.tmp", "w");
+    check(f);
+    r = gta_write_header_to_stream(header, f);
+    check(r == GTA_OK);
+    uintmax_t done = 0;
+    for (size_t b = 0; done < elements; b++)
+    {
+        uintmax_t n = batches[b % (sizeof(batches) / sizeof(batches[0]))];
+        if (n > elements - done)
+        {
+            n = elements - done;
+        }
+        r = gta_write_elements_to_stream(header, io_state, n, data + done, f);
+        check(r == GTA_OK);
+        done += n;
+    }
+    check(fclose(f) == 0);
+    gta_destroy_io_state(io_state);
+
+    size_t reference_size, batches_size;
+    void *reference = read_file("test-elements-reference.tmp", &reference_size);
+    void *batches_file = read_file("test-elements-batches.tmp", &batches_size);
+    check(batches_size == reference_size);
+    check(memcmp(batches_file, reference, reference_size) == 0);
+    free(reference);
+    free(batches_file);
+
+    uint32_t *read_data = malloc(gta_get_data_size(header));
+    check(read_data);
+    r = gta_create_io_state(&io_state);
+    check(r == GTA_OK);
+    f = fopen("test-elements-batches.tmp", "r");
+    check(f);
+    r = gta_read_header_from_stream(header, f);
+    check(r == GTA_OK);
+    done = 0;
+    for (size_t b = 1; done < elements; b++)
+    {
+        uintmax_t n = batches[b % (sizeof(batches) / sizeof(batches[0]))];
+        if (n > elements - done)
+        {
+            n = elements - done;
+        }
+        r = gta_read_elements_from_stream(header, io_state, n, read_data + done, f);
+        check(r == GTA_OK);
+        done += n;
+    }
+    check(fgetc(f) == EOF);
+    check(fclose(f) == 0);
+    gta_destroy_io_state(io_state);
+    check(memcmp(read_data, data, gta_get_data_size(header)) == 0);
+
+    free(read_data);
+    free(data);
+    gta_destroy_header(header);
+    remove("test-elements-reference.tmp");
+    remove("test-elements-batches.tmp");
+}
+
 int main(void)
 {
     FILE *fu, *fc;
@@ -150,5 +263,10 @@ int main(void)
     gta_destroy_header(hc);
     remove("test-elements-uncompressed.tmp");
     remove("test-elements-compressed.tmp");
+
+    test_batches(GTA_NONE, 0);
+    test_batches(GTA_ZLIB1, 0);
+    test_batches(GTA_ZLIB1, 2);
+    test_batches(GTA_ZLIB, 3);
     return 0;
 }
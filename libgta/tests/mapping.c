@@ -0,0 +1,121 @@
+/*
+ * mapping.c
+ *
+ * This file is part of libgta, a library that implements the Generic Tagged
+ * Array (GTA) file format.
+ *
+ * Copyright (C) 2010, 2011
+ * Martin Lambers <marlam@marlam.de>
+ *
+ * Libgta is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 2.1 of the License, or (at your option)
+ * any later version.
+ *
+ * Libgta is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Libgta. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <gta/gta.h>
+
+#define check(condition) \
+    /* fprintf(stderr, "%s:%d: %s: Checking '%s'.\n", __FILE__, __LINE__, __PRETTY_FUNCTION__, #condition); */ \
+    if (!(condition)) \
+    { \
+        fprintf(stderr, "%s:%d: %s: Check '%s' failed.\n", \
+                __FILE__, __LINE__, __PRETTY_FUNCTION__, #condition); \
+        exit(1); \
+    }
+
+int main(void)
+{
+    gta_header_t *header;
+    gta_mapping_t *mapping;
+    gta_result_t r;
+
+    r = gta_create_header(&header);
+    check(r == GTA_OK);
+
+    /* Define an array */
+    gta_type_t types[] = { GTA_UINT16, GTA_FLOAT64 };
+    r = gta_set_components(header, 2, types, NULL);
+    check(r == GTA_OK);
+    uintmax_t dims[] = { 123, 45 };
+    r = gta_set_dimensions(header, 2, dims);
+    check(r == GTA_OK);
+    gta_set_compression(header, GTA_NONE);
+
+    /* Create the array data */
+    void *data = malloc(gta_get_data_size(header));
+    check(data);
+    for (uintmax_t i = 0; i < gta_get_elements(header); i++)
+    {
+        void *element = gta_get_element_linear(header, data, i);
+        uint16_t c0 = i;
+        double c1 = i / 2.0;
+        memcpy(gta_get_component(header, element, 0), &c0, sizeof(c0));
+        memcpy(gta_get_component(header, element, 1), &c1, sizeof(c1));
+    }
+
+    /* Write the array after some junk, so that the data is not page-aligned */
+    int fd = open("test-mapping.tmp", O_CREAT | O_TRUNC | O_RDWR, S_IRUSR | S_IWUSR);
+    check(fd != -1);
+    check(write(fd, "junk", 4) == 4);
+    r = gta_write_header_to_fd(header, fd);
+    check(r == GTA_OK);
+    off_t data_offset = lseek(fd, 0, SEEK_CUR);
+    r = gta_write_data_to_fd(header, data, fd);
+    check(r == GTA_OK);
+
+    /* Map the data and close the file */
+    r = gta_map_data_from_fd(header, data_offset, &mapping, fd);
+    check(r == GTA_OK);
+    close(fd);
+    const void *mapped_data = gta_get_mapped_data(mapping);
+    check(mapped_data);
+    check(memcmp(mapped_data, data, gta_get_data_size(header)) == 0);
+    uintmax_t indices[] = { 100, 44 };
+    check(memcmp(gta_get_element_const(header, mapped_data, indices),
+                gta_get_element(header, data, indices), gta_get_element_size(header)) == 0);
+    gta_unmap_data(mapping);
+
+    /* Map through a stream */
+    FILE *f = fopen("test-mapping.tmp", "r");
+    check(f);
+    r = gta_map_data_from_stream(header, data_offset, &mapping, f);
+    check(r == GTA_OK);
+    fclose(f);
+    check(memcmp(gta_get_mapped_data(mapping), data, gta_get_data_size(header)) == 0);
+    gta_unmap_data(mapping);
+
+    /* Truncated data cannot be mapped */
+    fd = open("test-mapping.tmp", O_RDWR);
+    check(fd != -1);
+    check(ftruncate(fd, data_offset + gta_get_data_size(header) - 1) == 0);
+    r = gta_map_data_from_fd(header, data_offset, &mapping, fd);
+    check(r == GTA_UNEXPECTED_EOF);
+
+    /* Compressed data cannot be mapped */
+    gta_set_compression(header, GTA_ZLIB);
+    r = gta_map_data_from_fd(header, data_offset, &mapping, fd);
+    check(r == GTA_UNSUPPORTED_DATA);
+    close(fd);
+
+    free(data);
+    gta_destroy_header(header);
+    remove("test-mapping.tmp");
+    return 0;
+}
@@ -0,0 +1,348 @@
+/*
+ * memory.c
+ *
+ * This file is part of libgta, a library that implements the Generic Tagged
+ * Array (GTA) file format.
+ *
+ * Copyright (C) 2010, 2011
+ * Martin Lambers <marlam@marlam.de>
+ *
+ * Libgta is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 2.1 of the License, or (at your option)
+ * any later version.
+ *
+ * Libgta is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Libgta. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <gta/gta.h>
+
+#define check(condition) \
+    /* fprintf(stderr, "%s:%d: %s: Checking '%s'.\n", __FILE__, __LINE__, __PRETTY_FUNCTION__, #condition); */ \
+    if (!(condition)) \
+    { \
+        fprintf(stderr, "%s:%d: %s: Check '%s' failed.\n", \
+                __FILE__, __LINE__, __PRETTY_FUNCTION__, #condition); \
+        exit(1); \
+    }
+
+static void create_array(gta_header_t **header, void **data, gta_compression_t compression)
+{
+    gta_result_t r;
+
+    r = gta_create_header(header);
+    check(r == GTA_OK);
+    gta_type_t types[] = { GTA_UINT16, GTA_FLOAT64 };
+    r = gta_set_components(*header, 2, types, NULL);
+    check(r == GTA_OK);
+    uintmax_t dims[] = { 300, 200 };
+    r = gta_set_dimensions(*header, 2, dims);
+    check(r == GTA_OK);
+    gta_set_compression(*header, compression);
+    if (compression != GTA_NONE)
+    {
+        gta_set_filter(*header, GTA_FILTER_SHUFFLE);
+    }
+    r = gta_set_tag(gta_get_global_taglist(*header), "DESCRIPTION", "memory test");
+    check(r == GTA_OK);
+    r = gta_set_tag(gta_get_dimension_taglist(*header, 1), "INTERPRETATION", "Y");
+    check(r == GTA_OK);
+
+    *data = malloc(gta_get_data_size(*header));
+    check(*data);
+    for (uintmax_t i = 0; i < gta_get_elements(*header); i++)
+    {
+        void *element = gta_get_element_linear(*header, *data, i);
+        uint16_t c0 = i % 1000;
+        double c1 = i / 4.0;
+        memcpy(gta_get_component(*header, element, 0), &c0, sizeof(c0));
+        memcpy(gta_get_component(*header, element, 1), &c1, sizeof(c1));
+    }
+}
+
+static void test_memory(gta_compression_t compression)
+{
+    gta_header_t *header;
+    gta_header_t *header2;
+    gta_io_state_t *io_state;
+    void *data;
+    void *data2;
+    gta_result_t r;
+
+    create_array(&header, &data, compression);
+    size_t data_size = gta_get_data_size(header);
+    data2 = malloc(data_size);
+    check(data2);
+
+    /* Write two arrays to memory, starting with an empty buffer */
+    void *buffer = NULL;
+    size_t size = 0;
+    size_t capacity = 0;
+    for (int i = 0; i < 2; i++)
+    {
+        r = gta_write_header_to_memory(header, &buffer, &size, &capacity);
+        check(r == GTA_OK);
+        r = gta_write_data_to_memory(header, data, &buffer, &size, &capacity);
+        check(r == GTA_OK);
+        check(size <= capacity);
+    }
+
+    /* The buffer holds exactly what would be written to a file */
+    FILE *f = fopen("test-memory.tmp", "w+");
+    check(f);
+    for (int i = 0; i < 2; i++)
+    {
+        r = gta_write_header_to_stream(header, f);
+        check(r == GTA_OK);
+        r = gta_write_data_to_stream(header, data, f);
+        check(r == GTA_OK);
+    }
+    check(ftell(f) == (long)size);
+    rewind(f);
+    void *file_buffer = malloc(size);
+    check(file_buffer);
+    check(fread(file_buffer, 1, size, f) == size);
+    check(memcmp(file_buffer, buffer, size) == 0);
+    free(file_buffer);
+    check(fclose(f) == 0);
+    check(remove("test-memory.tmp") == 0);
+
+    /* Writing elements in batches gives the same result */
+    void *elements_buffer = NULL;
+    size_t elements_size = 0;
+    size_t elements_capacity = 0;
+    r = gta_create_io_state(&io_state);
+    check(r == GTA_OK);
+    r = gta_write_header_to_memory(header, &elements_buffer, &elements_size, &elements_capacity);
+    check(r == GTA_OK);
+    for (uintmax_t i = 0; i < gta_get_elements(header); i += 999)
+    {
+        uintmax_t n = gta_get_elements(header) - i;
+        n = (n > 999 ? 999 : n);
+        r = gta_write_elements_to_memory(header, io_state, n, gta_get_element_linear(header, data, i),
+                &elements_buffer, &elements_size, &elements_capacity);
+        check(r == GTA_OK);
+    }
+    gta_destroy_io_state(io_state);
+    check(elements_size == size / 2);
+    check(memcmp(elements_buffer, buffer, elements_size) == 0);
+    free(elements_buffer);
+
+    /* Read the first array completely, and skip the second */
+    size_t offset = 0;
+    r = gta_create_header(&header2);
+    check(r == GTA_OK);
+    r = gta_read_header_from_memory(header2, buffer, size, &offset);
+    check(r == GTA_OK);
+    check(gta_get_compression(header2) == compression);
+    check(gta_get_data_size(header2) == data_size);
+    check(strcmp(gta_get_tag(gta_get_global_taglist_const(header2), "DESCRIPTION"), "memory test") == 0);
+    check(strcmp(gta_get_tag(gta_get_dimension_taglist_const(header2, 1), "INTERPRETATION"), "Y") == 0);
+    size_t data_offset = offset;
+    const void *mapped_data;
+    r = gta_get_data_from_memory(header2, &mapped_data, buffer, size, &offset);
+    if (compression == GTA_NONE)
+    {
+        check(r == GTA_OK);
+        check(mapped_data == (const char *)buffer + data_offset);
+        check(offset == data_offset + data_size);
+        check(memcmp(mapped_data, data, data_size) == 0);
+        offset = data_offset;
+    }
+    else
+    {
+        check(r == GTA_UNSUPPORTED_DATA);
+        check(offset == data_offset);
+    }
+    memset(data2, 0, data_size);
+    r = gta_read_data_from_memory(header2, data2, buffer, size, &offset);
+    check(r == GTA_OK);
+    check(offset == size / 2);
+    check(memcmp(data, data2, data_size) == 0);
+    r = gta_read_header_from_memory(header2, buffer, size, &offset);
+    check(r == GTA_OK);
+    r = gta_skip_data_from_memory(header2, buffer, size, &offset);
+    check(r == GTA_OK);
+    check(offset == size);
+
+    /* Read the second array element-wise */
+    offset = size / 2;
+    r = gta_read_header_from_memory(header2, buffer, size, &offset);
+    check(r == GTA_OK);
+    r = gta_create_io_state(&io_state);
+    check(r == GTA_OK);
+    memset(data2, 0, data_size);
+    for (uintmax_t i = 0; i < gta_get_elements(header2); i += 777)
+    {
+        uintmax_t n = gta_get_elements(header2) - i;
+        n = (n > 777 ? 777 : n);
+        r = gta_read_elements_from_memory(header2, io_state, n, gta_get_element_linear(header2, data2, i),
+                buffer, size, &offset);
+        check(r == GTA_OK);
+    }
+    gta_destroy_io_state(io_state);
+    check(offset == size);
+    check(memcmp(data, data2, data_size) == 0);
+
+    /* Truncated input is detected, and leaves the offset unchanged */
+    size_t truncated_size = size / 2 - 1;
+    offset = 0;
+    r = gta_read_header_from_memory(header2, buffer, truncated_size, &offset);
+    check(r == GTA_OK);
+    data_offset = offset;
+    r = gta_read_data_from_memory(header2, data2, buffer, truncated_size, &offset);
+    check(r == GTA_UNEXPECTED_EOF);
+    check(offset == data_offset);
+    r = gta_skip_data_from_memory(header2, buffer, truncated_size, &offset);
+    check(r == GTA_UNEXPECTED_EOF);
+    check(offset == data_offset);
+    r = gta_get_data_from_memory(header2, &mapped_data, buffer, truncated_size, &offset);
+    check(r == (compression == GTA_NONE ? GTA_UNEXPECTED_EOF : GTA_UNSUPPORTED_DATA));
+    check(offset == data_offset);
+    offset = 0;
+    r = gta_read_header_from_memory(header2, buffer, 10, &offset);
+    check(r == GTA_UNEXPECTED_EOF);
+    check(offset == 0);
+
+    gta_destroy_header(header2);
+    gta_destroy_header(header);
+    free(buffer);
+    free(data2);
+    free(data);
+}
+
+/* Write a header to a fresh buffer */
+static void *encode_header(const gta_header_t *header, size_t *size)
+{
+    void *buffer = NULL;
+    size_t capacity = 0;
+    *size = 0;
+    gta_result_t r = gta_write_header_to_memory(header, &buffer, size, &capacity);
+    check(r == GTA_OK);
+    return buffer;
+}
+
+/* The same header read back from its encoding */
+static gta_header_t *decode_header(const void *buffer, size_t size)
+{
+    gta_header_t *header;
+    size_t offset = 0;
+    gta_result_t r = gta_create_header(&header);
+    check(r == GTA_OK);
+    r = gta_read_header_from_memory(header, buffer, size, &offset);
+    check(r == GTA_OK);
+    check(offset == size);
+    return header;
+}
+
+/* Every modification of a header or its tag lists must reach the encoded header cache */
+static void test_header_cache(void)
+{
+    gta_header_t *header;
+    gta_header_t *header2;
+    void *data;
+    void *buffer;
+    void *buffer2;
+    size_t size;
+    size_t size2;
+    gta_result_t r;
+
+    create_array(&header, &data, GTA_NONE);
+    gta_taglist_t *global_taglist = gta_get_global_taglist(header);
+    gta_taglist_t *dimension_taglist = gta_get_dimension_taglist(header, 1);
+
+    /* Writing an unchanged header twice gives the same result */
+    buffer = encode_header(header, &size);
+    buffer2 = encode_header(header, &size2);
+    check(size == size2 && memcmp(buffer, buffer2, size) == 0);
+    free(buffer2);
+
+    /* Tag lists that are modified through earlier pointers */
+    r = gta_set_tag(global_taglist, "DESCRIPTION", "changed");
+    check(r == GTA_OK);
+    buffer2 = encode_header(header, &size2);
+    header2 = decode_header(buffer2, size2);
+    check(strcmp(gta_get_tag(gta_get_global_taglist_const(header2), "DESCRIPTION"), "changed") == 0);
+    gta_destroy_header(header2);
+    free(buffer2);
+    gta_unset_all_tags(dimension_taglist);
+    buffer2 = encode_header(header, &size2);
+    header2 = decode_header(buffer2, size2);
+    check(gta_get_tags(gta_get_dimension_taglist_const(header2, 1)) == 0);
+    gta_destroy_header(header2);
+    free(buffer2);
+    r = gta_unset_tag(global_taglist, "DESCRIPTION");
+    check(r == GTA_OK);
+    r = gta_clone_taglist(dimension_taglist, gta_get_dimension_taglist_const(header, 0));
+    check(r == GTA_OK);
+    buffer2 = encode_header(header, &size2);
+    header2 = decode_header(buffer2, size2);
+    check(gta_get_tags(gta_get_global_taglist_const(header2)) == 0);
+    gta_destroy_header(header2);
+    free(buffer2);
+
+    /* Header properties */
+    gta_set_compression(header, GTA_ZLIB);
+    gta_set_filter(header, GTA_FILTER_DELTA);
+    buffer2 = encode_header(header, &size2);
+    header2 = decode_header(buffer2, size2);
+    check(gta_get_compression(header2) == GTA_ZLIB);
+    check(gta_get_filter(header2) == GTA_FILTER_DELTA);
+    gta_destroy_header(header2);
+    free(buffer2);
+    uintmax_t dims[] = { 7, 8, 9 };
+    r = gta_set_dimensions(header, 3, dims);
+    check(r == GTA_OK);
+    gta_type_t types[] = { GTA_INT8 };
+    r = gta_set_components(header, 1, types, NULL);
+    check(r == GTA_OK);
+    buffer2 = encode_header(header, &size2);
+    header2 = decode_header(buffer2, size2);
+    check(gta_get_dimensions(header2) == 3 && gta_get_dimension_size(header2, 2) == 9);
+    check(gta_get_components(header2) == 1 && gta_get_component_type(header2, 0) == GTA_INT8);
+
+    /* A clone and a header that was read are written like the original */
+    free(buffer);
+    buffer = encode_header(header2, &size);
+    check(size == size2 && memcmp(buffer, buffer2, size) == 0);
+    free(buffer);
+    r = gta_set_tag(gta_get_component_taglist(header, 0), "X", "Y");
+    check(r == GTA_OK);
+    r = gta_clone_header(header2, header);
+    check(r == GTA_OK);
+    buffer = encode_header(header, &size);
+    free(buffer2);
+    buffer2 = encode_header(header2, &size2);
+    check(size == size2 && memcmp(buffer, buffer2, size) == 0);
+    free(buffer2);
+    r = gta_set_tag(gta_get_component_taglist(header2, 0), "X", "Z");
+    check(r == GTA_OK);
+    buffer2 = encode_header(header2, &size2);
+    check(size == size2 && memcmp(buffer, buffer2, size) != 0);
+
+    gta_destroy_header(header2);
+    gta_destroy_header(header);
+    free(buffer2);
+    free(buffer);
+    free(data);
+}
+
+int main(void)
+{
+    test_header_cache();
+    test_memory(GTA_NONE);
+    test_memory(GTA_ZLIB);
+    test_memory(GTA_BZIP2);
+    test_memory(GTA_XZ);
+    return 0;
+}
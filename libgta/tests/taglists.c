@@ -36,6 +36,33 @@
         exit(1); \
     }
 
+/* Replace the first occurrence of a byte string in a file by another one of the same length */
+static void patch_file(const char *filename, const char *from, const char *to, size_t len)
+{
+    FILE *f = fopen(filename, "r+");
+    check(f);
+    check(fseek(f, 0, SEEK_END) == 0);
+    long size = ftell(f);
+    check(size > 0);
+    check(fseek(f, 0, SEEK_SET) == 0);
+    char *buf = malloc(size);
+    check(buf);
+    check(fread(buf, 1, size, f) == (size_t)size);
+    long pos = -1;
+    for (long i = 0; pos < 0 && i + (long)len <= size; i++)
+    {
+        if (memcmp(buf + i, from, len) == 0)
+        {
+            pos = i;
+        }
+    }
+    check(pos >= 0);
+    check(fseek(f, pos, SEEK_SET) == 0);
+    check(fwrite(to, 1, len, f) == len);
+    check(fclose(f) == 0);
+    free(buf);
+}
+
 int main(void)
 {
     gta_header_t *header;
@@ -224,6 +251,209 @@ int main(void)
     check(gta_set_tag(gtl, "name", "val\xf0\x80\x80\x80ue") == GTA_INVALID_DATA);
     check(gta_set_tag(gtl, "name", "val\xf0\x80\x80\x87ue") == GTA_INVALID_DATA);
     check(gta_set_tag(gtl, "name", "val\xf0\xbf\xbf\xbfue") == GTA_OK);
+    check(gta_set_tag(gtl, "name", "a long value with a control\x07" "character") == GTA_INVALID_DATA);
+    check(gta_set_tag(gtl, "a long tag name with an = sign", "value") == GTA_INVALID_DATA);
+    check(gta_set_tag(gtl, "name", "a long value that ends in a truncated sequence \xe2\x82") == GTA_INVALID_DATA);
+    check(gta_set_tag(gtl, "name", "a long value with an equal sign = and \xe2\x82\xac") == GTA_OK);
+
+    /* Read tags that span header chunk boundaries */
+    gta_header_t *header2;
+    r = gta_create_header(&header2);
+    check(r == GTA_OK);
+    size_t long_size = 20 * 1024 * 1024;
+    char *long_value = malloc(long_size + 1);
+    check(long_value);
+    for (size_t i = 0; i < long_size; i++)
+    {
+        long_value[i] = 'a' + i % 26;
+    }
+    long_value[long_size] = '\0';
+    memcpy(long_value + long_size - 6, "\xc3\xa4\xe2\x82\xac!", 6);
+    gtl = gta_get_global_taglist(header2);
+    r = gta_set_tag(gtl, "before", "x");
+    check(r == GTA_OK);
+    r = gta_set_tag(gtl, "long", long_value);
+    check(r == GTA_OK);
+    for (int i = 0; i < 1000; i++)
+    {
+        sprintf(namebuf, "after-%d", i);
+        sprintf(valbuf, "%d", i);
+        r = gta_set_tag(gtl, namebuf, valbuf);
+        check(r == GTA_OK);
+    }
+    f = fopen("test-taglists-long.tmp", "w");
+    check(f);
+    r = gta_write_header_to_stream(header2, f);
+    check(r == GTA_OK);
+    check(fclose(f) == 0);
+    gta_unset_all_tags(gtl);
+    f = fopen("test-taglists-long.tmp", "r");
+    check(f);
+    r = gta_read_header_from_stream(header2, f);
+    check(r == GTA_OK);
+    check(fclose(f) == 0);
+    gtl = gta_get_global_taglist(header2);
+    check(gta_get_tags(gtl) == 1002);
+    check(strcmp(gta_get_tag_name(gtl, 1), "long") == 0);
+    check(strcmp(gta_get_tag(gtl, "long"), long_value) == 0);
+    check(strcmp(gta_get_tag(gtl, "before"), "x") == 0);
+    check(strcmp(gta_get_tag(gtl, "after-999"), "999") == 0);
+    remove("test-taglists-long.tmp");
+    free(long_value);
+
+    /* Read a tag list in which a name occurs twice: the later value wins */
+    gta_unset_all_tags(gtl);
+    check(gta_set_tag(gtl, "dup", "first") == GTA_OK);
+    check(gta_set_tag(gtl, "mid", "m") == GTA_OK);
+    check(gta_set_tag(gtl, "dux", "second") == GTA_OK);
+    check(gta_set_tag(gtl, "end", "e") == GTA_OK);
+    check(gta_set_tag(gtl, "bad", "v") == GTA_OK);
+    f = fopen("test-taglists-dup.tmp", "w");
+    check(f);
+    r = gta_write_header_to_stream(header2, f);
+    check(r == GTA_OK);
+    check(fclose(f) == 0);
+    patch_file("test-taglists-dup.tmp", "dux", "dup", 4);
+    f = fopen("test-taglists-dup.tmp", "r");
+    check(f);
+    r = gta_read_header_from_stream(header2, f);
+    check(r == GTA_OK);
+    check(fclose(f) == 0);
+    gtl = gta_get_global_taglist(header2);
+    check(gta_get_tags(gtl) == 4);
+    check(strcmp(gta_get_tag_name(gtl, 0), "dup") == 0);
+    check(strcmp(gta_get_tag_value(gtl, 0), "second") == 0);
+    check(strcmp(gta_get_tag_name(gtl, 1), "mid") == 0);
+    check(strcmp(gta_get_tag_name(gtl, 2), "end") == 0);
+    check(strcmp(gta_get_tag_name(gtl, 3), "bad") == 0);
+    check(strcmp(gta_get_tag(gtl, "dup"), "second") == 0);
+    check(strcmp(gta_get_tag(gtl, "end"), "e") == 0);
+    check(gta_get_tag(gtl, "dux") == NULL);
+    check(gta_set_tag(gtl, "new", "n") == GTA_OK);
+    check(strcmp(gta_get_tag(gtl, "new"), "n") == 0);
+    check(gta_unset_tag(gtl, "dup") == GTA_OK);
+    check(gta_get_tags(gtl) == 4);
+    check(gta_get_tag(gtl, "dup") == NULL);
+    check(strcmp(gta_get_tag(gtl, "mid"), "m") == 0);
+
+    /* Reject invalid UTF-8 in a file */
+    patch_file("test-taglists-dup.tmp", "bad\0v", "bad\0\xff", 5);
+    f = fopen("test-taglists-dup.tmp", "r");
+    check(f);
+    r = gta_read_header_from_stream(header2, f);
+    check(r == GTA_INVALID_DATA);
+    check(fclose(f) == 0);
+    remove("test-taglists-dup.tmp");
+    gta_destroy_header(header2);
+
+    /* Set tags from values of the same tag list, and replace values often
+     * enough for the tag list to drop the old ones */
+    gta_taglist_t *tl;
+    r = gta_create_header(&header2);
+    check(r == GTA_OK);
+    tl = gta_get_global_taglist(header2);
+    check(gta_set_tag(tl, "source", "copied value") == GTA_OK);
+    for (int i = 0; i < 100; i++)
+    {
+        sprintf(namebuf, "copy-%d", i);
+        check(gta_set_tag(tl, namebuf, gta_get_tag(tl, "source")) == GTA_OK);
+    }
+    check(gta_set_tag(tl, gta_get_tag_name(tl, 50), gta_get_tag_value(tl, 0)) == GTA_OK);
+    for (int i = 0; i < 100; i++)
+    {
+        sprintf(namebuf, "copy-%d", i);
+        check(strcmp(gta_get_tag(tl, namebuf), "copied value") == 0);
+    }
+    for (int i = 0; i < 10000; i++)
+    {
+        sprintf(valbuf, "value-%d", i);
+        check(gta_set_tag(tl, "source", valbuf) == GTA_OK);
+        check(gta_set_tag(tl, "self", gta_get_tag(tl, "source")) == GTA_OK);
+    }
+    check(gta_get_tags(tl) == 102);
+    check(strcmp(gta_get_tag_name(tl, 0), "source") == 0);
+    check(strcmp(gta_get_tag_value(tl, 0), "value-9999") == 0);
+    check(strcmp(gta_get_tag_name(tl, 101), "self") == 0);
+    check(strcmp(gta_get_tag_value(tl, 101), "value-9999") == 0);
+
+    /* Unset tags and keep the order of the others */
+    for (int i = 0; i < 100; i += 2)
+    {
+        sprintf(namebuf, "copy-%d", i);
+        check(gta_unset_tag(tl, namebuf) == GTA_OK);
+        check(gta_get_tag(tl, namebuf) == NULL);
+    }
+    check(gta_get_tags(tl) == 52);
+    for (int i = 1; i < 100; i += 2)
+    {
+        sprintf(namebuf, "copy-%d", i);
+        check(strcmp(gta_get_tag_name(tl, 1 + i / 2), namebuf) == 0);
+        check(strcmp(gta_get_tag(tl, namebuf), "copied value") == 0);
+    }
+
+    /* Clone the tag list and the header, and check that the copies are
+     * independent and are written identically */
+    gta_header_t *header3;
+    r = gta_create_header(&header3);
+    check(r == GTA_OK);
+    r = gta_clone_header(header3, header2);
+    check(r == GTA_OK);
+    gta_taglist_t *tl3 = gta_get_global_taglist(header3);
+    check(gta_get_tags(tl3) == 52);
+    for (uintmax_t i = 0; i < gta_get_tags(tl); i++)
+    {
+        check(strcmp(gta_get_tag_name(tl3, i), gta_get_tag_name(tl, i)) == 0);
+        check(strcmp(gta_get_tag_value(tl3, i), gta_get_tag_value(tl, i)) == 0);
+        check(strcmp(gta_get_tag(tl3, gta_get_tag_name(tl, i)), gta_get_tag_value(tl, i)) == 0);
+    }
+    check(gta_set_tag(tl3, "source", "changed") == GTA_OK);
+    check(gta_set_tag(tl3, "added", "a") == GTA_OK);
+    check(strcmp(gta_get_tag(tl, "source"), "value-9999") == 0);
+    check(gta_get_tag(tl, "added") == NULL);
+    check(gta_clone_taglist(tl3, tl) == GTA_OK);
+    check(gta_get_tag(tl3, "added") == NULL);
+    f = fopen("test-taglists-clone.tmp", "w");
+    check(f);
+    r = gta_write_header_to_stream(header2, f);
+    check(r == GTA_OK);
+    r = gta_write_header_to_stream(header3, f);
+    check(r == GTA_OK);
+    check(fclose(f) == 0);
+    f = fopen("test-taglists-clone.tmp", "r");
+    check(f);
+    r = gta_read_header_from_stream(header3, f);
+    check(r == GTA_OK);
+    r = gta_read_header_from_stream(header3, f);
+    check(r == GTA_OK);
+    check(fgetc(f) == EOF);
+    check(fclose(f) == 0);
+    remove("test-taglists-clone.tmp");
+    tl3 = gta_get_global_taglist(header3);
+    check(gta_get_tags(tl3) == 52);
+    check(strcmp(gta_get_tag(tl3, "self"), "value-9999") == 0);
+    gta_destroy_header(header3);
+    /* Strings of a tag stay valid while other tags change */
+    const char *kept_name = gta_get_tag_name(tl, 0);
+    const char *kept_value = gta_get_tag_value(tl, 0);
+    for (int i = 0; i < 5000; i++)
+    {
+        snprintf(namebuf, sizeof(namebuf), "other-%d", i % 100);
+        snprintf(valbuf, sizeof(valbuf), "other value %d", i);
+        check(gta_set_tag(tl, namebuf, valbuf) == GTA_OK);
+        if (i % 3 == 0)
+        {
+            check(gta_unset_tag(tl, namebuf) == GTA_OK);
+        }
+    }
+    check(kept_name == gta_get_tag_name(tl, 0));
+    check(kept_value == gta_get_tag(tl, "source"));
+    check(strcmp(kept_name, "source") == 0);
+    check(strcmp(kept_value, "value-9999") == 0);
+    gta_unset_all_tags(tl);
+    check(gta_get_tags(tl) == 0);
+    check(gta_get_tag(tl, "source") == NULL);
+    check(gta_unset_tag(tl, "source") == GTA_OK);
+    gta_destroy_header(header2);
 
     gta_destroy_header(header);
 
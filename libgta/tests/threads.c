@@ -0,0 +1,233 @@
+/*
+ * threads.c
+ *
+ * This file is part of libgta, a library that implements the Generic Tagged
+ * Array (GTA) file format.
+ *
+ * Copyright (C) 2010, 2011
+ * Martin Lambers <marlam@marlam.de>
+ *
+ * Libgta is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 2.1 of the License, or (at your option)
+ * any later version.
+ *
+ * Libgta is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Libgta. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <gta/gta.h>
+
+#define check(condition) \
+    /* fprintf(stderr, "%s:%d: %s: Checking '%s'.\n", __FILE__, __LINE__, __PRETTY_FUNCTION__, #condition); */ \
+    if (!(condition)) \
+    { \
+        fprintf(stderr, "%s:%d: %s: Check '%s' failed.\n", \
+                __FILE__, __LINE__, __PRETTY_FUNCTION__, #condition); \
+        exit(1); \
+    }
+
+static void *read_file(const char *filename, size_t *size)
+{
+    FILE *f = fopen(filename, "r");
+    check(f);
+    check(fseek(f, 0, SEEK_END) == 0);
+    long s = ftell(f);
+    check(s > 0);
+    check(fseek(f, 0, SEEK_SET) == 0);
+    void *buf = malloc(s);
+    check(buf);
+    check(fread(buf, 1, s, f) == (size_t)s);
+    check(fclose(f) == 0);
+    *size = s;
+    return buf;
+}
+
+int main(void)
+{
+    gta_header_t *header;
+    gta_io_state_t *io_state;
+    gta_result_t r;
+    FILE *f;
+
+    r = gta_create_header(&header);
+    check(r == GTA_OK);
+    check(gta_get_compression_threads(header) == 0);
+
+    /* Define an array that needs three chunks: two full ones and a partial one */
+    gta_type_t types[] = { GTA_UINT32 };
+    r = gta_set_components(header, 1, types, NULL);
+    check(r == GTA_OK);
+    uintmax_t dims[] = { 11 * 1024 * 1024 };
+    r = gta_set_dimensions(header, 1, dims);
+    check(r == GTA_OK);
+    gta_set_compression(header, GTA_ZLIB1);
+    uintmax_t elements = gta_get_elements(header);
+    size_t data_size = gta_get_data_size(header);
+
+    /* Create the array data. The second chunk is not compressible. */
+    uint32_t *data = malloc(data_size);
+    check(data);
+    uint32_t x = 1;
+    for (uintmax_t i = 0; i < elements; i++)
+    {
+        x = x * 1664525 + 1013904223;
+        data[i] = (i >= 4 * 1024 * 1024 && i < 8 * 1024 * 1024) ? x : (uint32_t)(i / 3);
+    }
+
+    /* Write the data serially */
+    f = fopen("test-threads-serial.tmp", "w");
+    check(f);
+    r = gta_write_header_to_stream(header, f);
+    check(r == GTA_OK);
+    r = gta_write_data_to_stream(header, data, f);
+    check(r == GTA_OK);
+    check(fclose(f) == 0);
+
+    /* Write the data with parallel compression */
+    gta_set_compression_threads(header, 2);
+    check(gta_get_compression_threads(header) == 2);
+    f = fopen("test-threads-data.tmp", "w");
+    check(f);
+    r = gta_write_header_to_stream(header, f);
+    check(r == GTA_OK);
+    r = gta_write_data_to_stream(header, data, f);
+    check(r == GTA_OK);
+    check(fclose(f) == 0);
+
+    /* Write the elements with parallel compression, overriding the header setting */
+    r = gta_create_io_state(&io_state);
+    check(r == GTA_OK);
+    check(gta_get_io_state_compression_threads(io_state) == 0);
+    gta_set_io_state_compression_threads(io_state, 3);
+    check(gta_get_io_state_compression_threads(io_state) == 3);
+    f = fopen("test-threads-elements.tmp", "w");
+    check(f);
+    r = gta_write_header_to_stream(header, f);
+    check(r == GTA_OK);
+    uintmax_t written = 0;
+    uintmax_t n = 5 * 1024 * 1024;
+    while (written < elements)
+    {
+        if (n > elements - written)
+        {
+            n = elements - written;
+        }
+        r = gta_write_elements_to_stream(header, io_state, n, data + written, f);
+        check(r == GTA_OK);
+        written += n;
+        n = 123457;
+    }
+    check(fclose(f) == 0);
+    gta_destroy_io_state(io_state);
+
+    /* Check that all files are identical */
+    size_t serial_size, data_file_size, elements_file_size;
+    void *serial = read_file("test-threads-serial.tmp", &serial_size);
+    void *data_file = read_file("test-threads-data.tmp", &data_file_size);
+    void *elements_file = read_file("test-threads-elements.tmp", &elements_file_size);
+    check(data_file_size == serial_size);
+    check(memcmp(data_file, serial, serial_size) == 0);
+    check(elements_file_size == serial_size);
+    check(memcmp(elements_file, serial, serial_size) == 0);
+    free(serial);
+    free(data_file);
+    free(elements_file);
+
+    /* Read the data back */
+    gta_header_t *read_header;
+    r = gta_create_header(&read_header);
+    check(r == GTA_OK);
+    f = fopen("test-threads-elements.tmp", "r");
+    check(f);
+    r = gta_read_header_from_stream(read_header, f);
+    check(r == GTA_OK);
+    check(gta_get_data_size(read_header) == data_size);
+    uint32_t *read_data = malloc(data_size);
+    check(read_data);
+    r = gta_read_data_from_stream(read_header, read_data, f);
+    check(r == GTA_OK);
+    check(fclose(f) == 0);
+    check(memcmp(read_data, data, data_size) == 0);
+    free(read_data);
+    gta_destroy_header(read_header);
+
+    /* Read two consecutive GTAs with parallel decompression */
+    f = fopen("test-threads-two.tmp", "w");
+    check(f);
+    for (int k = 0; k < 2; k++)
+    {
+        r = gta_write_header_to_stream(header, f);
+        check(r == GTA_OK);
+        r = gta_write_data_to_stream(header, data, f);
+        check(r == GTA_OK);
+    }
+    check(fclose(f) == 0);
+    r = gta_create_header(&read_header);
+    check(r == GTA_OK);
+    gta_set_decompression_threads(read_header, 3);
+    f = fopen("test-threads-two.tmp", "r");
+    check(f);
+    r = gta_read_header_from_stream(read_header, f);
+    check(r == GTA_OK);
+    check(gta_get_decompression_threads(read_header) == 3);
+    read_data = malloc(data_size);
+    check(read_data);
+    r = gta_read_data_from_stream(read_header, read_data, f);
+    check(r == GTA_OK);
+    check(memcmp(read_data, data, data_size) == 0);
+    memset(read_data, 0, data_size);
+    gta_set_decompression_threads(read_header, 0);
+    r = gta_read_header_from_stream(read_header, f);
+    check(r == GTA_OK);
+    r = gta_create_io_state(&io_state);
+    check(r == GTA_OK);
+    gta_set_io_state_decompression_threads(io_state, 2);
+    check(gta_get_io_state_decompression_threads(io_state) == 2);
+    uintmax_t read = 0;
+    n = 1000003;
+    while (read < elements)
+    {
+        if (n > elements - read)
+        {
+            n = elements - read;
+        }
+        r = gta_read_elements_from_stream(read_header, io_state, n, read_data + read, f);
+        check(r == GTA_OK);
+        read += n;
+        if (read == 5 * n)
+        {
+            /* Continue with a clone of the state */
+            gta_io_state_t *clone;
+            r = gta_create_io_state(&clone);
+            check(r == GTA_OK);
+            r = gta_clone_io_state(clone, io_state);
+            check(r == GTA_OK);
+            gta_destroy_io_state(io_state);
+            io_state = clone;
+        }
+    }
+    gta_destroy_io_state(io_state);
+    check(memcmp(read_data, data, data_size) == 0);
+    check(fgetc(f) == EOF);
+    check(fclose(f) == 0);
+    free(read_data);
+    gta_destroy_header(read_header);
+
+    free(data);
+    gta_destroy_header(header);
+    remove("test-threads-serial.tmp");
+    remove("test-threads-data.tmp");
+    remove("test-threads-elements.tmp");
+    remove("test-threads-two.tmp");
+    return 0;
+}